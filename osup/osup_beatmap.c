@@ -8,7 +8,10 @@
 #ifdef OSUP_NO_LOGGING
 #define OSUP_BM_ERROR(...)
 #else
-#define OSUP_BM_ERROR(...) osup_error("[bm] " __VA_ARGS__)
+#define OSUP_BM_ERROR(...)                                      \
+  do {                                                          \
+    if (osup_has_error_callback()) osup_error("[bm] " __VA_ARGS__); \
+  } while (0)
 #endif
 
 typedef enum {
@@ -25,6 +28,19 @@ typedef enum {
   OSUP_BM_SECTION_HIT_OBJECTS
 } osup_bm_section;
 
+/* the OSUP_PARSE_* flag of every section, in osup_bm_section order */
+OSUP_STORAGE const osup_bitfield32 osup_bm_section_flags[] = {
+    OSUP_PARSE_GENERAL,    OSUP_PARSE_EDITOR, OSUP_PARSE_METADATA,
+    OSUP_PARSE_DIFFICULTY, OSUP_PARSE_COLORS, OSUP_PARSE_EVENTS,
+    OSUP_PARSE_TIMING_POINTS, OSUP_PARSE_HIT_OBJECTS};
+
+/* the capacities of the side tables of a hit object layout */
+typedef struct {
+  size_t sliders;
+  size_t endTimes;
+  size_t hitSamples;
+} osup_bm_side_capacity;
+
 typedef struct {
   char version[16]; /* should be more than enough to store the version */
   osup_bm_section section;
@@ -39,9 +55,91 @@ typedef struct {
   size_t timingpointCapacity;
   size_t colorComboCapacity;
   size_t hitObjectCapacity;
-
+  /* and for the hit object columns */
+  size_t columnCapacity;
+  osup_bm_side_capacity columnSides;
+  /* and for the compact hit objects */
+  size_t compactCapacity;
+  osup_bm_side_capacity compactSides;
+
+  /* where the map memory comes from, NULL means malloc */
+  osup_arena* arena;
+  /* OSUP_PARSE_STRING_VIEWS, strings are not copied */
+  osup_bool stringViews;
+
+  /* OSUP_PARSE_* flags of the sections we have already left, once every
+   * requested section is in here, the rest of the input can be ignored */
+  osup_bitfield32 closedSections;
+  /* false until the first section header */
+  osup_bool inSection;
+
+  /* records go to the visitor instead of the map */
+  const osup_bm_visitor* visitor;
+
+  /* OSUP_PARSE_STORYBOARD, the storyboard lines of [Events] go there, it has
+   * nothing to free since .osu files have no [Variables] */
+  osup_sb_parser storyboard;
+  /* a storyboard line was invalid, the storyboard is dropped and the rest of
+   * its lines are skipped */
+  osup_bool storyboardFailed;
 } osup_bm_ctx;
 
+/* allocation helpers, everything the parsers put in the map goes through
+ * these */
+OSUP_INTERN void* osup_bm_malloc(osup_bm_ctx* ctx, size_t size) {
+  return ctx->arena ? osup_arena_alloc(ctx->arena, size) : malloc(size);
+}
+
+OSUP_INTERN void* osup_bm_realloc(osup_bm_ctx* ctx, void* ptr, size_t oldSize,
+                                  size_t newSize) {
+  return ctx->arena ? osup_arena_realloc(ctx->arena, ptr, oldSize, newSize)
+                    : realloc(ptr, newSize);
+}
+
+OSUP_INTERN osup_bool osup_bm_strdup(osup_bm_ctx* ctx, const char* begin,
+                                     const char* end, char** value) {
+  return ctx->arena ? osup_arena_strdup(ctx->arena, begin, end, value)
+                    : osup_strdup(begin, end, value);
+}
+
+/* store a string field, either as a copy + a view of the copy, or only as a
+ * view into the input with OSUP_PARSE_STRING_VIEWS */
+OSUP_INTERN osup_bool osup_bm_store_string(osup_bm_ctx* ctx, const char* begin,
+                                           const char* end, char** value,
+                                           osup_slice* view) {
+  if (ctx->stringViews) {
+    view->begin = begin;
+    view->end = end;
+    return osup_true;
+  }
+  if (!osup_bm_strdup(ctx, begin, end, value)) {
+    return osup_false;
+  }
+  view->begin = *value;
+  view->end = *value + (end - begin);
+  return osup_true;
+}
+
+/* every requested section has been parsed, no need to read further */
+OSUP_INTERN osup_bool osup_bm_is_done(const osup_bm_ctx* ctx) {
+  return !(ctx->parseFlags & OSUP_PARSE_ALL & ~ctx->closedSections);
+}
+
+OSUP_INTERN void osup_bm_init_ctx(osup_bm_ctx* ctx, osup_bm* map,
+                                  osup_bitfield32 flags) {
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->map = map;
+  ctx->parseFlags = flags;
+  if (flags & OSUP_PARSE_ARENA) {
+    ctx->arena = &map->arena;
+  }
+  ctx->stringViews = (flags & OSUP_PARSE_STRING_VIEWS) != 0;
+  if (flags & OSUP_PARSE_STORYBOARD) {
+    osup_sb_parser_init(&ctx->storyboard, &map->storyboard, ctx->arena,
+                        ctx->stringViews);
+  }
+}
+
 static osup_bool osup_check_version(osup_bm_ctx* ctx) {
   /* only v14 is supported for the time being */
   return !strcmp(ctx->version, "14");
@@ -61,39 +159,6 @@ static osup_bool osup_check_prefix_and_advance(const char** string,
   return osup_true;
 }
 
-/* advance line pointer to the first char of next line, or at the null
- * terminator if this is the last line, also check for non-blank character if
- * checkForNonBlankChar is true */
-OSUP_INTERN osup_bool
-osup_advance_to_next_line(const char** line, osup_bool checkForNonBlankChar) {
-  while (osup_true) {
-    if (**line == '\0') {
-      return osup_true;
-    } else if (**line == '\r' || **line == '\n') {
-      ++(*line);
-      return osup_true;
-    } else if (checkForNonBlankChar && !isblank(**line)) {
-      return osup_false;
-    } else {
-      ++(*line);
-    }
-  }
-}
-
-/* advance line pointer to AFTER the last non-blank character of line, and
- * return the line-terminating character (one of '\0', '\r' and '\n') */
-OSUP_INTERN const char* osup_advance_to_last_nonblank_char(const char** line) {
-  const char* it = *line;
-  while (!osup_is_line_terminator(*it)) {
-    if (isblank(*it)) {
-      ++it;
-    } else {
-      *line = ++it;
-    }
-  }
-  return it;
-}
-
 /*********************************************
  * HELPER MACROS FOR PARSING KEY-VALUE LINES *
  *********************************************/
@@ -163,6 +228,46 @@ OSUP_INTERN osup_bool osup_bm_parse_general_line(osup_bm_ctx* ctx,
 }
 #endif
 
+/* split "Key: value", "Key:value" or "Key : value", *line is left at the
+ * first character of the value */
+OSUP_INTERN osup_bool osup_bm_split_key(const char** line,
+                                        size_t* keyLength) {
+  const char* it = *line;
+  /* keys are short, a plain loop beats the scanners here, and key characters
+   * are never below ' ' so the terminators cost one compare in the loop */
+  while (*it != ':') {
+    if ((unsigned char)*it < ' ' && (*it == '\n' || *it == '\r' || !*it)) {
+      return osup_false;
+    }
+    ++it;
+  }
+  const char* keyEnd = it;
+  while (keyEnd > *line && (keyEnd[-1] == ' ' || keyEnd[-1] == '\t')) {
+    --keyEnd;
+  }
+  ++it;
+  while (*it == ' ' || *it == '\t') ++it;
+  *keyLength = (size_t)(keyEnd - *line);
+  *line = it;
+  return osup_true;
+}
+
+/* every key-value parser first gets the key, then switches on its length and
+ * only compares the keys with that length (and the same first character), so
+ * one line costs one memcmp at most */
+#define OSUP_BM_KV_GET_KEY(sectionName)                                \
+  const char* keyBegin = *line;                                        \
+  size_t keyLength;                                                    \
+  if (!osup_bm_split_key(line, &keyLength)) {                          \
+    OSUP_BM_ERROR("invalid " sectionName " line: %s",                  \
+                  osup_temp_string_slice_line_terminated(keyBegin));   \
+    return osup_false;                                                 \
+  }
+
+#define OSUP_BM_KV_IS_KEY(key)                                        \
+  (keyLength == sizeof(key) - 1 && *keyBegin == *(key) &&             \
+   !memcmp(keyBegin, key, sizeof(key) - 1))
+
 /* advance valueEnd pointer to the end of value */
 #define OSUP_BM_KV_GET_VALUE()    \
   const char* valueEnd = *line;   \
@@ -170,20 +275,22 @@ OSUP_INTERN osup_bool osup_bm_parse_general_line(osup_bm_ctx* ctx,
   *line = osup_advance_to_last_nonblank_char(&valueEnd)
 
 /* parse macros */
-#define OSUP_BM_KV_PARSE_STRING(prefix, member)                      \
-  if (osup_check_prefix_and_advance(line, prefix)) {                 \
+#define OSUP_BM_KV_PARSE_STRING(key, member)                      \
+  if (OSUP_BM_KV_IS_KEY(key)) {                        \
     OSUP_BM_KV_GET_VALUE();                                          \
-    if (!osup_strdup(valueBegin, valueEnd, &ctx->map->member)) {     \
+    if (!osup_bm_store_string(ctx, valueBegin, valueEnd,             \
+                              &ctx->map->member,                     \
+                              &ctx->map->member##View)) {            \
       OSUP_BM_ERROR("osup_strdup returns false, malloc length: %zu", \
-                    (size_t)(valueEnd - *valueBegin));               \
+                    (size_t)(valueEnd - valueBegin));                \
       return osup_false;                                             \
     } else {                                                         \
       return osup_true;                                              \
     }                                                                \
   }
 
-#define OSUP_BM_KV_PARSE_INT(prefix, member)                           \
-  if (osup_check_prefix_and_advance(line, prefix)) {                   \
+#define OSUP_BM_KV_PARSE_INT(key, member)                           \
+  if (OSUP_BM_KV_IS_KEY(key)) {                          \
     OSUP_BM_KV_GET_VALUE();                                            \
     if (!osup_parse_int(valueBegin, valueEnd, &ctx->map->member)) {    \
       OSUP_BM_ERROR("osup_parse_int returns false, parsed string: %s", \
@@ -194,8 +301,8 @@ OSUP_INTERN osup_bool osup_bm_parse_general_line(osup_bm_ctx* ctx,
     }                                                                  \
   }
 
-#define OSUP_BM_KV_PARSE_BOOL(prefix, member)                           \
-  if (osup_check_prefix_and_advance(line, prefix)) {                    \
+#define OSUP_BM_KV_PARSE_BOOL(key, member)                           \
+  if (OSUP_BM_KV_IS_KEY(key)) {                           \
     OSUP_BM_KV_GET_VALUE();                                             \
     if (!osup_parse_bool(valueBegin, valueEnd, &ctx->map->member)) {    \
       OSUP_BM_ERROR("osup_parse_bool returns false, parsed string: %s", \
@@ -206,8 +313,8 @@ OSUP_INTERN osup_bool osup_bm_parse_general_line(osup_bm_ctx* ctx,
     }                                                                   \
   }
 
-#define OSUP_BM_KV_PARSE_DECIMAL(prefix, member)                           \
-  if (osup_check_prefix_and_advance(line, prefix)) {                       \
+#define OSUP_BM_KV_PARSE_DECIMAL(key, member)                           \
+  if (OSUP_BM_KV_IS_KEY(key)) {                              \
     OSUP_BM_KV_GET_VALUE();                                                \
     if (!osup_parse_decimal(valueBegin, valueEnd, &ctx->map->member)) {    \
       OSUP_BM_ERROR("osup_parse_decimal returns false, parsed string: %s", \
@@ -217,8 +324,8 @@ OSUP_INTERN osup_bool osup_bm_parse_general_line(osup_bm_ctx* ctx,
       return osup_true;                                                    \
     }                                                                      \
   }
-#define OSUP_BM_KV_PARSE_RGB(prefix, member)                           \
-  if (osup_check_prefix_and_advance(line, prefix)) {                   \
+#define OSUP_BM_KV_PARSE_RGB(key, member)                           \
+  if (OSUP_BM_KV_IS_KEY(key)) {                          \
     OSUP_BM_KV_GET_VALUE();                                            \
     if (!osup_parse_rgb(valueBegin, valueEnd, &ctx->map->member)) {    \
       OSUP_BM_ERROR("osup_parse_rgb returns false, parsed string: %s", \
@@ -229,8 +336,8 @@ OSUP_INTERN osup_bool osup_bm_parse_general_line(osup_bm_ctx* ctx,
     }                                                                  \
   }
 
-#define OSUP_BM_KV_PARSE_INT_ENUM(prefix, member, minEnum, maxEnum)            \
-  if (osup_check_prefix_and_advance(line, prefix)) {                           \
+#define OSUP_BM_KV_PARSE_INT_ENUM(key, member, minEnum, maxEnum)            \
+  if (OSUP_BM_KV_IS_KEY(key)) {                                  \
     OSUP_BM_KV_GET_VALUE();                                                    \
     osup_int enumValue;                                                        \
     if (!osup_parse_int(valueBegin, valueEnd, &enumValue) ||                   \
@@ -258,61 +365,86 @@ OSUP_INTERN osup_bool osup_bm_parse_general_line(osup_bm_ctx* ctx,
   if (!(ctx->parseFlags & OSUP_PARSE_GENERAL)) {
     return osup_advance_to_next_line(line, osup_false);
   }
-  const char* valueEnd;
-  osup_int enumValue;
-  OSUP_BM_KV_PARSE_STRING("AudioFilename: ", general.audioFilename);
-  OSUP_BM_KV_PARSE_INT("AudioLeadIn: ", general.audioLeadIn);
-  OSUP_BM_KV_PARSE_STRING("AudioHash: ", general.audioHash);
-  OSUP_BM_KV_PARSE_INT("PreviewTime: ", general.previewTime);
-  OSUP_BM_KV_PARSE_INT_ENUM("Countdown: ", general.countdown,
-                            OSUP_COUNTDOWN_SPEED_NONE,
-                            OSUP_COUNTDOWN_SPEED_DOUBLE);
-  OSUP_BM_KV_PARSE_DECIMAL("StackLeniency: ", general.stackLeniency);
-  OSUP_BM_KV_PARSE_INT_ENUM("Mode: ", general.mode, OSUP_MODE_OSU,
-                            OSUP_MODE_MANIA);
-  OSUP_BM_KV_PARSE_BOOL("LetterboxInBreaks: ", general.letterboxInBreaks);
-  OSUP_BM_KV_PARSE_BOOL("StoryFireInFront: ", general.storyFireInFront);
-  OSUP_BM_KV_PARSE_BOOL("UseSkinSprites: ", general.useSkinSprites);
-  OSUP_BM_KV_PARSE_BOOL("AlwaysShowPlayfield: ", general.alwaysShowPlayfield);
-  OSUP_BM_KV_PARSE_STRING("SkinPreference: ", general.skinPreference);
-  OSUP_BM_KV_PARSE_BOOL("EpilepsyWarning: ", general.epilepsyWarning);
-  OSUP_BM_KV_PARSE_INT("CountdownOffset: ", general.countdownOffset);
-  OSUP_BM_KV_PARSE_BOOL("SpecialStyle: ", general.specialStyle);
-  OSUP_BM_KV_PARSE_BOOL("WidescreenStoryboard: ", general.widescreenStoryboard);
-  OSUP_BM_KV_PARSE_BOOL("SamplesMatchPlaybackRate: ",
-                        general.samplesMatchPlaybackRate);
-
-  if (osup_check_prefix_and_advance(line, "SampleSet: ")) {
-    OSUP_BM_KV_GET_VALUE();
-    /* the specs wtf */
-    OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "None",
-                                 OSUP_SAMPLESET_DEFAULT);
-    OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "Normal",
-                                 OSUP_SAMPLESET_NORMAL);
-    OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "Soft",
-                                 OSUP_SAMPLESET_SOFT);
-    OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "Drum",
-                                 OSUP_SAMPLESET_DRUM);
-    OSUP_BM_ERROR("invalid SampleSet option: %s",
-                  osup_temp_string_slice(valueBegin, valueEnd));
-    return osup_false;
-  }
-
-  if (osup_check_prefix_and_advance(line, "OverlayPosition: ")) {
-    OSUP_BM_KV_GET_VALUE();
-    OSUP_BM_KV_CHECK_STRING_ENUM(general.overlayPosition, "NoChange",
-                                 OSUP_OVERLAYPOS_NOCHANGE);
-    OSUP_BM_KV_CHECK_STRING_ENUM(general.overlayPosition, "Below",
-                                 OSUP_OVERLAYPOS_BELOW);
-    OSUP_BM_KV_CHECK_STRING_ENUM(general.overlayPosition, "Above",
-                                 OSUP_OVERLAYPOS_ABOVE);
-    OSUP_BM_ERROR("invalid OverlayPosition option: %s",
-                  osup_temp_string_slice(valueBegin, valueEnd));
-    return osup_false;
+  OSUP_BM_KV_GET_KEY("[General]");
+  switch (keyLength) {
+    case 4:
+      OSUP_BM_KV_PARSE_INT_ENUM("Mode", general.mode, OSUP_MODE_OSU,
+                                OSUP_MODE_MANIA);
+      break;
+    case 9:
+      OSUP_BM_KV_PARSE_STRING("AudioHash", general.audioHash);
+      OSUP_BM_KV_PARSE_INT_ENUM("Countdown", general.countdown,
+                                OSUP_COUNTDOWN_SPEED_NONE,
+                                OSUP_COUNTDOWN_SPEED_DOUBLE);
+      if (OSUP_BM_KV_IS_KEY("SampleSet")) {
+        OSUP_BM_KV_GET_VALUE();
+        /* the specs wtf */
+        OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "None",
+                                     OSUP_SAMPLESET_DEFAULT);
+        OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "Normal",
+                                     OSUP_SAMPLESET_NORMAL);
+        OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "Soft",
+                                     OSUP_SAMPLESET_SOFT);
+        OSUP_BM_KV_CHECK_STRING_ENUM(general.sampleSet, "Drum",
+                                     OSUP_SAMPLESET_DRUM);
+        OSUP_BM_ERROR("invalid SampleSet option: %s",
+                      osup_temp_string_slice(valueBegin, valueEnd));
+        return osup_false;
+      }
+      break;
+    case 11:
+      OSUP_BM_KV_PARSE_INT("AudioLeadIn", general.audioLeadIn);
+      OSUP_BM_KV_PARSE_INT("PreviewTime", general.previewTime);
+      break;
+    case 12:
+      OSUP_BM_KV_PARSE_BOOL("SpecialStyle", general.specialStyle);
+      break;
+    case 13:
+      OSUP_BM_KV_PARSE_STRING("AudioFilename", general.audioFilename);
+      OSUP_BM_KV_PARSE_DECIMAL("StackLeniency", general.stackLeniency);
+      break;
+    case 14:
+      OSUP_BM_KV_PARSE_BOOL("UseSkinSprites", general.useSkinSprites);
+      OSUP_BM_KV_PARSE_STRING("SkinPreference", general.skinPreference);
+      break;
+    case 15:
+      OSUP_BM_KV_PARSE_BOOL("EpilepsyWarning", general.epilepsyWarning);
+      OSUP_BM_KV_PARSE_INT("CountdownOffset", general.countdownOffset);
+      if (OSUP_BM_KV_IS_KEY("OverlayPosition")) {
+        OSUP_BM_KV_GET_VALUE();
+        OSUP_BM_KV_CHECK_STRING_ENUM(general.overlayPosition, "NoChange",
+                                     OSUP_OVERLAYPOS_NOCHANGE);
+        OSUP_BM_KV_CHECK_STRING_ENUM(general.overlayPosition, "Below",
+                                     OSUP_OVERLAYPOS_BELOW);
+        OSUP_BM_KV_CHECK_STRING_ENUM(general.overlayPosition, "Above",
+                                     OSUP_OVERLAYPOS_ABOVE);
+        OSUP_BM_ERROR("invalid OverlayPosition option: %s",
+                      osup_temp_string_slice(valueBegin, valueEnd));
+        return osup_false;
+      }
+      break;
+    case 16:
+      OSUP_BM_KV_PARSE_BOOL("StoryFireInFront", general.storyFireInFront);
+      break;
+    case 17:
+      OSUP_BM_KV_PARSE_BOOL("LetterboxInBreaks", general.letterboxInBreaks);
+      break;
+    case 19:
+      OSUP_BM_KV_PARSE_BOOL("AlwaysShowPlayfield",
+                            general.alwaysShowPlayfield);
+      break;
+    case 20:
+      OSUP_BM_KV_PARSE_BOOL("WidescreenStoryboard",
+                            general.widescreenStoryboard);
+      break;
+    case 24:
+      OSUP_BM_KV_PARSE_BOOL("SamplesMatchPlaybackRate",
+                            general.samplesMatchPlaybackRate);
+      break;
   }
 
   OSUP_BM_ERROR("invalid line in [General] section: %s",
-                osup_temp_string_slice_line_terminated(*line));
+                osup_temp_string_slice_line_terminated(keyBegin));
   return osup_false;
 }
 
@@ -321,12 +453,23 @@ OSUP_INTERN osup_bool osup_bm_parse_editor_line(osup_bm_ctx* ctx,
   if (!(ctx->parseFlags & OSUP_PARSE_EDITOR)) {
     return osup_advance_to_next_line(line, osup_false);
   }
-  OSUP_BM_KV_PARSE_DECIMAL("DistanceSpacing: ", editor.distanceSpacing);
-  OSUP_BM_KV_PARSE_DECIMAL("BeatDivisor: ", editor.beatDivisor);
-  OSUP_BM_KV_PARSE_DECIMAL("TimelineZoom: ", editor.timelineZoom);
-  OSUP_BM_KV_PARSE_INT("GridSize: ", editor.gridSize);
+  OSUP_BM_KV_GET_KEY("[Editor]");
+  switch (keyLength) {
+    case 8:
+      OSUP_BM_KV_PARSE_INT("GridSize", editor.gridSize);
+      break;
+    case 11:
+      OSUP_BM_KV_PARSE_DECIMAL("BeatDivisor", editor.beatDivisor);
+      break;
+    case 12:
+      OSUP_BM_KV_PARSE_DECIMAL("TimelineZoom", editor.timelineZoom);
+      break;
+    case 15:
+      OSUP_BM_KV_PARSE_DECIMAL("DistanceSpacing", editor.distanceSpacing);
+      break;
+  }
 
-  if (osup_check_prefix_and_advance(line, "Bookmarks: ")) {
+  if (OSUP_BM_KV_IS_KEY("Bookmarks")) {
     OSUP_BM_KV_GET_VALUE();
     /* this is a comma-separated list of int */
     size_t elementCount = 1;
@@ -338,14 +481,20 @@ OSUP_INTERN osup_bool osup_bm_parse_editor_line(osup_bm_ctx* ctx,
       }
     }
     ctx->map->editor.bookmarks.elements =
-        malloc(elementCount * sizeof(osup_int));
+        osup_bm_malloc(ctx, elementCount * sizeof(osup_int));
+    if (!ctx->map->editor.bookmarks.elements) {
+      OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
+                    elementCount * sizeof(osup_int));
+      return osup_false;
+    }
     ctx->map->editor.bookmarks.count = elementCount;
     size_t index = 0;
     const char* elementBegin = NULL;
     const char* elementEnd = valueBegin - 1;
-    while (osup_split_string(',', &elementBegin, &elementEnd, valueEnd)) {
+    while (index < elementCount &&
+           osup_split_string(',', &elementBegin, &elementEnd, valueEnd)) {
       if (!osup_parse_int(elementBegin, elementEnd,
-                          &ctx->map->editor.bookmarks.elements[index])) {
+                          &ctx->map->editor.bookmarks.elements[index++])) {
         OSUP_BM_ERROR("invalid Bookmark value: %s",
                       osup_temp_string_slice(elementBegin, elementEnd));
         return osup_false;
@@ -355,7 +504,7 @@ OSUP_INTERN osup_bool osup_bm_parse_editor_line(osup_bm_ctx* ctx,
   }
 
   OSUP_BM_ERROR("invalid [Editor] line: %s",
-                osup_temp_string_slice_line_terminated(*line));
+                osup_temp_string_slice_line_terminated(keyBegin));
   return osup_false;
 }
 
@@ -364,65 +513,88 @@ OSUP_INTERN osup_bool osup_bm_parse_metadata_line(osup_bm_ctx* ctx,
   if (!(ctx->parseFlags & OSUP_PARSE_METADATA)) {
     return osup_advance_to_next_line(line, osup_false);
   }
-  OSUP_BM_KV_PARSE_STRING("Title:", metadata.title);
-  OSUP_BM_KV_PARSE_STRING("TitleUnicode:", metadata.titleUnicode);
-  OSUP_BM_KV_PARSE_STRING("Artist:", metadata.artist);
-  OSUP_BM_KV_PARSE_STRING("ArtistUnicode:", metadata.artistUnicode);
-  OSUP_BM_KV_PARSE_STRING("Creator:", metadata.creator);
-  OSUP_BM_KV_PARSE_STRING("Version:", metadata.version);
-  OSUP_BM_KV_PARSE_STRING("Source:", metadata.source);
-  OSUP_BM_KV_PARSE_STRING("Title:", metadata.title);
-  OSUP_BM_KV_PARSE_INT("BeatmapID:", metadata.beatmapID);
-  OSUP_BM_KV_PARSE_INT("BeatmapSetID:", metadata.beatmapSetID);
-
-  if (osup_check_prefix_and_advance(line, "Tags:")) {
+  OSUP_BM_KV_GET_KEY("[Metadata]");
+  switch (keyLength) {
+    case 5:
+      OSUP_BM_KV_PARSE_STRING("Title", metadata.title);
+      break;
+    case 6:
+      OSUP_BM_KV_PARSE_STRING("Artist", metadata.artist);
+      OSUP_BM_KV_PARSE_STRING("Source", metadata.source);
+      break;
+    case 7:
+      OSUP_BM_KV_PARSE_STRING("Creator", metadata.creator);
+      OSUP_BM_KV_PARSE_STRING("Version", metadata.version);
+      break;
+    case 9:
+      OSUP_BM_KV_PARSE_INT("BeatmapID", metadata.beatmapID);
+      break;
+    case 12:
+      OSUP_BM_KV_PARSE_STRING("TitleUnicode", metadata.titleUnicode);
+      OSUP_BM_KV_PARSE_INT("BeatmapSetID", metadata.beatmapSetID);
+      break;
+    case 13:
+      OSUP_BM_KV_PARSE_STRING("ArtistUnicode", metadata.artistUnicode);
+      break;
+  }
+
+  if (OSUP_BM_KV_IS_KEY("Tags")) {
     OSUP_BM_KV_GET_VALUE();
-    char* tags;
-    char* tagsEnd = valueEnd - valueBegin + tags;
-    if (!osup_strdup(valueBegin, valueEnd, &tags)) {
-      OSUP_BM_ERROR("osup_strdup returns false, malloc length: %zu",
-                    (size_t)(valueEnd - valueBegin));
-      return osup_false;
+    /* the input can't be split in place, users have to split the view */
+    if (ctx->stringViews) {
+      ctx->map->metadata.tagsView.begin = valueBegin;
+      ctx->map->metadata.tagsView.end = valueEnd;
+      return osup_true;
     }
-    /* since beatmap tags is a space-separated list of strings, we can just
-     * replace all space with '\0' and we got a bunch of null-terminated strings
-     */
-    char* it = tags;
+    /* since beatmap tags is a space-separated list of strings, a copy of the
+     * list where every space is replaced by '\0' is a bunch of null-terminated
+     * strings, it is stored right after the copy the view points at, so both
+     * are one allocation */
+    size_t length = (size_t)(valueEnd - valueBegin);
     size_t tagCount = 1;
-    while (*it) {
-      if (*it == ' ') {
-        *it = '\0';
-        tagCount++;
-      }
-      ++it;
+    const char* it = valueBegin;
+    while (it < valueEnd) {
+      if (*(it++) == ' ') tagCount++;
     }
 
     /* allocating memory */
-    ctx->map->metadata.tags.elements = malloc(tagCount * sizeof(char*));
-    ctx->map->metadata.tags.count = tagCount;
+    ctx->map->metadata.tags.elements =
+        osup_bm_malloc(ctx, tagCount * sizeof(char*));
     if (!ctx->map->metadata.tags.elements) {
       OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
                     tagCount * sizeof(char*));
       return osup_false;
     }
+    char* tags = osup_bm_malloc(ctx, 2 * (length + 1));
+    if (!tags) {
+      OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu", 2 * (length + 1));
+      return osup_false;
+    }
+    memcpy(tags, valueBegin, length);
+    tags[length] = '\0';
+    ctx->map->metadata.tagsView.begin = tags;
+    ctx->map->metadata.tagsView.end = tags + length;
+    ctx->map->metadata.tags.count = tagCount;
 
-    /* re-iterating to populated allocated memory  */
-    it = tags;
+    /* populate the elements while splitting the second copy */
+    char* split = tags + length + 1;
     size_t index = 0;
-    while (index < tagCount) {
-      /* add pointers to first character to list */
-      ctx->map->metadata.tags.elements[index++] = it;
-      /* skip all non-'\0' characters */
-      while (*it) ++it;
-      /* go to the first character of next token */
-      ++it;
+    ctx->map->metadata.tags.elements[index++] = split;
+    for (it = valueBegin; it < valueEnd; it++, split++) {
+      if (*it == ' ') {
+        *split = '\0';
+        ctx->map->metadata.tags.elements[index++] = split + 1;
+      } else {
+        *split = *it;
+      }
     }
+    *split = '\0';
 
     return osup_true;
   }
 
   OSUP_BM_ERROR("invalid [Metadata] line: %s",
-                osup_temp_string_slice_line_terminated(*line));
+                osup_temp_string_slice_line_terminated(keyBegin));
   return osup_false;
 }
 
@@ -431,14 +603,31 @@ OSUP_INTERN osup_bool osup_bm_parse_difficulty_line(osup_bm_ctx* ctx,
   if (!(ctx->parseFlags & OSUP_PARSE_DIFFICULTY)) {
     return osup_advance_to_next_line(line, osup_false);
   }
-  OSUP_BM_KV_PARSE_DECIMAL("HPDrainRate:", difficulty.hpDrainRate);
-  OSUP_BM_KV_PARSE_DECIMAL("CircleSize:", difficulty.circleSize);
-  OSUP_BM_KV_PARSE_DECIMAL("OverallDifficulty:", difficulty.overallDifficulty);
-  OSUP_BM_KV_PARSE_DECIMAL("ApproachRate:", difficulty.approachRate);
-  OSUP_BM_KV_PARSE_DECIMAL("SliderMultiplier:", difficulty.sliderMultiplier);
-  OSUP_BM_KV_PARSE_DECIMAL("SliderTickRate:", difficulty.sliderTickRate);
+  OSUP_BM_KV_GET_KEY("[Difficulty]");
+  switch (keyLength) {
+    case 10:
+      OSUP_BM_KV_PARSE_DECIMAL("CircleSize", difficulty.circleSize);
+      break;
+    case 11:
+      OSUP_BM_KV_PARSE_DECIMAL("HPDrainRate", difficulty.hpDrainRate);
+      break;
+    case 12:
+      OSUP_BM_KV_PARSE_DECIMAL("ApproachRate", difficulty.approachRate);
+      break;
+    case 14:
+      OSUP_BM_KV_PARSE_DECIMAL("SliderTickRate", difficulty.sliderTickRate);
+      break;
+    case 16:
+      OSUP_BM_KV_PARSE_DECIMAL("SliderMultiplier",
+                               difficulty.sliderMultiplier);
+      break;
+    case 17:
+      OSUP_BM_KV_PARSE_DECIMAL("OverallDifficulty",
+                               difficulty.overallDifficulty);
+      break;
+  }
   OSUP_BM_ERROR("invalid [Difficulty] line: %s",
-                osup_temp_string_slice_line_terminated(*line));
+                osup_temp_string_slice_line_terminated(keyBegin));
   return osup_false;
 }
 
@@ -512,7 +701,8 @@ OSUP_INTERN osup_bool osup_bm_parse_events_line(osup_bm_ctx* ctx,
       const char* valueEnd;
       if (!osup_split_string_line_terminated_quoted(',', &elementBegin,
                                                     &valueEnd, &elementEnd) ||
-          !osup_strdup(elementBegin, valueEnd, &event->bg.filename)) {
+          !osup_bm_store_string(ctx, elementBegin, valueEnd,
+                                &event->bg.filename, &event->bg.filenameView)) {
         OSUP_BM_ERROR(
             "couldn't get filename from background/video [Events] line: "
             "%s",
@@ -635,42 +825,39 @@ OSUP_INTERN osup_bool osup_bm_parse_colors_line(osup_bm_ctx* ctx,
   if (!(ctx->parseFlags & OSUP_PARSE_COLORS)) {
     return osup_advance_to_next_line(line, osup_false);
   }
-  OSUP_BM_KV_PARSE_RGB("SliderTrackOverride : ", colors.sliderTrackOverride);
-  OSUP_BM_KV_PARSE_RGB("SliderBorder : ", colors.sliderBorder);
-  if (osup_check_prefix_and_advance(line, "Combo")) {
-    size_t combo = 0;
-    if(**line >= '1' && **line <= '8') {
-      combo = **line - '1';
-    } else {
-      OSUP_BM_ERROR("expected digit");
-      return osup_false;
-    }
-    osup_rgb value;
-    if (!osup_check_prefix_and_advance(line, " : ")) {
-      OSUP_BM_ERROR("expected sequence ' : ': %s", *line);
-      return osup_false;
-    }
-
-    OSUP_BM_KV_GET_VALUE();
-    if (!osup_parse_rgb(valueBegin, valueEnd,
-                        &ctx->map->colors.combos[combo])) {
-      OSUP_BM_ERROR("combo color parsing error, parsed string: %s", *line);
-      return osup_false;
-    } else {
-      if (ctx->map->colors.maxCombo < combo) {
-        ctx->map->colors.maxCombo = combo;
+  OSUP_BM_KV_GET_KEY("[Colours]");
+  switch (keyLength) {
+    case 6:
+      /* Combo1 to Combo8 */
+      if (!memcmp(keyBegin, "Combo", sizeof("Combo") - 1)) {
+        if (keyBegin[5] < '1' || keyBegin[5] > '8') {
+          OSUP_BM_ERROR("expected digit");
+          return osup_false;
+        }
+        size_t combo = keyBegin[5] - '1';
+        OSUP_BM_KV_GET_VALUE();
+        if (!osup_parse_rgb(valueBegin, valueEnd,
+                            &ctx->map->colors.combos[combo])) {
+          OSUP_BM_ERROR("combo color parsing error, parsed string: %s",
+                        osup_temp_string_slice(valueBegin, valueEnd));
+          return osup_false;
+        }
+        if (ctx->map->colors.maxCombo < combo) {
+          ctx->map->colors.maxCombo = combo;
+        }
+        return osup_true;
       }
-      return osup_true;
-    }
-  }
-
-  if (!osup_advance_to_next_line(line, osup_true)) {
-    OSUP_BM_ERROR("unexpected token(s) in [Colours] line: %s",
-                  osup_temp_string_slice_line_terminated(*line));
-    return osup_false;
-  } else {
-    return osup_true;
+      break;
+    case 12:
+      OSUP_BM_KV_PARSE_RGB("SliderBorder", colors.sliderBorder);
+      break;
+    case 19:
+      OSUP_BM_KV_PARSE_RGB("SliderTrackOverride", colors.sliderTrackOverride);
+      break;
   }
+  OSUP_BM_ERROR("invalid [Colours] line: %s",
+                osup_temp_string_slice_line_terminated(keyBegin));
+  return osup_false;
 }
 
 OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
@@ -750,17 +937,17 @@ OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
 
     if (**line == '|') {
       ++(*line);
-      const char* it = *line;
+      const char* it = osup_find_special_char(*line);
       size_t curvePointCount = 1;
       while (*it != ',' && !osup_is_line_terminator(*it)) {
         if (*it == '|') {
           curvePointCount++;
         }
-        it++;
+        it = osup_find_special_char(it + 1);
       }
 
       value->slider.curvePoints.elements =
-          malloc(curvePointCount * sizeof(osup_vec2));
+          osup_bm_malloc(ctx, curvePointCount * sizeof(osup_vec2));
       if (!value->slider.curvePoints.elements) {
         OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
                       curvePointCount * sizeof(osup_vec2));
@@ -807,6 +994,12 @@ OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
       if (osup_is_line_terminator(*valueEnd)) {
         /* looking at my maps, i see a lot of omitted edgeSounds, edgeSets, so i
          * guess it's allowed */
+        if (!osup_parse_decimal(*line, valueEnd, &value->slider.length)) {
+          OSUP_BM_ERROR("couldn't get slider length from [HitObjects] line: %s",
+                        osup_temp_string_slice_line_terminated(*line));
+          return osup_false;
+        }
+        *line = valueEnd;
         return osup_true;
       }
       valueEnd++;
@@ -818,20 +1011,21 @@ OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
     }
     *line = valueEnd + 1;
 
-    const char* it = *line;
+    const char* it = osup_find_special_char(*line);
     size_t edgeSoundCount = 1;
     while (*it != ',') {
       if (*it == '|') {
         edgeSoundCount++;
       } else if (osup_is_line_terminator(*it)) {
         /* hit sample is omitted */
+        *line = it;
         return osup_true;
       }
-      it++;
+      it = osup_find_special_char(it + 1);
     }
 
     value->slider.edgeSounds.elements =
-        malloc(edgeSoundCount * sizeof(osup_int));
+        osup_bm_malloc(ctx, edgeSoundCount * sizeof(osup_int));
     if (!value->slider.edgeSounds.elements) {
       OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
                     edgeSoundCount * sizeof(osup_int));
@@ -856,7 +1050,7 @@ OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
       ++index;
     }
 
-    it = *line;
+    it = osup_find_special_char(*line);
     size_t edgeSetCount = 1;
     while (*it != ',') {
       if (*it == '|') {
@@ -864,11 +1058,12 @@ OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
       } else if (osup_is_line_terminator(*it)) {
         return osup_false;
       }
-      it++;
+      it = osup_find_special_char(it + 1);
     }
 
     value->slider.edgeSets.elements =
-        malloc(edgeSetCount * sizeof(*value->slider.edgeSets.elements));
+        osup_bm_malloc(ctx, edgeSetCount *
+                                sizeof(*value->slider.edgeSets.elements));
     if (!value->slider.edgeSets.elements) {
       OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
                     edgeSoundCount * sizeof(*value->slider.edgeSets.elements));
@@ -959,7 +1154,9 @@ OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
       if (filenameBegin > filenameEnd) return osup_false;
     }
   }
-  if (!osup_strdup(filenameBegin, filenameEnd, &value->hitSample.filename)) {
+  if (!osup_bm_store_string(ctx, filenameBegin, filenameEnd,
+                            &value->hitSample.filename,
+                            &value->hitSample.filenameView)) {
     OSUP_BM_ERROR("osup_strdup returns false, malloc length: %zu",
                   filenameEnd - filenameBegin);
     return osup_false;
@@ -968,141 +1165,707 @@ OSUP_INTERN osup_bool osup_bm_parse_hit_objects_line(osup_bm_ctx* ctx,
   }
 }
 
-/* will also advance the line pointer to the next line */
-OSUP_INTERN osup_bool osup_bm_nextline(osup_bm_ctx* ctx, const char** line) {
-  switch (**line) {
-    case '/':
-      /* probably a comment */
-      if ((*line)[1] == '/') {
-        /* yeah, it's a comment */
-        return osup_advance_to_next_line(line, osup_false) /* always true */;
+/* if *line is a known section header, store the section and advance *line
+ * past the header */
+OSUP_INTERN osup_bool osup_bm_parse_section_header(const char** line,
+                                                   osup_bm_section* section) {
+  osup_bm_section found;
+  const char* header;
+  /* the first letter is enough to know which header it can be */
+  switch ((*line)[1]) {
+    case 'G':
+      found = OSUP_BM_SECTION_GENERAL;
+      header = "[General]";
+      break;
+    case 'E':
+      if ((*line)[2] == 'd') {
+        found = OSUP_BM_SECTION_EDITOR;
+        header = "[Editor]";
       } else {
-        /* unexpected syntax */
-        OSUP_BM_ERROR("invalid syntax: %s",
-                      osup_temp_string_slice_line_terminated(*line));
-        return osup_false;
+        found = OSUP_BM_SECTION_EVENTS;
+        header = "[Events]";
       }
-    case '\r':
-    case '\n':
-    case '\0':
-      /* empty line */
-      return osup_true;
-    case '[':
-      /* a section header */
+      break;
+    case 'M':
+      found = OSUP_BM_SECTION_METADATA;
+      header = "[Metadata]";
+      break;
+    case 'D':
+      found = OSUP_BM_SECTION_DIFFICULTY;
+      header = "[Difficulty]";
+      break;
+    case 'T':
+      found = OSUP_BM_SECTION_TIMING_POINTS;
+      header = "[TimingPoints]";
+      break;
+    case 'C':
+      found = OSUP_BM_SECTION_COLORS;
+      header = "[Colours]";
+      break;
+    case 'H':
+      found = OSUP_BM_SECTION_HIT_OBJECTS;
+      header = "[HitObjects]";
+      break;
+    default:
+      return osup_false;
+  }
+  if (!osup_check_prefix_and_advance(line, header)) {
+    return osup_false;
+  }
+  *section = found;
+  return osup_true;
+}
 
-      if (osup_check_prefix_and_advance(line, "[General]")) {
-        ctx->section = OSUP_BM_SECTION_GENERAL;
-        return osup_advance_to_next_line(line, osup_true);
-      }
-      if (osup_check_prefix_and_advance(line, "[Editor]")) {
-        ctx->section = OSUP_BM_SECTION_EDITOR;
-        return osup_advance_to_next_line(line, osup_true);
-      }
-      if (osup_check_prefix_and_advance(line, "[Metadata]")) {
-        ctx->section = OSUP_BM_SECTION_METADATA;
-        return osup_advance_to_next_line(line, osup_true);
-      }
-      if (osup_check_prefix_and_advance(line, "[Difficulty]")) {
-        ctx->section = OSUP_BM_SECTION_DIFFICULTY;
-        return osup_advance_to_next_line(line, osup_true);
-      }
-      if (osup_check_prefix_and_advance(line, "[Events]")) {
-        ctx->section = OSUP_BM_SECTION_EVENTS;
-        return osup_advance_to_next_line(line, osup_true);
-      }
-      if (osup_check_prefix_and_advance(line, "[TimingPoints]")) {
-        ctx->section = OSUP_BM_SECTION_TIMING_POINTS;
-        return osup_advance_to_next_line(line, osup_true);
-      }
-      if (osup_check_prefix_and_advance(line, "[Colours]")) {
-        ctx->section = OSUP_BM_SECTION_COLORS;
-        return osup_advance_to_next_line(line, osup_true);
-      }
-      if (osup_check_prefix_and_advance(line, "[HitObjects]")) {
-        ctx->section = OSUP_BM_SECTION_HIT_OBJECTS;
-        return osup_advance_to_next_line(line, osup_true);
-      }
+/* the pre-scans only take a known header on a line of its own (trailing blanks
+ * allowed) as the start of a section, a bracketed line inside a section body
+ * doesn't end it, the input stops at end if it is not NULL */
+OSUP_INTERN osup_bool osup_bm_is_section_header_line(const char* line,
+                                                     const char* end,
+                                                     osup_bm_section* section) {
+  osup_bm_section found;
+  if (!osup_bm_parse_section_header(&line, &found)) return osup_false;
+  while ((!end || line < end) && (*line == ' ' || *line == '\t')) ++line;
+  if ((end && line >= end) || osup_is_line_terminator(*line)) {
+    *section = found;
+    return osup_true;
+  }
+  return osup_false;
+}
 
-      OSUP_BM_ERROR("invalid section header: %s",
-                    osup_temp_string_slice_line_terminated(*line));
-      return osup_false;
-    default:
-      switch (ctx->section) {
-        case OSUP_BM_SECTION_GENERAL:
-          return osup_bm_parse_general_line(ctx, line);
-        case OSUP_BM_SECTION_EDITOR:
-          return osup_bm_parse_editor_line(ctx, line);
-        case OSUP_BM_SECTION_METADATA:
-          return osup_bm_parse_metadata_line(ctx, line);
-        case OSUP_BM_SECTION_DIFFICULTY:
-          return osup_bm_parse_difficulty_line(ctx, line);
-        case OSUP_BM_SECTION_EVENTS: {
-          if (!(ctx->parseFlags & OSUP_PARSE_EVENTS)) {
-            return osup_advance_to_next_line(line, osup_false);
-          }
-          osup_bm_events* events = &ctx->map->events;
-          if (events->count >= ctx->eventCapacity) {
-            ctx->eventCapacity = (size_t)((events->count + 1) * 1.5);
-            osup_event* newEvent = realloc(
-                events->elements, ctx->eventCapacity * sizeof(osup_event));
-            if (!newEvent) {
-              OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
-                            ctx->eventCapacity * sizeof(osup_event));
-              return osup_false;
+/* count the lines of the list sections without parsing them, only a quick scan
+ * over the line terminators, so every list can be allocated exactly once, the
+ * scan stops at end (if not NULL), or once the sections in flags are over */
+OSUP_INTERN void osup_bm_count_capacity(const char* line, const char* end,
+                                        osup_bm_section section,
+                                        osup_bitfield32 flags,
+                                        osup_bm_capacity* capacity) {
+  osup_bool storyboard = (flags & OSUP_PARSE_STORYBOARD) != 0;
+  flags &= OSUP_PARSE_EVENTS | OSUP_PARSE_TIMING_POINTS | OSUP_PARSE_HIT_OBJECTS;
+  memset(capacity, 0, sizeof(*capacity));
+  while ((!end || line < end) && *line) {
+    osup_bm_section next;
+    switch (*line) {
+      case '[':
+        if (!osup_bm_is_section_header_line(line, end, &next)) break;
+        flags &= ~osup_bm_section_flags[section];
+        if (!flags) return;
+        section = next;
+        break;
+      case '/':
+      case '\r':
+      case '\n':
+        break;
+      default:
+        switch (section) {
+          case OSUP_BM_SECTION_EVENTS:
+            /* storyboard lines (Sprite, Animation, indented commands, ...)
+             * are not stored as events, only count what can be one */
+            if (osup_sb_is_storyboard_line(line)) {
+              if (storyboard) osup_sb_count_line(line, &capacity->storyboard);
+            } else if ((*line >= '0' && *line <= '9') || *line == 'V' ||
+                       *line == 'B') {
+              capacity->events++;
             }
-            events->elements = newEvent;
-          }
-          osup_event* event = &events->elements[events->count];
-          /* event may contains pointer, we should initialize it to NULL */
-          memset(event, 0, sizeof(*event));
-          /* we won't parse storyboards (for the time being), so we won't throw
-           * error for invalid effect type */
-          if (osup_bm_parse_events_line(ctx, line, event)) {
-            events->count++;
-          }
-          return osup_true;
+            break;
+          case OSUP_BM_SECTION_TIMING_POINTS:
+            capacity->timingPoints++;
+            break;
+          case OSUP_BM_SECTION_HIT_OBJECTS:
+            capacity->hitObjects++;
+            break;
+          default:
+            break;
         }
+    }
+    osup_advance_to_next_line(&line, osup_false);
+  }
+}
 
-        case OSUP_BM_SECTION_TIMING_POINTS: {
-          if (!(ctx->parseFlags & OSUP_PARSE_TIMING_POINTS)) {
-            return osup_advance_to_next_line(line, osup_false);
-          }
-          osup_bm_timingpoints* timingpoints = &ctx->map->timingPoints;
-          if (timingpoints->count >= ctx->timingpointCapacity) {
-            ctx->timingpointCapacity =
-                (size_t)((timingpoints->count + 1) * 1.5);
-            osup_timingpoint* newTimingPoints =
-                realloc(timingpoints->elements,
-                        ctx->timingpointCapacity * sizeof(osup_timingpoint));
-            if (!newTimingPoints) {
-              OSUP_BM_ERROR(
-                  "malloc returns NULL, malloc size: %zu",
-                  ctx->timingpointCapacity * sizeof(osup_timingpoint));
-              return osup_false;
-            }
-            timingpoints->elements = newTimingPoints;
-          }
-          osup_timingpoint* timingpoint =
-              &timingpoints->elements[timingpoints->count];
-          if (osup_bm_parse_timing_points_line(ctx, line, timingpoint)) {
-            timingpoints->count++;
-            return osup_true;
-          } else {
-            return osup_false;
-          }
-        }
-        case OSUP_BM_SECTION_COLORS:
-          return osup_bm_parse_colors_line(ctx, line);
-        case OSUP_BM_SECTION_HIT_OBJECTS: {
-          if (!(ctx->parseFlags & OSUP_PARSE_HIT_OBJECTS)) {
-            return osup_advance_to_next_line(line, osup_false);
-          }
-          osup_bm_hitobjects* hitObjects = &ctx->map->hitObjects;
-          if (hitObjects->count >= ctx->hitObjectCapacity) {
+/**********************
+ * HIT OBJECT COLUMNS *
+ **********************/
+/* grow a side table by 1.5x when it is full, like the section lists */
+#define OSUP_BM_GROW(ctx, list, capacity)                                    \
+  do {                                                                       \
+    if ((list).count >= (capacity)) {                                        \
+      size_t newCapacity = (size_t)(((list).count + 1) * 1.5);               \
+      void* newElements = osup_bm_realloc(                                   \
+          ctx, (list).elements, (capacity) * sizeof(*(list).elements),       \
+          newCapacity * sizeof(*(list).elements));                           \
+      if (!newElements) {                                                    \
+        OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",               \
+                      newCapacity * sizeof(*(list).elements));               \
+        return osup_false;                                                   \
+      }                                                                      \
+      (list).elements = newElements;                                         \
+      (capacity) = newCapacity;                                              \
+    }                                                                        \
+  } while (0)
+
+/* every column has the same capacity */
+OSUP_INTERN osup_bool osup_bm_reserve_columns(osup_bm_ctx* ctx,
+                                              size_t capacity) {
+  osup_bm_hitobject_columns* columns = &ctx->map->hitObjectColumns;
+  size_t old = ctx->columnCapacity;
+#define OSUP_BM_GROW_COLUMN(column)                                       \
+  do {                                                                    \
+    void* newColumn =                                                     \
+        osup_bm_realloc(ctx, columns->column, old * sizeof(*columns->column), \
+                        capacity * sizeof(*columns->column));             \
+    if (!newColumn) {                                                     \
+      OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",              \
+                    capacity * sizeof(*columns->column));                 \
+      return osup_false;                                                  \
+    }                                                                     \
+    columns->column = newColumn;                                          \
+  } while (0)
+  OSUP_BM_GROW_COLUMN(x);
+  OSUP_BM_GROW_COLUMN(y);
+  OSUP_BM_GROW_COLUMN(time);
+  OSUP_BM_GROW_COLUMN(type);
+  OSUP_BM_GROW_COLUMN(hitSound);
+  OSUP_BM_GROW_COLUMN(payload);
+#undef OSUP_BM_GROW_COLUMN
+  ctx->columnCapacity = capacity;
+  return osup_true;
+}
+
+/* "0:0:0:0:" still gets an empty filename, it counts as default too */
+OSUP_INTERN osup_bool osup_bm_is_default_hitsample(const osup_hitsample* h) {
+  return !h->normalSet && !h->additionSet && !h->index && !h->volume &&
+         h->filenameView.begin == h->filenameView.end;
+}
+
+/* the hit sample of a moved object is not kept, free what it owns */
+OSUP_INTERN void osup_bm_drop_hitsample(osup_bm_ctx* ctx, osup_hitsample* h) {
+  if (!ctx->arena) {
+    osup_free_ptr(h->filename);
+  }
+  h->filename = NULL;
+  memset(&h->filenameView, 0, sizeof(h->filenameView));
+}
+
+/* the new layout owns what was moved out of obj, clear it in obj right away so
+ * a failure halfway leaves every array with exactly one owner */
+OSUP_INTERN void osup_bm_moved_slider(osup_hitobject* obj) {
+  memset(&obj->slider, 0, sizeof(obj->slider));
+}
+
+OSUP_INTERN void osup_bm_moved_hitsample(osup_hitobject* obj) {
+  obj->hitSample.filename = NULL;
+  memset(&obj->hitSample.filenameView, 0, sizeof(obj->hitSample.filenameView));
+}
+
+/* the shared part of the column and compact layouts: store the slider or the
+ * end time of obj in sliders or endTimes and set payload to its index, keep
+ * the hit sample in hitSamples if it's not default, hitSample is set to its
+ * index (OSUP_NO_PAYLOAD if it's not kept). the slider arrays and the hit
+ * sample filename are moved, not copied */
+OSUP_INTERN osup_bool osup_bm_append_side_tables(
+    osup_bm_ctx* ctx, osup_hitobject* obj, size_t object,
+    osup_bm_sliders* sliders, osup_bm_end_times* endTimes,
+    osup_bm_hitsamples* hitSamples, osup_bm_side_capacity* capacity,
+    uint32_t* payload, uint32_t* hitSample) {
+  *payload = OSUP_NO_PAYLOAD;
+  *hitSample = OSUP_NO_PAYLOAD;
+  if (OSUP_IS_SLIDER(obj->type)) {
+    OSUP_BM_GROW(ctx, *sliders, capacity->sliders);
+    *payload = (uint32_t)sliders->count;
+    sliders->elements[sliders->count++] = obj->slider;
+    osup_bm_moved_slider(obj);
+  } else if (OSUP_IS_SPINNER(obj->type) || OSUP_IS_MANIA_HOLD(obj->type)) {
+    OSUP_BM_GROW(ctx, *endTimes, capacity->endTimes);
+    *payload = (uint32_t)endTimes->count;
+    endTimes->elements[endTimes->count++] = obj->spinner.endTime;
+  }
+  if (!osup_bm_is_default_hitsample(&obj->hitSample)) {
+    OSUP_BM_GROW(ctx, *hitSamples, capacity->hitSamples);
+    *hitSample = (uint32_t)hitSamples->count;
+    hitSamples->elements[hitSamples->count].object = object;
+    hitSamples->elements[hitSamples->count++].hitSample = obj->hitSample;
+    osup_bm_moved_hitsample(obj);
+  } else {
+    osup_bm_drop_hitsample(ctx, &obj->hitSample);
+  }
+  return osup_true;
+}
+
+/* append an object to the columns */
+OSUP_INTERN osup_bool osup_bm_append_hitobject_column(osup_bm_ctx* ctx,
+                                                      osup_hitobject* obj) {
+  osup_bm_hitobject_columns* columns = &ctx->map->hitObjectColumns;
+  size_t i = columns->count;
+  uint32_t hitSample;
+  if (i >= ctx->columnCapacity &&
+      !osup_bm_reserve_columns(ctx, (size_t)((i + 1) * 1.5))) {
+    return osup_false;
+  }
+  columns->x[i] = obj->x;
+  columns->y[i] = obj->y;
+  columns->time[i] = obj->time;
+  columns->type[i] = obj->type;
+  columns->hitSound[i] = obj->hitSound;
+  if (!osup_bm_append_side_tables(ctx, obj, i, &columns->sliders,
+                                  &columns->endTimes, &columns->hitSamples,
+                                  &ctx->columnSides, &columns->payload[i],
+                                  &hitSample)) {
+    return osup_false;
+  }
+  columns->count++;
+  return osup_true;
+}
+
+typedef osup_bool (*osup_bm_append_hitobject_fn)(osup_bm_ctx* ctx,
+                                                  osup_hitobject* obj);
+
+/* move every object of map->hitObjects with append, the payloads belong to
+ * the new layout afterwards, so only the array itself is dropped. on failure
+ * the objects moved so far keep their fields but not their slider arrays and
+ * hit sample filenames, which the new layout owns, osup_beatmap_free frees
+ * both */
+OSUP_INTERN osup_bool osup_bm_move_hitobjects(
+    osup_bm_ctx* ctx, osup_bm_append_hitobject_fn append) {
+  osup_bm* map = ctx->map;
+  size_t i;
+  for (i = 0; i < map->hitObjects.count; i++) {
+    if (!append(ctx, &map->hitObjects.elements[i])) {
+      return osup_false;
+    }
+  }
+  if (!map->arena.blocks) {
+    osup_free_ptr(map->hitObjects.elements);
+  }
+  map->hitObjects.elements = NULL;
+  map->hitObjects.count = 0;
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_beatmap_to_hitobject_columns(osup_bm* map) {
+  osup_bm_ctx ctx;
+  osup_bm_init_ctx(&ctx, map,
+                   map->arena.blocks ? OSUP_PARSE_ARENA : (osup_bitfield32)0);
+  if (map->hitObjectColumns.count) {
+    OSUP_BM_ERROR("the map already has hit object columns");
+    return osup_false;
+  }
+  if (map->hitObjects.count &&
+      !osup_bm_reserve_columns(&ctx, map->hitObjects.count)) {
+    return osup_false;
+  }
+  return osup_bm_move_hitobjects(&ctx, osup_bm_append_hitobject_column);
+}
+
+/***********************
+ * COMPACT HIT OBJECTS *
+ ***********************/
+OSUP_INTERN osup_bool osup_bm_reserve_compact(osup_bm_ctx* ctx,
+                                              size_t capacity) {
+  osup_bm_compact_hitobjects* list = &ctx->map->compactHitObjects;
+  void* elements = osup_bm_realloc(
+      ctx, list->elements, ctx->compactCapacity * sizeof(*list->elements),
+      capacity * sizeof(*list->elements));
+  if (!elements) {
+    OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
+                  capacity * sizeof(*list->elements));
+    return osup_false;
+  }
+  list->elements = elements;
+  ctx->compactCapacity = capacity;
+  return osup_true;
+}
+
+/* append an object to the compact list */
+OSUP_INTERN osup_bool osup_bm_append_compact_hitobject(osup_bm_ctx* ctx,
+                                                       osup_hitobject* obj) {
+  osup_bm_compact_hitobjects* list = &ctx->map->compactHitObjects;
+  if (list->count >= ctx->compactCapacity &&
+      !osup_bm_reserve_compact(ctx, (size_t)((list->count + 1) * 1.5))) {
+    return osup_false;
+  }
+  osup_compact_hitobject* compact = &list->elements[list->count];
+  compact->x = obj->x;
+  compact->y = obj->y;
+  compact->time = obj->time;
+  compact->type = obj->type;
+  compact->hitSound = obj->hitSound;
+  if (!osup_bm_append_side_tables(ctx, obj, list->count, &list->sliders,
+                                  &list->endTimes, &list->hitSamples,
+                                  &ctx->compactSides, &compact->payload,
+                                  &compact->hitSample)) {
+    return osup_false;
+  }
+  list->count++;
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_beatmap_to_compact_hitobjects(osup_bm* map) {
+  osup_bm_ctx ctx;
+  osup_bm_init_ctx(&ctx, map,
+                   map->arena.blocks ? OSUP_PARSE_ARENA : (osup_bitfield32)0);
+  if (map->compactHitObjects.count) {
+    OSUP_BM_ERROR("the map already has compact hit objects");
+    return osup_false;
+  }
+  if (map->hitObjects.count &&
+      !osup_bm_reserve_compact(&ctx, map->hitObjects.count)) {
+    return osup_false;
+  }
+  return osup_bm_move_hitobjects(&ctx, osup_bm_append_compact_hitobject);
+}
+
+OSUP_API const osup_slider_params* osup_compact_hitobject_slider(
+    const osup_bm_compact_hitobjects* list, size_t index) {
+  const osup_compact_hitobject* obj = &list->elements[index];
+  return OSUP_IS_SLIDER(obj->type) ? &list->sliders.elements[obj->payload]
+                                   : NULL;
+}
+
+OSUP_API osup_int osup_compact_hitobject_end_time(
+    const osup_bm_compact_hitobjects* list, size_t index) {
+  const osup_compact_hitobject* obj = &list->elements[index];
+  if (!OSUP_IS_SLIDER(obj->type) && obj->payload != OSUP_NO_PAYLOAD) {
+    return list->endTimes.elements[obj->payload];
+  }
+  return obj->time;
+}
+
+/* what the objects left out of the hit sample tables report, an empty
+ * filename like "0:0:0:0:" gives in the object array */
+OSUP_STORAGE const char osup_bm_empty_filename[1] = "";
+OSUP_STORAGE const osup_hitsample osup_bm_default_hitsample = {
+    OSUP_SAMPLESET_DEFAULT,
+    OSUP_SAMPLESET_DEFAULT,
+    0,
+    0,
+    (char*)osup_bm_empty_filename,
+    {osup_bm_empty_filename, osup_bm_empty_filename}};
+
+OSUP_API const osup_hitsample* osup_compact_hitobject_hitsample(
+    const osup_bm_compact_hitobjects* list, size_t index) {
+  const osup_compact_hitobject* obj = &list->elements[index];
+  return obj->hitSample == OSUP_NO_PAYLOAD
+             ? &osup_bm_default_hitsample
+             : &list->hitSamples.elements[obj->hitSample].hitSample;
+}
+
+OSUP_API const osup_hitsample* osup_hitobject_column_hitsample(
+    const osup_bm_hitobject_columns* columns, size_t index) {
+  size_t low = 0, high = columns->hitSamples.count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (columns->hitSamples.elements[middle].object < index) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low < columns->hitSamples.count &&
+                 columns->hitSamples.elements[low].object == index
+             ? &columns->hitSamples.elements[low].hitSample
+             : &osup_bm_default_hitsample;
+}
+
+OSUP_API void osup_compact_hitobject_expand(
+    const osup_bm_compact_hitobjects* list, size_t index, osup_hitobject* obj) {
+  const osup_compact_hitobject* compact = &list->elements[index];
+  memset(obj, 0, sizeof(*obj));
+  obj->x = compact->x;
+  obj->y = compact->y;
+  obj->time = compact->time;
+  obj->type = compact->type;
+  obj->hitSound = compact->hitSound;
+  obj->hitSample = *osup_compact_hitobject_hitsample(list, index);
+  if (OSUP_IS_SLIDER(compact->type)) {
+    obj->slider = list->sliders.elements[compact->payload];
+  } else if (compact->payload != OSUP_NO_PAYLOAD) {
+    obj->spinner.endTime = list->endTimes.elements[compact->payload];
+  }
+}
+
+/* allocate the list sections up front, a zero capacity means unknown, the
+ * lists will grow when needed anyway */
+OSUP_INTERN osup_bool osup_bm_reserve(osup_bm_ctx* ctx,
+                                      const osup_bm_capacity* capacity) {
+  osup_bm* map = ctx->map;
+  if ((ctx->parseFlags & OSUP_PARSE_EVENTS) && capacity->events &&
+      !map->events.elements) {
+    map->events.elements =
+        osup_bm_malloc(ctx, capacity->events * sizeof(osup_event));
+    if (!map->events.elements) return osup_false;
+    ctx->eventCapacity = capacity->events;
+  }
+  if ((ctx->parseFlags & OSUP_PARSE_STORYBOARD) &&
+      (ctx->parseFlags & OSUP_PARSE_EVENTS) &&
+      !osup_sb_parser_reserve(&ctx->storyboard, &capacity->storyboard)) {
+    return osup_false;
+  }
+  if ((ctx->parseFlags & OSUP_PARSE_TIMING_POINTS) && capacity->timingPoints &&
+      !map->timingPoints.elements) {
+    map->timingPoints.elements =
+        osup_bm_malloc(ctx, capacity->timingPoints * sizeof(osup_timingpoint));
+    if (!map->timingPoints.elements) return osup_false;
+    ctx->timingpointCapacity = capacity->timingPoints;
+  }
+  if ((ctx->parseFlags & OSUP_PARSE_HIT_OBJECT_COLUMNS) &&
+      (ctx->parseFlags & OSUP_PARSE_HIT_OBJECTS) && capacity->hitObjects &&
+      !ctx->columnCapacity) {
+    return osup_bm_reserve_columns(ctx, capacity->hitObjects);
+  }
+  if ((ctx->parseFlags & OSUP_PARSE_COMPACT_HIT_OBJECTS) &&
+      (ctx->parseFlags & OSUP_PARSE_HIT_OBJECTS) && capacity->hitObjects &&
+      !ctx->compactCapacity) {
+    return osup_bm_reserve_compact(ctx, capacity->hitObjects);
+  }
+  if ((ctx->parseFlags & OSUP_PARSE_HIT_OBJECTS) && capacity->hitObjects &&
+      !map->hitObjects.elements) {
+    map->hitObjects.elements =
+        osup_bm_malloc(ctx, capacity->hitObjects * sizeof(osup_hitobject));
+    if (!map->hitObjects.elements) return osup_false;
+    ctx->hitObjectCapacity = capacity->hitObjects;
+  }
+  return osup_true;
+}
+
+/* parse the line into a record on the stack and hand it to the visitor */
+OSUP_INTERN osup_bool osup_bm_visit_line(osup_bm_ctx* ctx, const char** line) {
+  const osup_bm_visitor* visitor = ctx->visitor;
+  osup_bitfield32 flag = osup_bm_section_flags[ctx->section];
+  osup_bool keepGoing = osup_true;
+  if (!(ctx->parseFlags & flag)) {
+    return osup_advance_to_next_line(line, osup_false);
+  }
+  switch (ctx->section) {
+    case OSUP_BM_SECTION_EVENTS: {
+      osup_event event;
+      memset(&event, 0, sizeof(event));
+      if (!osup_bm_parse_events_line(ctx, line, &event)) {
+        /* storyboard lines, same as osup_bm_nextline */
+        return osup_advance_to_next_line(line, osup_false);
+      }
+      if (visitor->on_event) {
+        keepGoing = visitor->on_event(visitor->userData, &event);
+      }
+      break;
+    }
+    case OSUP_BM_SECTION_TIMING_POINTS: {
+      osup_timingpoint timingPoint;
+      memset(&timingPoint, 0, sizeof(timingPoint));
+      if (!osup_bm_parse_timing_points_line(ctx, line, &timingPoint)) {
+        return osup_false;
+      }
+      if (visitor->on_timing_point) {
+        keepGoing = visitor->on_timing_point(visitor->userData, &timingPoint);
+      }
+      break;
+    }
+    case OSUP_BM_SECTION_HIT_OBJECTS: {
+      osup_hitobject hitObject;
+      memset(&hitObject, 0, sizeof(hitObject));
+      if (!osup_bm_parse_hit_objects_line(ctx, line, &hitObject)) {
+        return osup_false;
+      }
+      if (visitor->on_hit_object) {
+        keepGoing = visitor->on_hit_object(visitor->userData, &hitObject);
+      }
+      /* the slider arrays are not needed anymore */
+      osup_arena_reset(ctx->arena);
+      break;
+    }
+    default: {
+      /* key-value sections, the visitor gets the raw strings */
+      OSUP_BM_KV_GET_KEY("key-value");
+      OSUP_BM_KV_GET_VALUE();
+      if (visitor->on_kv) {
+        osup_slice key, value;
+        key.begin = keyBegin;
+        key.end = keyBegin + keyLength;
+        value.begin = valueBegin;
+        value.end = valueEnd;
+        keepGoing = visitor->on_kv(visitor->userData, flag, key, value);
+      }
+      break;
+    }
+  }
+  if (!keepGoing) {
+    /* pretend every section is over, the parse loop stops right away */
+    ctx->closedSections = ~(osup_bitfield32)0;
+  }
+  return osup_true;
+}
+
+/* the storyboard is decoration, a broken one must not cost the player the map,
+ * so it is reported and dropped instead of failing the load */
+OSUP_INTERN osup_bool osup_bm_parse_storyboard_line(osup_bm_ctx* ctx,
+                                                    const char** line) {
+  const char* begin = *line;
+  if (!ctx->storyboardFailed &&
+      osup_sb_parser_parse_line(&ctx->storyboard, line)) {
+    return osup_true;
+  }
+  if (!ctx->storyboardFailed) {
+    OSUP_BM_ERROR("invalid storyboard line, the storyboard is dropped: %s",
+                  osup_temp_string_slice_line_terminated(begin));
+    ctx->storyboardFailed = osup_true;
+    /* with an arena the tables go away with the map */
+    if (!ctx->arena) osup_storyboard_free(&ctx->map->storyboard);
+    memset(&ctx->map->storyboard, 0, sizeof(ctx->map->storyboard));
+  }
+  *line = begin;
+  return osup_advance_to_next_line(line, osup_false);
+}
+
+/* will also advance the line pointer to the next line */
+OSUP_INTERN osup_bool osup_bm_nextline(osup_bm_ctx* ctx, const char** line) {
+  switch (**line) {
+    case '/':
+      /* probably a comment */
+      if ((*line)[1] == '/') {
+        /* yeah, it's a comment */
+        return osup_advance_to_next_line(line, osup_false) /* always true */;
+      } else {
+        /* unexpected syntax */
+        OSUP_BM_ERROR("invalid syntax: %s",
+                      osup_temp_string_slice_line_terminated(*line));
+        return osup_false;
+      }
+    case '\r':
+    case '\n':
+      /* empty line, or the line terminator left behind by the line parsers */
+      ++(*line);
+      return osup_true;
+    case '\0':
+      return osup_true;
+    case '[':
+      /* a section header */
+
+      {
+        osup_bm_section previous = ctx->section;
+        if (osup_bm_parse_section_header(line, &ctx->section)) {
+          if (ctx->inSection) {
+            ctx->closedSections |= osup_bm_section_flags[previous];
+          }
+          ctx->inSection = osup_true;
+          return osup_advance_to_next_line(line, osup_true);
+        }
+      }
+
+      OSUP_BM_ERROR("invalid section header: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    default:
+      if (ctx->visitor) {
+        return osup_bm_visit_line(ctx, line);
+      }
+      switch (ctx->section) {
+        case OSUP_BM_SECTION_GENERAL:
+          return osup_bm_parse_general_line(ctx, line);
+        case OSUP_BM_SECTION_EDITOR:
+          return osup_bm_parse_editor_line(ctx, line);
+        case OSUP_BM_SECTION_METADATA:
+          return osup_bm_parse_metadata_line(ctx, line);
+        case OSUP_BM_SECTION_DIFFICULTY:
+          return osup_bm_parse_difficulty_line(ctx, line);
+        case OSUP_BM_SECTION_EVENTS: {
+          if (!(ctx->parseFlags & OSUP_PARSE_EVENTS)) {
+            return osup_advance_to_next_line(line, osup_false);
+          }
+          if ((ctx->parseFlags & OSUP_PARSE_STORYBOARD) &&
+              osup_sb_is_storyboard_line(*line)) {
+            return osup_bm_parse_storyboard_line(ctx, line);
+          }
+          osup_bm_events* events = &ctx->map->events;
+          if (events->count >= ctx->eventCapacity) {
+            size_t oldCapacity = ctx->eventCapacity;
+            ctx->eventCapacity = (size_t)((events->count + 1) * 1.5);
+            osup_event* newEvent = osup_bm_realloc(
+                ctx, events->elements, oldCapacity * sizeof(osup_event),
+                ctx->eventCapacity * sizeof(osup_event));
+            if (!newEvent) {
+              OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
+                            ctx->eventCapacity * sizeof(osup_event));
+              return osup_false;
+            }
+            events->elements = newEvent;
+          }
+          osup_event* event = &events->elements[events->count];
+          /* event may contains pointer, we should initialize it to NULL */
+          memset(event, 0, sizeof(*event));
+          /* without OSUP_PARSE_STORYBOARD, the storyboard lines end up here,
+           * so we won't throw error for invalid effect type, just skip the
+           * rest of the line */
+          if (osup_bm_parse_events_line(ctx, line, event)) {
+            events->count++;
+            return osup_true;
+          } else {
+            return osup_advance_to_next_line(line, osup_false);
+          }
+        }
+
+        case OSUP_BM_SECTION_TIMING_POINTS: {
+          if (!(ctx->parseFlags & OSUP_PARSE_TIMING_POINTS)) {
+            return osup_advance_to_next_line(line, osup_false);
+          }
+          osup_bm_timingpoints* timingpoints = &ctx->map->timingPoints;
+          if (timingpoints->count >= ctx->timingpointCapacity) {
+            size_t oldCapacity = ctx->timingpointCapacity;
+            ctx->timingpointCapacity =
+                (size_t)((timingpoints->count + 1) * 1.5);
+            osup_timingpoint* newTimingPoints = osup_bm_realloc(
+                ctx, timingpoints->elements,
+                oldCapacity * sizeof(osup_timingpoint),
+                ctx->timingpointCapacity * sizeof(osup_timingpoint));
+            if (!newTimingPoints) {
+              OSUP_BM_ERROR(
+                  "malloc returns NULL, malloc size: %zu",
+                  ctx->timingpointCapacity * sizeof(osup_timingpoint));
+              return osup_false;
+            }
+            timingpoints->elements = newTimingPoints;
+          }
+          osup_timingpoint* timingpoint =
+              &timingpoints->elements[timingpoints->count];
+          if (osup_bm_parse_timing_points_line(ctx, line, timingpoint)) {
+            timingpoints->count++;
+            return osup_true;
+          } else {
+            return osup_false;
+          }
+        }
+        case OSUP_BM_SECTION_COLORS:
+          return osup_bm_parse_colors_line(ctx, line);
+        case OSUP_BM_SECTION_HIT_OBJECTS: {
+          if (!(ctx->parseFlags & OSUP_PARSE_HIT_OBJECTS)) {
+            return osup_advance_to_next_line(line, osup_false);
+          }
+          if (ctx->parseFlags & OSUP_PARSE_HIT_OBJECT_COLUMNS) {
+            osup_hitobject column;
+            memset(&column, 0, sizeof(column));
+            if (osup_bm_parse_hit_objects_line(ctx, line, &column) &&
+                osup_bm_append_hitobject_column(ctx, &column)) {
+              return osup_true;
+            }
+            /* whatever was not moved into the columns is still ours */
+            if (!ctx->arena) osup_hitobject_free(&column);
+            return osup_false;
+          }
+          if (ctx->parseFlags & OSUP_PARSE_COMPACT_HIT_OBJECTS) {
+            osup_hitobject compact;
+            memset(&compact, 0, sizeof(compact));
+            if (osup_bm_parse_hit_objects_line(ctx, line, &compact) &&
+                osup_bm_append_compact_hitobject(ctx, &compact)) {
+              return osup_true;
+            }
+            if (!ctx->arena) osup_hitobject_free(&compact);
+            return osup_false;
+          }
+          osup_bm_hitobjects* hitObjects = &ctx->map->hitObjects;
+          if (hitObjects->count >= ctx->hitObjectCapacity) {
+            size_t oldCapacity = ctx->hitObjectCapacity;
             ctx->hitObjectCapacity = (size_t)((hitObjects->count + 1) * 1.5);
-            osup_hitobject* newHitObjects =
-                realloc(hitObjects->elements,
-                        ctx->hitObjectCapacity * sizeof(osup_hitobject));
+            osup_hitobject* newHitObjects = osup_bm_realloc(
+                ctx, hitObjects->elements,
+                oldCapacity * sizeof(osup_hitobject),
+                ctx->hitObjectCapacity * sizeof(osup_hitobject));
             if (!newHitObjects) {
               OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
                             ctx->hitObjectCapacity * sizeof(osup_hitobject));
@@ -1127,32 +1890,41 @@ OSUP_INTERN osup_bool osup_bm_nextline(osup_bm_ctx* ctx, const char** line) {
 
 OSUP_API osup_bool osup_beatmap_load(osup_bm* map, const char* file,
                                      osup_bitfield32 flags) {
-  FILE* f = fopen(file, "r");
-  if (!f) {
+  /* the whole file is mapped into memory and parsed in place, no per-line
+   * copies or syscalls */
+  osup_mapped_file f;
+  if (!osup_map_file(file, &f)) {
     OSUP_BM_ERROR("unable to read file %s", file);
     return osup_false;
   }
-  osup_bool ret = osup_beatmap_load_stream(map, f, flags);
-  fclose(f);
+  osup_bool ret = osup_beatmap_load_string(map, f.data, flags);
+  if (flags & OSUP_PARSE_STRING_VIEWS) {
+    /* the views point into the file, it goes away with the map */
+    map->source = f;
+  } else {
+    osup_unmap_file(&f);
+  }
   return ret;
 }
 
-OSUP_API osup_bool osup_beatmap_load_string(osup_bm* map, const char* string,
-                                            osup_bitfield32 flags) {
-  if (!strncmp(string, "osu file format v", sizeof("osu file format v") - 1)) {
+/* check the "osu file format vXX" header, *line is set to the line after it */
+OSUP_INTERN osup_bool osup_bm_parse_header(osup_bm_ctx* ctx, const char* string,
+                                           const char** line) {
+  /* skip UTF-8 BOM */
+  if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+    string += 3;
+  }
+  if (strncmp(string, "osu file format v", sizeof("osu file format v") - 1)) {
+    OSUP_BM_ERROR("invalid header");
     return osup_false;
   }
 
-  osup_bm_ctx ctx = {};
-  ctx.map = map;
-  ctx.parseFlags = flags;
-
   const char* versionBegin = string + sizeof("osu file format v") - 1;
   size_t i = 0;
-  while (i < sizeof((osup_bm_ctx){}.version)) {
-    ctx.version[i] = versionBegin[i];
-    if (osup_is_line_terminator(ctx.version[i])) {
-      ctx.version[i] = '\0';
+  while (i < sizeof(ctx->version)) {
+    ctx->version[i] = versionBegin[i];
+    if (osup_is_line_terminator(ctx->version[i])) {
+      ctx->version[i] = '\0';
       goto success;
     } else {
       i++;
@@ -1164,42 +1936,1227 @@ OSUP_API osup_bool osup_beatmap_load_string(osup_bm* map, const char* string,
   return osup_false;
 
 success:
-  if (!osup_check_version(&ctx)) {
+  if (!osup_check_version(ctx)) {
     OSUP_BM_ERROR("unsupported version");
     return osup_false;
   }
 
   /* go to the next line */
-  const char* line = versionBegin + i;
+  *line = versionBegin + i;
+  if (**line != '\0') {
+    ++(*line);
+  }
+  return osup_true;
+}
+
+/* parse the lines in [line, end), or until the end of the string if end is
+ * NULL, begin is only used to report line numbers */
+OSUP_INTERN osup_bool osup_bm_parse_lines(osup_bm_ctx* ctx, const char* begin,
+                                          const char* line, const char* end) {
+  while ((!end || line < end) && *line != '\0' && !osup_bm_is_done(ctx)) {
+    /* parse line by line */
+    if (!osup_bm_nextline(ctx, &line)) {
+      /* only count the lines when we need to report an error, so it won't be
+       * in the hot loop */
+      size_t lineNumber = 1;
+      const char* it = begin;
+      while (it < line) {
+        if (*(it++) == '\n') lineNumber++;
+      }
+      OSUP_BM_ERROR("error on line %zu", lineNumber);
+      return osup_false;
+    }
+  }
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_beatmap_load_string(osup_bm* map, const char* string,
+                                            osup_bitfield32 flags) {
+  osup_bm_ctx ctx;
+  const char* line;
+  osup_bm_init_ctx(&ctx, map, flags);
+  if (!osup_bm_parse_header(&ctx, string, &line)) {
+    return osup_false;
+  }
   if (*line == '\0') {
     /* there is no line other than the header line, so this is an empty .osu
      * file, still technically correct input */
     return osup_true;
   }
-  line++;
 
-  size_t lineNumber = 2;
-  do {
-    /* parse line by line */
-    if (!osup_bm_nextline(&ctx, &line)) {
-      OSUP_BM_ERROR("error on line %zu", lineNumber);
+  /* the whole input is in memory, so we can count the list elements first */
+  osup_bm_capacity capacity;
+  osup_bm_count_capacity(line, NULL, OSUP_BM_SECTION_GENERAL, flags,
+                         &capacity);
+  if (!osup_bm_reserve(&ctx, &capacity)) {
+    OSUP_BM_ERROR("malloc returns NULL");
+    return osup_false;
+  }
+
+  return osup_bm_parse_lines(&ctx, string, line, NULL);
+}
+
+/**********************************
+ * SECTION DIRECTORY, LAZY PARSING *
+ **********************************/
+/* the directory index of a section is the bit of its flag */
+OSUP_INTERN size_t osup_bm_section_index(osup_bm_section section) {
+  osup_bitfield32 flag = osup_bm_section_flags[section];
+  size_t index = 0;
+  while (!(flag & 1)) {
+    flag >>= 1;
+    index++;
+  }
+  return index;
+}
+
+/* only look at the lines starting with '[', everything in between is skipped
+ * with strstr */
+OSUP_INTERN void osup_bm_build_directory(osup_bm_directory* directory,
+                                         const char* line) {
+  osup_slice* current = NULL;
+  const char* header = *line == '[' ? line : strstr(line, "\n[");
+  while (header) {
+    if (*header == '\n') ++header;
+    osup_bm_section section;
+    const char* it = header;
+    if (osup_bm_is_section_header_line(header, NULL, &section)) {
+      size_t index = osup_bm_section_index(section);
+      /* the previous section ends where this header begins */
+      if (current) current->end = header;
+      current = NULL;
+      /* if a section appears twice, only the first one is used */
+      if (!directory->sections[index].begin) {
+        osup_advance_to_next_line(&it, osup_false);
+        current = &directory->sections[index];
+        current->begin = it;
+        directory->found |= osup_bm_section_flags[section];
+      }
+    }
+    header = strstr(header, "\n[");
+  }
+  if (current) current->end = current->begin + strlen(current->begin);
+}
+
+OSUP_API osup_bool osup_beatmap_open_string(osup_bm* map, const char* string,
+                                            osup_bitfield32 flags) {
+  osup_bm_ctx ctx;
+  const char* line;
+  osup_bm_init_ctx(&ctx, map, flags);
+  if (!osup_bm_parse_header(&ctx, string, &line)) {
+    return osup_false;
+  }
+  memset(&map->directory, 0, sizeof(map->directory));
+  map->directory.input = string;
+  map->directory.options = flags & ~OSUP_PARSE_ALL;
+  osup_bm_build_directory(&map->directory, line);
+  return osup_bm_parse_section(map, flags & OSUP_PARSE_ALL);
+}
+
+OSUP_API osup_bool osup_beatmap_open(osup_bm* map, const char* file,
+                                     osup_bitfield32 flags) {
+  /* unlike osup_beatmap_load, the sections are parsed later, so the file has
+   * to stay around */
+  if (!osup_map_file(file, &map->source)) {
+    OSUP_BM_ERROR("unable to read file %s", file);
+    return osup_false;
+  }
+  return osup_beatmap_open_string(map, map->source.data, flags);
+}
+
+OSUP_API osup_bool osup_bm_parse_section(osup_bm* map,
+                                         osup_bitfield32 sections) {
+  osup_bm_directory* directory = &map->directory;
+  if (!directory->input) {
+    OSUP_BM_ERROR("the map was not opened with osup_beatmap_open");
+    return osup_false;
+  }
+  /* missing sections are fine, there is just nothing to parse */
+  sections &= directory->found & ~directory->parsed;
+
+  osup_bm_section section;
+  for (section = OSUP_BM_SECTION_GENERAL; section <= OSUP_BM_SECTION_HIT_OBJECTS;
+       section++) {
+    osup_bitfield32 flag = osup_bm_section_flags[section];
+    if (!(sections & flag)) continue;
+
+    osup_slice range = directory->sections[osup_bm_section_index(section)];
+    osup_bm_ctx ctx;
+    osup_bm_init_ctx(&ctx, map, flag | directory->options);
+    ctx.section = section;
+
+    osup_bm_capacity capacity;
+    osup_bm_count_capacity(range.begin, range.end, section,
+                           flag | directory->options, &capacity);
+    if (!osup_bm_reserve(&ctx, &capacity) ||
+        !osup_bm_parse_lines(&ctx, directory->input, range.begin, range.end)) {
       return osup_false;
     }
-    lineNumber++;
-  } while (*line != '\0');
+    directory->parsed |= flag;
+  }
+  return osup_true;
+}
+
+/********************
+ * THREADED LOADING *
+ ********************/
+/* sections smaller than this are not worth a thread */
+#define OSUP_BM_MIN_CHUNK_SIZE (32 * 1024)
+
+/* one chunk of a list section, parsed into a map of its own */
+typedef struct {
+  osup_bm map;
+  osup_bm_section section;
+  osup_bitfield32 options;
+  /* only used to report line numbers */
+  const char* input;
+  osup_slice range;
+  osup_bool ok;
+  /* where the elements go when the chunks are joined */
+  const void* source;
+  void* destination;
+  size_t size;
+} osup_bm_chunk;
+
+OSUP_INTERN void osup_bm_parse_chunk(void* ptr) {
+  osup_bm_chunk* chunk = ptr;
+  osup_bitfield32 flag = osup_bm_section_flags[chunk->section];
+  osup_bm_ctx ctx;
+  osup_bm_capacity capacity;
+  osup_bm_init_ctx(&ctx, &chunk->map, flag | chunk->options);
+  ctx.section = chunk->section;
+  osup_bm_count_capacity(chunk->range.begin, chunk->range.end, chunk->section,
+                         flag, &capacity);
+  chunk->ok = osup_bm_reserve(&ctx, &capacity) &&
+              osup_bm_parse_lines(&ctx, chunk->input, chunk->range.begin,
+                                  chunk->range.end);
+}
+
+OSUP_INTERN void osup_bm_copy_chunk(void* ptr) {
+  osup_bm_chunk* chunk = ptr;
+  /* an empty chunk has no elements to copy from */
+  if (chunk->size) memcpy(chunk->destination, chunk->source, chunk->size);
+}
+
+/* move the elements of every chunk into map->list, in order, the copies are
+ * done on the pool too */
+#define OSUP_BM_JOIN_CHUNKS(list)                                             \
+  do {                                                                        \
+    size_t total = 0;                                                         \
+    for (i = 0; i < chunkCount; i++) total += chunks[i].map.list.count;       \
+    /* only blank lines and comments, malloc(0) may return NULL */            \
+    if (!total) break;                                                        \
+    map->list.elements = malloc(total * sizeof(*map->list.elements));         \
+    if (!map->list.elements) {                                                \
+      OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",                  \
+                    total * sizeof(*map->list.elements));                     \
+      ok = osup_false;                                                        \
+      break;                                                                  \
+    }                                                                         \
+    for (i = 0; i < chunkCount; i++) {                                        \
+      chunks[i].source = chunks[i].map.list.elements;                         \
+      chunks[i].destination = map->list.elements + map->list.count;           \
+      chunks[i].size =                                                        \
+          chunks[i].map.list.count * sizeof(*map->list.elements);             \
+      map->list.count += chunks[i].map.list.count;                            \
+    }                                                                         \
+    osup_pool_run(pool, osup_bm_copy_chunk, chunks, sizeof(osup_bm_chunk),    \
+                  chunkCount);                                                \
+    for (i = 0; i < chunkCount; i++) {                                        \
+      osup_free_ptr(chunks[i].map.list.elements);                             \
+      chunks[i].map.list.elements = NULL;                                     \
+      chunks[i].map.list.count = 0;                                           \
+    }                                                                         \
+  } while (0)
+
+OSUP_INTERN osup_bool osup_bm_parse_section_threaded(osup_bm* map,
+                                                     osup_bm_section section,
+                                                     osup_pool* pool) {
+  osup_bm_directory* directory = &map->directory;
+  osup_bitfield32 flag = osup_bm_section_flags[section];
+  osup_slice range = directory->sections[osup_bm_section_index(section)];
+  size_t chunkCount =
+      (size_t)(range.end - range.begin) / OSUP_BM_MIN_CHUNK_SIZE;
+  if (chunkCount > osup_pool_thread_count(pool)) {
+    chunkCount = osup_pool_thread_count(pool);
+  }
+  if (chunkCount <= 1) {
+    return osup_bm_parse_section(map, flag);
+  }
+
+  osup_bm_chunk* chunks = malloc(chunkCount * sizeof(osup_bm_chunk));
+  if (!chunks) {
+    OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu",
+                  chunkCount * sizeof(osup_bm_chunk));
+    return osup_false;
+  }
+  memset(chunks, 0, chunkCount * sizeof(osup_bm_chunk));
+  /* same size chunks, each one ends after the first newline past its share */
+  size_t i;
+  const char* begin = range.begin;
+  for (i = 0; i < chunkCount; i++) {
+    const char* end = range.end;
+    if (i + 1 < chunkCount) {
+      end = range.begin + (range.end - range.begin) * (i + 1) / chunkCount;
+      if (end < begin) end = begin;
+      end = memchr(end, '\n', range.end - end);
+      end = end ? end + 1 : range.end;
+    }
+    chunks[i].section = section;
+    /* the other layouts are built from the joined array */
+    chunks[i].options = directory->options & ~(OSUP_PARSE_HIT_OBJECT_COLUMNS |
+                                               OSUP_PARSE_COMPACT_HIT_OBJECTS);
+    chunks[i].input = directory->input;
+    chunks[i].range.begin = begin;
+    chunks[i].range.end = end;
+    begin = end;
+  }
+  osup_pool_run(pool, osup_bm_parse_chunk, chunks, sizeof(osup_bm_chunk),
+                chunkCount);
+
+  osup_bool ok = osup_true;
+  for (i = 0; i < chunkCount; i++) {
+    ok = ok && chunks[i].ok;
+  }
+  if (ok && section == OSUP_BM_SECTION_TIMING_POINTS) {
+    OSUP_BM_JOIN_CHUNKS(timingPoints);
+  } else if (ok) {
+    OSUP_BM_JOIN_CHUNKS(hitObjects);
+    if (ok && (directory->options & OSUP_PARSE_HIT_OBJECT_COLUMNS)) {
+      ok = osup_beatmap_to_hitobject_columns(map);
+    } else if (ok && (directory->options & OSUP_PARSE_COMPACT_HIT_OBJECTS)) {
+      ok = osup_beatmap_to_compact_hitobjects(map);
+    }
+  }
+  /* only the objects of failed chunks are left */
+  for (i = 0; i < chunkCount; i++) {
+    osup_beatmap_free(&chunks[i].map);
+  }
+  osup_free_ptr(chunks);
+  if (!ok) return osup_false;
+
+  directory->parsed |= flag;
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_beatmap_load_string_threaded(osup_bm* map,
+                                                     const char* string,
+                                                     osup_bitfield32 flags,
+                                                     size_t threadCount) {
+  const osup_bitfield32 threadedSections =
+      OSUP_PARSE_TIMING_POINTS | OSUP_PARSE_HIT_OBJECTS;
+  /* the arena is not thread-safe */
+  if (threadCount <= 1 || (flags & OSUP_PARSE_ARENA)) {
+    return osup_beatmap_load_string(map, string, flags);
+  }
+  if (!osup_beatmap_open_string(map, string, flags & ~threadedSections)) {
+    return osup_false;
+  }
+
+  osup_pool* pool = osup_pool_create(threadCount);
+  osup_bool ok = pool != NULL;
+  if (ok && (flags & map->directory.found & OSUP_PARSE_TIMING_POINTS)) {
+    ok = osup_bm_parse_section_threaded(map, OSUP_BM_SECTION_TIMING_POINTS,
+                                        pool);
+  }
+  if (ok && (flags & map->directory.found & OSUP_PARSE_HIT_OBJECTS)) {
+    ok = osup_bm_parse_section_threaded(map, OSUP_BM_SECTION_HIT_OBJECTS, pool);
+  }
+  osup_pool_free(pool);
+  /* like osup_beatmap_load_string, the map doesn't keep the input */
+  memset(&map->directory, 0, sizeof(map->directory));
+  return ok;
+}
+
+/*****************
+ * BATCH LOADING *
+ *****************/
+typedef struct {
+  const char* path;
+  osup_bitfield32 flags;
+  osup_bm_batch_result* result;
+} osup_bm_batch_file;
+
+#ifndef OSUP_NO_LOGGING
+/* keep the first message, it is usually the one that explains the rest */
+OSUP_INTERN void osup_bm_batch_error(const char* err, void* ptr) {
+  osup_bm_batch_result* result = ptr;
+  if (!result->error[0]) {
+    strncpy(result->error, err, sizeof(result->error) - 1);
+  }
+}
+#endif
+
+OSUP_INTERN void osup_bm_batch_load_file(void* ptr) {
+  osup_bm_batch_file* file = ptr;
+  osup_bm_batch_result* result = file->result;
+  osup_mapped_file f;
+#ifndef OSUP_NO_LOGGING
+  /* the calling thread runs parts too, its own callback is put back */
+  void* previousPtr;
+  osup_errcb previous = osup_get_thread_error_callback(&previousPtr);
+  osup_set_thread_error_callback(osup_bm_batch_error, result);
+#endif
+  /* same as osup_beatmap_load, but the size is wanted too */
+  if (!osup_map_file(file->path, &f)) {
+    OSUP_BM_ERROR("unable to read file %s", file->path);
+  } else {
+    result->size = f.size;
+    result->ok = osup_beatmap_load_string(&result->map, f.data, file->flags);
+    if (file->flags & OSUP_PARSE_STRING_VIEWS) {
+      result->map.source = f;
+    } else {
+      osup_unmap_file(&f);
+    }
+  }
+#ifndef OSUP_NO_LOGGING
+  osup_set_thread_error_callback(previous, previousPtr);
+#endif
+}
+
+OSUP_API size_t osup_batch_load(const char* const* paths, size_t count,
+                                osup_bitfield32 flags,
+                                osup_bm_batch_result* results,
+                                size_t threadCount, size_t* usedThreads) {
+  size_t i, loaded = 0;
+  if (usedThreads) *usedThreads = 0;
+  /* nothing to load, and malloc(0) may return NULL */
+  if (!count) return 0;
+  if (!results) {
+    OSUP_BM_ERROR("results is NULL");
+    return 0;
+  }
+  memset(results, 0, count * sizeof(osup_bm_batch_result));
+  osup_bm_batch_file* files = malloc(count * sizeof(osup_bm_batch_file));
+  osup_pool* pool = osup_pool_create(threadCount);
+  if (!files || !pool) {
+    OSUP_BM_ERROR("malloc returns NULL");
+    osup_free_ptr(files);
+    osup_pool_free(pool);
+    return 0;
+  }
+  for (i = 0; i < count; i++) {
+    files[i].path = paths[i];
+    files[i].flags = flags;
+    files[i].result = &results[i];
+  }
+  osup_pool_run(pool, osup_bm_batch_load_file, files,
+                sizeof(osup_bm_batch_file), count);
+  if (usedThreads) *usedThreads = osup_pool_thread_count(pool);
+  osup_pool_free(pool);
+  osup_free_ptr(files);
+  for (i = 0; i < count; i++) {
+    loaded += results[i].ok;
+  }
+  return loaded;
+}
+
+/*******************
+ * BINARY SNAPSHOTS *
+ *******************/
+#define OSUP_BM_BINARY_BYTE_ORDER 0x01020304u
+/* every item of the blob starts at a multiple of this */
+#define OSUP_BM_BINARY_ALIGN 8
+
+/* the writer walks the map twice, first with data NULL to measure the blob,
+ * then again to fill it */
+typedef struct {
+  char* data;
+  size_t size;
+} osup_bm_blob;
+
+OSUP_INTERN size_t osup_bm_blob_reserve(osup_bm_blob* blob, size_t size) {
+  size_t offset = (blob->size + OSUP_BM_BINARY_ALIGN - 1) &
+                  ~(size_t)(OSUP_BM_BINARY_ALIGN - 1);
+  blob->size = offset + size;
+  return offset;
+}
+
+/* copy size bytes into the blob, return what to store in place of src */
+OSUP_INTERN void* osup_bm_blob_put(osup_bm_blob* blob, const void* src,
+                                   size_t size) {
+  if (!src) return NULL;
+  size_t offset = osup_bm_blob_reserve(blob, size);
+  if (blob->data && size) memcpy(blob->data + offset, src, size);
+  return (void*)(uintptr_t)offset;
+}
+
+/* the string is taken from value, or from the view with
+ * OSUP_PARSE_STRING_VIEWS, both end up pointing at one null-terminated copy */
+OSUP_INTERN void osup_bm_blob_put_string(osup_bm_blob* blob, char** value,
+                                         osup_slice* view) {
+  const char* begin = *value ? *value : view->begin;
+  if (!begin) return;
+  size_t length = begin == view->begin ? (size_t)(view->end - view->begin)
+                                       : strlen(begin);
+  size_t offset = osup_bm_blob_reserve(blob, length + 1);
+  if (blob->data) {
+    memcpy(blob->data + offset, begin, length);
+    blob->data[offset + length] = '\0';
+  }
+  *value = (char*)(uintptr_t)offset;
+  view->begin = (const char*)(uintptr_t)offset;
+  view->end = (const char*)(uintptr_t)(offset + length);
+}
+
+/* every table of the storyboard, only the objects, samples and groups have
+ * strings */
+OSUP_INTERN void osup_bm_blob_put_storyboard(osup_bm_blob* blob,
+                                             const osup_sb* sb,
+                                             osup_sb* image) {
+  size_t i, offset;
+  memset(&image->arena, 0, sizeof(image->arena));
+  memset(&image->source, 0, sizeof(image->source));
+  if (sb->objects.elements) {
+    offset = osup_bm_blob_reserve(blob,
+                                  sb->objects.count * sizeof(osup_sb_object));
+    for (i = 0; i < sb->objects.count; i++) {
+      osup_sb_object object = sb->objects.elements[i];
+      osup_bm_blob_put_string(blob, &object.filename, &object.filenameView);
+      if (blob->data) {
+        memcpy(blob->data + offset + i * sizeof(osup_sb_object), &object,
+               sizeof(osup_sb_object));
+      }
+    }
+    image->objects.elements = (osup_sb_object*)(uintptr_t)offset;
+  }
+  if (sb->samples.elements) {
+    offset = osup_bm_blob_reserve(blob,
+                                  sb->samples.count * sizeof(osup_sb_sample));
+    for (i = 0; i < sb->samples.count; i++) {
+      osup_sb_sample sample = sb->samples.elements[i];
+      osup_bm_blob_put_string(blob, &sample.filename, &sample.filenameView);
+      if (blob->data) {
+        memcpy(blob->data + offset + i * sizeof(osup_sb_sample), &sample,
+               sizeof(osup_sb_sample));
+      }
+    }
+    image->samples.elements = (osup_sb_sample*)(uintptr_t)offset;
+  }
+  if (sb->groups.elements) {
+    offset = osup_bm_blob_reserve(blob,
+                                  sb->groups.count * sizeof(osup_sb_group));
+    for (i = 0; i < sb->groups.count; i++) {
+      osup_sb_group group = sb->groups.elements[i];
+      osup_bm_blob_put_string(blob, &group.trigger, &group.triggerView);
+      if (blob->data) {
+        memcpy(blob->data + offset + i * sizeof(osup_sb_group), &group,
+               sizeof(osup_sb_group));
+      }
+    }
+    image->groups.elements = (osup_sb_group*)(uintptr_t)offset;
+  }
+  image->fade.elements = osup_bm_blob_put(
+      blob, sb->fade.elements, sb->fade.count * sizeof(*sb->fade.elements));
+  image->move.elements = osup_bm_blob_put(
+      blob, sb->move.elements, sb->move.count * sizeof(*sb->move.elements));
+  image->moveX.elements = osup_bm_blob_put(
+      blob, sb->moveX.elements, sb->moveX.count * sizeof(*sb->moveX.elements));
+  image->moveY.elements = osup_bm_blob_put(
+      blob, sb->moveY.elements, sb->moveY.count * sizeof(*sb->moveY.elements));
+  image->scale.elements = osup_bm_blob_put(
+      blob, sb->scale.elements, sb->scale.count * sizeof(*sb->scale.elements));
+  image->vectorScale.elements = osup_bm_blob_put(
+      blob, sb->vectorScale.elements,
+      sb->vectorScale.count * sizeof(*sb->vectorScale.elements));
+  image->rotate.elements =
+      osup_bm_blob_put(blob, sb->rotate.elements,
+                       sb->rotate.count * sizeof(*sb->rotate.elements));
+  image->colour.elements =
+      osup_bm_blob_put(blob, sb->colour.elements,
+                       sb->colour.count * sizeof(*sb->colour.elements));
+  image->parameter.elements =
+      osup_bm_blob_put(blob, sb->parameter.elements,
+                       sb->parameter.count * sizeof(*sb->parameter.elements));
+}
+
+OSUP_INTERN void osup_bm_blob_write(osup_bm_blob* blob, const osup_bm* map) {
+  osup_bm image = *map;
+  size_t i, offset;
+  osup_bm_blob_reserve(blob, sizeof(osup_bm_binary_header));
+  size_t imageOffset = osup_bm_blob_reserve(blob, sizeof(osup_bm));
+  memset(&image.hitObjectColumns, 0, sizeof(image.hitObjectColumns));
+  memset(&image.compactHitObjects, 0, sizeof(image.compactHitObjects));
+  memset(&image.arena, 0, sizeof(image.arena));
+  memset(&image.source, 0, sizeof(image.source));
+  memset(&image.directory, 0, sizeof(image.directory));
+
+  osup_bm_blob_put_string(blob, &image.general.audioFilename,
+                          &image.general.audioFilenameView);
+  osup_bm_blob_put_string(blob, &image.general.audioHash,
+                          &image.general.audioHashView);
+  osup_bm_blob_put_string(blob, &image.general.skinPreference,
+                          &image.general.skinPreferenceView);
+  image.editor.bookmarks.elements =
+      osup_bm_blob_put(blob, map->editor.bookmarks.elements,
+                       map->editor.bookmarks.count * sizeof(osup_int));
+  osup_bm_blob_put_string(blob, &image.metadata.title,
+                          &image.metadata.titleView);
+  osup_bm_blob_put_string(blob, &image.metadata.titleUnicode,
+                          &image.metadata.titleUnicodeView);
+  osup_bm_blob_put_string(blob, &image.metadata.artist,
+                          &image.metadata.artistView);
+  osup_bm_blob_put_string(blob, &image.metadata.artistUnicode,
+                          &image.metadata.artistUnicodeView);
+  osup_bm_blob_put_string(blob, &image.metadata.creator,
+                          &image.metadata.creatorView);
+  osup_bm_blob_put_string(blob, &image.metadata.version,
+                          &image.metadata.versionView);
+  osup_bm_blob_put_string(blob, &image.metadata.source,
+                          &image.metadata.sourceView);
+
+  /* the view is the space-separated list, the elements point into a second
+   * copy of it split by '\0' */
+  image.metadata.tags.elements = NULL;
+  if (map->metadata.tagsView.begin) {
+    char* tags = NULL;
+    osup_bm_blob_put_string(blob, &tags, &image.metadata.tagsView);
+    if (map->metadata.tags.elements) {
+      const char* split = map->metadata.tags.elements[0];
+      size_t length = (size_t)(map->metadata.tagsView.end -
+                               map->metadata.tagsView.begin);
+      size_t splitOffset = osup_bm_blob_reserve(blob, length + 1);
+      if (blob->data) memcpy(blob->data + splitOffset, split, length + 1);
+      offset = osup_bm_blob_reserve(blob,
+                                    map->metadata.tags.count * sizeof(char*));
+      for (i = 0; blob->data && i < map->metadata.tags.count; i++) {
+        ((char**)(blob->data + offset))[i] =
+            (char*)(uintptr_t)(splitOffset +
+                               (map->metadata.tags.elements[i] - split));
+      }
+      image.metadata.tags.elements = (char**)(uintptr_t)offset;
+    }
+  }
+
+  if (map->events.elements) {
+    offset = osup_bm_blob_reserve(blob,
+                                  map->events.count * sizeof(osup_event));
+    for (i = 0; i < map->events.count; i++) {
+      osup_event event = map->events.elements[i];
+      /* video events have the same structure */
+      if (event.eventType == OSUP_EVENT_TYPE_BACKGROUND ||
+          event.eventType == OSUP_EVENT_TYPE_VIDEO) {
+        osup_bm_blob_put_string(blob, &event.bg.filename,
+                                &event.bg.filenameView);
+      }
+      if (blob->data) {
+        memcpy(blob->data + offset + i * sizeof(osup_event), &event,
+               sizeof(osup_event));
+      }
+    }
+    image.events.elements = (osup_event*)(uintptr_t)offset;
+  }
+
+  osup_bm_blob_put_storyboard(blob, &map->storyboard, &image.storyboard);
+
+  image.timingPoints.elements =
+      osup_bm_blob_put(blob, map->timingPoints.elements,
+                       map->timingPoints.count * sizeof(osup_timingpoint));
+
+  if (map->hitObjects.elements) {
+    offset = osup_bm_blob_reserve(
+        blob, map->hitObjects.count * sizeof(osup_hitobject));
+    for (i = 0; i < map->hitObjects.count; i++) {
+      osup_hitobject obj = map->hitObjects.elements[i];
+      osup_bm_blob_put_string(blob, &obj.hitSample.filename,
+                              &obj.hitSample.filenameView);
+      if (OSUP_IS_SLIDER(obj.type)) {
+        osup_slider_params* slider = &obj.slider;
+        slider->curvePoints.elements = osup_bm_blob_put(
+            blob, slider->curvePoints.elements,
+            slider->curvePoints.count * sizeof(osup_vec2));
+        slider->edgeSounds.elements = osup_bm_blob_put(
+            blob, slider->edgeSounds.elements,
+            slider->edgeSounds.count * sizeof(osup_int));
+        slider->edgeSets.elements = osup_bm_blob_put(
+            blob, slider->edgeSets.elements,
+            slider->edgeSets.count * sizeof(*slider->edgeSets.elements));
+      }
+      if (blob->data) {
+        memcpy(blob->data + offset + i * sizeof(osup_hitobject), &obj,
+               sizeof(osup_hitobject));
+      }
+    }
+    image.hitObjects.elements = (osup_hitobject*)(uintptr_t)offset;
+  }
+
+  /* so a corrupted string offset can't make a lookup run past the end */
+  offset = osup_bm_blob_reserve(blob, 1);
+  if (!blob->data) return;
+  blob->data[offset] = '\0';
+  memcpy(blob->data + imageOffset, &image, sizeof(osup_bm));
+  osup_bm_binary_header* header = (osup_bm_binary_header*)blob->data;
+  memcpy(header->magic, OSUP_BM_BINARY_MAGIC, sizeof(OSUP_BM_BINARY_MAGIC));
+  header->version = OSUP_BM_BINARY_VERSION;
+  header->byteOrder = OSUP_BM_BINARY_BYTE_ORDER;
+  header->size = blob->size;
+  header->pointerSize = sizeof(void*);
+  header->mapSize = sizeof(osup_bm);
+  header->hitObjectSize = sizeof(osup_hitobject);
+}
+
+OSUP_API osup_bool osup_beatmap_save_binary_buffer(const osup_bm* map,
+                                                   char** data, size_t* size) {
+  osup_bm_blob blob = {0};
+  *data = NULL;
+  *size = 0;
+  if (map->hitObjectColumns.count || map->compactHitObjects.count) {
+    OSUP_BM_ERROR("only map->hitObjects can be saved, not the hit object "
+                  "columns or the compact hit objects");
+    return osup_false;
+  }
+  osup_bm_blob_write(&blob, map);
+  /* calloc so the alignment padding is zeroed too */
+  blob.data = calloc(1, blob.size);
+  if (!blob.data) {
+    OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu", blob.size);
+    return osup_false;
+  }
+  blob.size = 0;
+  osup_bm_blob_write(&blob, map);
+  *data = blob.data;
+  *size = blob.size;
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_beatmap_save_binary(const osup_bm* map,
+                                            const char* file) {
+  char* data;
+  size_t size;
+  if (!osup_beatmap_save_binary_buffer(map, &data, &size)) {
+    return osup_false;
+  }
+  FILE* f = fopen(file, "wb");
+  osup_bool ok = f && fwrite(data, 1, size, f) == size;
+  if (f && fclose(f)) ok = osup_false;
+  if (!ok) OSUP_BM_ERROR("unable to write file %s", file);
+  osup_free_ptr(data);
+  return ok;
+}
+
+/* the image of the map comes right after the header */
+OSUP_INTERN size_t osup_bm_binary_image_offset() {
+  return (sizeof(osup_bm_binary_header) + OSUP_BM_BINARY_ALIGN - 1) &
+         ~(size_t)(OSUP_BM_BINARY_ALIGN - 1);
+}
+
+/* available is the length of the file or buffer the header was read from */
+OSUP_INTERN osup_bool osup_bm_check_binary_header(
+    const osup_bm_binary_header* header, uint64_t available) {
+#if SIZE_MAX < UINT64_MAX
+  /* the blob is loaded in one piece */
+  if (header->size > SIZE_MAX) return osup_false;
+#endif
+  return !memcmp(header->magic, OSUP_BM_BINARY_MAGIC,
+                 sizeof(OSUP_BM_BINARY_MAGIC)) &&
+         header->version == OSUP_BM_BINARY_VERSION &&
+         header->byteOrder == OSUP_BM_BINARY_BYTE_ORDER &&
+         header->pointerSize == sizeof(void*) &&
+         header->mapSize == sizeof(osup_bm) &&
+         header->hitObjectSize == sizeof(osup_hitobject) &&
+         header->size > osup_bm_binary_image_offset() + sizeof(osup_bm) &&
+         header->size <= available;
+}
+
+/* turn the offset stored in *field back into a pointer, after checking that
+ * count items of itemSize bytes fit in the blob */
+OSUP_INTERN osup_bool osup_bm_relocate(char* base, size_t size, void* field,
+                                       size_t count, size_t itemSize) {
+  void* ptr;
+  memcpy(&ptr, field, sizeof(ptr));
+  if (!ptr) return count == 0;
+  uintptr_t offset = (uintptr_t)ptr;
+  if (offset >= size || count > (size - offset) / itemSize ||
+      (itemSize > 1 && offset % OSUP_BM_BINARY_ALIGN)) {
+    return osup_false;
+  }
+  ptr = base + offset;
+  memcpy(field, &ptr, sizeof(ptr));
+  return osup_true;
+}
+
+#define OSUP_BM_RELOCATE(field, count)                                      \
+  if (!osup_bm_relocate(base, size, &(field), (count), sizeof(*(field)))) \
+  return osup_false
+
+OSUP_INTERN osup_bool osup_bm_relocate_string(char* base, size_t size,
+                                              char** value, osup_slice* view) {
+  uintptr_t begin = (uintptr_t)view->begin;
+  uintptr_t end = (uintptr_t)view->end;
+  if (*value && (uintptr_t)*value >= size) return osup_false;
+  if (*value) *value = base + (uintptr_t)*value;
+  if (!begin) return end == 0;
+  /* the last byte of the blob is '\0', so end < size is enough */
+  if (end < begin || end >= size) return osup_false;
+  view->begin = base + begin;
+  view->end = base + end;
+  return osup_true;
+}
+
+#define OSUP_BM_RELOCATE_STRING(value, view)                   \
+  if (!osup_bm_relocate_string(base, size, &(value), &(view))) \
+  return osup_false
+
+OSUP_INTERN osup_bool osup_bm_relocate_map(char* base, size_t size,
+                                           osup_bm* map) {
+  size_t i;
+  char* tags = NULL;
+  OSUP_BM_RELOCATE_STRING(map->general.audioFilename,
+                          map->general.audioFilenameView);
+  OSUP_BM_RELOCATE_STRING(map->general.audioHash, map->general.audioHashView);
+  OSUP_BM_RELOCATE_STRING(map->general.skinPreference,
+                          map->general.skinPreferenceView);
+  OSUP_BM_RELOCATE(map->editor.bookmarks.elements,
+                   map->editor.bookmarks.count);
+  OSUP_BM_RELOCATE_STRING(map->metadata.title, map->metadata.titleView);
+  OSUP_BM_RELOCATE_STRING(map->metadata.titleUnicode,
+                          map->metadata.titleUnicodeView);
+  OSUP_BM_RELOCATE_STRING(map->metadata.artist, map->metadata.artistView);
+  OSUP_BM_RELOCATE_STRING(map->metadata.artistUnicode,
+                          map->metadata.artistUnicodeView);
+  OSUP_BM_RELOCATE_STRING(map->metadata.creator, map->metadata.creatorView);
+  OSUP_BM_RELOCATE_STRING(map->metadata.version, map->metadata.versionView);
+  OSUP_BM_RELOCATE_STRING(map->metadata.source, map->metadata.sourceView);
+  OSUP_BM_RELOCATE_STRING(tags, map->metadata.tagsView);
+  OSUP_BM_RELOCATE(map->metadata.tags.elements, map->metadata.tags.count);
+  for (i = 0; i < map->metadata.tags.count; i++) {
+    OSUP_BM_RELOCATE(map->metadata.tags.elements[i], 1);
+  }
+
+  OSUP_BM_RELOCATE(map->events.elements, map->events.count);
+  for (i = 0; i < map->events.count; i++) {
+    osup_event* event = &map->events.elements[i];
+    if (event->eventType == OSUP_EVENT_TYPE_BACKGROUND ||
+        event->eventType == OSUP_EVENT_TYPE_VIDEO) {
+      OSUP_BM_RELOCATE_STRING(event->bg.filename, event->bg.filenameView);
+    }
+  }
+
+  osup_sb* sb = &map->storyboard;
+  memset(&sb->arena, 0, sizeof(sb->arena));
+  memset(&sb->source, 0, sizeof(sb->source));
+  OSUP_BM_RELOCATE(sb->objects.elements, sb->objects.count);
+  for (i = 0; i < sb->objects.count; i++) {
+    OSUP_BM_RELOCATE_STRING(sb->objects.elements[i].filename,
+                            sb->objects.elements[i].filenameView);
+  }
+  OSUP_BM_RELOCATE(sb->samples.elements, sb->samples.count);
+  for (i = 0; i < sb->samples.count; i++) {
+    OSUP_BM_RELOCATE_STRING(sb->samples.elements[i].filename,
+                            sb->samples.elements[i].filenameView);
+  }
+  OSUP_BM_RELOCATE(sb->groups.elements, sb->groups.count);
+  for (i = 0; i < sb->groups.count; i++) {
+    OSUP_BM_RELOCATE_STRING(sb->groups.elements[i].trigger,
+                            sb->groups.elements[i].triggerView);
+  }
+  OSUP_BM_RELOCATE(sb->fade.elements, sb->fade.count);
+  OSUP_BM_RELOCATE(sb->move.elements, sb->move.count);
+  OSUP_BM_RELOCATE(sb->moveX.elements, sb->moveX.count);
+  OSUP_BM_RELOCATE(sb->moveY.elements, sb->moveY.count);
+  OSUP_BM_RELOCATE(sb->scale.elements, sb->scale.count);
+  OSUP_BM_RELOCATE(sb->vectorScale.elements, sb->vectorScale.count);
+  OSUP_BM_RELOCATE(sb->rotate.elements, sb->rotate.count);
+  OSUP_BM_RELOCATE(sb->colour.elements, sb->colour.count);
+  OSUP_BM_RELOCATE(sb->parameter.elements, sb->parameter.count);
+  /* the commands refer to the objects and groups by index */
+  if (!osup_storyboard_check(sb)) return osup_false;
+
+  OSUP_BM_RELOCATE(map->timingPoints.elements, map->timingPoints.count);
+
+  OSUP_BM_RELOCATE(map->hitObjects.elements, map->hitObjects.count);
+  for (i = 0; i < map->hitObjects.count; i++) {
+    osup_hitobject* obj = &map->hitObjects.elements[i];
+    OSUP_BM_RELOCATE_STRING(obj->hitSample.filename,
+                            obj->hitSample.filenameView);
+    if (OSUP_IS_SLIDER(obj->type)) {
+      OSUP_BM_RELOCATE(obj->slider.curvePoints.elements,
+                       obj->slider.curvePoints.count);
+      OSUP_BM_RELOCATE(obj->slider.edgeSounds.elements,
+                       obj->slider.edgeSounds.count);
+      OSUP_BM_RELOCATE(obj->slider.edgeSets.elements,
+                       obj->slider.edgeSets.count);
+    }
+  }
+  return osup_true;
+}
+
+/* base is the only block of arena, the map takes it over on success */
+OSUP_INTERN osup_bool osup_bm_load_blob(osup_bm* map, osup_arena* arena,
+                                        char* base, size_t size) {
+  const osup_bm_binary_header* header = (const osup_bm_binary_header*)base;
+  if (header->size != size || base[size - 1] != '\0') {
+    OSUP_BM_ERROR("binary snapshot is truncated");
+    return osup_false;
+  }
+  osup_bm* image = (osup_bm*)(base + osup_bm_binary_image_offset());
+  /* these are never saved, don't trust whatever the blob says */
+  memset(&image->hitObjectColumns, 0, sizeof(image->hitObjectColumns));
+  memset(&image->compactHitObjects, 0, sizeof(image->compactHitObjects));
+  memset(&image->arena, 0, sizeof(image->arena));
+  memset(&image->source, 0, sizeof(image->source));
+  memset(&image->directory, 0, sizeof(image->directory));
+  if (!osup_bm_relocate_map(base, size, image)) {
+    OSUP_BM_ERROR("binary snapshot is corrupted");
+    return osup_false;
+  }
+  *map = *image;
+  map->arena = *arena;
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_beatmap_load_binary_buffer(osup_bm* map,
+                                                   const void* data,
+                                                   size_t size) {
+  osup_arena arena = {0};
+  osup_bm_binary_header header;
+  if (size < sizeof(header)) {
+    OSUP_BM_ERROR("binary snapshot is truncated");
+    return osup_false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (!osup_bm_check_binary_header(&header, size)) {
+    OSUP_BM_ERROR("not a binary snapshot (or from another version)");
+    return osup_false;
+  }
+  /* anything after the blob is not part of it */
+  size = (size_t)header.size;
+  char* base = osup_arena_alloc(&arena, size);
+  if (!base) {
+    OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu", size);
+    return osup_false;
+  }
+  memcpy(base, data, size);
+  if (!osup_bm_load_blob(map, &arena, base, size)) {
+    osup_arena_free(&arena);
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_beatmap_load_binary(osup_bm* map, const char* file) {
+  osup_arena arena = {0};
+  osup_bm_binary_header header;
+  FILE* f = fopen(file, "rb");
+  if (!f) {
+    OSUP_BM_ERROR("unable to read file %s", file);
+    return osup_false;
+  }
+  /* the header tells the size, so the blob is read straight into the arena
+   * without an intermediate buffer, the file length bounds the allocation */
+  long length = -1;
+  if (!fseek(f, 0, SEEK_END)) length = ftell(f);
+  if (length < 0 || fseek(f, 0, SEEK_SET) ||
+      fread(&header, sizeof(header), 1, f) != 1 ||
+      !osup_bm_check_binary_header(&header, (uint64_t)length)) {
+    OSUP_BM_ERROR("%s is not a binary snapshot (or from another version)",
+                  file);
+    fclose(f);
+    return osup_false;
+  }
+  size_t size = (size_t)header.size;
+  char* base = osup_arena_alloc(&arena, size);
+  if (!base) {
+    OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu", size);
+    fclose(f);
+    return osup_false;
+  }
+  memcpy(base, &header, sizeof(header));
+  size_t rest = size - sizeof(header);
+  osup_bool ok = fread(base + sizeof(header), 1, rest, f) == rest;
+  fclose(f);
+  if (!ok) {
+    OSUP_BM_ERROR("%s is truncated", file);
+  } else {
+    ok = osup_bm_load_blob(map, &arena, base, size);
+  }
+  if (!ok) osup_arena_free(&arena);
+  return ok;
+}
+
+/************
+ * VISITORS *
+ ************/
+OSUP_API osup_bool osup_beatmap_visit_string(const char* string,
+                                             const osup_bm_visitor* visitor,
+                                             osup_bitfield32 flags) {
+  /* the parsers still want a map, but nothing is stored in it */
+  osup_bm map;
+  osup_arena scratch;
+  osup_bm_ctx ctx;
+  const char* line;
+  osup_bool ret;
+  memset(&map, 0, sizeof(map));
+  memset(&scratch, 0, sizeof(scratch));
+  osup_bm_init_ctx(&ctx, &map,
+                   (flags & OSUP_PARSE_ALL) | OSUP_PARSE_STRING_VIEWS);
+  ctx.arena = &scratch;
+  ctx.visitor = visitor;
+  if (!osup_bm_parse_header(&ctx, string, &line)) {
+    return osup_false;
+  }
+  ret = osup_bm_parse_lines(&ctx, string, line, NULL);
+  osup_arena_free(&scratch);
+  return ret;
+}
+
+OSUP_API osup_bool osup_beatmap_visit(const char* file,
+                                      const osup_bm_visitor* visitor,
+                                      osup_bitfield32 flags) {
+  osup_mapped_file f;
+  if (!osup_map_file(file, &f)) {
+    OSUP_BM_ERROR("unable to read file %s", file);
+    return osup_false;
+  }
+  osup_bool ret = osup_beatmap_visit_string(f.data, visitor, flags);
+  osup_unmap_file(&f);
+  return ret;
+}
+
+/***********************
+ * HIT OBJECT ITERATOR *
+ ***********************/
+OSUP_API osup_bool osup_hitobject_iter_begin(osup_hitobject_iter* iter,
+                                             const char* string) {
+  osup_bm_ctx ctx;
+  osup_bm_directory directory;
+  const char* line;
+  osup_slice range;
+  memset(iter, 0, sizeof(*iter));
+  osup_bm_init_ctx(&ctx, NULL, 0);
+  if (!osup_bm_parse_header(&ctx, string, &line)) {
+    iter->failed = osup_true;
+    return osup_false;
+  }
+  /* only the headers are looked at, the other sections are skipped */
+  memset(&directory, 0, sizeof(directory));
+  osup_bm_build_directory(&directory, line);
+  range =
+      directory.sections[osup_bm_section_index(OSUP_BM_SECTION_HIT_OBJECTS)];
+  iter->line = range.begin;
+  iter->end = range.end;
+  return osup_true;
+}
 
+OSUP_API const osup_hitobject* osup_hitobject_iter_next(
+    osup_hitobject_iter* iter) {
+  osup_bm_ctx ctx;
+  if (iter->failed || !iter->line) return NULL;
+  osup_bm_init_ctx(&ctx, NULL,
+                   OSUP_PARSE_HIT_OBJECTS | OSUP_PARSE_STRING_VIEWS);
+  ctx.arena = &iter->scratch;
+  ctx.section = OSUP_BM_SECTION_HIT_OBJECTS;
+  while (iter->line < iter->end && *iter->line) {
+    switch (*iter->line) {
+      case '\r':
+      case '\n':
+        ++iter->line;
+        continue;
+      case '/':
+        osup_advance_to_next_line(&iter->line, osup_false);
+        continue;
+    }
+    /* the slider arrays of the previous object are not needed anymore */
+    osup_arena_reset(&iter->scratch);
+    memset(&iter->current, 0, sizeof(iter->current));
+    if (!osup_bm_parse_hit_objects_line(&ctx, &iter->line, &iter->current)) {
+      iter->failed = osup_true;
+      return NULL;
+    }
+    return &iter->current;
+  }
+  return NULL;
+}
+
+OSUP_API void osup_hitobject_iter_end(osup_hitobject_iter* iter) {
+  osup_arena_free(&iter->scratch);
+  iter->line = iter->end = NULL;
+}
+
+/******************
+ * CHUNKED INPUT *
+ ******************/
+/* the input arrives in chunks of any size, complete lines are parsed right in
+ * the chunk, only a line that spans chunks is copied into the carry-over
+ * buffer, so memory is bounded by the longest line */
+typedef struct {
+  osup_bm_ctx ctx;
+  osup_bool headerParsed;
+  /* the start of a line whose end is in a later chunk, always
+   * null-terminated */
+  char* carry;
+  size_t carryLength;
+  size_t carryCapacity;
+  /* only for error messages */
+  size_t chunkCount;
+} osup_bm_chunk_state;
+
+OSUP_INTERN void osup_bm_init_chunk_state(osup_bm_chunk_state* state,
+                                          osup_bm* map,
+                                          osup_bitfield32 flags) {
+  memset(state, 0, sizeof(*state));
+  /* the chunks are gone after parsing, so strings are always copied */
+  osup_bm_init_ctx(&state->ctx, map, flags & ~OSUP_PARSE_STRING_VIEWS);
+}
+
+OSUP_INTERN void osup_bm_free_chunk_state(osup_bm_chunk_state* state) {
+  osup_free_ptr(state->carry);
+  state->carry = NULL;
+  state->carryLength = state->carryCapacity = 0;
+}
+
+/* parse [begin, end), which only contains complete lines */
+OSUP_INTERN osup_bool osup_bm_parse_complete_lines(osup_bm_chunk_state* state,
+                                                   const char* begin,
+                                                   const char* end) {
+  const char* line = begin;
+  if (!state->headerParsed) {
+    if (!osup_bm_parse_header(&state->ctx, begin, &line)) {
+      return osup_false;
+    }
+    state->headerParsed = osup_true;
+  }
+  if (!osup_bm_parse_lines(&state->ctx, begin, line, end)) {
+    OSUP_BM_ERROR("(counted from the start of chunk %zu)", state->chunkCount);
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_bm_append_carry(osup_bm_chunk_state* state,
+                                           const char* data, size_t size) {
+  if (state->carryLength + size + 1 > state->carryCapacity) {
+    size_t capacity = state->carryCapacity ? state->carryCapacity : 256;
+    while (state->carryLength + size + 1 > capacity) capacity *= 2;
+    char* carry = realloc(state->carry, capacity);
+    if (!carry) {
+      OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu", capacity);
+      return osup_false;
+    }
+    state->carry = carry;
+    state->carryCapacity = capacity;
+  }
+  memcpy(state->carry + state->carryLength, data, size);
+  state->carryLength += size;
+  state->carry[state->carryLength] = '\0';
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_bm_feed_chunk(osup_bm_chunk_state* state,
+                                         const char* chunk, size_t size) {
+  const char* end = chunk + size;
+  const char* lastNewline;
+  state->chunkCount++;
+  if (osup_bm_is_done(&state->ctx)) return osup_true;
+
+  if (state->carryLength) {
+    /* finish the line started in an earlier chunk */
+    const char* newline = memchr(chunk, '\n', size);
+    if (!newline) {
+      return osup_bm_append_carry(state, chunk, size);
+    }
+    if (!osup_bm_append_carry(state, chunk, (size_t)(newline + 1 - chunk)) ||
+        !osup_bm_parse_complete_lines(state, state->carry,
+                                      state->carry + state->carryLength)) {
+      return osup_false;
+    }
+    state->carryLength = 0;
+    chunk = newline + 1;
+  }
+
+  /* everything up to the last '\n' is complete lines */
+  lastNewline = end;
+  while (lastNewline > chunk && lastNewline[-1] != '\n') --lastNewline;
+  if (lastNewline > chunk &&
+      !osup_bm_parse_complete_lines(state, chunk, lastNewline)) {
+    return osup_false;
+  }
+  if (lastNewline < end && !osup_bm_is_done(&state->ctx)) {
+    return osup_bm_append_carry(state, lastNewline,
+                                (size_t)(end - lastNewline));
+  }
   return osup_true;
 }
 
+/* the last line doesn't need a line terminator */
+OSUP_INTERN osup_bool osup_bm_finish_chunks(osup_bm_chunk_state* state) {
+  if (state->carryLength && !osup_bm_is_done(&state->ctx) &&
+      !osup_bm_parse_complete_lines(state, state->carry,
+                                    state->carry + state->carryLength)) {
+    return osup_false;
+  }
+  if (!state->headerParsed) {
+    OSUP_BM_ERROR("invalid header");
+    return osup_false;
+  }
+  return osup_true;
+}
+
+struct osup_bm_parser {
+  osup_bm_chunk_state state;
+  /* once feeding fails, the map is in an unknown state, reject everything */
+  osup_bool failed;
+};
+
+OSUP_API osup_bm_parser* osup_bm_parser_init(osup_bm* map,
+                                             osup_bitfield32 flags) {
+  osup_bm_parser* parser = malloc(sizeof(*parser));
+  if (!parser) {
+    OSUP_BM_ERROR("malloc returns NULL, malloc size: %zu", sizeof(*parser));
+    return NULL;
+  }
+  osup_bm_init_chunk_state(&parser->state, map, flags);
+  parser->failed = osup_false;
+  return parser;
+}
+
+OSUP_API osup_bool osup_bm_parser_feed(osup_bm_parser* parser,
+                                       const char* bytes, size_t length) {
+  if (parser->failed) return osup_false;
+  if (!osup_bm_feed_chunk(&parser->state, bytes, length)) {
+    parser->failed = osup_true;
+  }
+  return !parser->failed;
+}
+
+OSUP_API osup_bool osup_bm_parser_is_done(const osup_bm_parser* parser) {
+  return osup_bm_is_done(&parser->state.ctx);
+}
+
+OSUP_API osup_bool osup_bm_parser_finish(osup_bm_parser* parser) {
+  osup_bool ret = !parser->failed && osup_bm_finish_chunks(&parser->state);
+  osup_bm_free_chunk_state(&parser->state);
+  free(parser);
+  return ret;
+}
+
 OSUP_API osup_bool osup_beatmap_load_callbacks(osup_bm* map,
                                                osup_bm_callback callback,
                                                void* ptr,
                                                osup_bitfield32 flags) {
-  return osup_true;
+  osup_bm_chunk_state state;
+  osup_bool ret = osup_true;
+  const char* chunk;
+  size_t size;
+  osup_bm_init_chunk_state(&state, map, flags);
+  /* stop pulling chunks as soon as every requested section is parsed */
+  while (ret && !osup_bm_is_done(&state.ctx) &&
+         (chunk = callback(ptr, &size)) && size) {
+    ret = osup_bm_feed_chunk(&state, chunk, size);
+  }
+  if (ret) ret = osup_bm_finish_chunks(&state);
+  osup_bm_free_chunk_state(&state);
+  return ret;
 }
 
 OSUP_API osup_bool osup_beatmap_load_stream(osup_bm* map, FILE* file,
                                             osup_bitfield32 flags) {
+  return osup_beatmap_load_stream_with_capacity(map, file, flags, NULL);
+}
+
+OSUP_API osup_bool osup_beatmap_load_stream_with_capacity(
+    osup_bm* map, FILE* file, osup_bitfield32 flags,
+    const osup_bm_capacity* capacity) {
   OSUP_STORAGE size_t defaultBufSize = 32;
 
   char header[sizeof("osu file format v") - 1];
@@ -1209,13 +3166,13 @@ OSUP_API osup_bool osup_beatmap_load_stream(osup_bm* map, FILE* file,
     return osup_false;
   }
 
-  osup_bm_ctx ctx = {};
-  ctx.map = map;
-  ctx.parseFlags = flags;
+  /* the line buffer is reused, so strings always have to be copied */
+  osup_bm_ctx ctx;
+  osup_bm_init_ctx(&ctx, map, flags & ~OSUP_PARSE_STRING_VIEWS);
 
   size_t i = 0;
   while (i < sizeof(ctx.version)) {
-    if (fread(&ctx.version[i], 1, 1, file) != -1) {
+    if (fread(&ctx.version[i], 1, 1, file) == 1) {
       if (osup_is_line_terminator(ctx.version[i])) {
         ctx.version[i] = '\0';
         goto success;
@@ -1236,11 +3193,16 @@ success:
     OSUP_BM_ERROR("unsupported .osu version: %s", ctx.version);
     return osup_false;
   }
+  if (capacity && !osup_bm_reserve(&ctx, capacity)) {
+    OSUP_BM_ERROR("malloc returns NULL");
+    return osup_false;
+  }
   /* TODO: make this not depend on getline function */
   size_t bufSize = 32;
   char* line = malloc(defaultBufSize);
   size_t lineNumber = 2;
-  while (getline(&line, &bufSize, file) != -1) {
+  /* stop reading as soon as every requested section is parsed */
+  while (!osup_bm_is_done(&ctx) && getline(&line, &bufSize, file) != -1) {
     const char* lineConst = line;
     if (!osup_bm_nextline(&ctx, &lineConst)) {
       OSUP_BM_ERROR("error on line %zu", lineNumber);
@@ -1272,6 +3234,14 @@ OSUP_API void osup_hitobject_free(osup_hitobject* obj) {
 }
 
 OSUP_API void osup_beatmap_free(osup_bm* map) {
+  osup_unmap_file(&map->source);
+  if (map->arena.blocks) {
+    /* everything lives in the arena, no need to look at the objects */
+    osup_arena_free(&map->arena);
+    memset(map, 0, sizeof(*map));
+    return;
+  }
+
   osup_free_ptr(map->general.audioFilename);
   osup_free_ptr(map->general.audioHash);
   osup_free_ptr(map->general.skinPreference);
@@ -1284,9 +3254,10 @@ OSUP_API void osup_beatmap_free(osup_bm* map) {
   osup_free_ptr(map->metadata.version);
   osup_free_ptr(map->metadata.source);
 
-  /* tags are stored in a flat array of chars */
+  /* the view and the split tags are one buffer, the view is only owned by the
+   * map when the tags were split */
   if (map->metadata.tags.elements) {
-    osup_free_ptr(map->metadata.tags.elements[0]);
+    osup_free_ptr((char*)map->metadata.tagsView.begin);
     osup_free_ptr(map->metadata.tags.elements);
   }
 
@@ -1295,6 +3266,7 @@ OSUP_API void osup_beatmap_free(osup_bm* map) {
     osup_event_free(&map->events.elements[i++]);
   }
   osup_free_ptr(map->events.elements);
+  osup_storyboard_free(&map->storyboard);
   osup_free_ptr(map->timingPoints.elements);
 
   i = 0;
@@ -1303,6 +3275,41 @@ OSUP_API void osup_beatmap_free(osup_bm* map) {
   }
   osup_free_ptr(map->hitObjects.elements);
 
+  osup_bm_hitobject_columns* columns = &map->hitObjectColumns;
+  for (i = 0; i < columns->sliders.count; i++) {
+    osup_slider_params* slider = &columns->sliders.elements[i];
+    osup_free_ptr(slider->curvePoints.elements);
+    osup_free_ptr(slider->edgeSounds.elements);
+    osup_free_ptr(slider->edgeSets.elements);
+  }
+  for (i = 0; i < columns->hitSamples.count; i++) {
+    osup_free_ptr(columns->hitSamples.elements[i].hitSample.filename);
+  }
+  osup_free_ptr(columns->x);
+  osup_free_ptr(columns->y);
+  osup_free_ptr(columns->time);
+  osup_free_ptr(columns->type);
+  osup_free_ptr(columns->hitSound);
+  osup_free_ptr(columns->payload);
+  osup_free_ptr(columns->sliders.elements);
+  osup_free_ptr(columns->endTimes.elements);
+  osup_free_ptr(columns->hitSamples.elements);
+
+  osup_bm_compact_hitobjects* compact = &map->compactHitObjects;
+  for (i = 0; i < compact->sliders.count; i++) {
+    osup_slider_params* slider = &compact->sliders.elements[i];
+    osup_free_ptr(slider->curvePoints.elements);
+    osup_free_ptr(slider->edgeSounds.elements);
+    osup_free_ptr(slider->edgeSets.elements);
+  }
+  for (i = 0; i < compact->hitSamples.count; i++) {
+    osup_free_ptr(compact->hitSamples.elements[i].hitSample.filename);
+  }
+  osup_free_ptr(compact->elements);
+  osup_free_ptr(compact->sliders.elements);
+  osup_free_ptr(compact->endTimes.elements);
+  osup_free_ptr(compact->hitSamples.elements);
+
   /* reset everything to 0 */
   memset(map, 0, sizeof(*map));
 }
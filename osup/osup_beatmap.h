@@ -27,6 +27,7 @@ extern "C" {
 #include <stdio.h>
 
 #include "osup_common.h"
+#include "osup_storyboard.h"
 
 #define OSUP_FLAG(x) (1 << (x))
 #define OSUP_IS_HITCIRCLE(type) (type & OSUP_FLAG(0))
@@ -47,6 +48,28 @@ extern "C" {
    OSUP_PARSE_DIFFICULTY | OSUP_PARSE_TIMING_POINTS | OSUP_PARSE_EVENTS | \
    OSUP_PARSE_COLORS | OSUP_PARSE_HIT_OBJECTS)
 
+/* parsing options, these can be combined with the section flags above */
+/* allocate everything from a few big blocks owned by the map, so
+ * osup_beatmap_free is O(1) no matter how many objects there are */
+#define OSUP_PARSE_ARENA OSUP_FLAG(16)
+/* don't copy strings, only fill the *View slices, which point into the parsed
+ * input:
+ * - osup_beatmap_load_string: the caller's string, it must outlive the map
+ * - osup_beatmap_load: the file stays mapped until osup_beatmap_free
+ * - osup_beatmap_load_stream: ignored, the line buffer is reused so strings are
+ *   always copied
+ * the char* fields (and tags.elements) are left NULL */
+#define OSUP_PARSE_STRING_VIEWS OSUP_FLAG(17)
+/* store the hit objects in map->hitObjectColumns instead of map->hitObjects */
+#define OSUP_PARSE_HIT_OBJECT_COLUMNS OSUP_FLAG(18)
+/* store the hit objects in map->compactHitObjects instead of map->hitObjects,
+ * ignored together with OSUP_PARSE_HIT_OBJECT_COLUMNS */
+#define OSUP_PARSE_COMPACT_HIT_OBJECTS OSUP_FLAG(19)
+/* also parse the storyboard of [Events] (sprites, animations, samples and
+ * their commands) into map->storyboard, only with OSUP_PARSE_EVENTS. a broken
+ * storyboard is reported and left empty, the map still loads */
+#define OSUP_PARSE_STORYBOARD OSUP_FLAG(20)
+
 typedef enum {
   OSUP_SAMPLESET_DEFAULT = 0,
   OSUP_SAMPLESET_NORMAL = 1,
@@ -87,6 +110,11 @@ typedef struct {
   osup_bool specialStyle;
   osup_bool widescreenStoryboard;
   osup_bool samplesMatchPlaybackRate;
+
+  /* views of the strings above, these are set in every parse mode */
+  osup_slice audioFilenameView;
+  osup_slice audioHashView;
+  osup_slice skinPreferenceView;
 } osup_bm_general;
 
 typedef struct {
@@ -114,6 +142,17 @@ typedef struct {
   } tags;
   osup_int beatmapID;
   osup_int beatmapSetID;
+
+  /* views of the strings above, these are set in every parse mode */
+  osup_slice titleView;
+  osup_slice titleUnicodeView;
+  osup_slice artistView;
+  osup_slice artistUnicodeView;
+  osup_slice creatorView;
+  osup_slice versionView;
+  osup_slice sourceView;
+  /* the whole space-separated list */
+  osup_slice tagsView;
 } osup_bm_metadata;
 
 typedef struct {
@@ -135,6 +174,7 @@ typedef struct {
   char* filename;
   osup_int xOffset;
   osup_int yOffset;
+  osup_slice filenameView;
 } osup_bg_event_params;
 
 /* same structure */
@@ -194,6 +234,7 @@ typedef struct {
   osup_int index;
   osup_int volume;
   char* filename;
+  osup_slice filenameView;
 } osup_hitsample;
 
 typedef enum {
@@ -251,21 +292,167 @@ typedef struct {
   size_t count;
 } osup_bm_hitobjects;
 
+/* the payload column value of objects without a payload */
+#define OSUP_NO_PAYLOAD ((uint32_t)-1)
+
+typedef struct {
+  size_t object;
+  osup_hitsample hitSample;
+} osup_hitsample_entry;
+
+/* the side tables of the column and compact layouts */
+typedef struct {
+  osup_slider_params* elements;
+  size_t count;
+} osup_bm_sliders;
+
+typedef struct {
+  osup_int* elements;
+  size_t count;
+} osup_bm_end_times;
+
+/* only the objects whose hit sample is not all default, sorted by object */
+typedef struct {
+  osup_hitsample_entry* elements;
+  size_t count;
+} osup_bm_hitsamples;
+
+/* the hit objects as columns, for passes that only read one or two fields of
+ * every object, object i is x[i], y[i], time[i], ... */
+typedef struct {
+  size_t count;
+  osup_int* x;
+  osup_int* y;
+  osup_int* time;
+  osup_bitfield8* type;
+  osup_bitfield8* hitSound;
+  /* index into sliders for sliders, into endTimes for spinners and mania
+   * holds, OSUP_NO_PAYLOAD for circles */
+  uint32_t* payload;
+  osup_bm_sliders sliders;
+  osup_bm_end_times endTimes;
+  osup_bm_hitsamples hitSamples;
+} osup_bm_hitobject_columns;
+
+/* 24 bytes instead of sizeof(osup_hitobject), what doesn't fit is kept in the
+ * side tables of osup_bm_compact_hitobjects, use the accessors below */
+typedef struct {
+  osup_int x;
+  osup_int y;
+  osup_int time;
+  osup_bitfield8 type;
+  osup_bitfield8 hitSound;
+  /* same meaning as osup_bm_hitobject_columns.payload */
+  uint32_t payload;
+  /* index into hitSamples, OSUP_NO_PAYLOAD for the default hit sample */
+  uint32_t hitSample;
+} osup_compact_hitobject;
+
+typedef struct {
+  osup_compact_hitobject* elements;
+  size_t count;
+  osup_bm_sliders sliders;
+  osup_bm_end_times endTimes;
+  osup_bm_hitsamples hitSamples;
+} osup_bm_compact_hitobjects;
+
+/* where the sections are in the input, the index is the bit of the section's
+ * OSUP_PARSE_* flag, e.g. sections[4] is [TimingPoints] */
+#define OSUP_BM_SECTION_COUNT 8
+typedef struct {
+  /* the lines after the section header, begin is NULL if the section is
+   * missing */
+  osup_slice sections[OSUP_BM_SECTION_COUNT];
+  /* OSUP_PARSE_* flags of the sections that exist/are already parsed */
+  osup_bitfield32 found;
+  osup_bitfield32 parsed;
+  /* the parsing options given to osup_beatmap_open, e.g. OSUP_PARSE_ARENA */
+  osup_bitfield32 options;
+  const char* input;
+} osup_bm_directory;
+
 typedef struct {
   osup_bm_general general;
   osup_bm_editor editor;
   osup_bm_metadata metadata;
   osup_bm_difficulty difficulty;
   osup_bm_events events;
+  /* only used with OSUP_PARSE_STORYBOARD */
+  osup_sb storyboard;
   osup_bm_timingpoints timingPoints;
   union {
     osup_bm_colours colours;
     osup_bm_colors colors;
   };
   osup_bm_hitobjects hitObjects;
+  /* only used with OSUP_PARSE_HIT_OBJECT_COLUMNS or after
+   * osup_beatmap_to_hitobject_columns */
+  osup_bm_hitobject_columns hitObjectColumns;
+  /* only used with OSUP_PARSE_COMPACT_HIT_OBJECTS or after
+   * osup_beatmap_to_compact_hitobjects */
+  osup_bm_compact_hitobjects compactHitObjects;
+
+  /* only used with OSUP_PARSE_ARENA, every pointer above points into it */
+  osup_arena arena;
+  /* only used with OSUP_PARSE_STRING_VIEWS in osup_beatmap_load and with
+   * osup_beatmap_open, the views above point into it */
+  osup_mapped_file source;
+  /* only used with osup_beatmap_open */
+  osup_bm_directory directory;
 } osup_bm;
 
-typedef const char* (*osup_bm_callback)(void*);
+/* streaming without building a map, every line is parsed into a record that is
+ * only valid during the callback (strings are views into the input, slider
+ * arrays live in a scratch arena that is reset after every hit object), so
+ * memory use doesn't depend on the size of the map
+ * callbacks may be NULL, returning osup_false from a callback stops parsing
+ * (the visit function still returns osup_true) */
+typedef struct {
+  void* userData;
+  /* every line of the key-value sections, section is the OSUP_PARSE_* flag of
+   * the section, e.g. OSUP_PARSE_METADATA */
+  osup_bool (*on_kv)(void* userData, osup_bitfield32 section, osup_slice key,
+                     osup_slice value);
+  /* only background, video and break events, storyboards are skipped */
+  osup_bool (*on_event)(void* userData, const osup_event* event);
+  osup_bool (*on_timing_point)(void* userData,
+                               const osup_timingpoint* timingPoint);
+  osup_bool (*on_hit_object)(void* userData, const osup_hitobject* hitObject);
+} osup_bm_visitor;
+
+/* walk the hit objects of an in-memory .osu file one at a time, without
+ * parsing anything else
+ *   osup_hitobject_iter iter;
+ *   const osup_hitobject* obj;
+ *   osup_hitobject_iter_begin(&iter, string);
+ *   while ((obj = osup_hitobject_iter_next(&iter))) { ... }
+ *   osup_hitobject_iter_end(&iter);
+ * the returned object is overwritten by the next call, its strings are views
+ * into the string (which must outlive the iterator), failed tells a parse error
+ * apart from the end of the section */
+typedef struct {
+  const char* line;
+  const char* end;
+  osup_hitobject current;
+  /* slider arrays of the current object */
+  osup_arena scratch;
+  osup_bool failed;
+} osup_hitobject_iter;
+
+/* returns the next chunk of the input and stores its size, chunks don't have to
+ * be null-terminated and may end in the middle of a line, a chunk only has to
+ * stay valid until the next call, return NULL (or size 0) at the end */
+typedef const char* (*osup_bm_callback)(void* ptr, size_t* size);
+
+/* the expected number of elements in the list sections, so they can be
+ * allocated once instead of growing line by line, 0 means unknown */
+typedef struct {
+  size_t events;
+  size_t timingPoints;
+  size_t hitObjects;
+  /* with OSUP_PARSE_STORYBOARD */
+  osup_sb_capacity storyboard;
+} osup_bm_capacity;
 
 OSUP_API osup_bool osup_beatmap_load(osup_bm* map, const char* file,
                                      osup_bitfield32 flags);
@@ -276,6 +463,157 @@ OSUP_API osup_bool osup_beatmap_load_callbacks(osup_bm* map,
                                                void* ptr, osup_bitfield32 flags);
 OSUP_API osup_bool osup_beatmap_load_stream(osup_bm* map, FILE* stream,
                                             osup_bitfield32 flags);
+/* the stream can't be scanned twice, so the caller may give a capacity hint
+ * (e.g. from a previous load of the same file) */
+OSUP_API osup_bool osup_beatmap_load_stream_with_capacity(
+    osup_bm* map, FILE* stream, osup_bitfield32 flags,
+    const osup_bm_capacity* capacity);
+
+/* same as osup_beatmap_load_string, but big [TimingPoints] and [HitObjects]
+ * sections are split into line-aligned chunks and parsed on threadCount
+ * threads (the calling thread included), the result is the same map.
+ * everything runs on the calling thread with OSUP_PARSE_ARENA */
+OSUP_API osup_bool osup_beatmap_load_string_threaded(osup_bm* map,
+                                                     const char* string,
+                                                     osup_bitfield32 flags,
+                                                     size_t threadCount);
+
+/* one entry per file of osup_batch_load */
+typedef struct {
+  osup_bm map;
+  osup_bool ok;
+  /* the first error reported for this file, empty if there is none (always
+   * empty with OSUP_NO_LOGGING) */
+  char error[256];
+  /* the file size in bytes */
+  size_t size;
+} osup_bm_batch_result;
+
+/* load every file with osup_beatmap_load on threadCount threads (the calling
+ * thread included), results must have room for count entries and each map
+ * must be freed with osup_beatmap_free, even the failed ones. return the
+ * number of files loaded successfully. the errors go to the results instead
+ * of the error callback, the calling thread's own callback
+ * (osup_set_thread_error_callback) is kept. usedThreads (may be NULL) gets
+ * the number of threads that actually ran, fewer than threadCount if some
+ * couldn't be created */
+OSUP_API size_t osup_batch_load(const char* const* paths, size_t count,
+                                osup_bitfield32 flags,
+                                osup_bm_batch_result* results,
+                                size_t threadCount, size_t* usedThreads);
+
+/* binary snapshots: the whole map in one relocatable blob, every pointer is
+ * stored as an offset from the start of the blob (0 is NULL):
+ *   osup_bm_binary_header
+ *   the osup_bm itself
+ *   the strings, arrays, slider arrays and storyboard tables, 8-byte aligned
+ * loading is a single read and a pass over the pointers, no text is parsed.
+ * the blob is only readable by a build with the same byte order and struct
+ * layout, anything else is rejected (just re-parse the .osu file then) */
+#define OSUP_BM_BINARY_MAGIC "osupbm"
+#define OSUP_BM_BINARY_VERSION 2
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  /* 0x01020304 as written by the machine */
+  uint32_t byteOrder;
+  /* the size of the whole blob, this header included */
+  uint64_t size;
+  /* the struct layout of the build that wrote it */
+  uint32_t pointerSize;
+  uint32_t mapSize;
+  uint32_t hitObjectSize;
+  uint32_t reserved;
+} osup_bm_binary_header;
+
+/* the hit objects must be in map->hitObjects, convert to columns or the
+ * compact layout after loading. the section directory and the mapped source
+ * are not saved, the snapshot only holds what was parsed */
+OSUP_API osup_bool osup_beatmap_save_binary(const osup_bm* map,
+                                            const char* file);
+/* the blob is malloc-ed, free it with free */
+OSUP_API osup_bool osup_beatmap_save_binary_buffer(const osup_bm* map,
+                                                   char** data, size_t* size);
+/* the blob is read into map->arena and used in place, so osup_beatmap_free is
+ * O(1) */
+OSUP_API osup_bool osup_beatmap_load_binary(osup_bm* map, const char* file);
+/* same, data is copied and can be released afterwards */
+OSUP_API osup_bool osup_beatmap_load_binary_buffer(osup_bm* map,
+                                                   const void* data,
+                                                   size_t size);
+
+/* flags select the sections to visit */
+OSUP_API osup_bool osup_beatmap_visit(const char* file,
+                                      const osup_bm_visitor* visitor,
+                                      osup_bitfield32 flags);
+OSUP_API osup_bool osup_beatmap_visit_string(const char* string,
+                                             const osup_bm_visitor* visitor,
+                                             osup_bitfield32 flags);
+
+OSUP_API osup_bool osup_hitobject_iter_begin(osup_hitobject_iter* iter,
+                                             const char* string);
+OSUP_API const osup_hitobject* osup_hitobject_iter_next(
+    osup_hitobject_iter* iter);
+OSUP_API void osup_hitobject_iter_end(osup_hitobject_iter* iter);
+
+/* incremental parsing, feed the input as it arrives (e.g. from a socket or an
+ * inflate stream), in pieces of any size, the bytes only have to stay valid
+ * during the osup_bm_parser_feed call
+ *   osup_bm_parser* parser = osup_bm_parser_init(&map, OSUP_PARSE_ALL);
+ *   while ((n = read(fd, buf, sizeof(buf))) > 0 &&
+ *          !osup_bm_parser_is_done(parser)) {
+ *     if (!osup_bm_parser_feed(parser, buf, n)) break;
+ *   }
+ *   ok = osup_bm_parser_finish(parser);
+ * osup_bm_parser_finish parses the last line and frees the parser, it must be
+ * called even if feeding fails */
+typedef struct osup_bm_parser osup_bm_parser;
+
+OSUP_API osup_bm_parser* osup_bm_parser_init(osup_bm* map,
+                                             osup_bitfield32 flags);
+OSUP_API osup_bool osup_bm_parser_feed(osup_bm_parser* parser,
+                                       const char* bytes, size_t length);
+/* every requested section is parsed, the rest of the input can be dropped */
+OSUP_API osup_bool osup_bm_parser_is_done(const osup_bm_parser* parser);
+OSUP_API osup_bool osup_bm_parser_finish(osup_bm_parser* parser);
+
+/* lazy loading: only find where the sections are, then parse the sections in
+ * flags (which can be none of them), the rest can be parsed later on demand with
+ * osup_bm_parse_section, e.g. show the metadata right away and only parse the
+ * hit objects when the map is selected */
+OSUP_API osup_bool osup_beatmap_open(osup_bm* map, const char* file,
+                                     osup_bitfield32 flags);
+/* same, but the string must outlive the map */
+OSUP_API osup_bool osup_beatmap_open_string(osup_bm* map, const char* string,
+                                            osup_bitfield32 flags);
+/* parse the given sections (OSUP_PARSE_* flags) if they are not parsed yet */
+OSUP_API osup_bool osup_bm_parse_section(osup_bm* map,
+                                         osup_bitfield32 sections);
+
+/* move map->hitObjects into map->hitObjectColumns, map->hitObjects is empty
+ * afterwards */
+OSUP_API osup_bool osup_beatmap_to_hitobject_columns(osup_bm* map);
+/* same, into map->compactHitObjects */
+OSUP_API osup_bool osup_beatmap_to_compact_hitobjects(osup_bm* map);
+
+/* NULL if the object is not a slider */
+OSUP_API const osup_slider_params* osup_compact_hitobject_slider(
+    const osup_bm_compact_hitobjects* list, size_t index);
+/* the end time of spinners and mania holds, the start time otherwise */
+OSUP_API osup_int osup_compact_hitobject_end_time(
+    const osup_bm_compact_hitobjects* list, size_t index);
+/* never NULL, objects without a custom hit sample share an all-0 one with an
+ * empty filename, like the one parsed from "0:0:0:0:" */
+OSUP_API const osup_hitsample* osup_compact_hitobject_hitsample(
+    const osup_bm_compact_hitobjects* list, size_t index);
+/* same for object index of the columns, a binary search of hitSamples */
+OSUP_API const osup_hitsample* osup_hitobject_column_hitsample(
+    const osup_bm_hitobject_columns* columns, size_t index);
+/* fill a full object, the slider arrays and the hit sample filename are still
+ * owned by the list, don't call osup_hitobject_free on it */
+OSUP_API void osup_compact_hitobject_expand(
+    const osup_bm_compact_hitobjects* list, size_t index, osup_hitobject* obj);
 
 OSUP_API void osup_hitobject_free(osup_hitobject* obj);
 OSUP_API void osup_event_free(osup_event* event);
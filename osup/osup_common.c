@@ -1,13 +1,65 @@
+/* strtod_l, it has to come before any system header */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "osup_common.h"
 
-#include <ctype.h>
-#include <math.h>
+#include <float.h>
+#include <locale.h>
 #include <stdarg.h>
 #include <stdio.h>
 
+/* strtod in the C locale, so the decimal point is '.' whatever setlocale the
+ * application did */
+#if defined(_MSC_VER)
+#define OSUP_HAS_STRTOD_L
+typedef _locale_t osup_locale;
+#define osup_new_c_locale() _create_locale(LC_NUMERIC, "C")
+#define osup_strtod_l _strtod_l
+#elif defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__)
+#define OSUP_HAS_STRTOD_L
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+typedef locale_t osup_locale;
+#define osup_new_c_locale() newlocale(LC_NUMERIC_MASK, "C", (locale_t)0)
+#define osup_strtod_l strtod_l
+#endif
+
+#if !defined(OSUP_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define OSUP_HAS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define OSUP_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(OSUP_NO_THREADS)
+#define OSUP_HAS_THREADS
+#include <pthread.h>
+#endif
+
+#if defined(_MSC_VER)
+#define OSUP_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define OSUP_THREAD_LOCAL __thread
+#else
+#define OSUP_THREAD_LOCAL
+#endif
+
 #ifndef OSUP_NO_LOGGING
 OSUP_STORAGE osup_errcb errcb = NULL;
 OSUP_STORAGE void* errcb_ptr = NULL;
+/* takes precedence over errcb on its own thread */
+OSUP_STORAGE OSUP_THREAD_LOCAL osup_errcb threadErrcb = NULL;
+OSUP_STORAGE OSUP_THREAD_LOCAL void* threadErrcbPtr = NULL;
 
 static void osup_stderr_error_callback(const char* err, void* ptr) {
   fprintf(stderr, "[osup] %s\n", err);
@@ -22,18 +74,37 @@ OSUP_API void osup_set_default_error_callback() {
   errcb = osup_stderr_error_callback;
 }
 
+OSUP_API void osup_set_thread_error_callback(osup_errcb callback, void* ptr) {
+  threadErrcb = callback;
+  threadErrcbPtr = ptr;
+}
+
+OSUP_API osup_errcb osup_get_thread_error_callback(void** ptr) {
+  if (ptr) *ptr = threadErrcbPtr;
+  return threadErrcb;
+}
+
+OSUP_LIB osup_bool osup_has_error_callback() {
+  return threadErrcb != NULL || errcb != NULL;
+}
+
 OSUP_LIB void osup_error(const char* format, ...) {
-  if (errcb) {
+  if (threadErrcb || errcb) {
     char buffer[256];
     va_list va;
     va_start(va, format);
     vsnprintf(buffer, sizeof(buffer), format, va);
     va_end(va);
-    errcb(buffer, errcb_ptr);
+    if (threadErrcb) {
+      threadErrcb(buffer, threadErrcbPtr);
+    } else {
+      errcb(buffer, errcb_ptr);
+    }
   }
 }
 
-char osup_temp_slice[256 + 1] = {};
+/* one per thread, so the messages of the batch loader don't get mixed up */
+OSUP_STORAGE OSUP_THREAD_LOCAL char osup_temp_slice[256 + 1];
 OSUP_LIB const char* osup_temp_string_slice(const char* begin,
                                             const char* end) {
   assert(begin <= end);
@@ -75,28 +146,215 @@ OSUP_LIB osup_bool osup_strdup(const char* begin, const char* end,
   }
 }
 
-OSUP_INTERN osup_bool osup_parse_uint(const char* begin, const char* end,
-                                      osup_int* value) {
-  if (begin > end) return osup_false;
-  *value = 0;
-  const char* it = begin;
+OSUP_LIB uint64_t osup_hash(const void* data, size_t size) {
+  const unsigned char* it = data;
+  const unsigned char* end = it + size;
+  uint64_t hash = 14695981039346656037ULL;
   while (it < end) {
-    if (!isdigit(*it)) {
+    hash = (hash ^ *(it++)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+OSUP_LIB void osup_reader_init(osup_reader* reader, const void* data,
+                               size_t size) {
+  reader->it = data;
+  reader->end = reader->it + size;
+  reader->failed = osup_false;
+}
+
+OSUP_LIB const uint8_t* osup_reader_take(osup_reader* reader, size_t size) {
+  const uint8_t* bytes = reader->it;
+  if (reader->failed || (size_t)(reader->end - reader->it) < size) {
+    reader->failed = osup_true;
+    return NULL;
+  }
+  reader->it += size;
+  return bytes;
+}
+
+OSUP_LIB uint64_t osup_reader_uint(osup_reader* reader, size_t size) {
+  const uint8_t* bytes = osup_reader_take(reader, size);
+  uint64_t value = 0;
+  if (!bytes) return 0;
+  while (size--) value = (value << 8) | bytes[size];
+  return value;
+}
+
+OSUP_LIB float osup_reader_single(osup_reader* reader) {
+  uint32_t bits = (uint32_t)osup_reader_uint(reader, 4);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+OSUP_LIB double osup_reader_double(osup_reader* reader) {
+  uint64_t bits = osup_reader_uint(reader, 8);
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+OSUP_LIB osup_slice osup_reader_string(osup_reader* reader) {
+  osup_slice string = {NULL, NULL};
+  uint64_t length = 0;
+  unsigned shift = 0;
+  uint8_t byte;
+  switch (osup_reader_uint(reader, 1)) {
+    case 0x00:
+      return string;
+    case 0x0b:
+      break;
+    default:
+      reader->failed = osup_true;
+      return string;
+  }
+  do {
+    byte = (uint8_t)osup_reader_uint(reader, 1);
+    if (shift > 56) reader->failed = osup_true;
+    if (reader->failed) return string;
+    length |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  if (length > (uint64_t)(reader->end - reader->it)) {
+    reader->failed = osup_true;
+    return string;
+  }
+  string.begin = (const char*)osup_reader_take(reader, (size_t)length);
+  string.end = string.begin + length;
+  return string;
+}
+
+OSUP_INTERN osup_bool osup_is_little_endian() {
+  const uint16_t one = 1;
+  return *(const uint8_t*)&one;
+}
+
+OSUP_INTERN unsigned osup_ctz64(uint64_t v) {
+#ifdef __GNUC__
+  return (unsigned)__builtin_ctzll(v);
+#else
+  unsigned n = 0;
+  while (!(v & 1)) {
+    v >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+/* convert 8 ASCII digits (first digit in the lowest byte) to an integer with
+ * 3 multiplications instead of 8 */
+OSUP_INTERN uint32_t osup_swar_parse_8_digits(uint64_t chunk) {
+  chunk -= 0x3030303030303030ull;
+  chunk = (chunk * 10) + (chunk >> 8);
+  chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+           (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >>
+          32;
+  return (uint32_t)chunk;
+}
+
+OSUP_INTERN osup_bool osup_swar_all_digits(uint64_t chunk) {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0ull) |
+          (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+         0x3333333333333333ull;
+}
+
+/* check if 8 bytes can be loaded from it without crossing a page (4096 is
+ * the smallest page size around, every bigger one is a multiple of it), the
+ * load may read past the end of the string, but it is always readable */
+OSUP_INTERN osup_bool osup_can_load_8_bytes(const char* it) {
+#ifdef OSUP_NO_SIMD
+  return osup_false;
+#else
+  return osup_is_little_endian() && ((uintptr_t)it & 4095) <= 4096 - 8;
+#endif
+}
+
+/* move the first len (1 to 8) bytes of word to the high bytes and pad the
+ * front with '0' characters */
+OSUP_INTERN uint64_t osup_swar_pad_digits(uint64_t word, size_t len) {
+  if (len == 8) return word;
+  return (word << (64 - 8 * len)) | (0x3030303030303030ull >> (8 * len));
+}
+
+/* parse an unsigned integer of at most 8 digits, short numbers (most
+ * coordinates) are faster with plain multiply-adds, longer ones (times) go
+ * through SWAR so there is no branch per digit */
+OSUP_INTERN osup_bool osup_parse_up_to_8_digits(const char* begin, size_t len,
+                                                uint32_t* value) {
+  if (len > 3 && osup_can_load_8_bytes(begin)) {
+    uint64_t chunk;
+    memcpy(&chunk, begin, 8);
+    chunk = osup_swar_pad_digits(chunk, len);
+    if (!osup_swar_all_digits(chunk)) {
       return osup_false;
     }
-    *value = *value * 10 + (*it - '0');
-    ++it;
+    *value = osup_swar_parse_8_digits(chunk);
+    return osup_true;
+  } else {
+    const char* end = begin + len;
+    *value = 0;
+    while (begin < end) {
+      if (*begin < '0' || *begin > '9') return osup_false;
+      *value = *value * 10 + (*(begin++) - '0');
+    }
+    return osup_true;
+  }
+}
+
+/* parse the magnitude of an integer, the result is at most maxValue, anything
+ * bigger is an overflow */
+OSUP_INTERN osup_bool osup_parse_magnitude(const char* begin, const char* end,
+                                           uint32_t maxValue,
+                                           uint32_t* value) {
+  size_t len = end - begin;
+  if (begin > end) return osup_false;
+  if (len <= 8) {
+    return osup_parse_up_to_8_digits(begin, len, value);
+  }
+  /* leading zeros don't count toward the overflow check */
+  while (len > 8 && *begin == '0') {
+    begin++;
+    len--;
+  }
+  /* 10 digits is the most a 32-bit integer can have */
+  if (len > 10) return osup_false;
+  uint32_t high, low;
+  if (!osup_parse_up_to_8_digits(begin, len - 8, &high) ||
+      !osup_parse_up_to_8_digits(begin + len - 8, 8, &low)) {
+    return osup_false;
+  }
+  uint64_t result = (uint64_t)high * 100000000u + low;
+  if (result > maxValue) return osup_false;
+  *value = (uint32_t)result;
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_parse_uint(const char* begin, const char* end,
+                                      osup_int* value) {
+  uint32_t magnitude;
+  if (!osup_parse_magnitude(begin, end, INT32_MAX, &magnitude)) {
+    return osup_false;
   }
+  *value = (osup_int)magnitude;
   return osup_true;
 }
 
+/* the magnitude of INT32_MIN doesn't fit in an osup_int */
+OSUP_INTERN osup_int osup_negate_magnitude(uint32_t magnitude) {
+  return magnitude > INT32_MAX ? INT32_MIN : -(osup_int)magnitude;
+}
+
 OSUP_LIB osup_bool osup_parse_int(const char* begin, const char* end,
                                   osup_int* value) {
   if (*begin == '-') {
-    if (!osup_parse_uint(begin + 1, end, value)) {
+    uint32_t magnitude;
+    if (!osup_parse_magnitude(begin + 1, end, (uint32_t)INT32_MAX + 1,
+                              &magnitude)) {
       return osup_false;
     }
-    *value = -*value;
+    *value = osup_negate_magnitude(magnitude);
     return osup_true;
   } else {
     /* strings like +123 is not supported */
@@ -104,6 +362,52 @@ OSUP_LIB osup_bool osup_parse_int(const char* begin, const char* end,
   }
 }
 
+/* every integer up to 2^53 and every power of ten up to 10^22 is exactly
+ * representable as a double */
+#define OSUP_MAX_EXACT_INT (1ull << 53)
+#define OSUP_MAX_EXACT_POW10 22
+
+OSUP_STORAGE const double osup_exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+#ifdef OSUP_HAS_STRTOD_L
+/* created on the first slow-path decimal and kept until exit, NULL if it
+ * can't be created */
+OSUP_STORAGE osup_locale osup_c_locale;
+
+OSUP_INTERN void osup_init_c_locale() { osup_c_locale = osup_new_c_locale(); }
+
+OSUP_INTERN osup_locale osup_get_c_locale() {
+#ifdef OSUP_HAS_THREADS
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, osup_init_c_locale);
+#else
+  static osup_bool initialized = osup_false;
+  if (!initialized) {
+    osup_init_c_locale();
+    initialized = osup_true;
+  }
+#endif
+  return osup_c_locale;
+}
+#endif
+
+/* the buffer is modified without strtod_l, the locale's decimal point (e.g.
+ * ',' after setlocale(LC_ALL, "de_DE")) replaces the '.' */
+OSUP_INTERN double osup_strtod_c(char* buffer) {
+#ifdef OSUP_HAS_STRTOD_L
+  osup_locale locale = osup_get_c_locale();
+  if (locale) return osup_strtod_l(buffer, NULL, locale);
+#endif
+  {
+    char point = localeconv()->decimal_point[0];
+    char* it = strchr(buffer, '.');
+    if (it && point) *it = point;
+    return strtod(buffer, NULL);
+  }
+}
+
 OSUP_INTERN osup_bool osup_parse_unsigned_decimal(const char* begin,
                                                   const char* end,
                                                   osup_decimal* value) {
@@ -126,47 +430,102 @@ OSUP_INTERN osup_bool osup_parse_unsigned_decimal(const char* begin,
 
     return osup_false;
   }
+  /* the value is mantissa * 10^exp10, only the first 19 significant digits are
+   * kept in the mantissa (so it can't overflow), the rest are dropped and
+   * remembered in truncated */
+  uint64_t mantissa = 0;
+  int significantDigits = 0;
+  long exp10 = 0;
+  osup_bool truncated = osup_false;
+  osup_bool anyDigit = osup_false;
   enum { INT, FRACT } part = INT;
-  *value = 0.0;
-  double mult = 0.1;
   const char* it = begin;
-  while (it < end) {
-    switch (*it) {
-      case '.':
-        if (part == INT) {
-          part = FRACT;
-          ++it;
-        } else {
-          return osup_false;
-        }
-        break;
-      case 'e':
-      case 'E': {
-        /* the exponent part is an integer, so we can use osup_parse_int to
-         * parse it */
-        osup_int exp;
-        ++it;
-        osup_parse_int(begin, end, &exp);
-        *value *= pow(10.0, exp);
+  while (it < end && *it != 'e' && *it != 'E') {
+    if (*it == '.') {
+      if (part == FRACT) return osup_false;
+      part = FRACT;
+    } else if (*it >= '0' && *it <= '9') {
+      int digit = *it - '0';
+      anyDigit = osup_true;
+      if (significantDigits < 19) {
+        mantissa = mantissa * 10 + digit;
+        /* leading zeros are not significant */
+        if (mantissa) significantDigits++;
+        if (part == FRACT) exp10--;
+      } else {
+        truncated |= digit != 0;
+        if (part == INT) exp10++;
+      }
+    } else {
+      return osup_false;
+    }
+    ++it;
+  }
+  if (!anyDigit) return osup_false;
+
+  if (it < end) {
+    /* exponent part: e/E, optional sign and at least one digit */
+    osup_bool negativeExp = osup_false;
+    long exp = 0;
+    ++it;
+    if (it < end && (*it == '-' || *it == '+')) {
+      negativeExp = *(it++) == '-';
+    }
+    if (it == end) return osup_false;
+    while (it < end) {
+      if (*it < '0' || *it > '9') return osup_false;
+      /* clamp it, anything this big is 0 or infinity anyway */
+      if (exp < 100000) exp = exp * 10 + (*it - '0');
+      ++it;
+    }
+    exp10 += negativeExp ? -exp : exp;
+  }
+
+  if (!mantissa) {
+    *value = 0.0;
+    return osup_true;
+  }
+
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+  /* Clinger's fast path: if both the mantissa and the power of ten are exact
+   * doubles, a single IEEE multiplication/division is correctly rounded */
+  if (!truncated && mantissa <= OSUP_MAX_EXACT_INT) {
+    if (exp10 < 0 && exp10 >= -OSUP_MAX_EXACT_POW10) {
+      *value = (double)mantissa / osup_exact_pow10[-exp10];
+      return osup_true;
+    }
+    if (exp10 >= 0 && exp10 <= OSUP_MAX_EXACT_POW10) {
+      *value = (double)mantissa * osup_exact_pow10[exp10];
+      return osup_true;
+    }
+    /* 123e25 = 123000 * 1e22, still exact if the mantissa fits */
+    if (exp10 <= OSUP_MAX_EXACT_POW10 + 15) {
+      uint64_t shifted = mantissa;
+      long e = exp10;
+      while (e > OSUP_MAX_EXACT_POW10 && shifted <= OSUP_MAX_EXACT_INT / 10) {
+        shifted *= 10;
+        e--;
+      }
+      if (e == OSUP_MAX_EXACT_POW10) {
+        *value = (double)shifted * osup_exact_pow10[OSUP_MAX_EXACT_POW10];
         return osup_true;
       }
-      default:
-        if (isdigit(*it)) {
-          switch (part) {
-            case INT:
-              *value = *value * 10.0 + (*it - '0');
-              break;
-            case FRACT:
-              *value += (*it - '0') * mult;
-              mult *= 0.1;
-          }
-          ++it;
-        } else {
-          return osup_false;
-        }
     }
   }
+#endif
 
+  /* slow path, rare in .osu files: let the C library do the correctly rounded
+   * conversion, the syntax has already been validated above */
+  {
+    char stackBuffer[64];
+    size_t len = end - begin;
+    char* buffer = len < sizeof(stackBuffer) ? stackBuffer : malloc(len + 1);
+    if (!buffer) return osup_false;
+    memcpy(buffer, begin, len);
+    buffer[len] = '\0';
+    *value = osup_strtod_c(buffer);
+    if (buffer != stackBuffer) free(buffer);
+  }
   return osup_true;
 }
 
@@ -228,31 +587,77 @@ OSUP_LIB osup_bool osup_parse_ubyte(const char* begin, const char* end,
   return osup_true;
 }
 
-OSUP_INTERN osup_bool osup_parse_uint_until_nondigit_char(const char** begin,
-                                                          osup_int* value) {
-  if (!isdigit(**begin)) {
+OSUP_INTERN osup_bool osup_parse_magnitude_until_nondigit_char(
+    const char** begin, uint32_t maxValue, uint32_t* value) {
+  const char* it = *begin;
+  /* curve points and hit samples are mostly 1-3 digits, check them one by one
+   * first, the branches are cheaper than the SWAR setup for these */
+  uint32_t result = (uint8_t)(it[0] - '0');
+  uint32_t digit;
+  if (result > 9) return osup_false;
+  if ((digit = (uint8_t)(it[1] - '0')) > 9) {
+    *value = result;
+    *begin = it + 1;
+    return osup_true;
+  }
+  result = result * 10 + digit;
+  if ((digit = (uint8_t)(it[2] - '0')) > 9) {
+    *value = result;
+    *begin = it + 2;
+    return osup_true;
+  }
+  result = result * 10 + digit;
+  if ((digit = (uint8_t)(it[3] - '0')) > 9) {
+    *value = result;
+    *begin = it + 3;
+    return osup_true;
+  }
+  if (osup_can_load_8_bytes(it)) {
+    uint64_t chunk;
+    memcpy(&chunk, it, 8);
+    /* digits become 0..9, every byte >= 10 (or with the high bit set) is a
+     * non-digit, no borrow can cross bytes since every byte is >= 0x80 */
+    uint64_t v = chunk ^ 0x3030303030303030ull;
+    uint64_t nonDigits =
+        ((((v & 0x7F7F7F7F7F7F7F7Full) | 0x8080808080808080ull) -
+          0x0A0A0A0A0A0A0A0Aull) |
+         v) &
+        0x8080808080808080ull;
+    if (nonDigits) {
+      /* at most 7 digits, can't overflow */
+      size_t len = osup_ctz64(nonDigits) / 8;
+      *value = osup_swar_parse_8_digits(osup_swar_pad_digits(chunk, len));
+      *begin = it + len;
+      return osup_true;
+    }
+  }
+  while (*it >= '0' && *it <= '9') ++it;
+  if (!osup_parse_magnitude(*begin, it, maxValue, value)) {
     return osup_false;
   }
-  *value = 0;
-  do {
-    *value = *value * 10 + (**begin - '0');
-    ++(*begin);
-  } while (isdigit(**begin));
+  *begin = it;
   return osup_true;
 }
 
 OSUP_LIB osup_bool osup_parse_int_until_nondigit_char(const char** begin,
                                                       osup_int* value) {
+  uint32_t magnitude;
   if (**begin == '-') {
     ++(*begin);
-    if (!osup_parse_uint_until_nondigit_char(begin, value)) {
+    if (!osup_parse_magnitude_until_nondigit_char(
+            begin, (uint32_t)INT32_MAX + 1, &magnitude)) {
       return osup_false;
     }
-    *value = -*value;
+    *value = osup_negate_magnitude(magnitude);
     return osup_true;
   } else {
     /* strings like +123 is not supported */
-    return osup_parse_uint_until_nondigit_char(begin, value);
+    if (!osup_parse_magnitude_until_nondigit_char(begin, INT32_MAX,
+                                                  &magnitude)) {
+      return osup_false;
+    }
+    *value = (osup_int)magnitude;
+    return osup_true;
   }
 }
 
@@ -260,6 +665,273 @@ OSUP_LIB osup_bool osup_is_line_terminator(char c) {
   return c == '\0' || c == '\r' || c == '\n';
 }
 
+/* every special character except '|' is below 64, so a single 64-bit mask is
+ * enough to test them */
+#define OSUP_SPECIAL_CHAR_MASK                                            \
+  ((1ull << ',') | (1ull << ':') | (1ull << '"') | (1ull << '\r') |      \
+   (1ull << '\n') | (1ull << '\0'))
+
+OSUP_LIB osup_bool osup_is_special_char(char c) {
+  return (uint8_t)c < 64 ? (OSUP_SPECIAL_CHAR_MASK >> (uint8_t)c) & 1
+                         : c == '|';
+}
+
+/*****************************
+ * SCALAR AND SWAR SCANNERS *
+ *****************************/
+OSUP_INTERN const char* osup_find_special_char_scalar(const char* it) {
+  while (!osup_is_special_char(*it)) ++it;
+  return it;
+}
+
+OSUP_INTERN const char* osup_find_line_terminator_scalar(const char* it) {
+  while (!osup_is_line_terminator(*it)) ++it;
+  return it;
+}
+
+#ifndef OSUP_NO_SIMD
+#define OSUP_SWAR_ONES 0x0101010101010101ull
+#define OSUP_SWAR_LOW7 0x7F7F7F7F7F7F7F7Full
+
+/* 0x80 in every byte of word equal to c, 0x00 everywhere else, unlike the
+ * classic haszero trick there are no false positives caused by borrows */
+OSUP_INTERN uint64_t osup_swar_eq(uint64_t word, char c) {
+  uint64_t v = word ^ (OSUP_SWAR_ONES * (uint8_t)c);
+  return ~(((v & OSUP_SWAR_LOW7) + OSUP_SWAR_LOW7) | v | OSUP_SWAR_LOW7);
+}
+
+/* only aligned words are loaded, so we never cross a page boundary, bytes
+ * before `it` in the first word are masked out */
+#define OSUP_SWAR_SCAN(it, matchExpr)                                 \
+  do {                                                                \
+    size_t offset = (uintptr_t)(it) & 7;                              \
+    const char* p = (it) - offset;                                    \
+    uint64_t word;                                                    \
+    memcpy(&word, p, 8);                                              \
+    uint64_t mask = (matchExpr) & (~0ull << (offset * 8));            \
+    while (!mask) {                                                   \
+      p += 8;                                                         \
+      memcpy(&word, p, 8);                                            \
+      mask = (matchExpr);                                             \
+    }                                                                 \
+    return p + osup_ctz64(mask) / 8;                                  \
+  } while (0)
+
+OSUP_INTERN const char* osup_find_special_char_swar(const char* it) {
+  OSUP_SWAR_SCAN(it, osup_swar_eq(word, ',') | osup_swar_eq(word, '|') |
+                         osup_swar_eq(word, ':') | osup_swar_eq(word, '"') |
+                         osup_swar_eq(word, '\r') | osup_swar_eq(word, '\n') |
+                         osup_swar_eq(word, '\0'));
+}
+
+OSUP_INTERN const char* osup_find_line_terminator_swar(const char* it) {
+  OSUP_SWAR_SCAN(it, osup_swar_eq(word, '\r') | osup_swar_eq(word, '\n') |
+                         osup_swar_eq(word, '\0'));
+}
+#endif
+
+/***************************
+ * SSE2 AND AVX2 SCANNERS *
+ ***************************/
+#ifdef OSUP_HAS_X86_SIMD
+#define OSUP_SIMD_SCAN(it, width, vec, load, matchExpr)        \
+  do {                                                         \
+    size_t offset = (uintptr_t)(it) & (width - 1);             \
+    const char* p = (it) - offset;                             \
+    vec chunk = load((const vec*)p);                           \
+    uint32_t mask = (uint32_t)(matchExpr) >> offset;           \
+    if (mask) return (it) + osup_ctz64(mask);                  \
+    while (osup_true) {                                        \
+      p += width;                                              \
+      chunk = load((const vec*)p);                             \
+      mask = (uint32_t)(matchExpr);                            \
+      if (mask) return p + osup_ctz64(mask);                   \
+    }                                                          \
+  } while (0)
+
+#define OSUP_SSE2_EQ(c) _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c))
+#define OSUP_AVX2_EQ(c) _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(c))
+
+OSUP_INTERN const char* osup_find_special_char_sse2(const char* it) {
+  OSUP_SIMD_SCAN(
+      it, 16, __m128i, _mm_load_si128,
+      _mm_movemask_epi8(_mm_or_si128(
+          _mm_or_si128(_mm_or_si128(OSUP_SSE2_EQ(','), OSUP_SSE2_EQ('|')),
+                       _mm_or_si128(OSUP_SSE2_EQ(':'), OSUP_SSE2_EQ('"'))),
+          _mm_or_si128(_mm_or_si128(OSUP_SSE2_EQ('\r'), OSUP_SSE2_EQ('\n')),
+                       OSUP_SSE2_EQ('\0')))));
+}
+
+OSUP_INTERN const char* osup_find_line_terminator_sse2(const char* it) {
+  OSUP_SIMD_SCAN(it, 16, __m128i, _mm_load_si128,
+                 _mm_movemask_epi8(_mm_or_si128(
+                     _mm_or_si128(OSUP_SSE2_EQ('\r'), OSUP_SSE2_EQ('\n')),
+                     OSUP_SSE2_EQ('\0'))));
+}
+
+__attribute__((target("avx2"))) OSUP_INTERN const char*
+osup_find_special_char_avx2(const char* it) {
+  OSUP_SIMD_SCAN(
+      it, 32, __m256i, _mm256_load_si256,
+      _mm256_movemask_epi8(_mm256_or_si256(
+          _mm256_or_si256(
+              _mm256_or_si256(OSUP_AVX2_EQ(','), OSUP_AVX2_EQ('|')),
+              _mm256_or_si256(OSUP_AVX2_EQ(':'), OSUP_AVX2_EQ('"'))),
+          _mm256_or_si256(
+              _mm256_or_si256(OSUP_AVX2_EQ('\r'), OSUP_AVX2_EQ('\n')),
+              OSUP_AVX2_EQ('\0')))));
+}
+
+__attribute__((target("avx2"))) OSUP_INTERN const char*
+osup_find_line_terminator_avx2(const char* it) {
+  OSUP_SIMD_SCAN(it, 32, __m256i, _mm256_load_si256,
+                 _mm256_movemask_epi8(_mm256_or_si256(
+                     _mm256_or_si256(OSUP_AVX2_EQ('\r'), OSUP_AVX2_EQ('\n')),
+                     OSUP_AVX2_EQ('\0'))));
+}
+#endif
+
+/********************
+ * RUNTIME DISPATCH *
+ ********************/
+typedef const char* (*osup_scan_fn)(const char*);
+
+OSUP_INTERN const char* osup_find_special_char_resolve(const char* it);
+OSUP_INTERN const char* osup_find_line_terminator_resolve(const char* it);
+
+/* start with the resolvers, they will replace themselves with the best
+ * implementation on the first call */
+OSUP_STORAGE osup_scan_fn osup_find_special_char_impl =
+    osup_find_special_char_resolve;
+OSUP_STORAGE osup_scan_fn osup_find_line_terminator_impl =
+    osup_find_line_terminator_resolve;
+OSUP_STORAGE osup_simd_level osup_simd = OSUP_SIMD_NONE;
+
+OSUP_INTERN osup_bool osup_is_simd_level_supported(osup_simd_level level) {
+  switch (level) {
+    case OSUP_SIMD_NONE:
+      return osup_true;
+#ifndef OSUP_NO_SIMD
+    case OSUP_SIMD_SWAR:
+      return osup_is_little_endian();
+#endif
+#ifdef OSUP_HAS_X86_SIMD
+    case OSUP_SIMD_SSE2:
+      return osup_true;
+    case OSUP_SIMD_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") != 0;
+#endif
+    default:
+      return osup_false;
+  }
+}
+
+OSUP_LIB osup_bool osup_set_simd_level(osup_simd_level level) {
+  if (!osup_is_simd_level_supported(level)) {
+    return osup_false;
+  }
+  osup_simd = level;
+  switch (level) {
+#ifdef OSUP_HAS_X86_SIMD
+    case OSUP_SIMD_AVX2:
+      osup_find_special_char_impl = osup_find_special_char_avx2;
+      osup_find_line_terminator_impl = osup_find_line_terminator_avx2;
+      break;
+    case OSUP_SIMD_SSE2:
+      osup_find_special_char_impl = osup_find_special_char_sse2;
+      osup_find_line_terminator_impl = osup_find_line_terminator_sse2;
+      break;
+#endif
+#ifndef OSUP_NO_SIMD
+    case OSUP_SIMD_SWAR:
+      osup_find_special_char_impl = osup_find_special_char_swar;
+      osup_find_line_terminator_impl = osup_find_line_terminator_swar;
+      break;
+#endif
+    default:
+      osup_find_special_char_impl = osup_find_special_char_scalar;
+      osup_find_line_terminator_impl = osup_find_line_terminator_scalar;
+  }
+  return osup_true;
+}
+
+OSUP_INTERN void osup_select_best_simd_level() {
+  osup_simd_level level = OSUP_SIMD_AVX2;
+  while (!osup_set_simd_level(level)) {
+    level = (osup_simd_level)(level - 1);
+  }
+}
+
+OSUP_LIB osup_simd_level osup_get_simd_level() {
+  if (osup_find_special_char_impl == osup_find_special_char_resolve) {
+    osup_select_best_simd_level();
+  }
+  return osup_simd;
+}
+
+OSUP_INTERN const char* osup_find_special_char_resolve(const char* it) {
+  osup_select_best_simd_level();
+  return osup_find_special_char_impl(it);
+}
+
+OSUP_INTERN const char* osup_find_line_terminator_resolve(const char* it) {
+  osup_select_best_simd_level();
+  return osup_find_line_terminator_impl(it);
+}
+
+/* most fields are only a few characters long, the wide scanners have some
+ * setup cost, so check the first few characters one by one */
+#define OSUP_SCALAR_PROLOGUE 8
+
+OSUP_LIB const char* osup_find_special_char(const char* it) {
+  const char* prologueEnd = it + OSUP_SCALAR_PROLOGUE;
+  while (it < prologueEnd) {
+    if (osup_is_special_char(*it)) return it;
+    ++it;
+  }
+  return osup_find_special_char_impl(it);
+}
+
+OSUP_LIB const char* osup_find_line_terminator(const char* it) {
+  return osup_find_line_terminator_impl(it);
+}
+
+/* isblank() depends on the locale and is undefined for negative chars (which
+ * are common in UTF-8 strings), we only need the C locale behaviour */
+OSUP_INTERN osup_bool osup_is_blank(char c) { return c == ' ' || c == '\t'; }
+
+OSUP_LIB osup_bool osup_advance_to_next_line(const char** line,
+                                             osup_bool checkForNonBlankChar) {
+  if (!checkForNonBlankChar) {
+    *line = osup_find_line_terminator(*line);
+  } else {
+    /* usually only a few characters are left, no need for the scanner */
+    while (!osup_is_line_terminator(**line)) {
+      if (!osup_is_blank(**line)) {
+        return osup_false;
+      }
+      ++(*line);
+    }
+  }
+  if (**line != '\0') {
+    ++(*line);
+  }
+  return osup_true;
+}
+
+OSUP_LIB const char* osup_advance_to_last_nonblank_char(const char** line) {
+  const char* terminator = osup_find_line_terminator(*line);
+  /* walk back over the trailing blanks, if the line is all blank, *line is
+   * left untouched */
+  const char* it = terminator;
+  while (it > *line && osup_is_blank(it[-1])) {
+    --it;
+  }
+  *line = it;
+  return terminator;
+}
+
 OSUP_LIB osup_bool osup_split_string(char delimiter, const char** splitBegin,
                                      const char** splitEnd,
                                      const char* stringEnd) {
@@ -286,6 +958,23 @@ OSUP_LIB osup_bool osup_split_string(char delimiter, const char** splitBegin,
   return osup_true;
 }
 
+/* find the first delimiter or line terminator */
+OSUP_INTERN const char* osup_find_delimiter_line_terminated(char delimiter,
+                                                            const char* it) {
+  if (!osup_is_special_char(delimiter)) {
+    /* the scanners don't know about this delimiter */
+    while (*it != delimiter && !osup_is_line_terminator(*it)) ++it;
+    return it;
+  }
+  while (osup_true) {
+    it = osup_find_special_char(it);
+    if (*it == delimiter || osup_is_line_terminator(*it)) {
+      return it;
+    }
+    ++it;
+  }
+}
+
 OSUP_LIB osup_bool osup_split_string_line_terminated(char delimiter,
                                                      const char** splitBegin,
                                                      const char** splitEnd) {
@@ -293,10 +982,7 @@ OSUP_LIB osup_bool osup_split_string_line_terminated(char delimiter,
   if (*splitBegin && osup_is_line_terminator(**splitEnd)) return osup_false;
   /* basically the same algorithm as osup_split_string */
   *splitBegin = ++(*splitEnd);
-  while (**splitEnd != delimiter && !osup_is_line_terminator(**splitEnd)) {
-    ++(*splitEnd);
-  }
-
+  *splitEnd = osup_find_delimiter_line_terminated(delimiter, *splitEnd);
   return osup_true;
 }
 
@@ -312,20 +998,16 @@ OSUP_LIB osup_bool osup_split_string_line_terminated_quoted(
      * " character */
     *valueBegin = ++(*splitEnd);
     /* find next " character, also check if we are out of bounds */
-    while (**splitEnd != '"') {
-      if (osup_is_line_terminator(**splitEnd)) {
-        return osup_false;
-      }
-      ++(*splitEnd);
+    *splitEnd = osup_find_delimiter_line_terminated('"', *splitEnd);
+    if (**splitEnd != '"') {
+      return osup_false;
     }
     *valueEnd = *splitEnd;
     ++(*splitEnd);
     return osup_true;
   } else {
     /* same algorithm from osup_split_string_terminated */
-    while (**splitEnd != delimiter && !osup_is_line_terminator(**splitEnd)) {
-      ++(*splitEnd);
-    }
+    *splitEnd = osup_find_delimiter_line_terminated(delimiter, *splitEnd);
     *valueEnd = *splitEnd;
 
     return osup_true;
@@ -336,3 +1018,413 @@ OSUP_LIB void osup_free_ptr(void* ptr) {
   if (ptr) free(ptr);
 }
 
+
+/* read the whole file into a null-terminated heap buffer */
+OSUP_INTERN osup_bool osup_read_file(const char* path, osup_mapped_file* file) {
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    return osup_false;
+  }
+  size_t capacity = 4096;
+  size_t size = 0;
+  char* buffer = malloc(capacity + 1);
+  while (buffer) {
+    size += fread(buffer + size, 1, capacity - size, f);
+    if (size < capacity) {
+      break;
+    }
+    capacity *= 2;
+    char* newBuffer = realloc(buffer, capacity + 1);
+    if (!newBuffer) {
+      free(buffer);
+      buffer = NULL;
+    } else {
+      buffer = newBuffer;
+    }
+  }
+  if (!buffer || ferror(f)) {
+    osup_free_ptr(buffer);
+    fclose(f);
+    return osup_false;
+  }
+  fclose(f);
+  buffer[size] = '\0';
+  file->buffer = buffer;
+  file->data = buffer;
+  file->size = size;
+  return osup_true;
+}
+
+OSUP_LIB osup_bool osup_map_file(const char* path, osup_mapped_file* file) {
+  memset(file, 0, sizeof(*file));
+#ifdef OSUP_HAS_MMAP
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return osup_false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return osup_false;
+  }
+  size_t size = (size_t)st.st_size;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  /* the bytes between the end of file and the end of the last page are
+   * guaranteed to be zero, so the mapping is null-terminated for free, unless
+   * the file size is a multiple of the page size, in that case we have to fall
+   * back to reading the file into a buffer */
+  if (size > 0 && pageSize > 0 && size % (size_t)pageSize != 0) {
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+      madvise(mapping, size, MADV_SEQUENTIAL);
+#endif
+      close(fd);
+      file->mapping = mapping;
+      file->mappingSize = size;
+      file->data = mapping;
+      file->size = size;
+      return osup_true;
+    }
+  }
+  close(fd);
+#endif
+  return osup_read_file(path, file);
+}
+
+OSUP_LIB void osup_unmap_file(osup_mapped_file* file) {
+#ifdef OSUP_HAS_MMAP
+  if (file->mapping) {
+    munmap(file->mapping, file->mappingSize);
+  }
+#endif
+  osup_free_ptr(file->buffer);
+  memset(file, 0, sizeof(*file));
+}
+
+/*********
+ * ARENA *
+ *********/
+#define OSUP_ARENA_MIN_BLOCK_SIZE (16 * 1024)
+
+typedef union {
+  long double ld;
+  long long ll;
+  void* ptr;
+  void (*fn)();
+} osup_max_align;
+
+struct osup_arena_block {
+  osup_arena_block* next;
+  size_t size;
+  size_t used;
+  /* keep the data maximally aligned */
+  osup_max_align data[1];
+};
+
+OSUP_INTERN size_t osup_arena_align(size_t size) {
+  return (size + sizeof(osup_max_align) - 1) & ~(sizeof(osup_max_align) - 1);
+}
+
+OSUP_LIB void* osup_arena_alloc(osup_arena* arena, size_t size) {
+  osup_arena_block* block = arena->blocks;
+  size = osup_arena_align(size);
+  if (!block || block->size - block->used < size) {
+    /* blocks grow geometrically, so a map only needs a few of them */
+    size_t blockSize = block ? block->size * 2 : OSUP_ARENA_MIN_BLOCK_SIZE;
+    while (blockSize < size) blockSize *= 2;
+    block = malloc(offsetof(osup_arena_block, data) + blockSize);
+    if (!block) {
+      return NULL;
+    }
+    block->next = arena->blocks;
+    block->size = blockSize;
+    block->used = 0;
+    arena->blocks = block;
+    arena->blockCount++;
+  }
+  void* ptr = (char*)block->data + block->used;
+  block->used += size;
+  arena->allocationCount++;
+  return ptr;
+}
+
+OSUP_LIB void* osup_arena_realloc(osup_arena* arena, void* ptr,
+                                  size_t oldSize, size_t newSize) {
+  osup_arena_block* block = arena->blocks;
+  if (!ptr) {
+    return osup_arena_alloc(arena, newSize);
+  }
+  oldSize = osup_arena_align(oldSize);
+  /* the last allocation can simply be extended */
+  if ((char*)ptr + oldSize == (char*)block->data + block->used &&
+      block->size - block->used + oldSize >= osup_arena_align(newSize)) {
+    block->used += osup_arena_align(newSize) - oldSize;
+    return ptr;
+  }
+  void* newPtr = osup_arena_alloc(arena, newSize);
+  if (newPtr) {
+    memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+  }
+  return newPtr;
+}
+
+OSUP_LIB osup_bool osup_arena_strdup(osup_arena* arena, const char* begin,
+                                     const char* end, char** value) {
+  assert(begin <= end);
+  size_t len = end - begin;
+  *value = osup_arena_alloc(arena, len + 1);
+  if (!*value) {
+    return osup_false;
+  } else {
+    memcpy(*value, begin, len);
+    (*value)[len] = '\0';
+    return osup_true;
+  }
+}
+
+OSUP_LIB void osup_arena_reset(osup_arena* arena) {
+  osup_arena_block* block = arena->blocks;
+  if (!block) return;
+  /* the newest block is the biggest one, keep it for the next round */
+  osup_arena_block* next = block->next;
+  while (next) {
+    osup_arena_block* nextNext = next->next;
+    free(next);
+    next = nextNext;
+  }
+  block->next = NULL;
+  block->used = 0;
+  arena->blockCount = 1;
+  arena->allocationCount = 0;
+}
+
+OSUP_LIB void osup_arena_free(osup_arena* arena) {
+  osup_arena_block* block = arena->blocks;
+  while (block) {
+    osup_arena_block* next = block->next;
+    free(block);
+    block = next;
+  }
+  memset(arena, 0, sizeof(*arena));
+}
+
+/********
+ * POOL *
+ ********/
+/* every worker starts with a contiguous range of the parts and runs it from
+ * the front, a worker that runs out steals the back half of someone else's
+ * range, so a few slow parts (big files) don't leave the other threads idle */
+typedef struct {
+  osup_pool* pool;
+  size_t index;
+#ifdef OSUP_HAS_THREADS
+  pthread_t thread;
+  /* guards next, end and generation */
+  pthread_mutex_t mutex;
+#endif
+  /* the parts [next, end) of the job are left to run */
+  size_t next;
+  size_t end;
+  /* the job the range belongs to */
+  size_t generation;
+} osup_pool_worker;
+
+struct osup_pool {
+  size_t threadCount;
+  /* workers[0] is the calling thread */
+  osup_pool_worker* workers;
+#ifdef OSUP_HAS_THREADS
+  pthread_mutex_t mutex;
+  pthread_cond_t workReady;
+  pthread_cond_t workDone;
+  /* the current job */
+  osup_pool_fn fn;
+  char* parts;
+  size_t partSize;
+  size_t pending;
+  /* bumped for every job, so the sleeping workers can tell there is a new
+   * one */
+  size_t generation;
+  osup_bool quit;
+#endif
+};
+
+#ifdef OSUP_HAS_THREADS
+/* take the next part of worker's own range, or steal one */
+OSUP_INTERN osup_bool osup_pool_take(osup_pool_worker* worker,
+                                     size_t generation, size_t* part) {
+  osup_pool* pool = worker->pool;
+  size_t i;
+  pthread_mutex_lock(&worker->mutex);
+  if (worker->generation == generation && worker->next < worker->end) {
+    *part = worker->next++;
+    pthread_mutex_unlock(&worker->mutex);
+    return osup_true;
+  }
+  pthread_mutex_unlock(&worker->mutex);
+
+  for (i = 1; i < pool->threadCount; i++) {
+    osup_pool_worker* victim =
+        &pool->workers[(worker->index + i) % pool->threadCount];
+    size_t begin = 0, end = 0;
+    pthread_mutex_lock(&victim->mutex);
+    if (victim->generation == generation && victim->next < victim->end) {
+      end = victim->end;
+      begin = end - (end - victim->next + 1) / 2;
+      victim->end = begin;
+    }
+    pthread_mutex_unlock(&victim->mutex);
+    if (begin < end) {
+      pthread_mutex_lock(&worker->mutex);
+      worker->generation = generation;
+      worker->next = begin + 1;
+      worker->end = end;
+      pthread_mutex_unlock(&worker->mutex);
+      *part = begin;
+      return osup_true;
+    }
+  }
+  return osup_false;
+}
+
+/* run parts until there are none left anywhere, called with the pool mutex
+ * held */
+OSUP_INTERN void osup_pool_work(osup_pool_worker* worker) {
+  osup_pool* pool = worker->pool;
+  size_t generation = pool->generation;
+  osup_pool_fn fn = pool->fn;
+  char* parts = pool->parts;
+  size_t partSize = pool->partSize;
+  size_t part;
+  pthread_mutex_unlock(&pool->mutex);
+  while (osup_pool_take(worker, generation, &part)) {
+    fn(parts + part * partSize);
+    pthread_mutex_lock(&pool->mutex);
+    if (--pool->pending == 0) {
+      pthread_cond_signal(&pool->workDone);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+  }
+  pthread_mutex_lock(&pool->mutex);
+}
+
+OSUP_INTERN void* osup_pool_thread(void* ptr) {
+  osup_pool_worker* worker = ptr;
+  osup_pool* pool = worker->pool;
+  size_t generation = 0;
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (!pool->quit && pool->generation == generation) {
+      pthread_cond_wait(&pool->workReady, &pool->mutex);
+    }
+    if (pool->quit) break;
+    generation = pool->generation;
+    osup_pool_work(worker);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+#endif
+
+OSUP_LIB osup_pool* osup_pool_create(size_t threadCount) {
+  /* the scanners pick their implementation on the first call, do it here
+   * before any worker starts, so the workers only ever read the pointers */
+  osup_get_simd_level();
+  osup_pool* pool = malloc(sizeof(osup_pool));
+  if (!pool) return NULL;
+  memset(pool, 0, sizeof(*pool));
+  if (threadCount < 1) threadCount = 1;
+#ifndef OSUP_HAS_THREADS
+  threadCount = 1;
+#endif
+  pool->workers = malloc(threadCount * sizeof(osup_pool_worker));
+  if (!pool->workers) {
+    osup_free_ptr(pool);
+    return NULL;
+  }
+  memset(pool->workers, 0, threadCount * sizeof(osup_pool_worker));
+  pool->workers[0].pool = pool;
+#ifdef OSUP_HAS_THREADS
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->workReady, NULL);
+  pthread_cond_init(&pool->workDone, NULL);
+  pthread_mutex_init(&pool->workers[0].mutex, NULL);
+  pool->threadCount = 1;
+  /* fewer threads are still fine if some can't be created */
+  while (pool->threadCount < threadCount) {
+    osup_pool_worker* worker = &pool->workers[pool->threadCount];
+    worker->pool = pool;
+    worker->index = pool->threadCount;
+    pthread_mutex_init(&worker->mutex, NULL);
+    if (pthread_create(&worker->thread, NULL, osup_pool_thread, worker)) {
+      pthread_mutex_destroy(&worker->mutex);
+      break;
+    }
+    pool->threadCount++;
+  }
+#else
+  pool->threadCount = 1;
+#endif
+  return pool;
+}
+
+OSUP_LIB size_t osup_pool_thread_count(const osup_pool* pool) {
+  return pool->threadCount;
+}
+
+OSUP_LIB void osup_pool_run(osup_pool* pool, osup_pool_fn fn, void* parts,
+                            size_t partSize, size_t count) {
+#ifdef OSUP_HAS_THREADS
+  if (pool->threadCount > 1 && count > 1) {
+    size_t i;
+    pthread_mutex_lock(&pool->mutex);
+    pool->fn = fn;
+    pool->parts = parts;
+    pool->partSize = partSize;
+    pool->pending = count;
+    pool->generation++;
+    for (i = 0; i < pool->threadCount; i++) {
+      osup_pool_worker* worker = &pool->workers[i];
+      pthread_mutex_lock(&worker->mutex);
+      worker->generation = pool->generation;
+      worker->next = count * i / pool->threadCount;
+      worker->end = count * (i + 1) / pool->threadCount;
+      pthread_mutex_unlock(&worker->mutex);
+    }
+    pthread_cond_broadcast(&pool->workReady);
+    osup_pool_work(&pool->workers[0]);
+    while (pool->pending) {
+      pthread_cond_wait(&pool->workDone, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return;
+  }
+#endif
+  size_t i;
+  for (i = 0; i < count; i++) {
+    fn((char*)parts + i * partSize);
+  }
+}
+
+OSUP_LIB void osup_pool_free(osup_pool* pool) {
+  if (!pool) return;
+#ifdef OSUP_HAS_THREADS
+  size_t i;
+  pthread_mutex_lock(&pool->mutex);
+  pool->quit = osup_true;
+  pthread_cond_broadcast(&pool->workReady);
+  pthread_mutex_unlock(&pool->mutex);
+  for (i = 1; i < pool->threadCount; i++) {
+    pthread_join(pool->workers[i].thread, NULL);
+  }
+  for (i = 0; i < pool->threadCount; i++) {
+    pthread_mutex_destroy(&pool->workers[i].mutex);
+  }
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->workReady);
+  pthread_cond_destroy(&pool->workDone);
+#endif
+  osup_free_ptr(pool->workers);
+  osup_free_ptr(pool);
+}
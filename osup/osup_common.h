@@ -53,12 +53,30 @@ extern "C" {
 #define OSUP_INTERN static
 #define OSUP_STORAGE static
 
+#if __STDC_VERSION__ >= 199901L
+#include <stdbool.h>
+typedef bool osup_bool;
+#define osup_true true
+#define osup_false false
+#else
+typedef enum { osup_true = 1, osup_false = 0 } osup_bool;
+#endif
+
 #ifndef OSUP_NO_LOGGING
 typedef void (*osup_errcb)(const char*, void*);
 
 OSUP_API void osup_set_error_callback(osup_errcb callback, void* ptr);
 OSUP_API void osup_set_default_error_callback();
+/* only for the calling thread, takes precedence over the global callback,
+ * pass NULL to go back to it */
+OSUP_API void osup_set_thread_error_callback(osup_errcb callback, void* ptr);
+/* the calling thread's callback (NULL if none) and its ptr, so it can be put
+ * back after being replaced for a while */
+OSUP_API osup_errcb osup_get_thread_error_callback(void** ptr);
 OSUP_LIB void osup_error(const char* format, ...);
+/* check if there is an error callback, so the error messages (and their
+ * arguments) don't have to be built when nobody is listening */
+OSUP_LIB osup_bool osup_has_error_callback();
 /* return a temporary null-terminated string with content taken from begin to
  * end
  */
@@ -67,15 +85,6 @@ OSUP_LIB const char* osup_temp_string_slice(const char* begin, const char* end);
 OSUP_LIB const char* osup_temp_string_slice_line_terminated(const char* line);
 #endif
 
-#if __STDC_VERSION__ >= 199901L
-#include <stdbool.h>
-typedef bool osup_bool;
-#define osup_true true
-#define osup_false false
-#else
-typedef enum { osup_true = 1, osup_false = 0 } osup_bool;
-#endif
-
 typedef int osup_err_t;
 typedef int32_t osup_int;
 typedef int64_t osup_long;
@@ -134,7 +143,116 @@ OSUP_LIB osup_bool osup_split_string_line_terminated(char delimiter,
 OSUP_LIB osup_bool osup_split_string_line_terminated_quoted(
     char delimiter, const char** splitBegin, const char** splitEnd,
     const char** splitQuoteEnd);
+/* advance line pointer to the first char of next line, or at the null
+ * terminator if this is the last line, also check for non-blank character if
+ * checkForNonBlankChar is true */
+OSUP_LIB osup_bool osup_advance_to_next_line(const char** line,
+                                             osup_bool checkForNonBlankChar);
+/* advance line pointer to AFTER the last non-blank character of line, and
+ * return the line-terminating character (one of '\0', '\r' and '\n') */
+OSUP_LIB const char* osup_advance_to_last_nonblank_char(const char** line);
 OSUP_LIB void osup_free_ptr(void* ptr);
+/* 64-bit FNV-1a, to tell whether a file has changed, not for security */
+OSUP_LIB uint64_t osup_hash(const void* data, size_t size);
+
+/* reads the little-endian numbers and strings written by .NET's BinaryWriter
+ * (.osr, osu!.db), reading past the end sets failed and gives 0 */
+typedef struct {
+  const uint8_t* it;
+  const uint8_t* end;
+  osup_bool failed;
+} osup_reader;
+
+OSUP_LIB void osup_reader_init(osup_reader* reader, const void* data,
+                               size_t size);
+/* the next size bytes, NULL if there are not enough */
+OSUP_LIB const uint8_t* osup_reader_take(osup_reader* reader, size_t size);
+/* an unsigned integer of size bytes, cast it for signed ones */
+OSUP_LIB uint64_t osup_reader_uint(osup_reader* reader, size_t size);
+OSUP_LIB float osup_reader_single(osup_reader* reader);
+OSUP_LIB double osup_reader_double(osup_reader* reader);
+/* 0x00 for a missing string (begin is NULL), or 0x0b, the ULEB128 length and
+ * the bytes, which are not null-terminated */
+OSUP_LIB osup_slice osup_reader_string(osup_reader* reader);
+
+/* the scanners below are the inner loop of every section parser, they look at
+ * 8 (SWAR), 16 (SSE2) or 32 (AVX2) bytes at a time and the best version is
+ * picked at runtime. the wide versions only do aligned loads, so they may read
+ * past the null terminator, but never past the page containing it (define
+ * OSUP_NO_SIMD when running under a memory checker) */
+typedef enum {
+  OSUP_SIMD_NONE,
+  OSUP_SIMD_SWAR,
+  OSUP_SIMD_SSE2,
+  OSUP_SIMD_AVX2
+} osup_simd_level;
+
+/* find the first character that is one of ',', '|', ':', '"', '\r', '\n' and
+ * '\0' */
+OSUP_LIB const char* osup_find_special_char(const char* it);
+/* find the first character that is one of '\r', '\n' and '\0' */
+OSUP_LIB const char* osup_find_line_terminator(const char* it);
+OSUP_LIB osup_bool osup_is_special_char(char c);
+/* the first call (or the first scan) picks the best level, that is not
+ * thread-safe, osup_pool_create does it before starting its workers, call it
+ * once before scanning on threads of your own */
+OSUP_LIB osup_simd_level osup_get_simd_level();
+/* mostly for testing and benchmarking, return osup_false if the CPU (or the
+ * build) doesn't support the given level */
+OSUP_LIB osup_bool osup_set_simd_level(osup_simd_level level);
+
+/* a bump allocator, allocations are taken from a list of big blocks and are
+ * all released at once by osup_arena_free, no matter how many there are */
+typedef struct osup_arena_block osup_arena_block;
+
+typedef struct {
+  /* most recent block first */
+  osup_arena_block* blocks;
+  /* statistics */
+  size_t blockCount;
+  size_t allocationCount;
+} osup_arena;
+
+OSUP_LIB void* osup_arena_alloc(osup_arena* arena, size_t size);
+/* grows in place if ptr is the last allocation and there is room left */
+OSUP_LIB void* osup_arena_realloc(osup_arena* arena, void* ptr,
+                                  size_t oldSize, size_t newSize);
+OSUP_LIB osup_bool osup_arena_strdup(osup_arena* arena, const char* begin,
+                                     const char* end, char** value);
+/* forget every allocation but keep the memory, for scratch arenas */
+OSUP_LIB void osup_arena_reset(osup_arena* arena);
+OSUP_LIB void osup_arena_free(osup_arena* arena);
+
+/* a whole file loaded into memory, either mmap-ed (if possible) or read into a
+ * heap buffer, data[size] is always '\0' so the content can be parsed as a
+ * null-terminated string */
+typedef struct {
+  const char* data;
+  size_t size;
+
+  /* private, used by osup_unmap_file */
+  void* mapping;
+  size_t mappingSize;
+  char* buffer;
+} osup_mapped_file;
+
+OSUP_LIB osup_bool osup_map_file(const char* path, osup_mapped_file* file);
+OSUP_LIB void osup_unmap_file(osup_mapped_file* file);
+
+/* a small work-stealing pool of worker threads for jobs made of independent
+ * parts, without thread support (or with OSUP_NO_THREADS) every part runs on
+ * the calling thread */
+typedef struct osup_pool osup_pool;
+typedef void (*osup_pool_fn)(void* part);
+
+/* threadCount includes the calling thread, which runs parts too */
+OSUP_LIB osup_pool* osup_pool_create(size_t threadCount);
+OSUP_LIB size_t osup_pool_thread_count(const osup_pool* pool);
+/* call fn on every part of parts[0 .. count), each part is partSize bytes, and
+ * wait until all of them are done */
+OSUP_LIB void osup_pool_run(osup_pool* pool, osup_pool_fn fn, void* parts,
+                            size_t partSize, size_t count);
+OSUP_LIB void osup_pool_free(osup_pool* pool);
 
 #ifdef __cplusplus
 }
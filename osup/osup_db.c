@@ -0,0 +1,258 @@
+#include "osup_db.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OSUP_NO_LOGGING
+#define OSUP_DB_ERROR(...)
+#else
+#define OSUP_DB_ERROR(...)                                         \
+  do {                                                             \
+    if (osup_has_error_callback()) osup_error("[db] " __VA_ARGS__); \
+  } while (0)
+#endif
+
+/* 0x08, the int mods, 0x0d and a double (or 0x0c and a float) */
+#define OSUP_DB_DOUBLE_PAIR_SIZE 14
+#define OSUP_DB_FLOAT_PAIR_SIZE 10
+/* double beat length, double offset, bool uninherited */
+#define OSUP_DB_TIMING_POINT_SIZE 17
+
+/***********
+ * RECORDS *
+ ***********/
+OSUP_INTERN osup_decimal osup_db_read_setting(osup_reader* reader,
+                                              osup_int version) {
+  if (version < OSUP_DB_VERSION_FLOAT_DIFFICULTY) {
+    return (osup_decimal)osup_reader_uint(reader, 1);
+  }
+  return osup_reader_single(reader);
+}
+
+/* an int count followed by count items of itemSize bytes */
+OSUP_INTERN void osup_db_read_list(osup_reader* reader, size_t itemSize,
+                                   osup_slice* bytes, size_t* count) {
+  uint32_t n = (uint32_t)osup_reader_uint(reader, 4);
+  if (n > (size_t)(reader->end - reader->it) / itemSize) {
+    reader->failed = osup_true;
+    return;
+  }
+  const char* begin = (const char*)osup_reader_take(reader, n * itemSize);
+  if (!begin) return;
+  bytes->begin = begin;
+  bytes->end = begin + n * itemSize;
+  *count = n;
+}
+
+/* walk one record from reader->it (after its size prefix in old versions),
+ * every field is read even when only the end of the record is wanted, since
+ * the strings have variable lengths */
+OSUP_INTERN void osup_db_read_record(osup_reader* reader, osup_int version,
+                                     osup_db_record* record) {
+  osup_bool floatStarRatings =
+      version >= OSUP_DB_VERSION_FLOAT_STAR_RATINGS;
+  size_t i;
+  memset(record, 0, sizeof(*record));
+  record->floatStarRatings = floatStarRatings;
+  record->metadata.artistView = osup_reader_string(reader);
+  record->metadata.artistUnicodeView = osup_reader_string(reader);
+  record->metadata.titleView = osup_reader_string(reader);
+  record->metadata.titleUnicodeView = osup_reader_string(reader);
+  record->metadata.creatorView = osup_reader_string(reader);
+  record->metadata.versionView = osup_reader_string(reader);
+  record->audioFilename = osup_reader_string(reader);
+  record->hash = osup_reader_string(reader);
+  record->osuFilename = osup_reader_string(reader);
+  record->rankedStatus = (osup_db_ranked_status)osup_reader_uint(reader, 1);
+  record->hitCircleCount = (osup_int)osup_reader_uint(reader, 2);
+  record->sliderCount = (osup_int)osup_reader_uint(reader, 2);
+  record->spinnerCount = (osup_int)osup_reader_uint(reader, 2);
+  record->lastModified = (osup_long)osup_reader_uint(reader, 8);
+  record->difficulty.approachRate = osup_db_read_setting(reader, version);
+  record->difficulty.circleSize = osup_db_read_setting(reader, version);
+  record->difficulty.hpDrainRate = osup_db_read_setting(reader, version);
+  record->difficulty.overallDifficulty = osup_db_read_setting(reader, version);
+  record->difficulty.sliderMultiplier = osup_reader_double(reader);
+  if (version >= OSUP_DB_VERSION_FLOAT_DIFFICULTY) {
+    for (i = 0; i < 4; i++) {
+      osup_db_read_list(reader,
+                        floatStarRatings ? OSUP_DB_FLOAT_PAIR_SIZE
+                                         : OSUP_DB_DOUBLE_PAIR_SIZE,
+                        &record->starRatings[i].pairs,
+                        &record->starRatings[i].count);
+    }
+  }
+  record->drainTime = (osup_int)osup_reader_uint(reader, 4);
+  record->totalTime = (osup_int)osup_reader_uint(reader, 4);
+  record->previewTime = (osup_int)osup_reader_uint(reader, 4);
+  osup_db_read_list(reader, OSUP_DB_TIMING_POINT_SIZE,
+                    &record->timingPoints.bytes, &record->timingPoints.count);
+  record->metadata.beatmapID = (osup_int)osup_reader_uint(reader, 4);
+  record->metadata.beatmapSetID = (osup_int)osup_reader_uint(reader, 4);
+  record->threadID = (osup_int)osup_reader_uint(reader, 4);
+  for (i = 0; i < 4; i++) {
+    record->grades[i] = (uint8_t)osup_reader_uint(reader, 1);
+  }
+  record->localOffset = (int16_t)osup_reader_uint(reader, 2);
+  record->stackLeniency = osup_reader_single(reader);
+  record->mode = (osup_gamemode)osup_reader_uint(reader, 1);
+  record->metadata.sourceView = osup_reader_string(reader);
+  record->metadata.tagsView = osup_reader_string(reader);
+  record->onlineOffset = (int16_t)osup_reader_uint(reader, 2);
+  record->titleFont = osup_reader_string(reader);
+  record->unplayed = osup_reader_uint(reader, 1) != 0;
+  record->lastPlayed = (osup_long)osup_reader_uint(reader, 8);
+  record->osz2 = osup_reader_uint(reader, 1) != 0;
+  record->folderName = osup_reader_string(reader);
+  record->lastChecked = (osup_long)osup_reader_uint(reader, 8);
+  record->ignoreSounds = osup_reader_uint(reader, 1) != 0;
+  record->ignoreSkin = osup_reader_uint(reader, 1) != 0;
+  record->disableStoryboard = osup_reader_uint(reader, 1) != 0;
+  record->disableVideo = osup_reader_uint(reader, 1) != 0;
+  record->visualOverride = osup_reader_uint(reader, 1) != 0;
+  if (version < OSUP_DB_VERSION_FLOAT_DIFFICULTY) {
+    osup_reader_take(reader, 2);
+  }
+  /* another modification time, of unknown meaning */
+  osup_reader_take(reader, 4);
+  record->maniaScrollSpeed = (uint8_t)osup_reader_uint(reader, 1);
+  if (record->mode > OSUP_MODE_MANIA) reader->failed = osup_true;
+}
+
+/***********
+ * READING *
+ ***********/
+OSUP_API osup_bool osup_db_open_buffer(osup_db* db, const void* data,
+                                       size_t size) {
+  osup_reader reader;
+  osup_db_record record;
+  size_t i;
+  memset(db, 0, sizeof(*db));
+  osup_reader_init(&reader, data, size);
+  db->data = data;
+  db->version = (osup_int)osup_reader_uint(&reader, 4);
+  db->folderCount = (osup_int)osup_reader_uint(&reader, 4);
+  db->accountUnlocked = osup_reader_uint(&reader, 1) != 0;
+  db->unlockDate = (osup_long)osup_reader_uint(&reader, 8);
+  db->playerName = osup_reader_string(&reader);
+  db->count = (uint32_t)osup_reader_uint(&reader, 4);
+  /* every record takes far more than a byte, so a corrupted count can't make
+   * us allocate more than the file size */
+  if (reader.failed || db->count > (size_t)(reader.end - reader.it)) {
+    OSUP_DB_ERROR("not an osu!.db file, or truncated");
+    osup_db_close(db);
+    return osup_false;
+  }
+  db->offsets = malloc((db->count + 1) * sizeof(size_t));
+  if (!db->offsets) {
+    OSUP_DB_ERROR("malloc returns NULL, malloc size: %zu",
+                  (db->count + 1) * sizeof(size_t));
+    osup_db_close(db);
+    return osup_false;
+  }
+
+  /* old versions give the size of every record, the newer ones have to be
+   * walked field by field */
+  for (i = 0; i < db->count && !reader.failed; i++) {
+    db->offsets[i] = (size_t)(reader.it - db->data);
+    if (db->version < OSUP_DB_VERSION_NO_ENTRY_SIZE) {
+      uint32_t recordSize = (uint32_t)osup_reader_uint(&reader, 4);
+      osup_reader_take(&reader, recordSize);
+    } else {
+      osup_db_read_record(&reader, db->version, &record);
+    }
+  }
+  db->offsets[i] = (size_t)(reader.it - db->data);
+  db->permissions = (osup_int)osup_reader_uint(&reader, 4);
+  if (reader.failed) {
+    OSUP_DB_ERROR("osu!.db is truncated at record %zu of %zu", i, db->count);
+    osup_db_close(db);
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_db_open(osup_db* db, const char* file) {
+  osup_mapped_file f;
+  if (!osup_map_file(file, &f)) {
+    memset(db, 0, sizeof(*db));
+    OSUP_DB_ERROR("unable to read file %s", file);
+    return osup_false;
+  }
+  if (!osup_db_open_buffer(db, f.data, f.size)) {
+    osup_unmap_file(&f);
+    return osup_false;
+  }
+  /* the records point into it */
+  db->file = f;
+  return osup_true;
+}
+
+OSUP_API void osup_db_close(osup_db* db) {
+  osup_free_ptr(db->offsets);
+  osup_unmap_file(&db->file);
+  memset(db, 0, sizeof(*db));
+}
+
+OSUP_API size_t osup_db_count(const osup_db* db) { return db->count; }
+
+OSUP_API osup_bool osup_db_get(const osup_db* db, size_t i,
+                               osup_db_record* record) {
+  osup_reader reader;
+  if (i >= db->count) return osup_false;
+  osup_reader_init(&reader, db->data + db->offsets[i],
+                   db->offsets[i + 1] - db->offsets[i]);
+  if (db->version < OSUP_DB_VERSION_NO_ENTRY_SIZE) {
+    osup_reader_take(&reader, 4);
+  }
+  osup_db_read_record(&reader, db->version, record);
+  if (reader.failed) {
+    OSUP_DB_ERROR("record %zu is corrupted", i);
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_db_star_rating(const osup_db_record* record,
+                                       osup_gamemode mode,
+                                       osup_bitfield32 mods,
+                                       osup_decimal* stars) {
+  osup_reader reader;
+  size_t i;
+  if ((unsigned)mode > OSUP_MODE_MANIA || !record->starRatings[mode].count) {
+    return osup_false;
+  }
+  osup_reader_init(&reader, record->starRatings[mode].pairs.begin,
+                   (size_t)(record->starRatings[mode].pairs.end -
+                            record->starRatings[mode].pairs.begin));
+  for (i = 0; i < record->starRatings[mode].count; i++) {
+    osup_reader_take(&reader, 1);
+    osup_bitfield32 pairMods = (osup_bitfield32)osup_reader_uint(&reader, 4);
+    osup_reader_take(&reader, 1);
+    osup_decimal value = record->floatStarRatings
+                             ? osup_reader_single(&reader)
+                             : osup_reader_double(&reader);
+    if (pairMods == mods) {
+      *stars = value;
+      return osup_true;
+    }
+  }
+  return osup_false;
+}
+
+OSUP_API osup_bool osup_db_timing_point(const osup_db_record* record,
+                                        size_t i,
+                                        osup_timingpoint* timingPoint) {
+  osup_reader reader;
+  if (i >= record->timingPoints.count) return osup_false;
+  osup_reader_init(&reader,
+                   record->timingPoints.bytes.begin +
+                       i * OSUP_DB_TIMING_POINT_SIZE,
+                   OSUP_DB_TIMING_POINT_SIZE);
+  memset(timingPoint, 0, sizeof(*timingPoint));
+  timingPoint->beatLength = osup_reader_double(&reader);
+  timingPoint->time = (osup_int)osup_reader_double(&reader);
+  timingPoint->uninherited = osup_reader_uint(&reader, 1) != 0;
+  return osup_true;
+}
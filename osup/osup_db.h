@@ -0,0 +1,151 @@
+#ifndef OSUP_DB_H
+#define OSUP_DB_H
+
+/*********
+ * USAGE *
+ *********/
+#if 0
+
+int main() {
+  /* the records are found once, their fields are only decoded on demand */
+  osup_db db{};
+  osup_db_record record;
+  osup_db_open(&db, "/path/to/osu!/osu!.db");
+  for (size_t i = 0; i < osup_db_count(&db); i++) {
+    if (!osup_db_get(&db, i, &record)) continue;
+    printf("%.*s\n", (int)(record.metadata.titleView.end -
+                           record.metadata.titleView.begin),
+           record.metadata.titleView.begin);
+  }
+  osup_db_close(&db);
+  return 0;
+}
+
+#endif
+
+#define OSUP_API
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "osup_beatmap.h"
+
+/* the version the records got rid of their size prefix */
+#define OSUP_DB_VERSION_NO_ENTRY_SIZE 20191106
+/* the version difficulty settings became floats and star ratings appeared */
+#define OSUP_DB_VERSION_FLOAT_DIFFICULTY 20140609
+/* the version star ratings became floats instead of doubles */
+#define OSUP_DB_VERSION_FLOAT_STAR_RATINGS 20250107
+
+typedef enum {
+  OSUP_DB_RANKED_UNKNOWN = 0,
+  OSUP_DB_RANKED_UNSUBMITTED = 1,
+  /* pending, wip and graveyard */
+  OSUP_DB_RANKED_PENDING = 2,
+  OSUP_DB_RANKED_RANKED = 4,
+  OSUP_DB_RANKED_APPROVED = 5,
+  OSUP_DB_RANKED_QUALIFIED = 6,
+  OSUP_DB_RANKED_LOVED = 7
+} osup_db_ranked_status;
+
+/* one installed difficulty, every string is a view into the database (not
+ * null-terminated), the char* fields and tags.elements of metadata are NULL,
+ * like with OSUP_PARSE_STRING_VIEWS */
+typedef struct {
+  osup_bm_metadata metadata;
+  /* sliderTickRate is not in the database, it is 0 */
+  osup_bm_difficulty difficulty;
+  osup_slice audioFilename;
+  /* MD5 of the .osu file, in hex, the same as osup_replay.beatmapHash */
+  osup_slice hash;
+  osup_slice osuFilename;
+  osup_slice folderName;
+  osup_slice titleFont;
+  osup_db_ranked_status rankedStatus;
+  osup_int hitCircleCount;
+  osup_int sliderCount;
+  osup_int spinnerCount;
+  /* windows ticks, 100 ns since 0001-01-01 */
+  osup_long lastModified;
+  osup_long lastPlayed;
+  osup_long lastChecked;
+  /* seconds */
+  osup_int drainTime;
+  /* milliseconds */
+  osup_int totalTime;
+  osup_int previewTime;
+  osup_int threadID;
+  /* per mode, 9 if the map was never played */
+  uint8_t grades[4];
+  osup_int localOffset;
+  osup_int onlineOffset;
+  osup_decimal stackLeniency;
+  osup_gamemode mode;
+  osup_bool unplayed;
+  osup_bool osz2;
+  osup_bool ignoreSounds;
+  osup_bool ignoreSkin;
+  osup_bool disableStoryboard;
+  osup_bool disableVideo;
+  osup_bool visualOverride;
+  uint8_t maniaScrollSpeed;
+
+  /* raw, read them with osup_db_star_rating and osup_db_timing_point */
+  struct {
+    osup_slice pairs;
+    size_t count;
+  } starRatings[4];
+  struct {
+    osup_slice bytes;
+    size_t count;
+  } timingPoints;
+  osup_bool floatStarRatings;
+} osup_db_record;
+
+typedef struct {
+  osup_int version;
+  osup_int folderCount;
+  osup_bool accountUnlocked;
+  /* windows ticks */
+  osup_long unlockDate;
+  osup_slice playerName;
+  osup_int permissions;
+
+  /* where the records are, record i is [offsets[i], offsets[i + 1]) in
+   * data */
+  const uint8_t* data;
+  size_t* offsets;
+  size_t count;
+  /* only used with osup_db_open */
+  osup_mapped_file file;
+} osup_db;
+
+/* map the database and find every record, nothing else is decoded */
+OSUP_API osup_bool osup_db_open(osup_db* db, const char* file);
+/* the records are not copied, data must outlive the db */
+OSUP_API osup_bool osup_db_open_buffer(osup_db* db, const void* data,
+                                       size_t size);
+OSUP_API void osup_db_close(osup_db* db);
+OSUP_API size_t osup_db_count(const osup_db* db);
+/* decode record i, return osup_false if it is corrupted */
+OSUP_API osup_bool osup_db_get(const osup_db* db, size_t i,
+                               osup_db_record* record);
+
+/* the star rating of the record for the given mode and (difficulty
+ * changing) mods, osup_false if it was never computed */
+OSUP_API osup_bool osup_db_star_rating(const osup_db_record* record,
+                                       osup_gamemode mode,
+                                       osup_bitfield32 mods,
+                                       osup_decimal* stars);
+/* only time, beatLength and uninherited are in the database, the rest is 0,
+ * osup_false if i is out of range */
+OSUP_API osup_bool osup_db_timing_point(const osup_db_record* record,
+                                        size_t i,
+                                        osup_timingpoint* timingPoint);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
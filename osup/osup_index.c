@@ -0,0 +1,378 @@
+#include "osup_index.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define OSUP_HAS_STAT
+#include <sys/stat.h>
+#endif
+
+#ifdef OSUP_NO_LOGGING
+#define OSUP_INDEX_ERROR(...)
+#else
+#define OSUP_INDEX_ERROR(...)                                         \
+  do {                                                                \
+    if (osup_has_error_callback()) osup_error("[index] " __VA_ARGS__); \
+  } while (0)
+#endif
+
+#define OSUP_INDEX_BYTE_ORDER 0x01020304u
+
+/* the string fields of osup_index_record, path first */
+OSUP_STORAGE const size_t osup_index_string_fields[] = {
+    offsetof(osup_index_record, path),
+    offsetof(osup_index_record, title),
+    offsetof(osup_index_record, titleUnicode),
+    offsetof(osup_index_record, artist),
+    offsetof(osup_index_record, artistUnicode),
+    offsetof(osup_index_record, creator),
+    offsetof(osup_index_record, version),
+    offsetof(osup_index_record, source),
+    offsetof(osup_index_record, tags),
+    offsetof(osup_index_record, audioFilename)};
+
+#define OSUP_INDEX_STRING_COUNT \
+  (sizeof(osup_index_string_fields) / sizeof(osup_index_string_fields[0]))
+
+OSUP_INTERN uint32_t* osup_index_record_string(osup_index_record* record,
+                                               size_t i) {
+  return (uint32_t*)((char*)record + osup_index_string_fields[i]);
+}
+
+/***********
+ * READING *
+ ***********/
+OSUP_API osup_bool osup_index_open(osup_index* index, const char* path) {
+  const osup_index_header* header;
+  memset(index, 0, sizeof(*index));
+  if (!osup_map_file(path, &index->file)) {
+    return osup_false;
+  }
+  header = (const osup_index_header*)index->file.data;
+  if (index->file.size < sizeof(osup_index_header) ||
+      memcmp(header->magic, OSUP_INDEX_MAGIC, sizeof(OSUP_INDEX_MAGIC)) ||
+      header->version != OSUP_INDEX_VERSION ||
+      header->byteOrder != OSUP_INDEX_BYTE_ORDER) {
+    OSUP_INDEX_ERROR("%s is not an index file (or from another version)",
+                     path);
+    osup_index_close(index);
+    return osup_false;
+  }
+  /* the strings must end with a null terminator so no lookup can run past
+   * the end */
+  if (header->recordCount >
+          (index->file.size - sizeof(osup_index_header)) /
+              sizeof(osup_index_record) ||
+      header->stringsSize !=
+          index->file.size - sizeof(osup_index_header) -
+              header->recordCount * sizeof(osup_index_record) ||
+      !header->stringsSize ||
+      index->file.data[index->file.size - 1] != '\0') {
+    OSUP_INDEX_ERROR("%s is truncated", path);
+    osup_index_close(index);
+    return osup_false;
+  }
+  index->header = header;
+  index->records = (const osup_index_record*)(header + 1);
+  index->strings = (const char*)(index->records + header->recordCount);
+  return osup_true;
+}
+
+OSUP_API void osup_index_close(osup_index* index) {
+  osup_unmap_file(&index->file);
+  memset(index, 0, sizeof(*index));
+}
+
+OSUP_API size_t osup_index_count(const osup_index* index) {
+  return index->header ? (size_t)index->header->recordCount : 0;
+}
+
+OSUP_API const osup_index_record* osup_index_get(const osup_index* index,
+                                                 size_t i) {
+  return &index->records[i];
+}
+
+OSUP_API const char* osup_index_string(const osup_index* index,
+                                       uint32_t offset) {
+  return offset < index->header->stringsSize ? index->strings + offset : "";
+}
+
+OSUP_API const osup_index_record* osup_index_find(const osup_index* index,
+                                                  const char* path) {
+  size_t begin = 0;
+  size_t end = osup_index_count(index);
+  while (begin < end) {
+    size_t middle = begin + (end - begin) / 2;
+    int cmp = strcmp(osup_index_string(index, index->records[middle].path),
+                     path);
+    if (cmp == 0) {
+      return &index->records[middle];
+    } else if (cmp < 0) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return NULL;
+}
+
+/************
+ * UPDATING *
+ ************/
+typedef struct {
+  const char* path;
+  osup_index_record record;
+  /* the strings of record, taken from the old index or from buffer */
+  const char* strings[OSUP_INDEX_STRING_COUNT];
+  char* buffer;
+  const osup_index_record* old;
+  const osup_index* oldIndex;
+  enum { OSUP_INDEX_REUSED, OSUP_INDEX_REHASHED, OSUP_INDEX_PARSED,
+         OSUP_INDEX_FAILED } status;
+} osup_index_file;
+
+OSUP_INTERN void osup_index_reuse(osup_index_file* file) {
+  size_t i;
+  int64_t mtime = file->record.mtime;
+  uint64_t size = file->record.size;
+  file->record = *file->old;
+  file->record.mtime = mtime;
+  file->record.size = size;
+  for (i = 0; i < OSUP_INDEX_STRING_COUNT; i++) {
+    file->strings[i] = osup_index_string(
+        file->oldIndex, *osup_index_record_string(&file->record, i));
+  }
+}
+
+/* copy the viewed strings into one buffer owned by file, the map goes away
+ * right after */
+OSUP_INTERN osup_bool osup_index_copy_strings(osup_index_file* file,
+                                              const osup_slice* views) {
+  size_t i, size = 0;
+  char* it;
+  for (i = 1; i < OSUP_INDEX_STRING_COUNT; i++) {
+    size += views[i].end - views[i].begin + 1;
+  }
+  file->buffer = malloc(size);
+  if (!file->buffer) return osup_false;
+  it = file->buffer;
+  file->strings[0] = file->path;
+  for (i = 1; i < OSUP_INDEX_STRING_COUNT; i++) {
+    size_t len = views[i].end - views[i].begin;
+    if (len) memcpy(it, views[i].begin, len);
+    it[len] = '\0';
+    file->strings[i] = it;
+    it += len + 1;
+  }
+  return osup_true;
+}
+
+OSUP_INTERN void osup_index_parse_file(void* ptr) {
+  osup_index_file* file = ptr;
+  osup_mapped_file f;
+  osup_bm map;
+  if (!osup_map_file(file->path, &f)) {
+    OSUP_INDEX_ERROR("unable to read file %s", file->path);
+    file->status = OSUP_INDEX_FAILED;
+    return;
+  }
+  file->record.size = f.size;
+  file->record.hash = osup_hash(f.data, f.size);
+  if (file->old && file->old->hash == file->record.hash) {
+    /* touched, but the content is the same */
+    osup_unmap_file(&f);
+    osup_index_reuse(file);
+    file->status = OSUP_INDEX_REHASHED;
+    return;
+  }
+
+  /* everything needed is at the top of the file, the rest isn't read */
+  memset(&map, 0, sizeof(map));
+  if (!osup_beatmap_load_string(&map, f.data,
+                                OSUP_PARSE_GENERAL | OSUP_PARSE_METADATA |
+                                    OSUP_PARSE_DIFFICULTY |
+                                    OSUP_PARSE_STRING_VIEWS)) {
+    OSUP_INDEX_ERROR("unable to parse file %s", file->path);
+    file->status = OSUP_INDEX_FAILED;
+  } else {
+    osup_slice views[OSUP_INDEX_STRING_COUNT];
+    memset(&views[0], 0, sizeof(views[0]));
+    views[1] = map.metadata.titleView;
+    views[2] = map.metadata.titleUnicodeView;
+    views[3] = map.metadata.artistView;
+    views[4] = map.metadata.artistUnicodeView;
+    views[5] = map.metadata.creatorView;
+    views[6] = map.metadata.versionView;
+    views[7] = map.metadata.sourceView;
+    views[8] = map.metadata.tagsView;
+    views[9] = map.general.audioFilenameView;
+    file->record.beatmapID = map.metadata.beatmapID;
+    file->record.beatmapSetID = map.metadata.beatmapSetID;
+    file->record.previewTime = map.general.previewTime;
+    file->record.mode = map.general.mode;
+    file->record.stackLeniency = map.general.stackLeniency;
+    file->record.difficulty = map.difficulty;
+    file->status = osup_index_copy_strings(file, views) ? OSUP_INDEX_PARSED
+                                                        : OSUP_INDEX_FAILED;
+  }
+  osup_beatmap_free(&map);
+  osup_unmap_file(&f);
+}
+
+OSUP_INTERN int osup_index_compare_files(const void* a, const void* b) {
+  return strcmp(((const osup_index_file*)a)->path,
+                ((const osup_index_file*)b)->path);
+}
+
+OSUP_INTERN osup_bool osup_index_write(osup_index_file* files, size_t count,
+                                       const char* output) {
+  osup_index_header header;
+  size_t i, j, recordCount = 0;
+  uint64_t stringsSize = 1;
+  FILE* f;
+  osup_bool ok = osup_true;
+  for (i = 0; i < count; i++) {
+    if (files[i].status == OSUP_INDEX_FAILED) continue;
+    if (i && !strcmp(files[i].path, files[i - 1].path)) {
+      /* listed twice */
+      files[i].status = OSUP_INDEX_FAILED;
+      continue;
+    }
+    for (j = 0; j < OSUP_INDEX_STRING_COUNT; j++) {
+      size_t len = strlen(files[i].strings[j]);
+      *osup_index_record_string(&files[i].record, j) =
+          len ? (uint32_t)stringsSize : 0;
+      if (len) stringsSize += len + 1;
+    }
+    recordCount++;
+  }
+  if (stringsSize > UINT32_MAX) {
+    OSUP_INDEX_ERROR("too many strings for an index file");
+    return osup_false;
+  }
+
+  f = fopen(output, "wb");
+  if (!f) {
+    OSUP_INDEX_ERROR("unable to write file %s", output);
+    return osup_false;
+  }
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, OSUP_INDEX_MAGIC, sizeof(OSUP_INDEX_MAGIC));
+  header.version = OSUP_INDEX_VERSION;
+  header.byteOrder = OSUP_INDEX_BYTE_ORDER;
+  header.recordCount = recordCount;
+  header.stringsSize = stringsSize;
+  ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  for (i = 0; ok && i < count; i++) {
+    if (files[i].status == OSUP_INDEX_FAILED) continue;
+    ok = fwrite(&files[i].record, sizeof(osup_index_record), 1, f) == 1;
+  }
+  /* the empty string first, then the others in the order of the offsets */
+  ok = ok && fputc('\0', f) != EOF;
+  for (i = 0; ok && i < count; i++) {
+    if (files[i].status == OSUP_INDEX_FAILED) continue;
+    for (j = 0; ok && j < OSUP_INDEX_STRING_COUNT; j++) {
+      size_t len = strlen(files[i].strings[j]);
+      if (len) ok = fwrite(files[i].strings[j], 1, len + 1, f) == len + 1;
+    }
+  }
+  ok = !fclose(f) && ok;
+  if (!ok) {
+    OSUP_INDEX_ERROR("unable to write file %s", output);
+    remove(output);
+  }
+  return ok;
+}
+
+OSUP_API osup_bool osup_index_update(const osup_index* old,
+                                     const char* const* paths, size_t count,
+                                     const char* output, size_t threadCount,
+                                     osup_index_stats* stats) {
+  osup_index_file* files = malloc((count ? count : 1) * sizeof(osup_index_file));
+  osup_index_file* changed = NULL;
+  size_t i, changedCount = 0;
+  osup_bool ok;
+  if (!files) {
+    OSUP_INDEX_ERROR("malloc returns NULL");
+    return osup_false;
+  }
+  memset(files, 0, count * sizeof(osup_index_file));
+  for (i = 0; i < count; i++) {
+    osup_index_file* file = &files[i];
+    file->path = paths[i];
+    file->oldIndex = old;
+    file->old = old ? osup_index_find(old, paths[i]) : NULL;
+#ifdef OSUP_HAS_STAT
+    /* the mtime only has a one second resolution, a file rewritten with the
+     * same size within the same second as the last scan is missed */
+    struct stat st;
+    if (stat(paths[i], &st) || !S_ISREG(st.st_mode)) {
+      OSUP_INDEX_ERROR("unable to read file %s", paths[i]);
+      file->status = OSUP_INDEX_FAILED;
+      continue;
+    }
+    file->record.mtime = (int64_t)st.st_mtime;
+    file->record.size = (uint64_t)st.st_size;
+    if (file->old && file->old->mtime == file->record.mtime &&
+        file->old->size == file->record.size) {
+      osup_index_reuse(file);
+      file->status = OSUP_INDEX_REUSED;
+      continue;
+    }
+#endif
+    file->status = OSUP_INDEX_PARSED;
+    changedCount++;
+  }
+
+  /* the files are sorted first, so the changed ones are parsed in order */
+  qsort(files, count, sizeof(osup_index_file), osup_index_compare_files);
+  changed = malloc((changedCount ? changedCount : 1) * sizeof(osup_index_file));
+  ok = changed != NULL;
+  if (ok && changedCount) {
+    size_t j = 0;
+    osup_pool* pool = osup_pool_create(threadCount);
+    for (i = 0; i < count; i++) {
+      if (files[i].status == OSUP_INDEX_PARSED) changed[j++] = files[i];
+    }
+    ok = pool != NULL;
+    if (ok) {
+      osup_pool_run(pool, osup_index_parse_file, changed,
+                    sizeof(osup_index_file), changedCount);
+    }
+    osup_pool_free(pool);
+    j = 0;
+    for (i = 0; i < count; i++) {
+      if (files[i].status == OSUP_INDEX_PARSED) files[i] = changed[j++];
+    }
+  }
+
+  ok = ok && osup_index_write(files, count, output);
+  if (stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < count; i++) {
+      switch (files[i].status) {
+        case OSUP_INDEX_REUSED:
+          stats->reused++;
+          break;
+        case OSUP_INDEX_REHASHED:
+          stats->rehashed++;
+          break;
+        case OSUP_INDEX_PARSED:
+          stats->parsed++;
+          break;
+        case OSUP_INDEX_FAILED:
+          stats->failed++;
+          break;
+      }
+    }
+  }
+  for (i = 0; i < count; i++) {
+    osup_free_ptr(files[i].buffer);
+  }
+  osup_free_ptr(changed);
+  osup_free_ptr(files);
+  return ok;
+}
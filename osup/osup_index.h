@@ -0,0 +1,124 @@
+#ifndef OSUP_INDEX_H
+#define OSUP_INDEX_H
+
+/*********
+ * USAGE *
+ *********/
+#if 0
+
+int main() {
+  /* the first run parses every file, the next ones only parse what changed */
+  osup_index old{};
+  osup_index index{};
+  osup_index_stats stats;
+  osup_index_open(&old, "songs.idx"); /* fine if it doesn't exist yet */
+  osup_index_update(&old, paths, pathCount, "songs.idx.new", 4, &stats);
+  osup_index_close(&old);
+  rename("songs.idx.new", "songs.idx");
+
+  osup_index_open(&index, "songs.idx");
+  for (size_t i = 0; i < osup_index_count(&index); i++) {
+    const osup_index_record* record = osup_index_get(&index, i);
+    printf("%s\n", osup_index_string(&index, record->title));
+  }
+  osup_index_close(&index);
+  return 0;
+}
+
+#endif
+
+#define OSUP_API
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "osup_beatmap.h"
+
+/* the index is a single file, mapped as is:
+ *   osup_index_header
+ *   osup_index_record[recordCount], sorted by path
+ *   the strings, null-terminated, referenced by their offset
+ * everything is in the byte order of the machine that wrote it, an index
+ * written on a machine with another byte order is rejected */
+#define OSUP_INDEX_MAGIC "osupidx"
+#define OSUP_INDEX_VERSION 1
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  /* 0x01020304 as written by the machine */
+  uint32_t byteOrder;
+  uint64_t recordCount;
+  uint64_t stringsSize;
+  uint64_t reserved;
+} osup_index_header;
+
+/* the string fields are offsets into the strings, 0 is the empty string */
+typedef struct {
+  uint32_t path;
+  uint32_t title;
+  uint32_t titleUnicode;
+  uint32_t artist;
+  uint32_t artistUnicode;
+  uint32_t creator;
+  uint32_t version;
+  uint32_t source;
+  uint32_t tags;
+  uint32_t audioFilename;
+  /* what the record was built from */
+  int64_t mtime;
+  uint64_t size;
+  uint64_t hash;
+  osup_int beatmapID;
+  osup_int beatmapSetID;
+  osup_int previewTime;
+  osup_int mode;
+  osup_decimal stackLeniency;
+  osup_bm_difficulty difficulty;
+} osup_index_record;
+
+typedef struct {
+  osup_mapped_file file;
+  const osup_index_header* header;
+  const osup_index_record* records;
+  const char* strings;
+} osup_index;
+
+typedef struct {
+  /* same mtime and size, the file wasn't even opened */
+  size_t reused;
+  /* different mtime or size, but the same content hash */
+  size_t rehashed;
+  size_t parsed;
+  /* missing, invalid or listed twice, they are left out of the new index */
+  size_t failed;
+} osup_index_stats;
+
+/* map an index file, return osup_false if it is missing or invalid, the
+ * index is left empty (and can still be used) in that case */
+OSUP_API osup_bool osup_index_open(osup_index* index, const char* path);
+OSUP_API void osup_index_close(osup_index* index);
+OSUP_API size_t osup_index_count(const osup_index* index);
+OSUP_API const osup_index_record* osup_index_get(const osup_index* index,
+                                                 size_t i);
+/* binary search, NULL if path is not in the index */
+OSUP_API const osup_index_record* osup_index_find(const osup_index* index,
+                                                  const char* path);
+OSUP_API const char* osup_index_string(const osup_index* index,
+                                       uint32_t offset);
+
+/* write the index of the given .osu files to output, the records of old (which
+ * may be empty) are reused for unchanged files and only the general, metadata
+ * and difficulty sections of the others are parsed, on threadCount threads.
+ * output must not be the file old is mapped from. stats may be NULL */
+OSUP_API osup_bool osup_index_update(const osup_index* old,
+                                     const char* const* paths, size_t count,
+                                     const char* output, size_t threadCount,
+                                     osup_index_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,673 @@
+#include "osup_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OSUP_NO_LOGGING
+#define OSUP_REPLAY_ERROR(...)
+#else
+#define OSUP_REPLAY_ERROR(...)                                         \
+  do {                                                                 \
+    if (osup_has_error_callback()) osup_error("[replay] " __VA_ARGS__); \
+  } while (0)
+#endif
+
+/****************
+ * LZMA DECODER *
+ ****************/
+/* a plain LZMA decoder for the "lzma alone" format the frames are stored in,
+ * after the reference decoder of the LZMA SDK. it decodes on demand: the
+ * window doubles as the dictionary, and a match that doesn't fit in the
+ * caller's buffer is finished on the next call, so nothing but the window is
+ * ever kept in memory */
+#define OSUP_LZMA_HEADER_SIZE 13
+#define OSUP_LZMA_MIN_DICT_SIZE (1u << 12)
+/* the window starts this big and doubles while the output grows, up to the
+ * dictionary size, so a header asking for a 4 GiB dictionary costs nothing
+ * until that much is actually decoded */
+#define OSUP_LZMA_INITIAL_WINDOW_SIZE (1u << 16)
+#define OSUP_LZMA_NUM_STATES 12
+#define OSUP_LZMA_MAX_POS_STATES (1 << 4)
+#define OSUP_LZMA_MATCH_MIN_LEN 2
+#define OSUP_LZMA_LEN_TO_POS_STATES 4
+#define OSUP_LZMA_END_POS_MODEL_INDEX 14
+#define OSUP_LZMA_FULL_DISTANCES (1 << 7)
+#define OSUP_LZMA_ALIGN_BITS 4
+#define OSUP_LZMA_LITERAL_SIZE 0x300
+/* the probabilities are 11-bit fixed point numbers, starting at 0.5 */
+#define OSUP_LZMA_PROB_BITS 11
+#define OSUP_LZMA_PROB_INIT (1 << (OSUP_LZMA_PROB_BITS - 1))
+#define OSUP_LZMA_MOVE_BITS 5
+#define OSUP_LZMA_TOP (1u << 24)
+
+typedef uint16_t osup_lzma_prob;
+
+typedef struct {
+  osup_lzma_prob choice;
+  osup_lzma_prob choice2;
+  osup_lzma_prob low[OSUP_LZMA_MAX_POS_STATES][1 << 3];
+  osup_lzma_prob mid[OSUP_LZMA_MAX_POS_STATES][1 << 3];
+  osup_lzma_prob high[1 << 8];
+} osup_lzma_len;
+
+struct osup_lzma {
+  /* range decoder */
+  const uint8_t* in;
+  const uint8_t* inEnd;
+  uint32_t range;
+  uint32_t code;
+
+  /* the last windowSize bytes of output, a ring buffer, it only wraps once it
+   * has grown to maxWindowSize */
+  uint8_t* window;
+  size_t windowSize;
+  size_t maxWindowSize;
+  size_t pos;
+  osup_bool full;
+  uint64_t totalPos;
+
+  uint32_t dictSize;
+  unsigned lc, lp, pb;
+  /* the header may give the size, otherwise the stream ends with a marker */
+  osup_bool sizeKnown;
+  uint64_t remaining;
+
+  unsigned state;
+  uint32_t rep0, rep1, rep2, rep3;
+  /* bytes of the current match that are not copied yet */
+  unsigned matchLength;
+  osup_bool finished;
+  osup_bool failed;
+
+  /* nothing but probabilities, so they can be initialized as one array */
+  struct {
+    osup_lzma_prob isMatch[OSUP_LZMA_NUM_STATES * OSUP_LZMA_MAX_POS_STATES];
+    osup_lzma_prob isRep[OSUP_LZMA_NUM_STATES];
+    osup_lzma_prob isRepG0[OSUP_LZMA_NUM_STATES];
+    osup_lzma_prob isRepG1[OSUP_LZMA_NUM_STATES];
+    osup_lzma_prob isRepG2[OSUP_LZMA_NUM_STATES];
+    osup_lzma_prob isRep0Long[OSUP_LZMA_NUM_STATES * OSUP_LZMA_MAX_POS_STATES];
+    osup_lzma_prob posSlot[OSUP_LZMA_LEN_TO_POS_STATES][1 << 6];
+    osup_lzma_prob posDecoders[1 + OSUP_LZMA_FULL_DISTANCES -
+                               OSUP_LZMA_END_POS_MODEL_INDEX];
+    osup_lzma_prob align[1 << OSUP_LZMA_ALIGN_BITS];
+    osup_lzma_len lenDecoder;
+    osup_lzma_len repLenDecoder;
+  } probs;
+  /* OSUP_LZMA_LITERAL_SIZE per literal state, allocated after the struct */
+  osup_lzma_prob* literals;
+};
+
+OSUP_INTERN uint8_t osup_lzma_next_byte(osup_lzma* lzma) {
+  if (lzma->in == lzma->inEnd) {
+    lzma->failed = osup_true;
+    return 0;
+  }
+  return *lzma->in++;
+}
+
+OSUP_INTERN void osup_lzma_normalize(osup_lzma* lzma) {
+  if (lzma->range < OSUP_LZMA_TOP) {
+    lzma->range <<= 8;
+    lzma->code = (lzma->code << 8) | osup_lzma_next_byte(lzma);
+  }
+}
+
+OSUP_INTERN unsigned osup_lzma_bit(osup_lzma* lzma, osup_lzma_prob* prob) {
+  uint32_t bound = (lzma->range >> OSUP_LZMA_PROB_BITS) * *prob;
+  unsigned bit;
+  if (lzma->code < bound) {
+    *prob += ((1u << OSUP_LZMA_PROB_BITS) - *prob) >> OSUP_LZMA_MOVE_BITS;
+    lzma->range = bound;
+    bit = 0;
+  } else {
+    *prob -= *prob >> OSUP_LZMA_MOVE_BITS;
+    lzma->code -= bound;
+    lzma->range -= bound;
+    bit = 1;
+  }
+  osup_lzma_normalize(lzma);
+  return bit;
+}
+
+/* bits with a fixed probability of 0.5 */
+OSUP_INTERN uint32_t osup_lzma_direct_bits(osup_lzma* lzma, unsigned count) {
+  uint32_t result = 0;
+  do {
+    lzma->range >>= 1;
+    lzma->code -= lzma->range;
+    uint32_t mask = 0 - (lzma->code >> 31);
+    lzma->code += lzma->range & mask;
+    if (lzma->code == lzma->range) lzma->failed = osup_true;
+    osup_lzma_normalize(lzma);
+    result = (result << 1) + (mask + 1);
+  } while (--count);
+  return result;
+}
+
+OSUP_INTERN unsigned osup_lzma_tree(osup_lzma* lzma, osup_lzma_prob* probs,
+                                    unsigned bits) {
+  unsigned m = 1;
+  unsigned i;
+  for (i = 0; i < bits; i++) {
+    m = (m << 1) + osup_lzma_bit(lzma, &probs[m]);
+  }
+  return m - (1u << bits);
+}
+
+OSUP_INTERN unsigned osup_lzma_reverse_tree(osup_lzma* lzma,
+                                            osup_lzma_prob* probs,
+                                            unsigned bits) {
+  unsigned m = 1;
+  unsigned symbol = 0;
+  unsigned i;
+  for (i = 0; i < bits; i++) {
+    unsigned bit = osup_lzma_bit(lzma, &probs[m]);
+    m = (m << 1) + bit;
+    symbol |= bit << i;
+  }
+  return symbol;
+}
+
+OSUP_INTERN unsigned osup_lzma_decode_len(osup_lzma* lzma, osup_lzma_len* len,
+                                          unsigned posState) {
+  if (!osup_lzma_bit(lzma, &len->choice)) {
+    return osup_lzma_tree(lzma, len->low[posState], 3);
+  }
+  if (!osup_lzma_bit(lzma, &len->choice2)) {
+    return 8 + osup_lzma_tree(lzma, len->mid[posState], 3);
+  }
+  return 16 + osup_lzma_tree(lzma, len->high, 8);
+}
+
+OSUP_INTERN uint32_t osup_lzma_decode_distance(osup_lzma* lzma,
+                                               unsigned len) {
+  unsigned lenState = len < OSUP_LZMA_LEN_TO_POS_STATES - 1
+                          ? len
+                          : OSUP_LZMA_LEN_TO_POS_STATES - 1;
+  unsigned posSlot = osup_lzma_tree(lzma, lzma->probs.posSlot[lenState], 6);
+  if (posSlot < 4) return posSlot;
+  unsigned directBits = (posSlot >> 1) - 1;
+  uint32_t dist = (2 | (posSlot & 1)) << directBits;
+  if (posSlot < OSUP_LZMA_END_POS_MODEL_INDEX) {
+    dist += osup_lzma_reverse_tree(
+        lzma, lzma->probs.posDecoders + dist - posSlot, directBits);
+  } else {
+    dist += osup_lzma_direct_bits(lzma, directBits - OSUP_LZMA_ALIGN_BITS)
+            << OSUP_LZMA_ALIGN_BITS;
+    dist += osup_lzma_reverse_tree(lzma, lzma->probs.align,
+                                   OSUP_LZMA_ALIGN_BITS);
+  }
+  return dist;
+}
+
+/* dist is 1 for the last byte */
+OSUP_INTERN uint8_t osup_lzma_get(const osup_lzma* lzma, uint32_t dist) {
+  return lzma->window[dist <= lzma->pos ? lzma->pos - dist
+                                        : lzma->windowSize - dist + lzma->pos];
+}
+
+OSUP_INTERN void osup_lzma_put(osup_lzma* lzma, uint8_t byte) {
+  lzma->window[lzma->pos++] = byte;
+  lzma->totalPos++;
+  lzma->remaining--;
+  if (lzma->pos < lzma->windowSize) return;
+  if (lzma->windowSize < lzma->maxWindowSize) {
+    /* not wrapped yet, so the output is still in order and can be moved */
+    size_t windowSize = lzma->windowSize * 2 < lzma->maxWindowSize
+                            ? lzma->windowSize * 2
+                            : lzma->maxWindowSize;
+    uint8_t* window = realloc(lzma->window, windowSize);
+    if (!window) {
+      lzma->failed = osup_true;
+      return;
+    }
+    lzma->window = window;
+    lzma->windowSize = windowSize;
+    return;
+  }
+  lzma->pos = 0;
+  lzma->full = osup_true;
+}
+
+OSUP_INTERN uint8_t osup_lzma_literal(osup_lzma* lzma) {
+  unsigned prevByte = lzma->totalPos ? osup_lzma_get(lzma, 1) : 0;
+  unsigned symbol = 1;
+  unsigned litState =
+      (((unsigned)lzma->totalPos & ((1u << lzma->lp) - 1)) << lzma->lc) +
+      (prevByte >> (8 - lzma->lc));
+  osup_lzma_prob* probs = lzma->literals + OSUP_LZMA_LITERAL_SIZE * litState;
+  /* right after a match, the byte that follows the match in the dictionary
+   * is a good guess */
+  if (lzma->state >= 7) {
+    unsigned matchByte = osup_lzma_get(lzma, lzma->rep0 + 1);
+    do {
+      unsigned matchBit = (matchByte >> 7) & 1;
+      matchByte <<= 1;
+      unsigned bit =
+          osup_lzma_bit(lzma, &probs[((1 + matchBit) << 8) + symbol]);
+      symbol = (symbol << 1) | bit;
+      if (matchBit != bit) break;
+    } while (symbol < 0x100);
+  }
+  while (symbol < 0x100) {
+    symbol = (symbol << 1) | osup_lzma_bit(lzma, &probs[symbol]);
+  }
+  return (uint8_t)(symbol - 0x100);
+}
+
+/* decode the next literal (it is put in the window right away) or match (it
+ * is only checked, its bytes are copied by osup_lzma_read) */
+OSUP_INTERN void osup_lzma_step(osup_lzma* lzma) {
+  unsigned state = lzma->state;
+  unsigned posState = (unsigned)lzma->totalPos & ((1u << lzma->pb) - 1);
+  osup_bool atEnd = lzma->sizeKnown && !lzma->remaining;
+  unsigned len;
+  /* the end marker is optional when the size is known */
+  if (atEnd && !lzma->code) {
+    lzma->finished = osup_true;
+    return;
+  }
+  if (!osup_lzma_bit(lzma, &lzma->probs.isMatch[(state << 4) + posState])) {
+    if (atEnd) goto corrupted;
+    osup_lzma_put(lzma, osup_lzma_literal(lzma));
+    lzma->state = state < 4 ? 0 : state < 10 ? state - 3 : state - 6;
+    return;
+  }
+  if (osup_lzma_bit(lzma, &lzma->probs.isRep[state])) {
+    if (atEnd || !lzma->totalPos) goto corrupted;
+    if (!osup_lzma_bit(lzma, &lzma->probs.isRepG0[state])) {
+      if (!osup_lzma_bit(lzma,
+                         &lzma->probs.isRep0Long[(state << 4) + posState])) {
+        /* a single byte at rep0 */
+        lzma->state = state < 7 ? 9 : 11;
+        lzma->matchLength = 1;
+        return;
+      }
+    } else {
+      uint32_t dist;
+      if (!osup_lzma_bit(lzma, &lzma->probs.isRepG1[state])) {
+        dist = lzma->rep1;
+      } else {
+        if (!osup_lzma_bit(lzma, &lzma->probs.isRepG2[state])) {
+          dist = lzma->rep2;
+        } else {
+          dist = lzma->rep3;
+          lzma->rep3 = lzma->rep2;
+        }
+        lzma->rep2 = lzma->rep1;
+      }
+      lzma->rep1 = lzma->rep0;
+      lzma->rep0 = dist;
+    }
+    len = osup_lzma_decode_len(lzma, &lzma->probs.repLenDecoder, posState);
+    lzma->state = state < 7 ? 8 : 11;
+  } else {
+    lzma->rep3 = lzma->rep2;
+    lzma->rep2 = lzma->rep1;
+    lzma->rep1 = lzma->rep0;
+    len = osup_lzma_decode_len(lzma, &lzma->probs.lenDecoder, posState);
+    lzma->state = state < 7 ? 7 : 10;
+    lzma->rep0 = osup_lzma_decode_distance(lzma, len);
+    if (lzma->rep0 == 0xFFFFFFFF) {
+      /* the end marker */
+      if (lzma->code || (lzma->sizeKnown && lzma->remaining)) goto corrupted;
+      lzma->finished = osup_true;
+      return;
+    }
+    if (atEnd || lzma->rep0 >= lzma->dictSize ||
+        (!lzma->full && lzma->rep0 >= lzma->pos)) {
+      goto corrupted;
+    }
+  }
+  len += OSUP_LZMA_MATCH_MIN_LEN;
+  if (lzma->sizeKnown && lzma->remaining < len) goto corrupted;
+  lzma->matchLength = len;
+  return;
+
+corrupted:
+  lzma->failed = osup_true;
+}
+
+/* decode up to size bytes, fewer only at the end of the stream (or if it is
+ * corrupted, then failed is set) */
+OSUP_INTERN size_t osup_lzma_read(osup_lzma* lzma, char* out, size_t size) {
+  size_t n = 0;
+  while (n < size) {
+    if (lzma->matchLength) {
+      uint8_t byte = osup_lzma_get(lzma, lzma->rep0 + 1);
+      osup_lzma_put(lzma, byte);
+      out[n++] = (char)byte;
+      lzma->matchLength--;
+      if (lzma->failed) break;
+      continue;
+    }
+    if (lzma->finished || lzma->failed) break;
+    uint64_t totalPos = lzma->totalPos;
+    osup_lzma_step(lzma);
+    if (lzma->failed) break;
+    if (lzma->totalPos != totalPos) {
+      out[n++] = (char)osup_lzma_get(lzma, 1);
+    }
+  }
+  return n;
+}
+
+OSUP_INTERN uint64_t osup_lzma_le(const uint8_t* bytes, size_t size) {
+  uint64_t value = 0;
+  while (size--) value = (value << 8) | bytes[size];
+  return value;
+}
+
+/* NULL if the header is invalid or malloc fails */
+OSUP_INTERN osup_lzma* osup_lzma_create(const uint8_t* data, size_t size) {
+  if (size < OSUP_LZMA_HEADER_SIZE + 5 || data[0] >= 9 * 5 * 5) return NULL;
+  unsigned lc = data[0] % 9;
+  unsigned lp = data[0] / 9 % 5;
+  unsigned pb = data[0] / 9 / 5;
+  uint32_t dictSize = (uint32_t)osup_lzma_le(data + 1, 4);
+  uint64_t unpackSize = osup_lzma_le(data + 5, 8);
+  osup_bool sizeKnown = unpackSize != (uint64_t)-1;
+  if (dictSize < OSUP_LZMA_MIN_DICT_SIZE) dictSize = OSUP_LZMA_MIN_DICT_SIZE;
+  /* no need for a window bigger than the whole output */
+  size_t maxWindowSize = dictSize;
+  if (sizeKnown && unpackSize < maxWindowSize) {
+    maxWindowSize = unpackSize ? (size_t)unpackSize : 1;
+  }
+  size_t windowSize = maxWindowSize < OSUP_LZMA_INITIAL_WINDOW_SIZE
+                          ? maxWindowSize
+                          : OSUP_LZMA_INITIAL_WINDOW_SIZE;
+  size_t literalCount = (size_t)OSUP_LZMA_LITERAL_SIZE << (lc + lp);
+  osup_lzma* lzma =
+      malloc(sizeof(osup_lzma) + literalCount * sizeof(osup_lzma_prob));
+  if (!lzma) return NULL;
+  memset(lzma, 0, sizeof(osup_lzma));
+  lzma->window = malloc(windowSize);
+  if (!lzma->window) {
+    osup_free_ptr(lzma);
+    return NULL;
+  }
+  lzma->literals = (osup_lzma_prob*)(lzma + 1);
+  lzma->windowSize = windowSize;
+  lzma->maxWindowSize = maxWindowSize;
+  lzma->dictSize = dictSize;
+  lzma->lc = lc;
+  lzma->lp = lp;
+  lzma->pb = pb;
+  lzma->sizeKnown = sizeKnown;
+  lzma->remaining = unpackSize;
+
+  size_t i;
+  osup_lzma_prob* probs = (osup_lzma_prob*)&lzma->probs;
+  for (i = 0; i < sizeof(lzma->probs) / sizeof(osup_lzma_prob); i++) {
+    probs[i] = OSUP_LZMA_PROB_INIT;
+  }
+  for (i = 0; i < literalCount; i++) {
+    lzma->literals[i] = OSUP_LZMA_PROB_INIT;
+  }
+
+  /* the range decoder starts with a 0 byte and the 4-byte code */
+  lzma->in = data + OSUP_LZMA_HEADER_SIZE + 5;
+  lzma->inEnd = data + size;
+  lzma->range = 0xFFFFFFFF;
+  lzma->code = (uint32_t)data[OSUP_LZMA_HEADER_SIZE + 1] << 24 |
+               (uint32_t)data[OSUP_LZMA_HEADER_SIZE + 2] << 16 |
+               (uint32_t)data[OSUP_LZMA_HEADER_SIZE + 3] << 8 |
+               (uint32_t)data[OSUP_LZMA_HEADER_SIZE + 4];
+  if (data[OSUP_LZMA_HEADER_SIZE] || lzma->code == lzma->range) {
+    lzma->failed = osup_true;
+  }
+  return lzma;
+}
+
+OSUP_INTERN void osup_lzma_free(osup_lzma* lzma) {
+  if (!lzma) return;
+  osup_free_ptr(lzma->window);
+  osup_free_ptr(lzma);
+}
+
+/**********
+ * HEADER *
+ **********/
+/* a missing string stays NULL */
+OSUP_INTERN void osup_replay_read_string(osup_reader* reader, char** value) {
+  osup_slice string = osup_reader_string(reader);
+  if (string.begin && !osup_strdup(string.begin, string.end, value)) {
+    reader->failed = osup_true;
+  }
+}
+
+/* comma-separated time|health pairs */
+OSUP_INTERN osup_bool osup_replay_parse_lifebar(osup_replay* replay,
+                                                const char* string) {
+  size_t capacity = 1;
+  const char* it;
+  for (it = string; *it; it++) capacity += *it == ',';
+  replay->lifeBar.elements = malloc(capacity * sizeof(osup_lifebar_point));
+  if (!replay->lifeBar.elements) {
+    OSUP_REPLAY_ERROR("malloc returns NULL, malloc size: %zu",
+                      capacity * sizeof(osup_lifebar_point));
+    return osup_false;
+  }
+  it = string;
+  while (*it) {
+    const char* end = strchr(it, ',');
+    if (!end) end = it + strlen(it);
+    if (end != it) {
+      osup_lifebar_point* point =
+          &replay->lifeBar.elements[replay->lifeBar.count];
+      const char* bar = memchr(it, '|', end - it);
+      if (!bar || !osup_parse_int(it, bar, &point->time) ||
+          !osup_parse_decimal(bar + 1, end, &point->health)) {
+        OSUP_REPLAY_ERROR("invalid life bar point: %s",
+                          osup_temp_string_slice(it, end));
+        return osup_false;
+      }
+      replay->lifeBar.count++;
+    }
+    it = *end ? end + 1 : end;
+  }
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_replay_load_buffer(osup_replay* replay,
+                                           const void* data, size_t size) {
+  osup_reader reader;
+  char* lifeBar = NULL;
+  osup_reader_init(&reader, data, size);
+
+  uint8_t mode = (uint8_t)osup_reader_uint(&reader, 1);
+  if (!reader.failed && mode > OSUP_MODE_MANIA) {
+    OSUP_REPLAY_ERROR("invalid game mode: %d", (int)mode);
+    return osup_false;
+  }
+  replay->mode = (osup_gamemode)mode;
+  replay->version = (osup_int)osup_reader_uint(&reader, 4);
+  osup_replay_read_string(&reader, &replay->beatmapHash);
+  osup_replay_read_string(&reader, &replay->playerName);
+  osup_replay_read_string(&reader, &replay->replayHash);
+  replay->count300 = (osup_int)osup_reader_uint(&reader, 2);
+  replay->count100 = (osup_int)osup_reader_uint(&reader, 2);
+  replay->count50 = (osup_int)osup_reader_uint(&reader, 2);
+  replay->countGeki = (osup_int)osup_reader_uint(&reader, 2);
+  replay->countKatu = (osup_int)osup_reader_uint(&reader, 2);
+  replay->countMiss = (osup_int)osup_reader_uint(&reader, 2);
+  replay->score = (osup_int)osup_reader_uint(&reader, 4);
+  replay->maxCombo = (osup_int)osup_reader_uint(&reader, 2);
+  replay->perfect = osup_reader_uint(&reader, 1) != 0;
+  replay->mods = (osup_bitfield32)osup_reader_uint(&reader, 4);
+  osup_replay_read_string(&reader, &lifeBar);
+  replay->timestamp = (osup_long)osup_reader_uint(&reader, 8);
+  int32_t frameDataSize = (int32_t)osup_reader_uint(&reader, 4);
+  /* some replays have no frames at all */
+  if (frameDataSize > 0) {
+    const char* frames =
+        (const char*)osup_reader_take(&reader, (size_t)frameDataSize);
+    replay->frameData.begin = frames;
+    replay->frameData.end = frames ? frames + frameDataSize : NULL;
+  }
+  /* the score id was added, then widened */
+  if (replay->version >= 20140721) {
+    replay->onlineScoreID = (osup_long)osup_reader_uint(&reader, 8);
+  } else if (replay->version >= 20121008) {
+    replay->onlineScoreID = (int32_t)osup_reader_uint(&reader, 4);
+  }
+  if (replay->mods & OSUP_MOD_TARGET) {
+    replay->targetPracticeAccuracy = osup_reader_double(&reader);
+  }
+
+  if (reader.failed) {
+    OSUP_REPLAY_ERROR("replay is truncated or has an invalid string");
+    osup_free_ptr(lifeBar);
+    osup_replay_free(replay);
+    return osup_false;
+  }
+  if (lifeBar && !osup_replay_parse_lifebar(replay, lifeBar)) {
+    osup_free_ptr(lifeBar);
+    osup_replay_free(replay);
+    return osup_false;
+  }
+  osup_free_ptr(lifeBar);
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_replay_load(osup_replay* replay, const char* file) {
+  osup_mapped_file f;
+  if (!osup_map_file(file, &f)) {
+    OSUP_REPLAY_ERROR("unable to read file %s", file);
+    return osup_false;
+  }
+  if (!osup_replay_load_buffer(replay, f.data, f.size)) {
+    osup_unmap_file(&f);
+    return osup_false;
+  }
+  /* the frames point into it */
+  replay->source = f;
+  return osup_true;
+}
+
+OSUP_API void osup_replay_free(osup_replay* replay) {
+  osup_free_ptr(replay->beatmapHash);
+  osup_free_ptr(replay->playerName);
+  osup_free_ptr(replay->replayHash);
+  osup_free_ptr(replay->lifeBar.elements);
+  osup_unmap_file(&replay->source);
+  memset(replay, 0, sizeof(*replay));
+}
+
+/**********
+ * FRAMES *
+ **********/
+/* a frame is at most a few dozen bytes, the buffer only bounds the work done
+ * per refill */
+#define OSUP_REPLAY_BUFFER_SIZE 4096
+/* the delta of the frame that holds the RNG seed */
+#define OSUP_REPLAY_SEED_DELTA (-12345)
+
+OSUP_API osup_bool osup_replay_frame_iter_begin(osup_replay_frame_iter* iter,
+                                                const osup_replay* replay) {
+  memset(iter, 0, sizeof(*iter));
+  iter->eof = osup_true;
+  if (replay->frameData.begin == replay->frameData.end) {
+    return osup_true;
+  }
+  iter->lzma = osup_lzma_create(
+      (const uint8_t*)replay->frameData.begin,
+      (size_t)(replay->frameData.end - replay->frameData.begin));
+  iter->buffer = malloc(OSUP_REPLAY_BUFFER_SIZE);
+  if (!iter->lzma || !iter->buffer) {
+    OSUP_REPLAY_ERROR("invalid LZMA header or malloc returns NULL");
+    osup_replay_frame_iter_end(iter);
+    iter->failed = osup_true;
+    return osup_false;
+  }
+  iter->bufferSize = OSUP_REPLAY_BUFFER_SIZE;
+  iter->it = iter->end = iter->buffer;
+  iter->eof = osup_false;
+  return osup_true;
+}
+
+/* move the unparsed tail to the front and decode more after it */
+OSUP_INTERN void osup_replay_frame_iter_fill(osup_replay_frame_iter* iter) {
+  size_t left = (size_t)(iter->end - iter->it);
+  if (left == iter->bufferSize) {
+    OSUP_REPLAY_ERROR("frame longer than %zu bytes", iter->bufferSize);
+    iter->failed = osup_true;
+  } else {
+    memmove(iter->buffer, iter->it, left);
+    size_t space = iter->bufferSize - left;
+    size_t n = osup_lzma_read(iter->lzma, iter->buffer + left, space);
+    iter->it = iter->buffer;
+    iter->end = iter->buffer + left + n;
+    if (n == space) return;
+    if (iter->lzma->failed) {
+      OSUP_REPLAY_ERROR("corrupted LZMA stream");
+      iter->failed = osup_true;
+    }
+  }
+  iter->eof = osup_true;
+  if (iter->failed) iter->it = iter->end;
+}
+
+/* w|x|y|z */
+OSUP_INTERN osup_bool osup_replay_parse_frame(const char* begin,
+                                              const char* end,
+                                              osup_replay_frame* frame) {
+  osup_int keys;
+  const char* x = memchr(begin, '|', end - begin);
+  const char* y = x ? memchr(x + 1, '|', end - x - 1) : NULL;
+  const char* z = y ? memchr(y + 1, '|', end - y - 1) : NULL;
+  if (!z || !osup_parse_int(begin, x, &frame->delta) ||
+      !osup_parse_decimal(x + 1, y, &frame->x) ||
+      !osup_parse_decimal(y + 1, z, &frame->y) ||
+      !osup_parse_int(z + 1, end, &keys)) {
+    return osup_false;
+  }
+  frame->keys = (osup_bitfield32)keys;
+  return osup_true;
+}
+
+OSUP_API const osup_replay_frame* osup_replay_frame_iter_next(
+    osup_replay_frame_iter* iter) {
+  for (;;) {
+    if (iter->eof && iter->it == iter->end) return NULL;
+    const char* comma = memchr(iter->it, ',', iter->end - iter->it);
+    if (!comma && !iter->eof) {
+      osup_replay_frame_iter_fill(iter);
+      continue;
+    }
+    /* the last frame may not be followed by a comma */
+    const char* frameEnd = comma ? comma : iter->end;
+    const char* frameBegin = iter->it;
+    if (frameBegin == frameEnd) {
+      if (!comma) return NULL;
+      iter->it = comma + 1;
+      continue;
+    }
+    iter->it = comma ? comma + 1 : frameEnd;
+    if (!osup_replay_parse_frame(frameBegin, frameEnd, &iter->frame)) {
+      OSUP_REPLAY_ERROR("invalid frame: %s",
+                        osup_temp_string_slice(frameBegin, frameEnd));
+      iter->failed = osup_true;
+      iter->eof = osup_true;
+      iter->it = iter->end;
+      return NULL;
+    }
+    if (iter->frame.delta == OSUP_REPLAY_SEED_DELTA) {
+      iter->hasSeed = osup_true;
+      iter->seed = (osup_int)iter->frame.keys;
+      continue;
+    }
+    iter->frame.time += iter->frame.delta;
+    return &iter->frame;
+  }
+}
+
+OSUP_API void osup_replay_frame_iter_end(osup_replay_frame_iter* iter) {
+  osup_lzma_free(iter->lzma);
+  osup_free_ptr(iter->buffer);
+  iter->lzma = NULL;
+  iter->buffer = NULL;
+  iter->it = iter->end = NULL;
+}
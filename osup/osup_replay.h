@@ -0,0 +1,177 @@
+#ifndef OSUP_REPLAY_H
+#define OSUP_REPLAY_H
+
+/*********
+ * USAGE *
+ *********/
+#if 0
+
+int main() {
+  /* same as maps, initialize everything to 0 */
+  osup_replay replay{};
+  osup_replay_frame_iter iter;
+  const osup_replay_frame* frame;
+  osup_replay_load(&replay, "/path/to/replay.osr");
+  printf("%s: %d\n", replay.playerName, replay.score);
+  /* the frames are decompressed as they are read */
+  osup_replay_frame_iter_begin(&iter, &replay);
+  while ((frame = osup_replay_frame_iter_next(&iter))) {
+    printf("%lld %f %f\n", (long long)frame->time, frame->x, frame->y);
+  }
+  osup_replay_frame_iter_end(&iter);
+  osup_replay_free(&replay);
+  return 0;
+}
+
+#endif
+
+#define OSUP_API
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "osup_common.h"
+
+#define OSUP_MOD_NOFAIL (1u << 0)
+#define OSUP_MOD_EASY (1u << 1)
+#define OSUP_MOD_TOUCH_DEVICE (1u << 2)
+#define OSUP_MOD_HIDDEN (1u << 3)
+#define OSUP_MOD_HARD_ROCK (1u << 4)
+#define OSUP_MOD_SUDDEN_DEATH (1u << 5)
+#define OSUP_MOD_DOUBLE_TIME (1u << 6)
+#define OSUP_MOD_RELAX (1u << 7)
+#define OSUP_MOD_HALF_TIME (1u << 8)
+/* always set together with OSUP_MOD_DOUBLE_TIME */
+#define OSUP_MOD_NIGHTCORE (1u << 9)
+#define OSUP_MOD_FLASHLIGHT (1u << 10)
+#define OSUP_MOD_AUTOPLAY (1u << 11)
+#define OSUP_MOD_SPUN_OUT (1u << 12)
+#define OSUP_MOD_AUTOPILOT (1u << 13)
+/* always set together with OSUP_MOD_SUDDEN_DEATH */
+#define OSUP_MOD_PERFECT (1u << 14)
+#define OSUP_MOD_KEY4 (1u << 15)
+#define OSUP_MOD_KEY5 (1u << 16)
+#define OSUP_MOD_KEY6 (1u << 17)
+#define OSUP_MOD_KEY7 (1u << 18)
+#define OSUP_MOD_KEY8 (1u << 19)
+#define OSUP_MOD_FADE_IN (1u << 20)
+#define OSUP_MOD_RANDOM (1u << 21)
+#define OSUP_MOD_CINEMA (1u << 22)
+#define OSUP_MOD_TARGET (1u << 23)
+#define OSUP_MOD_KEY9 (1u << 24)
+#define OSUP_MOD_KEY_COOP (1u << 25)
+#define OSUP_MOD_KEY1 (1u << 26)
+#define OSUP_MOD_KEY3 (1u << 27)
+#define OSUP_MOD_KEY2 (1u << 28)
+#define OSUP_MOD_SCORE_V2 (1u << 29)
+#define OSUP_MOD_MIRROR (1u << 30)
+
+/* the keys of osu!standard frames, in mania x holds the pressed columns
+ * instead */
+#define OSUP_KEY_M1 (1u << 0)
+#define OSUP_KEY_M2 (1u << 1)
+#define OSUP_KEY_K1 (1u << 2)
+#define OSUP_KEY_K2 (1u << 3)
+#define OSUP_KEY_SMOKE (1u << 4)
+
+typedef struct {
+  /* milliseconds into the song */
+  osup_int time;
+  /* 0 to 1 */
+  osup_decimal health;
+} osup_lifebar_point;
+
+typedef struct {
+  osup_gamemode mode;
+  /* the game version that made the replay, e.g. 20210520 */
+  osup_int version;
+  /* NULL if the string is not in the file */
+  char* beatmapHash;
+  char* playerName;
+  char* replayHash;
+  osup_int count300;
+  osup_int count100;
+  osup_int count50;
+  osup_int countGeki;
+  osup_int countKatu;
+  osup_int countMiss;
+  osup_int score;
+  osup_int maxCombo;
+  osup_bool perfect;
+  /* OSUP_MOD_* flags */
+  osup_bitfield32 mods;
+  struct {
+    osup_lifebar_point* elements;
+    size_t count;
+  } lifeBar;
+  /* windows ticks, 100 ns since 0001-01-01 */
+  osup_long timestamp;
+  /* 0 if the score was never submitted */
+  osup_long onlineScoreID;
+  /* only with OSUP_MOD_TARGET */
+  osup_decimal targetPracticeAccuracy;
+
+  /* the LZMA-compressed frames, decoded by osup_replay_frame_iter, they point
+   * into source or into the buffer given to osup_replay_load_buffer */
+  osup_slice frameData;
+  /* only used with osup_replay_load */
+  osup_mapped_file source;
+} osup_replay;
+
+typedef struct {
+  /* milliseconds since the previous frame (the first frames of a replay may
+   * have 0 or negative deltas), and since the start of the song */
+  osup_int delta;
+  osup_long time;
+  osup_decimal x;
+  osup_decimal y;
+  /* OSUP_KEY_* flags */
+  osup_bitfield32 keys;
+} osup_replay_frame;
+
+/* the frames of a replay, decompressed a few KB at a time, so memory use
+ * depends on the LZMA dictionary size instead of on the length of the replay
+ *   osup_replay_frame_iter iter;
+ *   const osup_replay_frame* frame;
+ *   osup_replay_frame_iter_begin(&iter, &replay);
+ *   while ((frame = osup_replay_frame_iter_next(&iter))) { ... }
+ *   osup_replay_frame_iter_end(&iter);
+ * the returned frame is overwritten by the next call, failed tells a corrupted
+ * stream apart from the end of the frames. the replay must outlive the
+ * iterator */
+typedef struct osup_lzma osup_lzma;
+
+typedef struct {
+  osup_lzma* lzma;
+  /* decompressed text that is not parsed yet */
+  char* buffer;
+  size_t bufferSize;
+  const char* it;
+  const char* end;
+  osup_bool eof;
+  osup_replay_frame frame;
+  osup_bool failed;
+  /* the seed of the RNG frame that ends newer replays, it is not returned as a
+   * frame */
+  osup_bool hasSeed;
+  osup_int seed;
+} osup_replay_frame_iter;
+
+OSUP_API osup_bool osup_replay_load(osup_replay* replay, const char* file);
+/* the frames are not copied, data must outlive the replay */
+OSUP_API osup_bool osup_replay_load_buffer(osup_replay* replay,
+                                           const void* data, size_t size);
+OSUP_API void osup_replay_free(osup_replay* replay);
+
+OSUP_API osup_bool osup_replay_frame_iter_begin(osup_replay_frame_iter* iter,
+                                                const osup_replay* replay);
+OSUP_API const osup_replay_frame* osup_replay_frame_iter_next(
+    osup_replay_frame_iter* iter);
+OSUP_API void osup_replay_frame_iter_end(osup_replay_frame_iter* iter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,527 @@
+#include "osup_slider.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OSUP_NO_LOGGING
+#define OSUP_SLIDER_ERROR(...)
+#else
+#define OSUP_SLIDER_ERROR(...)                                          \
+  do {                                                                  \
+    if (osup_has_error_callback()) osup_error("[slider] " __VA_ARGS__); \
+  } while (0)
+#endif
+
+#define OSUP_SLIDER_PI 3.14159265358979323846
+
+/* the constants of osu!framework's PathApproximator */
+#define OSUP_SLIDER_BEZIER_TOLERANCE 0.25f
+#define OSUP_SLIDER_CATMULL_DETAIL 50
+#define OSUP_SLIDER_CIRCLE_TOLERANCE 0.1
+/* arcs that need this many points are drawn as bezier curves */
+#define OSUP_SLIDER_CIRCLE_MAX_POINTS 1000
+
+/***********
+ * BUFFERS *
+ ***********/
+OSUP_INTERN osup_bool osup_slider_reserve(osup_slider_path* path,
+                                          size_t count) {
+  size_t capacity;
+  osup_vec2f* points;
+  osup_decimal* lengths;
+  if (count <= path->capacity) return osup_true;
+  capacity = (size_t)((count + 1) * 1.5);
+  points = realloc(path->points, capacity * sizeof(osup_vec2f));
+  if (!points) {
+    OSUP_SLIDER_ERROR("malloc returns NULL, malloc size: %zu",
+                      capacity * sizeof(osup_vec2f));
+    return osup_false;
+  }
+  path->points = points;
+  lengths = realloc(path->lengths, capacity * sizeof(osup_decimal));
+  if (!lengths) {
+    OSUP_SLIDER_ERROR("malloc returns NULL, malloc size: %zu",
+                      capacity * sizeof(osup_decimal));
+    return osup_false;
+  }
+  path->lengths = lengths;
+  path->capacity = capacity;
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_slider_reserve_scratch(osup_slider_path* path,
+                                                  size_t count) {
+  size_t capacity;
+  osup_vec2f* scratch;
+  if (count <= path->scratchCapacity) return osup_true;
+  capacity = (size_t)((count + 1) * 1.5);
+  scratch = realloc(path->scratch, capacity * sizeof(osup_vec2f));
+  if (!scratch) {
+    OSUP_SLIDER_ERROR("malloc returns NULL, malloc size: %zu",
+                      capacity * sizeof(osup_vec2f));
+    return osup_false;
+  }
+  path->scratch = scratch;
+  path->scratchCapacity = capacity;
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_vec2f_equal(osup_vec2f a, osup_vec2f b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+/**********
+ * CURVES *
+ **********/
+/* the caller reserves the room for every point it pushes */
+OSUP_INTERN void osup_slider_push(osup_slider_path* path, osup_decimal x,
+                                  osup_decimal y) {
+  osup_vec2f* point = &path->points[path->count++];
+  point->x = (float)x;
+  point->y = (float)y;
+}
+
+OSUP_INTERN osup_bool osup_slider_linear(osup_slider_path* path,
+                                         const osup_vec2f* points,
+                                         size_t count) {
+  if (!osup_slider_reserve(path, path->count + count)) return osup_false;
+  memcpy(path->points + path->count, points, count * sizeof(osup_vec2f));
+  path->count += count;
+  return osup_true;
+}
+
+OSUP_INTERN osup_decimal osup_slider_catmull(osup_decimal v1, osup_decimal v2,
+                                             osup_decimal v3, osup_decimal v4,
+                                             osup_decimal t) {
+  osup_decimal t2 = t * t;
+  osup_decimal t3 = t * t2;
+  return 0.5 * (2 * v2 + (-v1 + v3) * t +
+                (2 * v1 - 5 * v2 + 4 * v3 - v4) * t2 +
+                (-v1 + 3 * v2 - 3 * v3 + v4) * t3);
+}
+
+/* osu!framework pushes both ends of every step, so every inner point is there
+ * twice, once is enough, the lengths are the same */
+OSUP_INTERN osup_bool osup_slider_catmull_rom(osup_slider_path* path,
+                                              const osup_vec2f* points,
+                                              size_t count) {
+  size_t i;
+  int c;
+  if (!osup_slider_reserve(
+          path, path->count + (count - 1) * OSUP_SLIDER_CATMULL_DETAIL + 1))
+    return osup_false;
+  osup_slider_push(path, points[0].x, points[0].y);
+  for (i = 0; i < count - 1; i++) {
+    osup_vec2f v1 = i > 0 ? points[i - 1] : points[i];
+    osup_vec2f v2 = points[i];
+    osup_vec2f v3 = points[i + 1];
+    osup_vec2f v4;
+    if (i < count - 2) {
+      v4 = points[i + 2];
+    } else {
+      v4.x = v3.x + v3.x - v2.x;
+      v4.y = v3.y + v3.y - v2.y;
+    }
+    for (c = 1; c <= OSUP_SLIDER_CATMULL_DETAIL; c++) {
+      osup_decimal t = (osup_decimal)c / OSUP_SLIDER_CATMULL_DETAIL;
+      osup_slider_push(path, osup_slider_catmull(v1.x, v2.x, v3.x, v4.x, t),
+                       osup_slider_catmull(v1.y, v2.y, v3.y, v4.y, t));
+    }
+  }
+  return osup_true;
+}
+
+/* false when the 3 points don't make a usable arc, the segment is then drawn as
+ * a bezier curve */
+OSUP_INTERN osup_bool osup_slider_circle(osup_slider_path* path,
+                                         const osup_vec2f* points) {
+  osup_decimal ax = points[0].x, ay = points[0].y;
+  osup_decimal bx = points[1].x, by = points[1].y;
+  osup_decimal cx = points[2].x, cy = points[2].y;
+  osup_decimal d = 2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by));
+  osup_decimal aSq, bSq, cSq, centreX, centreY, radius;
+  osup_decimal thetaStart, thetaEnd, thetaRange, direction = 1;
+  size_t amount, i;
+  if (fabs(d) < 1e-3) return osup_false;
+  aSq = ax * ax + ay * ay;
+  bSq = bx * bx + by * by;
+  cSq = cx * cx + cy * cy;
+  centreX = (aSq * (by - cy) + bSq * (cy - ay) + cSq * (ay - by)) / d;
+  centreY = (aSq * (cx - bx) + bSq * (ax - cx) + cSq * (bx - ax)) / d;
+  radius = sqrt((ax - centreX) * (ax - centreX) +
+                (ay - centreY) * (ay - centreY));
+  thetaStart = atan2(ay - centreY, ax - centreX);
+  thetaEnd = atan2(cy - centreY, cx - centreX);
+  while (thetaEnd < thetaStart) thetaEnd += 2 * OSUP_SLIDER_PI;
+  thetaRange = thetaEnd - thetaStart;
+  /* draw the arc the other way if b is on the other side of ac */
+  if ((cy - ay) * (bx - ax) - (cx - ax) * (by - ay) < 0) {
+    direction = -1;
+    thetaRange = 2 * OSUP_SLIDER_PI - thetaRange;
+  }
+  if (2 * radius <= OSUP_SLIDER_CIRCLE_TOLERANCE) {
+    amount = 2;
+  } else {
+    osup_decimal step = 2 * acos(1 - OSUP_SLIDER_CIRCLE_TOLERANCE / radius);
+    osup_decimal steps = ceil(thetaRange / step);
+    if (!(steps < OSUP_SLIDER_CIRCLE_MAX_POINTS)) return osup_false;
+    amount = steps < 2 ? 2 : (size_t)steps;
+  }
+  if (!osup_slider_reserve(path, path->count + amount)) return osup_false;
+  for (i = 0; i < amount; i++) {
+    osup_decimal theta =
+        thetaStart + direction * thetaRange * (osup_decimal)i / (amount - 1);
+    osup_slider_push(path, centreX + cos(theta) * radius,
+                     centreY + sin(theta) * radius);
+  }
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_slider_bezier_flat(const osup_vec2f* points,
+                                              size_t count) {
+  size_t i;
+  for (i = 1; i + 1 < count; i++) {
+    float x = points[i - 1].x - 2 * points[i].x + points[i + 1].x;
+    float y = points[i - 1].y - 2 * points[i].y + points[i + 1].y;
+    if (x * x + y * y > OSUP_SLIDER_BEZIER_TOLERANCE *
+                            OSUP_SLIDER_BEZIER_TOLERANCE * 4)
+      return osup_false;
+  }
+  return osup_true;
+}
+
+/* de casteljau at t = 0.5, right may be midpoints, right may also be points
+ * since points are only read before anything is written */
+OSUP_INTERN void osup_slider_bezier_subdivide(const osup_vec2f* points,
+                                              osup_vec2f* left,
+                                              osup_vec2f* right,
+                                              osup_vec2f* midpoints,
+                                              size_t count) {
+  size_t i, j;
+  memmove(midpoints, points, count * sizeof(osup_vec2f));
+  for (i = 0; i < count; i++) {
+    left[i] = midpoints[0];
+    right[count - i - 1] = midpoints[count - i - 1];
+    for (j = 0; j < count - i - 1; j++) {
+      midpoints[j].x = (midpoints[j].x + midpoints[j + 1].x) / 2;
+      midpoints[j].y = (midpoints[j].y + midpoints[j + 1].y) / 2;
+    }
+  }
+}
+
+/* every point of a flat enough piece but the last one */
+OSUP_INTERN void osup_slider_bezier_approximate(osup_slider_path* path,
+                                                const osup_vec2f* points,
+                                                osup_vec2f* buffer1,
+                                                osup_vec2f* buffer2,
+                                                size_t count) {
+  osup_vec2f* left = buffer2;
+  osup_vec2f* right = buffer1;
+  size_t i;
+  osup_slider_bezier_subdivide(points, left, right, buffer1, count);
+  for (i = 0; i < count - 1; i++) left[count + i] = right[i + 1];
+  osup_slider_push(path, points[0].x, points[0].y);
+  for (i = 1; i < count - 1; i++) {
+    size_t index = 2 * i;
+    osup_slider_push(
+        path,
+        0.25f * (left[index - 1].x + 2 * left[index].x + left[index + 1].x),
+        0.25f * (left[index - 1].y + 2 * left[index].y + left[index + 1].y));
+  }
+}
+
+/* the segment is the count points at control in the scratch, the controls
+ * control points of the slider are followed by the two subdivision buffers and
+ * by the pieces still to flatten, a stack of blocks of count points. the top
+ * block is split in place: the right half replaces it and the left half is
+ * pushed on top of it, so the curve comes out in order */
+OSUP_INTERN osup_bool osup_slider_bezier(osup_slider_path* path,
+                                         size_t controls, size_t control,
+                                         size_t count) {
+  size_t buffers = controls;
+  size_t blocks = buffers + count * 3 - 1;
+  size_t depth = 1;
+  if (!osup_slider_reserve_scratch(path, blocks + count)) return osup_false;
+  memcpy(path->scratch + blocks, path->scratch + control,
+         count * sizeof(osup_vec2f));
+  while (depth) {
+    osup_vec2f* buffer1 = path->scratch + buffers;
+    osup_vec2f* buffer2 = buffer1 + count;
+    osup_vec2f* top = path->scratch + blocks + (depth - 1) * count;
+    if (osup_slider_bezier_flat(top, count)) {
+      if (!osup_slider_reserve(path, path->count + count - 1))
+        return osup_false;
+      osup_slider_bezier_approximate(path, top, buffer1, buffer2, count);
+      depth--;
+      continue;
+    }
+    if (!osup_slider_reserve_scratch(path, blocks + (depth + 1) * count))
+      return osup_false;
+    buffer1 = path->scratch + buffers;
+    buffer2 = buffer1 + count;
+    top = path->scratch + blocks + (depth - 1) * count;
+    osup_slider_bezier_subdivide(top, buffer2, top, buffer1, count);
+    memcpy(top + count, buffer2, count * sizeof(osup_vec2f));
+    depth++;
+  }
+  if (!osup_slider_reserve(path, path->count + 1)) return osup_false;
+  path->points[path->count++] = path->scratch[control + count - 1];
+  return osup_true;
+}
+
+/*********
+ * PATHS *
+ *********/
+/* the cumulative lengths of the points from begin, then the path is cut or its
+ * last segment is stretched to the length of the slider like osu! does */
+OSUP_INTERN void osup_slider_measure(osup_slider_path* path, size_t begin,
+                                     osup_decimal expected) {
+  osup_vec2f* points = path->points;
+  osup_decimal* lengths = path->lengths;
+  size_t end = path->count - 1;
+  osup_decimal length = 0, distance;
+  float x, y;
+  size_t i;
+  lengths[begin] = 0;
+  for (i = begin + 1; i <= end; i++) {
+    x = points[i].x - points[i - 1].x;
+    y = points[i].y - points[i - 1].y;
+    length += (float)sqrt(x * x + y * y);
+    lengths[i] = length;
+  }
+  if (expected <= 0 || length == expected) return;
+  /* osu!stable doesn't stretch paths whose last two points are the same */
+  if (end > begin && osup_vec2f_equal(points[end], points[end - 1]) &&
+      expected > length)
+    return;
+  if (length > expected) {
+    while (end > begin && lengths[end - 1] >= expected) end--;
+  }
+  if (end == begin) {
+    path->count = begin + 1;
+    return;
+  }
+  x = points[end].x - points[end - 1].x;
+  y = points[end].y - points[end - 1].y;
+  distance = sqrt(x * x + y * y);
+  if (distance > 0) {
+    osup_decimal scale = (expected - lengths[end - 1]) / distance;
+    points[end].x = (float)(points[end - 1].x + x * scale);
+    points[end].y = (float)(points[end - 1].y + y * scale);
+  } else {
+    points[end] = points[end - 1];
+  }
+  lengths[end] = expected;
+  path->count = end + 1;
+}
+
+/* flatten the slider into the points after path->count, the segments are cut
+ * where a control point is repeated, and the first point of a segment is
+ * dropped when it is the last point of the one before */
+OSUP_INTERN osup_bool osup_slider_append(osup_slider_path* path,
+                                         osup_vec2 head,
+                                         const osup_slider_params* slider) {
+  size_t begin = path->count;
+  size_t count = slider->curvePoints.count + 1;
+  osup_slider_curve type = slider->curveType;
+  const osup_vec2f* control;
+  size_t start = 0, i;
+  if (!osup_slider_reserve_scratch(path, count)) return osup_false;
+  path->scratch[0].x = (float)head.x;
+  path->scratch[0].y = (float)head.y;
+  for (i = 1; i < count; i++) {
+    path->scratch[i].x = (float)slider->curvePoints.elements[i - 1].x;
+    path->scratch[i].y = (float)slider->curvePoints.elements[i - 1].y;
+  }
+  if (type == OSUP_CURVE_PERFECT_CIRCLE) {
+    const osup_vec2f* p = path->scratch;
+    if (count != 3) {
+      type = OSUP_CURVE_BEZIER;
+    } else if (fabs((p[1].y - p[0].y) * (p[2].x - p[0].x) -
+                    (p[1].x - p[0].x) * (p[2].y - p[0].y)) < 1e-3) {
+      type = OSUP_CURVE_LINEAR;
+    }
+  }
+  for (i = 0; i < count; i++) {
+    size_t mark = path->count;
+    size_t segment = i - start + 1;
+    osup_bool ok = osup_true;
+    control = path->scratch;
+    if (i + 1 < count) {
+      /* the last control point never starts a segment, and catmull-rom
+       * segments are only cut after a repeated head */
+      if (i + 2 == count || !osup_vec2f_equal(control[i], control[i + 1]) ||
+          (type == OSUP_CURVE_CENTRIPETAL_CATMULL_ROM && i > 0))
+        continue;
+    }
+    if (segment == 1) {
+      if (!osup_slider_reserve(path, path->count + 1)) return osup_false;
+      path->points[path->count++] = control[start];
+      start = i + 1;
+      continue;
+    }
+    switch (type) {
+      case OSUP_CURVE_LINEAR:
+        ok = osup_slider_linear(path, control + start, segment);
+        break;
+      case OSUP_CURVE_CENTRIPETAL_CATMULL_ROM:
+        ok = osup_slider_catmull_rom(path, control + start, segment);
+        break;
+      case OSUP_CURVE_PERFECT_CIRCLE:
+        if (osup_slider_circle(path, control + start)) break;
+        path->count = mark;
+        /* fall through */
+      default:
+        ok = osup_slider_bezier(path, count, start, segment);
+        break;
+    }
+    if (!ok) return osup_false;
+    if (mark > begin && mark < path->count &&
+        osup_vec2f_equal(path->points[mark], path->points[mark - 1])) {
+      memmove(path->points + mark, path->points + mark + 1,
+              (path->count - mark - 1) * sizeof(osup_vec2f));
+      path->count--;
+    }
+    start = i + 1;
+  }
+  osup_slider_measure(path, begin, slider->length);
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_slider_path_compute(osup_vec2 head,
+                                            const osup_slider_params* slider,
+                                            osup_slider_path* path) {
+  path->count = 0;
+  if (!osup_slider_append(path, head, slider)) {
+    path->count = 0;
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_API void osup_slider_path_free(osup_slider_path* path) {
+  osup_free_ptr(path->points);
+  osup_free_ptr(path->lengths);
+  osup_free_ptr(path->scratch);
+  memset(path, 0, sizeof(*path));
+}
+
+OSUP_API osup_decimal osup_slider_path_length(const osup_slider_path* path) {
+  return path->count ? path->lengths[path->count - 1] : 0;
+}
+
+OSUP_API osup_vec2f osup_slider_position_at(const osup_slider_path* path,
+                                            osup_decimal progress) {
+  osup_vec2f position = {0, 0};
+  osup_vec2f from, to;
+  osup_decimal distance, weight;
+  size_t low = 0, high;
+  if (!path->count) return position;
+  if (progress < 0) progress = 0;
+  if (progress > 1) progress = 1;
+  distance = progress * path->lengths[path->count - 1];
+  /* the first point at or past distance */
+  high = path->count - 1;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (path->lengths[middle] < distance) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0 || path->lengths[low] <= path->lengths[low - 1])
+    return path->points[low];
+  from = path->points[low - 1];
+  to = path->points[low];
+  weight = (distance - path->lengths[low - 1]) /
+           (path->lengths[low] - path->lengths[low - 1]);
+  position.x = (float)(from.x + (to.x - from.x) * weight);
+  position.y = (float)(from.y + (to.y - from.y) * weight);
+  return position;
+}
+
+/***********
+ * BATCHED *
+ ***********/
+/* the slider of object i of whichever layout holds the hit objects, NULL for
+ * the other objects */
+OSUP_INTERN const osup_slider_params* osup_slider_of(const osup_bm* map,
+                                                     size_t i,
+                                                     osup_vec2* head) {
+  if (map->hitObjects.count) {
+    const osup_hitobject* obj = &map->hitObjects.elements[i];
+    if (!OSUP_IS_SLIDER(obj->type)) return NULL;
+    head->x = obj->x;
+    head->y = obj->y;
+    return &obj->slider;
+  }
+  if (map->hitObjectColumns.count) {
+    const osup_bm_hitobject_columns* columns = &map->hitObjectColumns;
+    if (!OSUP_IS_SLIDER(columns->type[i]) ||
+        columns->payload[i] == OSUP_NO_PAYLOAD)
+      return NULL;
+    head->x = columns->x[i];
+    head->y = columns->y[i];
+    return &columns->sliders.elements[columns->payload[i]];
+  }
+  head->x = map->compactHitObjects.elements[i].x;
+  head->y = map->compactHitObjects.elements[i].y;
+  return osup_compact_hitobject_slider(&map->compactHitObjects, i);
+}
+
+OSUP_API osup_bool osup_beatmap_slider_paths(const osup_bm* map,
+                                             osup_slider_paths* paths) {
+  size_t objects = map->compactHitObjects.count;
+  size_t count = 0, i;
+  size_t* offsets;
+  osup_vec2 head;
+  if (map->hitObjects.count) {
+    objects = map->hitObjects.count;
+  } else if (map->hitObjectColumns.count) {
+    objects = map->hitObjectColumns.count;
+  }
+  for (i = 0; i < objects; i++) {
+    if (osup_slider_of(map, i, &head)) count++;
+  }
+  offsets = realloc(paths->offsets, (count + 1) * sizeof(size_t));
+  if (!offsets) {
+    OSUP_SLIDER_ERROR("malloc returns NULL, malloc size: %zu",
+                      (count + 1) * sizeof(size_t));
+    return osup_false;
+  }
+  paths->offsets = offsets;
+  paths->count = 0;
+  paths->all.count = 0;
+  offsets[0] = 0;
+  for (i = 0; i < objects; i++) {
+    const osup_slider_params* slider = osup_slider_of(map, i, &head);
+    if (!slider) continue;
+    if (!osup_slider_append(&paths->all, head, slider)) {
+      paths->count = 0;
+      paths->all.count = 0;
+      return osup_false;
+    }
+    offsets[++paths->count] = paths->all.count;
+  }
+  return osup_true;
+}
+
+OSUP_API osup_slider_path osup_slider_paths_get(const osup_slider_paths* paths,
+                                                size_t i) {
+  osup_slider_path view;
+  size_t begin = paths->offsets[i];
+  memset(&view, 0, sizeof(view));
+  view.points = paths->all.points + begin;
+  view.lengths = paths->all.lengths + begin;
+  view.count = paths->offsets[i + 1] - begin;
+  return view;
+}
+
+OSUP_API void osup_slider_paths_free(osup_slider_paths* paths) {
+  osup_slider_path_free(&paths->all);
+  osup_free_ptr(paths->offsets);
+  memset(paths, 0, sizeof(*paths));
+}
@@ -0,0 +1,110 @@
+#ifndef OSUP_SLIDER_H
+#define OSUP_SLIDER_H
+
+/*********
+ * USAGE *
+ *********/
+#if 0
+
+int main() {
+  osup_bm map{};
+  osup_beatmap_load(&map, "/path/to/map.osu", OSUP_PARSE_HIT_OBJECTS);
+  /* one slider at a time, the path keeps its buffers from one call to the
+   * next */
+  osup_slider_path path{};
+  for (size_t i = 0; i < map.hitObjects.count; i++) {
+    const osup_hitobject* obj = &map.hitObjects.elements[i];
+    if (!OSUP_IS_SLIDER(obj->type)) continue;
+    osup_vec2 head = {obj->x, obj->y};
+    osup_slider_path_compute(head, &obj->slider, &path);
+    osup_vec2f middle = osup_slider_position_at(&path, 0.5);
+    printf("%f %f\n", middle.x, middle.y);
+  }
+  osup_slider_path_free(&path);
+
+  /* or every slider of the map at once */
+  osup_slider_paths paths{};
+  osup_beatmap_slider_paths(&map, &paths);
+  for (size_t i = 0; i < paths.count; i++) {
+    osup_slider_path view = osup_slider_paths_get(&paths, i);
+    printf("%f\n", osup_slider_path_length(&view));
+  }
+  osup_slider_paths_free(&paths);
+  osup_beatmap_free(&map);
+  return 0;
+}
+
+#endif
+
+#define OSUP_API
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "osup_beatmap.h"
+
+typedef struct {
+  float x;
+  float y;
+} osup_vec2f;
+
+/* a slider path flattened into line segments, lengths[i] is the length of the
+ * path up to points[i], so lengths[0] is 0 and lengths[count - 1] is the
+ * length of the slider */
+typedef struct {
+  osup_vec2f* points;
+  osup_decimal* lengths;
+  size_t count;
+  /* of points and lengths, 0 for the views of osup_slider_paths_get */
+  size_t capacity;
+  /* control points and bezier subdivision blocks, kept between calls */
+  osup_vec2f* scratch;
+  size_t scratchCapacity;
+} osup_slider_path;
+
+/* flatten the curve of a slider that starts at head (the x and y of the hit
+ * object), the way osu! does it:
+ *   a control point given twice in a row starts a new segment
+ *   bezier segments are subdivided until they are flat
+ *   catmull-rom segments are sampled 50 times between control points
+ *   perfect circles need exactly 3 control points (head included) that are
+ *     not on a line, otherwise they are drawn as bezier curves
+ *   the path is then cut (or its last segment extended) to slider->length
+ * path must be zeroed before the first call, it can be reused for the next
+ * slider */
+OSUP_API osup_bool osup_slider_path_compute(osup_vec2 head,
+                                            const osup_slider_params* slider,
+                                            osup_slider_path* path);
+OSUP_API void osup_slider_path_free(osup_slider_path* path);
+OSUP_API osup_decimal osup_slider_path_length(const osup_slider_path* path);
+/* the point at progress (0 to 1) of the length, with a binary search of the
+ * lengths. for a slider with repeats, fold the progress of the whole slider
+ * into one span first */
+OSUP_API osup_vec2f osup_slider_position_at(const osup_slider_path* path,
+                                            osup_decimal progress);
+
+/* the paths of every slider of a map in one buffer, path i is
+ * [offsets[i], offsets[i + 1]) of all */
+typedef struct {
+  osup_slider_path all;
+  size_t* offsets;
+  size_t count;
+} osup_slider_paths;
+
+/* the sliders of map->hitObjects, or of map->hitObjectColumns or
+ * map->compactHitObjects when the hit objects are in one of these layouts,
+ * in object order. paths must be zeroed before the first call, its buffers are
+ * reused by the next one */
+OSUP_API osup_bool osup_beatmap_slider_paths(const osup_bm* map,
+                                             osup_slider_paths* paths);
+/* a view of path i, valid until the paths are freed */
+OSUP_API osup_slider_path osup_slider_paths_get(const osup_slider_paths* paths,
+                                                size_t i);
+OSUP_API void osup_slider_paths_free(osup_slider_paths* paths);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1679 @@
+#include "osup_storyboard.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osup_beatmap.h"
+
+#ifdef OSUP_NO_LOGGING
+#define OSUP_SB_ERROR(...)
+#else
+#define OSUP_SB_ERROR(...)                                          \
+  do {                                                              \
+    if (osup_has_error_callback()) osup_error("[sb] " __VA_ARGS__); \
+  } while (0)
+#endif
+
+/* every table of osup_sb is an elements pointer followed by a count, this is
+ * how the parser sees them, they are copied in and out with memcpy */
+typedef struct {
+  char* elements;
+  size_t count;
+} osup_sb_table;
+
+/* where the command tables are in osup_sb and the size of their elements, in
+ * osup_sb_command_type order */
+OSUP_STORAGE const size_t osup_sb_command_offsets[] = {
+    offsetof(osup_sb, fade),   offsetof(osup_sb, move),
+    offsetof(osup_sb, moveX),  offsetof(osup_sb, moveY),
+    offsetof(osup_sb, scale),  offsetof(osup_sb, vectorScale),
+    offsetof(osup_sb, rotate), offsetof(osup_sb, colour),
+    offsetof(osup_sb, parameter)};
+OSUP_STORAGE const size_t osup_sb_command_sizes[] = {
+    sizeof(osup_sb_scalar_command),    sizeof(osup_sb_vector_command),
+    sizeof(osup_sb_scalar_command),    sizeof(osup_sb_scalar_command),
+    sizeof(osup_sb_scalar_command),    sizeof(osup_sb_vector_command),
+    sizeof(osup_sb_scalar_command),    sizeof(osup_sb_colour_command),
+    sizeof(osup_sb_parameter_command)};
+/* how many values follow the times */
+OSUP_STORAGE const size_t osup_sb_command_arity[] = {1, 2, 1, 1, 1, 2, 1, 3, 1};
+
+OSUP_STORAGE const char* const osup_sb_layer_names[] = {
+    "Background", "Fail", "Pass", "Foreground", "Overlay"};
+OSUP_STORAGE const char* const osup_sb_origin_names[] = {
+    "TopLeft",   "Centre", "CentreLeft",  "TopRight",   "BottomCentre",
+    "TopCentre", "Custom", "CentreRight", "BottomLeft", "BottomRight"};
+OSUP_STORAGE const char* const osup_sb_loop_type_names[] = {"LoopForever",
+                                                            "LoopOnce"};
+
+/**********
+ * TABLES *
+ **********/
+OSUP_INTERN void osup_sb_get_table(const osup_sb* sb, size_t offset,
+                                   osup_sb_table* table) {
+  memcpy(table, (const char*)sb + offset, sizeof(*table));
+}
+
+OSUP_INTERN void osup_sb_set_table(osup_sb* sb, size_t offset,
+                                   const osup_sb_table* table) {
+  memcpy((char*)sb + offset, table, sizeof(*table));
+}
+
+OSUP_INTERN void* osup_sb_realloc(osup_sb_parser* parser, void* ptr,
+                                  size_t oldSize, size_t newSize) {
+  return parser->arena
+             ? osup_arena_realloc(parser->arena, ptr, oldSize, newSize)
+             : realloc(ptr, newSize);
+}
+
+/* grow the table at offset to capacity elements */
+OSUP_INTERN osup_bool osup_sb_grow(osup_sb_parser* parser, size_t offset,
+                                   size_t elementSize, size_t* capacity,
+                                   size_t newCapacity) {
+  osup_sb_table table;
+  osup_sb_get_table(parser->sb, offset, &table);
+  char* elements = osup_sb_realloc(parser, table.elements,
+                                   *capacity * elementSize,
+                                   newCapacity * elementSize);
+  if (!elements) {
+    OSUP_SB_ERROR("malloc returns NULL, malloc size: %zu",
+                  newCapacity * elementSize);
+    return osup_false;
+  }
+  table.elements = elements;
+  osup_sb_set_table(parser->sb, offset, &table);
+  *capacity = newCapacity;
+  return osup_true;
+}
+
+/* a new zeroed element at the end of the table at offset, NULL if out of
+ * memory */
+OSUP_INTERN void* osup_sb_append(osup_sb_parser* parser, size_t offset,
+                                 size_t elementSize, size_t* capacity) {
+  osup_sb_table table;
+  osup_sb_get_table(parser->sb, offset, &table);
+  if (table.count >= *capacity) {
+    if (!osup_sb_grow(parser, offset, elementSize, capacity,
+                      (size_t)((table.count + 1) * 1.5))) {
+      return NULL;
+    }
+    osup_sb_get_table(parser->sb, offset, &table);
+  }
+  char* element = table.elements + table.count * elementSize;
+  memset(element, 0, elementSize);
+  table.count++;
+  osup_sb_set_table(parser->sb, offset, &table);
+  return element;
+}
+
+OSUP_INTERN osup_bool osup_sb_store_string(osup_sb_parser* parser,
+                                           const char* begin, const char* end,
+                                           osup_bool copy, char** value,
+                                           osup_slice* view) {
+  if (parser->stringViews && !copy) {
+    view->begin = begin;
+    view->end = end;
+    return osup_true;
+  }
+  if (parser->arena ? !osup_arena_strdup(parser->arena, begin, end, value)
+                    : !osup_strdup(begin, end, value)) {
+    OSUP_SB_ERROR("osup_strdup returns false, malloc length: %zu",
+                  (size_t)(end - begin));
+    return osup_false;
+  }
+  view->begin = *value;
+  view->end = *value + (end - begin);
+  return osup_true;
+}
+
+/***********
+ * PARSING *
+ ***********/
+OSUP_API void osup_sb_parser_init(osup_sb_parser* parser, osup_sb* sb,
+                                  osup_arena* arena, osup_bool stringViews) {
+  memset(parser, 0, sizeof(*parser));
+  parser->sb = sb;
+  parser->arena = arena;
+  parser->stringViews = stringViews;
+  parser->group = OSUP_SB_NO_GROUP;
+}
+
+OSUP_API osup_bool osup_sb_parser_reserve(osup_sb_parser* parser,
+                                          const osup_sb_capacity* capacity) {
+  size_t i;
+  if (capacity->objects > parser->objectCapacity &&
+      !osup_sb_grow(parser, offsetof(osup_sb, objects),
+                    sizeof(osup_sb_object), &parser->objectCapacity,
+                    capacity->objects)) {
+    return osup_false;
+  }
+  if (capacity->samples > parser->sampleCapacity &&
+      !osup_sb_grow(parser, offsetof(osup_sb, samples),
+                    sizeof(osup_sb_sample), &parser->sampleCapacity,
+                    capacity->samples)) {
+    return osup_false;
+  }
+  if (capacity->groups > parser->groupCapacity &&
+      !osup_sb_grow(parser, offsetof(osup_sb, groups), sizeof(osup_sb_group),
+                    &parser->groupCapacity, capacity->groups)) {
+    return osup_false;
+  }
+  for (i = 0; i < OSUP_SB_COMMAND_TYPE_COUNT; i++) {
+    if (capacity->commands[i] > parser->commandCapacity[i] &&
+        !osup_sb_grow(parser, osup_sb_command_offsets[i],
+                      osup_sb_command_sizes[i], &parser->commandCapacity[i],
+                      capacity->commands[i])) {
+      return osup_false;
+    }
+  }
+  return osup_true;
+}
+
+OSUP_API void osup_sb_parser_free(osup_sb_parser* parser) {
+  osup_free_ptr(parser->variables.names);
+  osup_free_ptr(parser->variables.values);
+  osup_free_ptr(parser->expanded);
+  memset(parser, 0, sizeof(*parser));
+}
+
+OSUP_API osup_bool osup_sb_is_storyboard_line(const char* line) {
+  switch (*line) {
+    case ' ':
+    case '_':
+    case 'A':
+      return osup_true;
+    case 'S':
+      /* Sprite or Sample */
+      return line[1] == 'p' || line[1] == 'a';
+    case '4':
+    case '5':
+    case '6':
+      return line[1] == ',';
+    default:
+      return osup_false;
+  }
+}
+
+OSUP_API void osup_sb_count_line(const char* line,
+                                 osup_sb_capacity* capacity) {
+  switch (*line) {
+    case 'S':
+      if (line[1] == 'a') {
+        capacity->samples++;
+        return;
+      }
+      capacity->objects++;
+      return;
+    case '5':
+      capacity->samples++;
+      return;
+    case 'A':
+    case '4':
+    case '6':
+      capacity->objects++;
+      return;
+    case ' ':
+    case '_':
+      break;
+    default:
+      return;
+  }
+  while (*line == ' ' || *line == '_') ++line;
+  switch (*line) {
+    case 'F':
+      capacity->commands[OSUP_SB_COMMAND_FADE]++;
+      break;
+    case 'M':
+      if (line[1] == 'X') {
+        capacity->commands[OSUP_SB_COMMAND_MOVE_X]++;
+      } else if (line[1] == 'Y') {
+        capacity->commands[OSUP_SB_COMMAND_MOVE_Y]++;
+      } else {
+        capacity->commands[OSUP_SB_COMMAND_MOVE]++;
+      }
+      break;
+    case 'S':
+      capacity->commands[OSUP_SB_COMMAND_SCALE]++;
+      break;
+    case 'V':
+      capacity->commands[OSUP_SB_COMMAND_VECTOR_SCALE]++;
+      break;
+    case 'R':
+      capacity->commands[OSUP_SB_COMMAND_ROTATE]++;
+      break;
+    case 'C':
+      capacity->commands[OSUP_SB_COMMAND_COLOUR]++;
+      break;
+    case 'P':
+      capacity->commands[OSUP_SB_COMMAND_PARAMETER]++;
+      break;
+    case 'L':
+    case 'T':
+      capacity->groups++;
+      break;
+  }
+}
+
+/* a name from names, or its index */
+OSUP_INTERN osup_bool osup_sb_parse_name(const char* begin, const char* end,
+                                         const char* const* names,
+                                         size_t count, osup_int* value) {
+  size_t i;
+  if (begin < end && *begin >= '0' && *begin <= '9') {
+    return osup_parse_int(begin, end, value) && *value >= 0 &&
+           (size_t)*value < count;
+  }
+  for (i = 0; i < count; i++) {
+    if ((size_t)(end - begin) == strlen(names[i]) &&
+        !memcmp(begin, names[i], end - begin)) {
+      *value = (osup_int)i;
+      return osup_true;
+    }
+  }
+  return osup_false;
+}
+
+/* times are integers, but some editors write them with decimals */
+OSUP_INTERN osup_bool osup_sb_parse_time(const char* begin, const char* end,
+                                         osup_int* value) {
+  osup_decimal decimal;
+  if (osup_parse_int(begin, end, value)) return osup_true;
+  if (!osup_parse_decimal(begin, end, &decimal) || !(decimal >= INT32_MIN) ||
+      !(decimal <= INT32_MAX)) {
+    return osup_false;
+  }
+  *value = (osup_int)decimal;
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_sb_parse_float(const char* begin, const char* end,
+                                          float* value) {
+  osup_decimal decimal;
+  if (!osup_parse_decimal(begin, end, &decimal)) return osup_false;
+  *value = (float)decimal;
+  return osup_true;
+}
+
+/* Sprite,layer,origin,"file",x,y
+ * Animation,layer,origin,"file",x,y,frameCount,frameDelay[,loopType]
+ * Sample,time,layer,"file"[,volume] */
+OSUP_INTERN osup_bool osup_sb_parse_object(osup_sb_parser* parser,
+                                           const char** line,
+                                           osup_bool copyStrings) {
+  osup_sb* sb = parser->sb;
+  const char* elementBegin = NULL;
+  const char* elementEnd = *line - 1;
+  const char* valueEnd;
+  osup_int value;
+  size_t i;
+  osup_split_string_line_terminated(',', &elementBegin, &elementEnd);
+  size_t length = (size_t)(elementEnd - elementBegin);
+  osup_bool sample = (length == 6 && !memcmp(elementBegin, "Sample", 6)) ||
+                     (length == 1 && *elementBegin == '5');
+
+  if (sample) {
+    osup_sb_sample* s = osup_sb_append(parser, offsetof(osup_sb, samples),
+                                       sizeof(osup_sb_sample),
+                                       &parser->sampleCapacity);
+    if (!s) return osup_false;
+    parser->inObject = osup_false;
+    if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_sb_parse_time(elementBegin, elementEnd, &s->time) ||
+        !osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_sb_parse_name(elementBegin, elementEnd, osup_sb_layer_names, 5,
+                            &value) ||
+        !osup_split_string_line_terminated_quoted(',', &elementBegin,
+                                                  &valueEnd, &elementEnd) ||
+        !osup_sb_store_string(parser, elementBegin, valueEnd, copyStrings,
+                              &s->filename, &s->filenameView)) {
+      /* the string is freed with the storyboard */
+      OSUP_SB_ERROR("invalid storyboard sample: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    }
+    s->layer = (osup_sb_layer)value;
+    s->volume = 100;
+    if (osup_split_string_line_terminated(',', &elementBegin, &elementEnd) &&
+        !osup_parse_int(elementBegin, elementEnd, &s->volume)) {
+      OSUP_SB_ERROR("invalid storyboard sample volume: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    }
+    *line = elementEnd;
+    return osup_advance_to_next_line(line, osup_true);
+  }
+
+  osup_sb_object* object;
+  osup_sb_object_type type;
+  if ((length == 6 && !memcmp(elementBegin, "Sprite", 6)) ||
+      (length == 1 && *elementBegin == '4')) {
+    type = OSUP_SB_OBJECT_SPRITE;
+  } else if ((length == 9 && !memcmp(elementBegin, "Animation", 9)) ||
+             (length == 1 && *elementBegin == '6')) {
+    type = OSUP_SB_OBJECT_ANIMATION;
+  } else {
+    OSUP_SB_ERROR("invalid/unsupported storyboard object: %s",
+                  osup_temp_string_slice(elementBegin, elementEnd));
+    return osup_false;
+  }
+  object = osup_sb_append(parser, offsetof(osup_sb, objects),
+                          sizeof(osup_sb_object), &parser->objectCapacity);
+  if (!object) return osup_false;
+  parser->inObject = osup_true;
+  parser->group = OSUP_SB_NO_GROUP;
+  object->type = type;
+  for (i = 0; i < OSUP_SB_COMMAND_TYPE_COUNT; i++) {
+    osup_sb_table table;
+    osup_sb_get_table(sb, osup_sb_command_offsets[i], &table);
+    object->commands[i] = (uint32_t)table.count;
+  }
+  object->groups = (uint32_t)sb->groups.count;
+
+  if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+      !osup_sb_parse_name(elementBegin, elementEnd, osup_sb_layer_names, 5,
+                          &value)) {
+    OSUP_SB_ERROR("invalid storyboard layer: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  object->layer = (osup_sb_layer)value;
+  if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+      !osup_sb_parse_name(elementBegin, elementEnd, osup_sb_origin_names, 10,
+                          &value)) {
+    OSUP_SB_ERROR("invalid storyboard origin: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  object->origin = (osup_sb_origin)value;
+  if (!osup_split_string_line_terminated_quoted(',', &elementBegin, &valueEnd,
+                                                &elementEnd) ||
+      !osup_sb_store_string(parser, elementBegin, valueEnd, copyStrings,
+                            &object->filename, &object->filenameView)) {
+    OSUP_SB_ERROR("couldn't get the filename of storyboard object: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+      !osup_sb_parse_float(elementBegin, elementEnd, &object->x) ||
+      !osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+      !osup_sb_parse_float(elementBegin, elementEnd, &object->y)) {
+    OSUP_SB_ERROR("couldn't get the position of storyboard object: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  if (type == OSUP_SB_OBJECT_ANIMATION) {
+    if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_parse_int(elementBegin, elementEnd, &object->frameCount) ||
+        !osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_parse_decimal(elementBegin, elementEnd, &object->frameDelay)) {
+      OSUP_SB_ERROR("couldn't get the frames of storyboard animation: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    }
+    if (osup_split_string_line_terminated(',', &elementBegin, &elementEnd)) {
+      if (!osup_sb_parse_name(elementBegin, elementEnd,
+                              osup_sb_loop_type_names, 2, &value)) {
+        OSUP_SB_ERROR("invalid storyboard animation loop type: %s",
+                      osup_temp_string_slice_line_terminated(*line));
+        return osup_false;
+      }
+      object->loopType = (osup_sb_loop_type)value;
+    }
+  }
+  /* there should be no leftover tokens */
+  *line = elementEnd;
+  if (!osup_advance_to_next_line(line, osup_true)) {
+    OSUP_SB_ERROR("unexpected token(s) in storyboard object: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  return osup_true;
+}
+
+/* L,startTime,loopCount or T,trigger[,startTime[,endTime[,groupNumber]]],
+ * elementEnd is after the command name */
+OSUP_INTERN osup_bool osup_sb_parse_group(osup_sb_parser* parser,
+                                          const char** line,
+                                          const char* elementEnd,
+                                          osup_bool copyStrings) {
+  const char* elementBegin = elementEnd;
+  char name = elementBegin[-1];
+  osup_sb_group* group =
+      osup_sb_append(parser, offsetof(osup_sb, groups), sizeof(osup_sb_group),
+                     &parser->groupCapacity);
+  if (!group) return osup_false;
+  group->object = (uint32_t)(parser->sb->objects.count - 1);
+  parser->group = (uint32_t)(parser->sb->groups.count - 1);
+
+  if (name == 'L') {
+    group->type = OSUP_SB_GROUP_LOOP;
+    if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_sb_parse_time(elementBegin, elementEnd, &group->startTime) ||
+        !osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_parse_int(elementBegin, elementEnd, &group->loopCount)) {
+      OSUP_SB_ERROR("invalid storyboard loop: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    }
+  } else {
+    group->type = OSUP_SB_GROUP_TRIGGER;
+    group->startTime = INT32_MIN;
+    group->endTime = INT32_MAX;
+    if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_sb_store_string(parser, elementBegin, elementEnd, copyStrings,
+                              &group->trigger, &group->triggerView)) {
+      OSUP_SB_ERROR("invalid storyboard trigger: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    }
+    if ((osup_split_string_line_terminated(',', &elementBegin, &elementEnd) &&
+         !osup_sb_parse_time(elementBegin, elementEnd, &group->startTime)) ||
+        (osup_split_string_line_terminated(',', &elementBegin, &elementEnd) &&
+         !osup_sb_parse_time(elementBegin, elementEnd, &group->endTime)) ||
+        (osup_split_string_line_terminated(',', &elementBegin, &elementEnd) &&
+         !osup_parse_int(elementBegin, elementEnd, &group->groupNumber))) {
+      OSUP_SB_ERROR("invalid storyboard trigger: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    }
+  }
+  *line = elementEnd;
+  if (!osup_advance_to_next_line(line, osup_true)) {
+    OSUP_SB_ERROR("unexpected token(s) in storyboard command: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_sb_parse_parameter(const char* begin,
+                                              const char* end,
+                                              osup_sb_parameter* parameter) {
+  if (end - begin != 1) return osup_false;
+  switch (*begin) {
+    case 'H':
+      *parameter = OSUP_SB_PARAMETER_FLIP_H;
+      return osup_true;
+    case 'V':
+      *parameter = OSUP_SB_PARAMETER_FLIP_V;
+      return osup_true;
+    case 'A':
+      *parameter = OSUP_SB_PARAMETER_ADDITIVE;
+      return osup_true;
+    default:
+      return osup_false;
+  }
+}
+
+OSUP_INTERN uint8_t osup_sb_colour_channel(float value) {
+  if (!(value > 0)) return 0;
+  if (value >= 255) return 255;
+  return (uint8_t)(value + 0.5f);
+}
+
+/* add a command to its table, from and to are the values before and after
+ * the times */
+OSUP_INTERN osup_bool osup_sb_add_command(osup_sb_parser* parser,
+                                          osup_sb_command_type type,
+                                          const osup_sb_command* command,
+                                          const float* from, const float* to,
+                                          osup_sb_parameter parameter) {
+  void* element =
+      osup_sb_append(parser, osup_sb_command_offsets[type],
+                     osup_sb_command_sizes[type],
+                     &parser->commandCapacity[type]);
+  if (!element) return osup_false;
+  switch (type) {
+    case OSUP_SB_COMMAND_MOVE:
+    case OSUP_SB_COMMAND_VECTOR_SCALE: {
+      osup_sb_vector_command* vector = element;
+      vector->command = *command;
+      vector->start[0] = from[0];
+      vector->start[1] = from[1];
+      vector->end[0] = to[0];
+      vector->end[1] = to[1];
+      break;
+    }
+    case OSUP_SB_COMMAND_COLOUR: {
+      osup_sb_colour_command* colour = element;
+      colour->command = *command;
+      colour->start.red = osup_sb_colour_channel(from[0]);
+      colour->start.green = osup_sb_colour_channel(from[1]);
+      colour->start.blue = osup_sb_colour_channel(from[2]);
+      colour->end.red = osup_sb_colour_channel(to[0]);
+      colour->end.green = osup_sb_colour_channel(to[1]);
+      colour->end.blue = osup_sb_colour_channel(to[2]);
+      break;
+    }
+    case OSUP_SB_COMMAND_PARAMETER: {
+      osup_sb_parameter_command* p = element;
+      p->command = *command;
+      p->parameter = parameter;
+      break;
+    }
+    default: {
+      osup_sb_scalar_command* scalar = element;
+      scalar->command = *command;
+      scalar->start = from[0];
+      scalar->end = to[0];
+      break;
+    }
+  }
+  return osup_true;
+}
+
+/* _F,easing,startTime,endTime,values... with depth underscores (or spaces)
+ * in front */
+OSUP_INTERN osup_bool osup_sb_parse_command(osup_sb_parser* parser,
+                                            const char** line, size_t depth,
+                                            osup_bool copyStrings) {
+  const char* elementBegin = NULL;
+  const char* elementEnd = *line + depth - 1;
+  osup_sb_command_type type;
+  osup_sb_command command;
+  osup_sb_parameter parameter = OSUP_SB_PARAMETER_FLIP_H;
+  osup_int easing;
+  float from[3], to[3];
+  size_t arity, i;
+
+  if (!parser->inObject) {
+    OSUP_SB_ERROR("storyboard command without an object: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  /* the commands right under the object close the loop or trigger */
+  if (depth < 2) parser->group = OSUP_SB_NO_GROUP;
+
+  osup_split_string_line_terminated(',', &elementBegin, &elementEnd);
+  switch (elementEnd - elementBegin) {
+    case 1:
+      switch (*elementBegin) {
+        case 'F':
+          type = OSUP_SB_COMMAND_FADE;
+          break;
+        case 'M':
+          type = OSUP_SB_COMMAND_MOVE;
+          break;
+        case 'S':
+          type = OSUP_SB_COMMAND_SCALE;
+          break;
+        case 'V':
+          type = OSUP_SB_COMMAND_VECTOR_SCALE;
+          break;
+        case 'R':
+          type = OSUP_SB_COMMAND_ROTATE;
+          break;
+        case 'C':
+          type = OSUP_SB_COMMAND_COLOUR;
+          break;
+        case 'P':
+          type = OSUP_SB_COMMAND_PARAMETER;
+          break;
+        case 'L':
+        case 'T':
+          return osup_sb_parse_group(parser, line, elementEnd, copyStrings);
+        default:
+          goto invalid;
+      }
+      break;
+    case 2:
+      if (elementBegin[0] == 'M' && elementBegin[1] == 'X') {
+        type = OSUP_SB_COMMAND_MOVE_X;
+        break;
+      }
+      if (elementBegin[0] == 'M' && elementBegin[1] == 'Y') {
+        type = OSUP_SB_COMMAND_MOVE_Y;
+        break;
+      }
+      goto invalid;
+    default:
+    invalid:
+      OSUP_SB_ERROR("invalid/unsupported storyboard command: %s",
+                    osup_temp_string_slice(elementBegin, elementEnd));
+      return osup_false;
+  }
+
+  command.object = (uint32_t)(parser->sb->objects.count - 1);
+  command.group = parser->group;
+  if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+      !osup_parse_int(elementBegin, elementEnd, &easing) || easing < 0 ||
+      easing >= OSUP_SB_EASING_COUNT ||
+      !osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+      !osup_sb_parse_time(elementBegin, elementEnd, &command.startTime) ||
+      !osup_split_string_line_terminated(',', &elementBegin, &elementEnd)) {
+    OSUP_SB_ERROR("couldn't get easing and times of storyboard command: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  command.easing = (uint32_t)easing;
+  if (elementBegin == elementEnd) {
+    command.endTime = command.startTime;
+  } else if (!osup_sb_parse_time(elementBegin, elementEnd, &command.endTime)) {
+    OSUP_SB_ERROR("couldn't get end time of storyboard command: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+
+  if (type == OSUP_SB_COMMAND_PARAMETER) {
+    if (!osup_split_string_line_terminated(',', &elementBegin, &elementEnd) ||
+        !osup_sb_parse_parameter(elementBegin, elementEnd, &parameter) ||
+        !osup_sb_add_command(parser, type, &command, NULL, NULL, parameter)) {
+      OSUP_SB_ERROR("invalid storyboard parameter command: %s",
+                    osup_temp_string_slice_line_terminated(*line));
+      return osup_false;
+    }
+  } else {
+    /* more values than needed are a shorthand for a chain of commands of the
+     * same duration, each one starting where the previous one ended:
+     * F,0,1000,2000,0,1,0.5 is F,0,1000,2000,0,1 and F,0,2000,3000,1,0.5 */
+    osup_int duration = command.endTime - command.startTime;
+    osup_bool first = osup_true;
+    arity = osup_sb_command_arity[type];
+    for (i = 0; i < arity; i++) {
+      if (!osup_split_string_line_terminated(',', &elementBegin,
+                                             &elementEnd) ||
+          !osup_sb_parse_float(elementBegin, elementEnd, &from[i])) {
+        OSUP_SB_ERROR("couldn't get values of storyboard command: %s",
+                      osup_temp_string_slice_line_terminated(*line));
+        return osup_false;
+      }
+    }
+    while (osup_true) {
+      if (!osup_split_string_line_terminated(',', &elementBegin,
+                                             &elementEnd)) {
+        /* only the start values, the end values are the same */
+        if (first &&
+            !osup_sb_add_command(parser, type, &command, from, from,
+                                 parameter)) {
+          return osup_false;
+        }
+        break;
+      }
+      for (i = 0; i < arity; i++) {
+        if ((i && !osup_split_string_line_terminated(',', &elementBegin,
+                                                     &elementEnd)) ||
+            !osup_sb_parse_float(elementBegin, elementEnd, &to[i])) {
+          OSUP_SB_ERROR("couldn't get values of storyboard command: %s",
+                        osup_temp_string_slice_line_terminated(*line));
+          return osup_false;
+        }
+      }
+      if (!osup_sb_add_command(parser, type, &command, from, to, parameter)) {
+        return osup_false;
+      }
+      memcpy(from, to, sizeof(from));
+      command.startTime += duration;
+      command.endTime += duration;
+      first = osup_false;
+    }
+  }
+  /* there should be no leftover tokens */
+  *line = elementEnd;
+  if (!osup_advance_to_next_line(line, osup_true)) {
+    OSUP_SB_ERROR("unexpected token(s) in storyboard command: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_INTERN osup_bool osup_sb_parse_expanded(osup_sb_parser* parser,
+                                             const char** line,
+                                             osup_bool copyStrings) {
+  size_t depth = 0;
+  while ((*line)[depth] == ' ' || (*line)[depth] == '_') depth++;
+  if (depth) {
+    return osup_sb_parse_command(parser, line, depth, copyStrings);
+  }
+  return osup_sb_parse_object(parser, line, copyStrings);
+}
+
+/* copy the line into parser->expanded with its variables replaced, the
+ * longest variable name wins */
+OSUP_INTERN osup_bool osup_sb_expand_variables(osup_sb_parser* parser,
+                                               const char* line,
+                                               const char* end) {
+  size_t size = 0, i;
+  while (line < end) {
+    const char* value = line;
+    size_t length = 1, nameLength = 0;
+    if (*line == '$') {
+      for (i = 0; i < parser->variables.count; i++) {
+        osup_slice name = parser->variables.names[i];
+        size_t n = (size_t)(name.end - name.begin);
+        if (n > nameLength && n <= (size_t)(end - line) &&
+            !memcmp(line, name.begin, n)) {
+          nameLength = n;
+          value = parser->variables.values[i].begin;
+          length = (size_t)(parser->variables.values[i].end - value);
+        }
+      }
+    }
+    if (size + length + 1 > parser->expandedCapacity) {
+      size_t capacity = (size + length + 1) * 2;
+      char* expanded = realloc(parser->expanded, capacity);
+      if (!expanded) {
+        OSUP_SB_ERROR("malloc returns NULL, malloc size: %zu", capacity);
+        return osup_false;
+      }
+      parser->expanded = expanded;
+      parser->expandedCapacity = capacity;
+    }
+    memcpy(parser->expanded + size, value, length);
+    size += length;
+    line += nameLength ? nameLength : 1;
+  }
+  parser->expanded[size] = '\0';
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_sb_parser_parse_line(osup_sb_parser* parser,
+                                             const char** line) {
+  if (parser->variables.count) {
+    const char* end = osup_find_line_terminator(*line);
+    if (memchr(*line, '$', (size_t)(end - *line))) {
+      /* the strings of the line can't be views of the expanded copy */
+      const char* expanded;
+      if (!osup_sb_expand_variables(parser, *line, end)) return osup_false;
+      expanded = parser->expanded;
+      if (!osup_sb_parse_expanded(parser, &expanded, osup_true)) {
+        return osup_false;
+      }
+      *line = end;
+      return osup_advance_to_next_line(line, osup_false);
+    }
+  }
+  return osup_sb_parse_expanded(parser, line, osup_false);
+}
+
+OSUP_API osup_bool osup_sb_parser_parse_variable(osup_sb_parser* parser,
+                                                 const char** line) {
+  const char* nameEnd = *line;
+  const char* valueEnd = *line;
+  if (**line != '$') {
+    OSUP_SB_ERROR("invalid [Variables] line: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  while (*nameEnd != '=' && !osup_is_line_terminator(*nameEnd)) ++nameEnd;
+  if (*nameEnd != '=') {
+    OSUP_SB_ERROR("invalid [Variables] line: %s",
+                  osup_temp_string_slice_line_terminated(*line));
+    return osup_false;
+  }
+  osup_advance_to_last_nonblank_char(&valueEnd);
+  if (parser->variables.count >= parser->variables.capacity) {
+    size_t capacity = parser->variables.capacity * 2 + 8;
+    osup_slice* names =
+        realloc(parser->variables.names, capacity * sizeof(osup_slice));
+    if (names) parser->variables.names = names;
+    osup_slice* values =
+        realloc(parser->variables.values, capacity * sizeof(osup_slice));
+    if (values) parser->variables.values = values;
+    if (!names || !values) {
+      OSUP_SB_ERROR("malloc returns NULL, malloc size: %zu",
+                    capacity * sizeof(osup_slice));
+      return osup_false;
+    }
+    parser->variables.capacity = capacity;
+  }
+  parser->variables.names[parser->variables.count].begin = *line;
+  parser->variables.names[parser->variables.count].end = nameEnd;
+  parser->variables.values[parser->variables.count].begin = nameEnd + 1;
+  parser->variables.values[parser->variables.count].end =
+      valueEnd < nameEnd + 1 ? nameEnd + 1 : valueEnd;
+  parser->variables.count++;
+  return osup_advance_to_next_line(line, osup_false);
+}
+
+/********************
+ * STANDALONE .OSB *
+ ********************/
+typedef enum {
+  OSUP_SB_SECTION_NONE,
+  OSUP_SB_SECTION_EVENTS,
+  OSUP_SB_SECTION_VARIABLES
+} osup_sb_section;
+
+OSUP_INTERN osup_sb_section osup_sb_parse_section_header(const char* line) {
+  if (!strncmp(line, "[Events]", sizeof("[Events]") - 1)) {
+    return OSUP_SB_SECTION_EVENTS;
+  }
+  if (!strncmp(line, "[Variables]", sizeof("[Variables]") - 1)) {
+    return OSUP_SB_SECTION_VARIABLES;
+  }
+  /* anything else is skipped */
+  return OSUP_SB_SECTION_NONE;
+}
+
+/* the storyboard lines of the [Events] section */
+OSUP_INTERN void osup_sb_count_capacity(const char* line,
+                                        osup_sb_capacity* capacity) {
+  osup_sb_section section = OSUP_SB_SECTION_NONE;
+  memset(capacity, 0, sizeof(*capacity));
+  while (*line) {
+    if (*line == '[') {
+      section = osup_sb_parse_section_header(line);
+    } else if (section == OSUP_SB_SECTION_EVENTS) {
+      osup_sb_count_line(line, capacity);
+    }
+    osup_advance_to_next_line(&line, osup_false);
+  }
+}
+
+OSUP_API osup_bool osup_storyboard_load_string(osup_sb* sb,
+                                               const char* string,
+                                               osup_bitfield32 flags) {
+  osup_sb_parser parser;
+  osup_sb_capacity capacity;
+  osup_sb_section section = OSUP_SB_SECTION_NONE;
+  const char* line = string;
+  osup_bool ok = osup_true;
+  memset(sb, 0, sizeof(*sb));
+  osup_sb_parser_init(&parser, sb,
+                      (flags & OSUP_PARSE_ARENA) ? &sb->arena : NULL,
+                      (flags & OSUP_PARSE_STRING_VIEWS) != 0);
+  /* skip UTF-8 BOM */
+  if (line[0] == '\xEF' && line[1] == '\xBB' && line[2] == '\xBF') line += 3;
+
+  osup_sb_count_capacity(line, &capacity);
+  if (!osup_sb_parser_reserve(&parser, &capacity)) {
+    osup_sb_parser_free(&parser);
+    osup_storyboard_free(sb);
+    return osup_false;
+  }
+
+  while (*line && ok) {
+    switch (*line) {
+      case '\r':
+      case '\n':
+        ++line;
+        continue;
+      case '/':
+        if (line[1] == '/') {
+          osup_advance_to_next_line(&line, osup_false);
+          continue;
+        }
+        break;
+      case '[':
+        section = osup_sb_parse_section_header(line);
+        osup_advance_to_next_line(&line, osup_false);
+        continue;
+    }
+    switch (section) {
+      case OSUP_SB_SECTION_EVENTS:
+        if (osup_sb_is_storyboard_line(line)) {
+          ok = osup_sb_parser_parse_line(&parser, &line);
+        } else {
+          /* backgrounds, videos and breaks belong to the maps */
+          osup_advance_to_next_line(&line, osup_false);
+        }
+        break;
+      case OSUP_SB_SECTION_VARIABLES:
+        ok = osup_sb_parser_parse_variable(&parser, &line);
+        break;
+      default:
+        /* e.g. an "osu file format" header */
+        osup_advance_to_next_line(&line, osup_false);
+        break;
+    }
+  }
+  osup_sb_parser_free(&parser);
+  if (!ok) {
+    /* only count the lines when we need to report an error */
+    size_t lineNumber = 1;
+    const char* it = string;
+    while (it < line) {
+      if (*(it++) == '\n') lineNumber++;
+    }
+    OSUP_SB_ERROR("error on line %zu", lineNumber);
+    osup_storyboard_free(sb);
+  }
+  return ok;
+}
+
+OSUP_API osup_bool osup_storyboard_load(osup_sb* sb, const char* file,
+                                        osup_bitfield32 flags) {
+  osup_mapped_file f;
+  if (!osup_map_file(file, &f)) {
+    memset(sb, 0, sizeof(*sb));
+    OSUP_SB_ERROR("unable to read file %s", file);
+    return osup_false;
+  }
+  if (!osup_storyboard_load_string(sb, f.data, flags)) {
+    osup_unmap_file(&f);
+    return osup_false;
+  }
+  if (flags & OSUP_PARSE_STRING_VIEWS) {
+    /* the views point into the file, it goes away with the storyboard */
+    sb->source = f;
+  } else {
+    osup_unmap_file(&f);
+  }
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_storyboard_check(const osup_sb* sb) {
+  size_t i, type;
+  for (i = 0; i < sb->objects.count; i++) {
+    const osup_sb_object* object = &sb->objects.elements[i];
+    const osup_sb_object* next = object + 1;
+    if (object->groups > (i + 1 < sb->objects.count ? next->groups
+                                                    : sb->groups.count)) {
+      return osup_false;
+    }
+    for (type = 0; type < OSUP_SB_COMMAND_TYPE_COUNT; type++) {
+      osup_sb_table table;
+      osup_sb_get_table(sb, osup_sb_command_offsets[type], &table);
+      if (object->commands[type] > (i + 1 < sb->objects.count
+                                        ? next->commands[type]
+                                        : table.count)) {
+        return osup_false;
+      }
+    }
+  }
+  for (i = 0; i < sb->groups.count; i++) {
+    if (sb->groups.elements[i].object >= sb->objects.count) return osup_false;
+  }
+  for (type = 0; type < OSUP_SB_COMMAND_TYPE_COUNT; type++) {
+    osup_sb_table table;
+    osup_sb_get_table(sb, osup_sb_command_offsets[type], &table);
+    for (i = 0; i < table.count; i++) {
+      const osup_sb_command* command =
+          (const osup_sb_command*)(table.elements +
+                                   i * osup_sb_command_sizes[type]);
+      if (command->object >= sb->objects.count ||
+          (command->group != OSUP_SB_NO_GROUP &&
+           command->group >= sb->groups.count) ||
+          command->easing >= OSUP_SB_EASING_COUNT) {
+        return osup_false;
+      }
+    }
+  }
+  return osup_true;
+}
+
+OSUP_API void osup_storyboard_free(osup_sb* sb) {
+  size_t i;
+  osup_unmap_file(&sb->source);
+  if (sb->arena.blocks) {
+    osup_arena_free(&sb->arena);
+    memset(sb, 0, sizeof(*sb));
+    return;
+  }
+  for (i = 0; i < sb->objects.count; i++) {
+    osup_free_ptr(sb->objects.elements[i].filename);
+  }
+  for (i = 0; i < sb->samples.count; i++) {
+    osup_free_ptr(sb->samples.elements[i].filename);
+  }
+  for (i = 0; i < sb->groups.count; i++) {
+    osup_free_ptr(sb->groups.elements[i].trigger);
+  }
+  osup_free_ptr(sb->objects.elements);
+  osup_free_ptr(sb->samples.elements);
+  osup_free_ptr(sb->groups.elements);
+  for (i = 0; i < OSUP_SB_COMMAND_TYPE_COUNT; i++) {
+    osup_sb_table table;
+    osup_sb_get_table(sb, osup_sb_command_offsets[i], &table);
+    osup_free_ptr(table.elements);
+  }
+  memset(sb, 0, sizeof(*sb));
+}
+
+/**************
+ * EVALUATION *
+ **************/
+#define OSUP_SB_PI 3.14159265358979323846
+#define OSUP_SB_ELASTIC_CONST (2 * OSUP_SB_PI / 0.3)
+#define OSUP_SB_ELASTIC_CONST2 (0.3 / 4)
+#define OSUP_SB_BACK_CONST 1.70158
+#define OSUP_SB_BACK_CONST2 (OSUP_SB_BACK_CONST * 1.525)
+
+OSUP_INTERN double osup_sb_bounce_out(double t) {
+  if (t < 1 / 2.75) return 7.5625 * t * t;
+  if (t < 2 / 2.75) {
+    t -= 1.5 / 2.75;
+    return 7.5625 * t * t + 0.75;
+  }
+  if (t < 2.5 / 2.75) {
+    t -= 2.25 / 2.75;
+    return 7.5625 * t * t + 0.9375;
+  }
+  t -= 2.625 / 2.75;
+  return 7.5625 * t * t + 0.984375;
+}
+
+/* the curves of osu!framework, which the storyboard easings are numbered
+ * after */
+OSUP_API double osup_sb_ease(osup_sb_easing easing, double t) {
+  switch (easing) {
+    case OSUP_SB_EASING_IN:
+    case OSUP_SB_EASING_QUAD_IN:
+      return t * t;
+    case OSUP_SB_EASING_OUT:
+    case OSUP_SB_EASING_QUAD_OUT:
+      return t * (2 - t);
+    case OSUP_SB_EASING_QUAD_IN_OUT:
+      if (t < 0.5) return t * t * 2;
+      t -= 1;
+      return t * t * -2 + 1;
+    case OSUP_SB_EASING_CUBIC_IN:
+      return t * t * t;
+    case OSUP_SB_EASING_CUBIC_OUT:
+      t -= 1;
+      return t * t * t + 1;
+    case OSUP_SB_EASING_CUBIC_IN_OUT:
+      if (t < 0.5) return t * t * t * 4;
+      t -= 1;
+      return t * t * t * 4 + 1;
+    case OSUP_SB_EASING_QUART_IN:
+      return t * t * t * t;
+    case OSUP_SB_EASING_QUART_OUT:
+      t -= 1;
+      return 1 - t * t * t * t;
+    case OSUP_SB_EASING_QUART_IN_OUT:
+      if (t < 0.5) return t * t * t * t * 8;
+      t -= 1;
+      return t * t * t * t * -8 + 1;
+    case OSUP_SB_EASING_QUINT_IN:
+      return t * t * t * t * t;
+    case OSUP_SB_EASING_QUINT_OUT:
+      t -= 1;
+      return t * t * t * t * t + 1;
+    case OSUP_SB_EASING_QUINT_IN_OUT:
+      if (t < 0.5) return t * t * t * t * t * 16;
+      t -= 1;
+      return t * t * t * t * t * 16 + 1;
+    case OSUP_SB_EASING_SINE_IN:
+      return 1 - cos(t * OSUP_SB_PI * 0.5);
+    case OSUP_SB_EASING_SINE_OUT:
+      return sin(t * OSUP_SB_PI * 0.5);
+    case OSUP_SB_EASING_SINE_IN_OUT:
+      return 0.5 - 0.5 * cos(OSUP_SB_PI * t);
+    case OSUP_SB_EASING_EXPO_IN:
+      return pow(2, 10 * (t - 1));
+    case OSUP_SB_EASING_EXPO_OUT:
+      return -pow(2, -10 * t) + 1;
+    case OSUP_SB_EASING_EXPO_IN_OUT:
+      if (t < 0.5) return 0.5 * pow(2, 20 * t - 10);
+      return 1 - 0.5 * pow(2, -20 * t + 10);
+    case OSUP_SB_EASING_CIRC_IN:
+      return 1 - sqrt(1 - t * t);
+    case OSUP_SB_EASING_CIRC_OUT:
+      t -= 1;
+      return sqrt(1 - t * t);
+    case OSUP_SB_EASING_CIRC_IN_OUT:
+      t *= 2;
+      if (t < 1) return 0.5 - 0.5 * sqrt(1 - t * t);
+      t -= 2;
+      return 0.5 * sqrt(1 - t * t) + 0.5;
+    case OSUP_SB_EASING_ELASTIC_IN:
+      return -pow(2, -10 + 10 * t) *
+             sin((1 - OSUP_SB_ELASTIC_CONST2 - t) * OSUP_SB_ELASTIC_CONST);
+    case OSUP_SB_EASING_ELASTIC_OUT:
+      return pow(2, -10 * t) *
+                 sin((t - OSUP_SB_ELASTIC_CONST2) * OSUP_SB_ELASTIC_CONST) +
+             1;
+    case OSUP_SB_EASING_ELASTIC_HALF_OUT:
+      return pow(2, -10 * t) * sin((0.5 * t - OSUP_SB_ELASTIC_CONST2) *
+                                   OSUP_SB_ELASTIC_CONST) +
+             1;
+    case OSUP_SB_EASING_ELASTIC_QUARTER_OUT:
+      return pow(2, -10 * t) * sin((0.25 * t - OSUP_SB_ELASTIC_CONST2) *
+                                   OSUP_SB_ELASTIC_CONST) +
+             1;
+    case OSUP_SB_EASING_ELASTIC_IN_OUT:
+      t *= 2;
+      if (t < 1) {
+        return -0.5 * pow(2, -10 + 10 * t) *
+               sin((1 - OSUP_SB_ELASTIC_CONST2 * 1.5 - t) *
+                   OSUP_SB_ELASTIC_CONST / 1.5);
+      }
+      t -= 1;
+      return 0.5 * pow(2, -10 * t) *
+                 sin((t - OSUP_SB_ELASTIC_CONST2 * 1.5) *
+                     OSUP_SB_ELASTIC_CONST / 1.5) +
+             1;
+    case OSUP_SB_EASING_BACK_IN:
+      return t * t * ((OSUP_SB_BACK_CONST + 1) * t - OSUP_SB_BACK_CONST);
+    case OSUP_SB_EASING_BACK_OUT:
+      t -= 1;
+      return t * t * ((OSUP_SB_BACK_CONST + 1) * t + OSUP_SB_BACK_CONST) + 1;
+    case OSUP_SB_EASING_BACK_IN_OUT:
+      t *= 2;
+      if (t < 1) {
+        return 0.5 * t * t *
+               ((OSUP_SB_BACK_CONST2 + 1) * t - OSUP_SB_BACK_CONST2);
+      }
+      t -= 2;
+      return 0.5 * (t * t * ((OSUP_SB_BACK_CONST2 + 1) * t +
+                             OSUP_SB_BACK_CONST2) +
+                    2);
+    case OSUP_SB_EASING_BOUNCE_IN:
+      return 1 - osup_sb_bounce_out(1 - t);
+    case OSUP_SB_EASING_BOUNCE_OUT:
+      return osup_sb_bounce_out(t);
+    case OSUP_SB_EASING_BOUNCE_IN_OUT:
+      if (t < 0.5) return 0.5 - 0.5 * osup_sb_bounce_out(1 - t * 2);
+      return osup_sb_bounce_out((t - 0.5) * 2) * 0.5 + 0.5;
+    default:
+      return t;
+  }
+}
+
+/* the channels a command drives and its values on each of them, return the
+ * number of channels */
+OSUP_INTERN size_t osup_sb_command_channels(osup_sb_command_type type,
+                                            const void* element,
+                                            osup_sb_channel* channels,
+                                            float* start, float* end) {
+  switch (type) {
+    case OSUP_SB_COMMAND_MOVE:
+    case OSUP_SB_COMMAND_VECTOR_SCALE: {
+      const osup_sb_vector_command* vector = element;
+      channels[0] = type == OSUP_SB_COMMAND_MOVE ? OSUP_SB_CHANNEL_X
+                                                 : OSUP_SB_CHANNEL_VECTOR_X;
+      channels[1] = type == OSUP_SB_COMMAND_MOVE ? OSUP_SB_CHANNEL_Y
+                                                 : OSUP_SB_CHANNEL_VECTOR_Y;
+      start[0] = vector->start[0];
+      start[1] = vector->start[1];
+      end[0] = vector->end[0];
+      end[1] = vector->end[1];
+      return 2;
+    }
+    case OSUP_SB_COMMAND_COLOUR: {
+      const osup_sb_colour_command* colour = element;
+      channels[0] = OSUP_SB_CHANNEL_RED;
+      channels[1] = OSUP_SB_CHANNEL_GREEN;
+      channels[2] = OSUP_SB_CHANNEL_BLUE;
+      start[0] = colour->start.red;
+      start[1] = colour->start.green;
+      start[2] = colour->start.blue;
+      end[0] = colour->end.red;
+      end[1] = colour->end.green;
+      end[2] = colour->end.blue;
+      return 3;
+    }
+    case OSUP_SB_COMMAND_PARAMETER: {
+      const osup_sb_parameter_command* p = element;
+      channels[0] = (osup_sb_channel)(OSUP_SB_CHANNEL_FLIP_H + p->parameter);
+      start[0] = end[0] = 1;
+      return 1;
+    }
+    default: {
+      static const osup_sb_channel scalarChannels[] = {
+          OSUP_SB_CHANNEL_OPACITY,  OSUP_SB_CHANNEL_X,
+          OSUP_SB_CHANNEL_X,        OSUP_SB_CHANNEL_Y,
+          OSUP_SB_CHANNEL_SCALE,    OSUP_SB_CHANNEL_VECTOR_X,
+          OSUP_SB_CHANNEL_ROTATION};
+      const osup_sb_scalar_command* scalar = element;
+      channels[0] = scalarChannels[type];
+      start[0] = scalar->start;
+      end[0] = scalar->end;
+      return 1;
+    }
+  }
+}
+
+OSUP_INTERN osup_int osup_sb_clamp_time(osup_long time) {
+  if (time < INT32_MIN) return INT32_MIN;
+  if (time > INT32_MAX) return INT32_MAX;
+  return (osup_int)time;
+}
+
+/* how a loop repeats its commands, the way osu!lazer does it: iteration i
+ * shifts them by startTime + i * (end of the last one - start of the first
+ * one) */
+typedef struct {
+  osup_int commandsStart;
+  osup_int commandsEnd;
+  osup_int iterations;
+} osup_sb_loop;
+
+/* the number of times a command is played, 0 for the commands of triggers */
+OSUP_INTERN osup_int osup_sb_command_repeats(const osup_sb* sb,
+                                             const osup_sb_loop* loops,
+                                             const osup_sb_command* command) {
+  if (command->group == OSUP_SB_NO_GROUP) return 1;
+  if (sb->groups.elements[command->group].type != OSUP_SB_GROUP_LOOP) {
+    return 0;
+  }
+  return loops[command->group].iterations;
+}
+
+OSUP_INTERN osup_bool osup_sb_find_loops(const osup_sb* sb,
+                                         osup_sb_loop** loops) {
+  size_t i, type;
+  *loops = malloc((sb->groups.count ? sb->groups.count : 1) *
+                  sizeof(osup_sb_loop));
+  if (!*loops) {
+    OSUP_SB_ERROR("malloc returns NULL, malloc size: %zu",
+                  sb->groups.count * sizeof(osup_sb_loop));
+    return osup_false;
+  }
+  for (i = 0; i < sb->groups.count; i++) {
+    (*loops)[i].commandsStart = INT32_MAX;
+    (*loops)[i].commandsEnd = INT32_MIN;
+  }
+  for (type = 0; type < OSUP_SB_COMMAND_TYPE_COUNT; type++) {
+    osup_sb_table table;
+    osup_sb_get_table(sb, osup_sb_command_offsets[type], &table);
+    for (i = 0; i < table.count; i++) {
+      const osup_sb_command* command =
+          (const osup_sb_command*)(table.elements +
+                                   i * osup_sb_command_sizes[type]);
+      if (command->group == OSUP_SB_NO_GROUP) continue;
+      osup_sb_loop* loop = &(*loops)[command->group];
+      if (command->startTime < loop->commandsStart) {
+        loop->commandsStart = command->startTime;
+      }
+      if (command->endTime > loop->commandsEnd) {
+        loop->commandsEnd = command->endTime;
+      }
+    }
+  }
+  for (i = 0; i < sb->groups.count; i++) {
+    osup_sb_loop* loop = &(*loops)[i];
+    /* a loop of nothing or of instant commands is played once */
+    loop->iterations = sb->groups.elements[i].loopCount;
+    if (loop->iterations < 1 || loop->commandsEnd <= loop->commandsStart) {
+      loop->iterations = 1;
+    }
+  }
+  return osup_true;
+}
+
+/* stable, so that of two keyframes starting together the one given last
+ * wins, as it does in the file */
+OSUP_INTERN void osup_sb_sort_keyframes(osup_sb_keyframe* keyframes,
+                                        size_t count,
+                                        osup_sb_keyframe* scratch) {
+  size_t half = count / 2, i = 0, j = half, k = 0;
+  if (count < 2) return;
+  osup_sb_sort_keyframes(keyframes, half, scratch);
+  osup_sb_sort_keyframes(keyframes + half, count - half, scratch);
+  if (keyframes[half - 1].startTime <= keyframes[half].startTime) return;
+  while (i < half && j < count) {
+    scratch[k++] = keyframes[j].startTime < keyframes[i].startTime
+                       ? keyframes[j++]
+                       : keyframes[i++];
+  }
+  while (i < half) scratch[k++] = keyframes[i++];
+  memcpy(keyframes, scratch, k * sizeof(osup_sb_keyframe));
+}
+
+OSUP_INTERN int osup_sb_compare_times(const void* a, const void* b) {
+  osup_int x = *(const osup_int*)a, y = *(const osup_int*)b;
+  return (x > y) - (x < y);
+}
+
+OSUP_INTERN int osup_sb_compare_objects(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+typedef struct {
+  osup_int startTime;
+  uint32_t object;
+} osup_sb_appearance;
+
+OSUP_INTERN int osup_sb_compare_appearances(const void* a, const void* b) {
+  const osup_sb_appearance* x = a;
+  const osup_sb_appearance* y = b;
+  if (x->startTime != y->startTime) {
+    return (x->startTime > y->startTime) - (x->startTime < y->startTime);
+  }
+  return (x->object > y->object) - (x->object < y->object);
+}
+
+/* count (or, with fill, write) the keyframes of every track */
+OSUP_INTERN void osup_sb_expand_commands(const osup_sb* sb,
+                                         const osup_sb_loop* loops,
+                                         size_t* tracks,
+                                         osup_sb_keyframe* keyframes) {
+  size_t i, c, type;
+  osup_int k;
+  for (type = 0; type < OSUP_SB_COMMAND_TYPE_COUNT; type++) {
+    osup_sb_table table;
+    osup_sb_get_table(sb, osup_sb_command_offsets[type], &table);
+    for (i = 0; i < table.count; i++) {
+      const char* element = table.elements + i * osup_sb_command_sizes[type];
+      const osup_sb_command* command = (const osup_sb_command*)element;
+      osup_sb_channel channels[3];
+      float start[3], end[3];
+      size_t channelCount = osup_sb_command_channels(
+          (osup_sb_command_type)type, element, channels, start, end);
+      osup_int repeats = osup_sb_command_repeats(sb, loops, command);
+      for (c = 0; c < channelCount; c++) {
+        size_t* track =
+            &tracks[command->object * OSUP_SB_CHANNEL_COUNT + channels[c]];
+        if (!keyframes) {
+          *track += (size_t)repeats;
+          continue;
+        }
+        for (k = 0; k < repeats; k++) {
+          osup_sb_keyframe* keyframe = &keyframes[(*track)++];
+          osup_long offset = 0;
+          if (command->group != OSUP_SB_NO_GROUP) {
+            const osup_sb_loop* loop = &loops[command->group];
+            offset = (osup_long)sb->groups.elements[command->group].startTime +
+                     (osup_long)k * (loop->commandsEnd - loop->commandsStart);
+          }
+          keyframe->startTime = osup_sb_clamp_time(offset + command->startTime);
+          keyframe->endTime = osup_sb_clamp_time(offset + command->endTime);
+          keyframe->start = start[c];
+          keyframe->end = end[c];
+          keyframe->easing = command->easing;
+        }
+      }
+    }
+  }
+}
+
+OSUP_INTERN osup_bool osup_sb_evaluator_alloc(void** ptr, size_t count,
+                                              size_t size) {
+  *ptr = malloc((count ? count : 1) * size);
+  if (!*ptr) {
+    OSUP_SB_ERROR("malloc returns NULL, malloc size: %zu", count * size);
+    return osup_false;
+  }
+  return osup_true;
+}
+
+OSUP_API osup_bool osup_sb_evaluator_init(osup_sb_evaluator* evaluator,
+                                          const osup_sb* sb) {
+  size_t trackCount = sb->objects.count * OSUP_SB_CHANNEL_COUNT;
+  size_t total = 0, longest = 0, count, i, alive;
+  osup_sb_loop* loops = NULL;
+  size_t* ends = NULL;
+  osup_sb_keyframe* scratch = NULL;
+  osup_sb_appearance* appearances = NULL;
+  osup_int* endTimes = NULL;
+  osup_bool ok = osup_false;
+  memset(evaluator, 0, sizeof(*evaluator));
+  evaluator->sb = sb;
+  evaluator->time = INT32_MIN;
+  if (!osup_sb_find_loops(sb, &loops) ||
+      !osup_sb_evaluator_alloc((void**)&evaluator->tracks, trackCount + 1,
+                               sizeof(size_t)) ||
+      !osup_sb_evaluator_alloc((void**)&ends, trackCount, sizeof(size_t))) {
+    goto done;
+  }
+
+  /* count the keyframes of every track, then turn the counts into the start
+   * of every track and write them */
+  memset(evaluator->tracks, 0, (trackCount + 1) * sizeof(size_t));
+  osup_sb_expand_commands(sb, loops, evaluator->tracks, NULL);
+  for (i = 0; i < trackCount; i++) {
+    count = evaluator->tracks[i];
+    /* a loop repeated billions of times */
+    if (count > (((size_t)-1) / sizeof(osup_sb_keyframe) - total)) {
+      OSUP_SB_ERROR("too many storyboard keyframes");
+      goto done;
+    }
+    if (count > longest) longest = count;
+    evaluator->tracks[i] = total;
+    ends[i] = total;
+    total += count;
+  }
+  evaluator->tracks[trackCount] = total;
+  if (!osup_sb_evaluator_alloc((void**)&evaluator->keyframes, total,
+                               sizeof(osup_sb_keyframe)) ||
+      !osup_sb_evaluator_alloc((void**)&scratch, longest,
+                               sizeof(osup_sb_keyframe))) {
+    goto done;
+  }
+  osup_sb_expand_commands(sb, loops, ends, evaluator->keyframes);
+  for (i = 0; i < trackCount; i++) {
+    osup_sb_sort_keyframes(evaluator->keyframes + evaluator->tracks[i],
+                           evaluator->tracks[i + 1] - evaluator->tracks[i],
+                           scratch);
+  }
+
+  /* the lifetimes, and the objects by the time they appear */
+  if (!osup_sb_evaluator_alloc((void**)&evaluator->startTimes,
+                               sb->objects.count, sizeof(osup_int)) ||
+      !osup_sb_evaluator_alloc((void**)&evaluator->endTimes, sb->objects.count,
+                               sizeof(osup_int)) ||
+      !osup_sb_evaluator_alloc((void**)&evaluator->order, sb->objects.count,
+                               sizeof(uint32_t)) ||
+      !osup_sb_evaluator_alloc((void**)&appearances, sb->objects.count,
+                               sizeof(osup_sb_appearance)) ||
+      !osup_sb_evaluator_alloc((void**)&endTimes, sb->objects.count,
+                               sizeof(osup_int))) {
+    goto done;
+  }
+  for (i = 0; i < sb->objects.count; i++) {
+    const osup_sb_keyframe* keyframe =
+        evaluator->keyframes + evaluator->tracks[i * OSUP_SB_CHANNEL_COUNT];
+    const osup_sb_keyframe* end =
+        evaluator->keyframes +
+        evaluator->tracks[(i + 1) * OSUP_SB_CHANNEL_COUNT];
+    osup_int startTime = INT32_MAX, endTime = INT32_MIN;
+    for (; keyframe < end; keyframe++) {
+      if (keyframe->startTime < startTime) startTime = keyframe->startTime;
+      if (keyframe->endTime > endTime) endTime = keyframe->endTime;
+    }
+    evaluator->startTimes[i] = startTime;
+    evaluator->endTimes[i] = endTime;
+    if (startTime > endTime) continue;
+    appearances[evaluator->orderCount].startTime = startTime;
+    appearances[evaluator->orderCount].object = (uint32_t)i;
+    endTimes[evaluator->orderCount] = endTime;
+    evaluator->orderCount++;
+  }
+  qsort(appearances, evaluator->orderCount, sizeof(osup_sb_appearance),
+        osup_sb_compare_appearances);
+  qsort(endTimes, evaluator->orderCount, sizeof(osup_int),
+        osup_sb_compare_times);
+  /* an object is alive from its start to its end, both included */
+  alive = 0;
+  for (i = 0, count = 0; i < evaluator->orderCount; i++) {
+    evaluator->order[i] = appearances[i].object;
+    while (endTimes[count] < appearances[i].startTime) {
+      count++;
+      alive--;
+    }
+    if (++alive > evaluator->maxActive) evaluator->maxActive = alive;
+  }
+  if (!osup_sb_evaluator_alloc((void**)&evaluator->active,
+                               evaluator->maxActive, sizeof(uint32_t)) ||
+      !osup_sb_evaluator_alloc((void**)&evaluator->appeared,
+                               evaluator->maxActive, sizeof(uint32_t))) {
+    goto done;
+  }
+  ok = osup_true;
+
+done:
+  osup_free_ptr(loops);
+  osup_free_ptr(ends);
+  osup_free_ptr(scratch);
+  osup_free_ptr(appearances);
+  osup_free_ptr(endTimes);
+  if (!ok) osup_sb_evaluator_free(evaluator);
+  return ok;
+}
+
+OSUP_API void osup_sb_evaluator_free(osup_sb_evaluator* evaluator) {
+  osup_free_ptr(evaluator->keyframes);
+  osup_free_ptr(evaluator->tracks);
+  osup_free_ptr(evaluator->startTimes);
+  osup_free_ptr(evaluator->endTimes);
+  osup_free_ptr(evaluator->order);
+  osup_free_ptr(evaluator->active);
+  osup_free_ptr(evaluator->appeared);
+  memset(evaluator, 0, sizeof(*evaluator));
+}
+
+/* the last keyframe of the track that started at time, NULL if none has
+ * started yet */
+OSUP_INTERN const osup_sb_keyframe* osup_sb_find_keyframe(
+    const osup_sb_keyframe* begin, const osup_sb_keyframe* end,
+    osup_int time) {
+  while (begin < end) {
+    const osup_sb_keyframe* middle = begin + (end - begin) / 2;
+    if (middle->startTime <= time) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return begin;
+}
+
+/* the value of channel of the object at time, value is left untouched if the
+ * channel has no keyframes */
+OSUP_INTERN void osup_sb_channel_value(const osup_sb_evaluator* evaluator,
+                                       uint32_t object, osup_sb_channel channel,
+                                       osup_int time, float* value) {
+  size_t track = object * OSUP_SB_CHANNEL_COUNT + channel;
+  const osup_sb_keyframe* first =
+      evaluator->keyframes + evaluator->tracks[track];
+  const osup_sb_keyframe* last =
+      evaluator->keyframes + evaluator->tracks[track + 1];
+  const osup_sb_keyframe* keyframe;
+  double progress;
+  if (first == last) return;
+  keyframe = osup_sb_find_keyframe(first, last, time);
+  if (channel >= OSUP_SB_CHANNEL_FLIP_H) {
+    /* parameters hold for the duration of the command, or for good when it
+     * has none */
+    *value = keyframe > first && (keyframe[-1].startTime ==
+                                      keyframe[-1].endTime ||
+                                  time < keyframe[-1].endTime);
+    return;
+  }
+  /* before the first command, the object starts with its first value */
+  if (keyframe == first) {
+    *value = first->start;
+    return;
+  }
+  keyframe--;
+  if (time >= keyframe->endTime) {
+    *value = keyframe->end;
+    return;
+  }
+  progress = osup_sb_ease((osup_sb_easing)keyframe->easing,
+                          (double)((osup_long)time - keyframe->startTime) /
+                              ((osup_long)keyframe->endTime -
+                               keyframe->startTime));
+  *value = (float)(keyframe->start + (keyframe->end - keyframe->start) *
+                                         progress);
+}
+
+OSUP_INTERN void osup_sb_evaluate_state(const osup_sb_evaluator* evaluator,
+                                        uint32_t object, osup_int time,
+                                        osup_sb_state* state) {
+  const osup_sb_object* o = &evaluator->sb->objects.elements[object];
+  float scale = 1, flip[3] = {0, 0, 0};
+  state->object = object;
+  state->x = o->x;
+  state->y = o->y;
+  state->scale[0] = state->scale[1] = 1;
+  state->rotation = 0;
+  state->opacity = 1;
+  state->colour[0] = state->colour[1] = state->colour[2] = 255;
+  state->frame = 0;
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_X, time, &state->x);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_Y, time, &state->y);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_SCALE, time,
+                        &scale);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_VECTOR_X, time,
+                        &state->scale[0]);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_VECTOR_Y, time,
+                        &state->scale[1]);
+  state->scale[0] *= scale;
+  state->scale[1] *= scale;
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_ROTATION, time,
+                        &state->rotation);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_OPACITY, time,
+                        &state->opacity);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_RED, time,
+                        &state->colour[0]);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_GREEN, time,
+                        &state->colour[1]);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_BLUE, time,
+                        &state->colour[2]);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_FLIP_H, time,
+                        &flip[0]);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_FLIP_V, time,
+                        &flip[1]);
+  osup_sb_channel_value(evaluator, object, OSUP_SB_CHANNEL_ADDITIVE, time,
+                        &flip[2]);
+  state->flipH = flip[0] != 0;
+  state->flipV = flip[1] != 0;
+  state->additive = flip[2] != 0;
+  /* animations start with the object */
+  if (o->type == OSUP_SB_OBJECT_ANIMATION && o->frameCount > 0 &&
+      o->frameDelay > 0) {
+    osup_decimal frame =
+        floor(((osup_long)time - evaluator->startTimes[object]) /
+              o->frameDelay);
+    if (o->loopType == OSUP_SB_LOOP_ONCE) {
+      state->frame = frame < o->frameCount ? (osup_int)frame
+                                           : o->frameCount - 1;
+    } else {
+      state->frame = (osup_int)fmod(frame, o->frameCount);
+    }
+  }
+}
+
+OSUP_API osup_bool osup_sb_evaluate_object(const osup_sb_evaluator* evaluator,
+                                           uint32_t object, osup_int time,
+                                           osup_sb_state* state) {
+  if (object >= evaluator->sb->objects.count ||
+      time < evaluator->startTimes[object] ||
+      time > evaluator->endTimes[object]) {
+    return osup_false;
+  }
+  osup_sb_evaluate_state(evaluator, object, time, state);
+  return osup_true;
+}
+
+OSUP_API size_t osup_sb_evaluate(osup_sb_evaluator* evaluator, osup_int time,
+                                 osup_sb_state* states) {
+  size_t i, kept = 0, appeared = 0;
+  if (time < evaluator->time) {
+    evaluator->cursor = 0;
+    evaluator->activeCount = 0;
+  }
+  evaluator->time = time;
+  /* the objects that are gone */
+  for (i = 0; i < evaluator->activeCount; i++) {
+    if (evaluator->endTimes[evaluator->active[i]] >= time) {
+      evaluator->active[kept++] = evaluator->active[i];
+    }
+  }
+  evaluator->activeCount = kept;
+  /* the ones that appear, after a jump some of them are already gone */
+  while (evaluator->cursor < evaluator->orderCount) {
+    uint32_t object = evaluator->order[evaluator->cursor];
+    if (evaluator->startTimes[object] > time) break;
+    evaluator->cursor++;
+    if (evaluator->endTimes[object] >= time) {
+      evaluator->appeared[appeared++] = object;
+    }
+  }
+  if (appeared) {
+    /* merge them in from the back, to keep the object order */
+    size_t j = kept, k = kept + appeared;
+    qsort(evaluator->appeared, appeared, sizeof(uint32_t),
+          osup_sb_compare_objects);
+    i = appeared;
+    while (i > 0) {
+      if (j > 0 && evaluator->active[j - 1] > evaluator->appeared[i - 1]) {
+        evaluator->active[--k] = evaluator->active[--j];
+      } else {
+        evaluator->active[--k] = evaluator->appeared[--i];
+      }
+    }
+    evaluator->activeCount = kept + appeared;
+  }
+  for (i = 0; i < evaluator->activeCount; i++) {
+    osup_sb_evaluate_state(evaluator, evaluator->active[i], time, &states[i]);
+  }
+  return evaluator->activeCount;
+}
@@ -0,0 +1,452 @@
+#ifndef OSUP_STORYBOARD_H
+#define OSUP_STORYBOARD_H
+
+/*********
+ * USAGE *
+ *********/
+#if 0
+
+int main() {
+  /* the storyboard of a map is in map.storyboard with OSUP_PARSE_STORYBOARD,
+   * a standalone .osb file is loaded on its own */
+  osup_sb sb{};
+  osup_storyboard_load(&sb, "/path/to/storyboard.osb", 0);
+  for (size_t i = 0; i < sb.fade.count; i++) {
+    const osup_sb_scalar_command* fade = &sb.fade.elements[i];
+    printf("sprite %u: %f -> %f\n", fade->command.object, fade->start,
+           fade->end);
+  }
+
+  /* the state of every live sprite, frame by frame */
+  osup_sb_evaluator evaluator;
+  osup_sb_evaluator_init(&evaluator, &sb);
+  osup_sb_state* states = malloc(evaluator.maxActive * sizeof(osup_sb_state));
+  for (osup_int time = 0; time < 60000; time += 16) {
+    size_t count = osup_sb_evaluate(&evaluator, time, states);
+    /* draw states[0 .. count) */
+  }
+  free(states);
+  osup_sb_evaluator_free(&evaluator);
+  osup_storyboard_free(&sb);
+  return 0;
+}
+
+#endif
+
+#define OSUP_API
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "osup_common.h"
+
+typedef enum {
+  OSUP_SB_LAYER_BACKGROUND,
+  OSUP_SB_LAYER_FAIL,
+  OSUP_SB_LAYER_PASS,
+  OSUP_SB_LAYER_FOREGROUND,
+  OSUP_SB_LAYER_OVERLAY
+} osup_sb_layer;
+
+/* the numbers are the ones used by the numeric form of the object lines */
+typedef enum {
+  OSUP_SB_ORIGIN_TOP_LEFT = 0,
+  OSUP_SB_ORIGIN_CENTRE = 1,
+  OSUP_SB_ORIGIN_CENTRE_LEFT = 2,
+  OSUP_SB_ORIGIN_TOP_RIGHT = 3,
+  OSUP_SB_ORIGIN_BOTTOM_CENTRE = 4,
+  OSUP_SB_ORIGIN_TOP_CENTRE = 5,
+  OSUP_SB_ORIGIN_CUSTOM = 6,
+  OSUP_SB_ORIGIN_CENTRE_RIGHT = 7,
+  OSUP_SB_ORIGIN_BOTTOM_LEFT = 8,
+  OSUP_SB_ORIGIN_BOTTOM_RIGHT = 9
+} osup_sb_origin;
+
+typedef enum {
+  OSUP_SB_OBJECT_SPRITE,
+  OSUP_SB_OBJECT_ANIMATION
+} osup_sb_object_type;
+
+typedef enum {
+  OSUP_SB_LOOP_FOREVER,
+  OSUP_SB_LOOP_ONCE
+} osup_sb_loop_type;
+
+typedef enum {
+  OSUP_SB_EASING_LINEAR,
+  OSUP_SB_EASING_OUT,
+  OSUP_SB_EASING_IN,
+  OSUP_SB_EASING_QUAD_IN,
+  OSUP_SB_EASING_QUAD_OUT,
+  OSUP_SB_EASING_QUAD_IN_OUT,
+  OSUP_SB_EASING_CUBIC_IN,
+  OSUP_SB_EASING_CUBIC_OUT,
+  OSUP_SB_EASING_CUBIC_IN_OUT,
+  OSUP_SB_EASING_QUART_IN,
+  OSUP_SB_EASING_QUART_OUT,
+  OSUP_SB_EASING_QUART_IN_OUT,
+  OSUP_SB_EASING_QUINT_IN,
+  OSUP_SB_EASING_QUINT_OUT,
+  OSUP_SB_EASING_QUINT_IN_OUT,
+  OSUP_SB_EASING_SINE_IN,
+  OSUP_SB_EASING_SINE_OUT,
+  OSUP_SB_EASING_SINE_IN_OUT,
+  OSUP_SB_EASING_EXPO_IN,
+  OSUP_SB_EASING_EXPO_OUT,
+  OSUP_SB_EASING_EXPO_IN_OUT,
+  OSUP_SB_EASING_CIRC_IN,
+  OSUP_SB_EASING_CIRC_OUT,
+  OSUP_SB_EASING_CIRC_IN_OUT,
+  OSUP_SB_EASING_ELASTIC_IN,
+  OSUP_SB_EASING_ELASTIC_OUT,
+  OSUP_SB_EASING_ELASTIC_HALF_OUT,
+  OSUP_SB_EASING_ELASTIC_QUARTER_OUT,
+  OSUP_SB_EASING_ELASTIC_IN_OUT,
+  OSUP_SB_EASING_BACK_IN,
+  OSUP_SB_EASING_BACK_OUT,
+  OSUP_SB_EASING_BACK_IN_OUT,
+  OSUP_SB_EASING_BOUNCE_IN,
+  OSUP_SB_EASING_BOUNCE_OUT,
+  OSUP_SB_EASING_BOUNCE_IN_OUT,
+  OSUP_SB_EASING_COUNT
+} osup_sb_easing;
+
+/* one table per command type, in the order of this enum */
+typedef enum {
+  /* F */
+  OSUP_SB_COMMAND_FADE,
+  /* M */
+  OSUP_SB_COMMAND_MOVE,
+  /* MX */
+  OSUP_SB_COMMAND_MOVE_X,
+  /* MY */
+  OSUP_SB_COMMAND_MOVE_Y,
+  /* S */
+  OSUP_SB_COMMAND_SCALE,
+  /* V */
+  OSUP_SB_COMMAND_VECTOR_SCALE,
+  /* R */
+  OSUP_SB_COMMAND_ROTATE,
+  /* C */
+  OSUP_SB_COMMAND_COLOUR,
+  /* P */
+  OSUP_SB_COMMAND_PARAMETER,
+  OSUP_SB_COMMAND_TYPE_COUNT
+} osup_sb_command_type;
+
+typedef enum {
+  OSUP_SB_PARAMETER_FLIP_H,
+  OSUP_SB_PARAMETER_FLIP_V,
+  OSUP_SB_PARAMETER_ADDITIVE
+} osup_sb_parameter;
+
+/* the group of commands that are outside of loops and triggers */
+#define OSUP_SB_NO_GROUP ((uint32_t)-1)
+
+/* the part every command starts with */
+typedef struct {
+  /* index into objects */
+  uint32_t object;
+  /* index into groups, the times of the commands of a group are relative to
+   * the start of the loop (or of the trigger) */
+  uint32_t group;
+  osup_int startTime;
+  /* startTime if it was left empty */
+  osup_int endTime;
+  /* osup_sb_easing */
+  uint32_t easing;
+} osup_sb_command;
+
+/* the values are floats to keep the tables small, storyboards are drawn with
+ * floats anyway */
+typedef struct {
+  osup_sb_command command;
+  float start;
+  float end;
+} osup_sb_scalar_command;
+
+typedef struct {
+  osup_sb_command command;
+  float start[2];
+  float end[2];
+} osup_sb_vector_command;
+
+typedef struct {
+  osup_sb_command command;
+  osup_rgb start;
+  osup_rgb end;
+} osup_sb_colour_command;
+
+typedef struct {
+  osup_sb_command command;
+  osup_sb_parameter parameter;
+} osup_sb_parameter_command;
+
+typedef enum { OSUP_SB_GROUP_LOOP, OSUP_SB_GROUP_TRIGGER } osup_sb_group_type;
+
+/* L and T, the commands of a group are the following ones of the same
+ * object */
+typedef struct {
+  osup_sb_group_type type;
+  uint32_t object;
+  osup_int startTime;
+  /* loops only */
+  osup_int loopCount;
+  /* triggers only, e.g. HitSoundClap or Passing */
+  osup_int endTime;
+  osup_int groupNumber;
+  char* trigger;
+  osup_slice triggerView;
+} osup_sb_group;
+
+/* a Sprite or an Animation */
+typedef struct {
+  osup_sb_object_type type;
+  osup_sb_layer layer;
+  osup_sb_origin origin;
+  char* filename;
+  float x;
+  float y;
+  /* animations only */
+  osup_int frameCount;
+  osup_decimal frameDelay;
+  osup_sb_loop_type loopType;
+  /* the commands of the object are
+   * [commands[type], next object's commands[type]) of every command table,
+   * and its groups [groups, next object's groups) */
+  uint32_t commands[OSUP_SB_COMMAND_TYPE_COUNT];
+  uint32_t groups;
+  osup_slice filenameView;
+} osup_sb_object;
+
+typedef struct {
+  osup_int time;
+  osup_sb_layer layer;
+  char* filename;
+  osup_int volume;
+  osup_slice filenameView;
+} osup_sb_sample;
+
+typedef struct {
+  osup_sb_scalar_command* elements;
+  size_t count;
+} osup_sb_scalar_commands;
+
+typedef struct {
+  osup_sb_vector_command* elements;
+  size_t count;
+} osup_sb_vector_commands;
+
+typedef struct {
+  struct {
+    osup_sb_object* elements;
+    size_t count;
+  } objects;
+  struct {
+    osup_sb_sample* elements;
+    size_t count;
+  } samples;
+  struct {
+    osup_sb_group* elements;
+    size_t count;
+  } groups;
+
+  /* the command tables, every command of a type is in one array, sorted by
+   * object */
+  osup_sb_scalar_commands fade;
+  osup_sb_vector_commands move;
+  osup_sb_scalar_commands moveX;
+  osup_sb_scalar_commands moveY;
+  osup_sb_scalar_commands scale;
+  osup_sb_vector_commands vectorScale;
+  osup_sb_scalar_commands rotate;
+  struct {
+    osup_sb_colour_command* elements;
+    size_t count;
+  } colour;
+  struct {
+    osup_sb_parameter_command* elements;
+    size_t count;
+  } parameter;
+
+  /* only used by osup_storyboard_load(_string) with OSUP_PARSE_ARENA, a map
+   * keeps its storyboard in its own arena */
+  osup_arena arena;
+  /* only used by osup_storyboard_load with OSUP_PARSE_STRING_VIEWS */
+  osup_mapped_file source;
+} osup_sb;
+
+/* the expected number of elements of every table, 0 means unknown */
+typedef struct {
+  size_t objects;
+  size_t samples;
+  size_t groups;
+  size_t commands[OSUP_SB_COMMAND_TYPE_COUNT];
+} osup_sb_capacity;
+
+/* parses the storyboard lines of an [Events] section one at a time, this is
+ * what the beatmap parser uses with OSUP_PARSE_STORYBOARD */
+typedef struct {
+  osup_sb* sb;
+  /* where the tables come from, NULL means malloc */
+  osup_arena* arena;
+  /* don't copy the strings, only fill the *View slices */
+  osup_bool stringViews;
+  size_t objectCapacity;
+  size_t sampleCapacity;
+  size_t groupCapacity;
+  size_t commandCapacity[OSUP_SB_COMMAND_TYPE_COUNT];
+  /* commands need an object to go to, samples can't have any */
+  osup_bool inObject;
+  /* the loop or trigger the indented commands go to */
+  uint32_t group;
+
+  /* the [Variables] of .osb files, $name is replaced with value before the
+   * line is parsed */
+  struct {
+    osup_slice* names;
+    osup_slice* values;
+    size_t count;
+    size_t capacity;
+  } variables;
+  /* the line with its variables replaced */
+  char* expanded;
+  size_t expandedCapacity;
+} osup_sb_parser;
+
+OSUP_API void osup_sb_parser_init(osup_sb_parser* parser, osup_sb* sb,
+                                  osup_arena* arena, osup_bool stringViews);
+/* allocate every table once */
+OSUP_API osup_bool osup_sb_parser_reserve(osup_sb_parser* parser,
+                                          const osup_sb_capacity* capacity);
+/* parse the storyboard line at *line and advance *line to the next one */
+OSUP_API osup_bool osup_sb_parser_parse_line(osup_sb_parser* parser,
+                                             const char** line);
+/* a $name=value line of [Variables] */
+OSUP_API osup_bool osup_sb_parser_parse_variable(osup_sb_parser* parser,
+                                                 const char** line);
+/* frees the parser itself, not the storyboard */
+OSUP_API void osup_sb_parser_free(osup_sb_parser* parser);
+
+/* whether the [Events] line is part of the storyboard (an object or an
+ * indented command), the others are backgrounds, videos and breaks */
+OSUP_API osup_bool osup_sb_is_storyboard_line(const char* line);
+/* count the storyboard line at line into capacity, only by looking at its
+ * first characters */
+OSUP_API void osup_sb_count_line(const char* line, osup_sb_capacity* capacity);
+
+/* the flags can be OSUP_PARSE_ARENA and OSUP_PARSE_STRING_VIEWS, with the
+ * same meaning as for osup_beatmap_load */
+OSUP_API osup_bool osup_storyboard_load(osup_sb* sb, const char* file,
+                                        osup_bitfield32 flags);
+OSUP_API osup_bool osup_storyboard_load_string(osup_sb* sb,
+                                               const char* string,
+                                               osup_bitfield32 flags);
+OSUP_API void osup_storyboard_free(osup_sb* sb);
+/* whether the objects, groups and commands refer to each other with indices
+ * that are in range, the parser always gets them right, this is for
+ * storyboards read from somewhere else (e.g. a binary snapshot) */
+OSUP_API osup_bool osup_storyboard_check(const osup_sb* sb);
+
+/* the animated properties of an object, M drives both X and Y, V both
+ * VECTOR_X and VECTOR_Y and C the three colour channels */
+typedef enum {
+  OSUP_SB_CHANNEL_X,
+  OSUP_SB_CHANNEL_Y,
+  OSUP_SB_CHANNEL_SCALE,
+  OSUP_SB_CHANNEL_VECTOR_X,
+  OSUP_SB_CHANNEL_VECTOR_Y,
+  OSUP_SB_CHANNEL_ROTATION,
+  OSUP_SB_CHANNEL_OPACITY,
+  OSUP_SB_CHANNEL_RED,
+  OSUP_SB_CHANNEL_GREEN,
+  OSUP_SB_CHANNEL_BLUE,
+  OSUP_SB_CHANNEL_FLIP_H,
+  OSUP_SB_CHANNEL_FLIP_V,
+  OSUP_SB_CHANNEL_ADDITIVE,
+  OSUP_SB_CHANNEL_COUNT
+} osup_sb_channel;
+
+/* one command on one channel, with the loops expanded and the times
+ * absolute */
+typedef struct {
+  osup_int startTime;
+  osup_int endTime;
+  float start;
+  float end;
+  /* osup_sb_easing */
+  uint32_t easing;
+} osup_sb_keyframe;
+
+/* the state of an object at a given time */
+typedef struct {
+  uint32_t object;
+  float x;
+  float y;
+  /* S times V */
+  float scale[2];
+  /* radians, clockwise */
+  float rotation;
+  float opacity;
+  /* 0 to 255 */
+  float colour[3];
+  osup_bool flipH;
+  osup_bool flipV;
+  osup_bool additive;
+  /* animations only, the index of the frame to show */
+  osup_int frame;
+} osup_sb_state;
+
+/* the keyframes of every object, sorted by start time on each channel, and
+ * the objects sorted by the time they appear.
+ * an object lives from the start of its first command to the end of its last
+ * one, objects without commands never show up. the commands of triggers are
+ * left out, they depend on the gameplay */
+typedef struct {
+  const osup_sb* sb;
+  osup_sb_keyframe* keyframes;
+  /* channel c of object o is [tracks[o * OSUP_SB_CHANNEL_COUNT + c],
+   * tracks[o * OSUP_SB_CHANNEL_COUNT + c + 1]) of keyframes */
+  size_t* tracks;
+  /* the lifetime of every object */
+  osup_int* startTimes;
+  osup_int* endTimes;
+  /* the objects with commands, by start time */
+  uint32_t* order;
+  size_t orderCount;
+  /* the most objects alive at the same time, the size osup_sb_evaluate needs
+   * for its states */
+  size_t maxActive;
+
+  /* the playback state of osup_sb_evaluate, the next object of order to
+   * appear and the live ones, in object order */
+  size_t cursor;
+  uint32_t* active;
+  size_t activeCount;
+  uint32_t* appeared;
+  osup_int time;
+} osup_sb_evaluator;
+
+/* the sb must outlive the evaluator */
+OSUP_API osup_bool osup_sb_evaluator_init(osup_sb_evaluator* evaluator,
+                                          const osup_sb* sb);
+OSUP_API void osup_sb_evaluator_free(osup_sb_evaluator* evaluator);
+/* the state of every object alive at time, in object order, states must have
+ * room for evaluator->maxActive of them. return the number of states.
+ * playing forward only looks at the live objects and the ones that appear, a
+ * jump back in time starts over from the first object */
+OSUP_API size_t osup_sb_evaluate(osup_sb_evaluator* evaluator, osup_int time,
+                                 osup_sb_state* states);
+/* the state of a single object, false if it isn't alive at time */
+OSUP_API osup_bool osup_sb_evaluate_object(const osup_sb_evaluator* evaluator,
+                                           uint32_t object, osup_int time,
+                                           osup_sb_state* state);
+/* progress (0 to 1) through the easing curve */
+OSUP_API double osup_sb_ease(osup_sb_easing easing, double progress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,485 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "osup/osup_beatmap.h"
+
+/* compare the mmap-based osup_beatmap_load against the FILE-based
+ * osup_beatmap_load_stream, run from the repository root */
+
+#define ROUNDS 5
+#define ITERATIONS 40
+
+typedef osup_bool (*load_fn)(osup_bm*, const char*);
+
+#ifdef OSUP_BENCH_COUNT_ALLOCS
+/* the bench is linked with --wrap, so every malloc/realloc/free of the
+ * library ends up here */
+void* __real_malloc(size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static size_t allocCount = 0;
+static size_t freeCount = 0;
+
+void* __wrap_malloc(size_t size) {
+  allocCount++;
+  return __real_malloc(size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  allocCount++;
+  return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr) {
+  if (ptr) freeCount++;
+  __real_free(ptr);
+}
+#endif
+
+static osup_bool load_mapped(osup_bm* map, const char* path) {
+  return osup_beatmap_load(map, path, OSUP_PARSE_ALL);
+}
+
+static osup_bool load_arena(osup_bm* map, const char* path) {
+  return osup_beatmap_load(map, path, OSUP_PARSE_ALL | OSUP_PARSE_ARENA);
+}
+
+/* what a metadata indexer needs, with and without string copies */
+#define INDEX_FLAGS (OSUP_PARSE_GENERAL | OSUP_PARSE_METADATA | OSUP_PARSE_EVENTS)
+
+static osup_bool load_index_copies(osup_bm* map, const char* path) {
+  return osup_beatmap_load(map, path, INDEX_FLAGS);
+}
+
+static osup_bool load_index_views(osup_bm* map, const char* path) {
+  return osup_beatmap_load(map, path, INDEX_FLAGS | OSUP_PARSE_STRING_VIEWS);
+}
+
+/* what a song browser shows first, load and stream stop reading after
+ * [Difficulty], open skips the other sections with the section directory */
+#define BROWSE_FLAGS (OSUP_PARSE_METADATA | OSUP_PARSE_DIFFICULTY)
+
+static osup_bool load_browse(osup_bm* map, const char* path) {
+  return osup_beatmap_load(map, path, BROWSE_FLAGS);
+}
+
+static osup_bool stream_browse(osup_bm* map, const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return osup_false;
+  osup_bool ret = osup_beatmap_load_stream(map, f, BROWSE_FLAGS);
+  fclose(f);
+  return ret;
+}
+
+static osup_bool open_browse(osup_bm* map, const char* path) {
+  return osup_beatmap_open(map, path, BROWSE_FLAGS);
+}
+
+/* a file that is nothing but key-value lines: the key-value sections of the
+ * map, each repeated KV_REPEAT times under one header */
+#define KV_REPEAT 200
+#define KV_FLAGS                                                         \
+  (OSUP_PARSE_GENERAL | OSUP_PARSE_EDITOR | OSUP_PARSE_METADATA |        \
+   OSUP_PARSE_DIFFICULTY | OSUP_PARSE_COLORS)
+
+static char* kvInput = NULL;
+
+static char* make_kv_input(const char* path) {
+  static const char* headers[] = {"[General]\n", "[Editor]\n", "[Metadata]\n",
+                                  "[Difficulty]\n", NULL, NULL,
+                                  "[Colours]\n"};
+  osup_bm map = {0};
+  size_t size = sizeof("osu file format v14\n");
+  size_t i, j;
+  char* input;
+  if (!osup_beatmap_open(&map, path, 0)) return NULL;
+  for (i = 0; i < sizeof(headers) / sizeof(headers[0]); i++) {
+    osup_slice range = map.directory.sections[i];
+    if (headers[i] && range.begin) {
+      size += strlen(headers[i]) + (range.end - range.begin) * KV_REPEAT;
+    }
+  }
+  input = malloc(size);
+  char* it = input + sprintf(input, "osu file format v14\n");
+  for (i = 0; i < sizeof(headers) / sizeof(headers[0]); i++) {
+    osup_slice range = map.directory.sections[i];
+    if (!headers[i] || !range.begin) continue;
+    it += sprintf(it, "%s", headers[i]);
+    for (j = 0; j < KV_REPEAT; j++) {
+      memcpy(it, range.begin, range.end - range.begin);
+      it += range.end - range.begin;
+    }
+  }
+  *it = '\0';
+  osup_beatmap_free(&map);
+  return input;
+}
+
+/* the repeated strings would leak without the arena */
+static osup_bool load_kv(osup_bm* map, const char* path) {
+  (void)path;
+  return osup_beatmap_load_string(map, kvInput, KV_FLAGS | OSUP_PARSE_ARENA);
+}
+
+/* the file handed over in 64KB chunks, like a decompression layer would */
+#define CHUNK_SIZE (64 * 1024)
+
+typedef struct {
+  const char* data;
+  size_t size;
+  size_t offset;
+} chunk_reader;
+
+static const char* next_chunk(void* ptr, size_t* size) {
+  chunk_reader* reader = ptr;
+  const char* chunk = reader->data + reader->offset;
+  *size = reader->size - reader->offset;
+  if (*size > CHUNK_SIZE) *size = CHUNK_SIZE;
+  reader->offset += *size;
+  return chunk;
+}
+
+static osup_bool load_chunked(osup_bm* map, const char* path) {
+  osup_mapped_file f;
+  chunk_reader reader;
+  if (!osup_map_file(path, &f)) return osup_false;
+  reader.data = f.data;
+  reader.size = f.size;
+  reader.offset = 0;
+  osup_bool ret =
+      osup_beatmap_load_callbacks(map, next_chunk, &reader, OSUP_PARSE_ALL);
+  osup_unmap_file(&f);
+  return ret;
+}
+
+/* a density histogram only needs the hit object times, the visitor gets them
+ * without building the map */
+static size_t histogram[64];
+
+static osup_bool add_to_histogram(void* userData, const osup_hitobject* obj) {
+  (void)userData;
+  histogram[(obj->time / 4096) & 63]++;
+  return osup_true;
+}
+
+static osup_bool visit_hit_objects(osup_bm* map, const char* path) {
+  osup_bm_visitor visitor;
+  (void)map;
+  memset(&visitor, 0, sizeof(visitor));
+  visitor.on_hit_object = add_to_histogram;
+  return osup_beatmap_visit(path, &visitor, OSUP_PARSE_HIT_OBJECTS);
+}
+
+static osup_bool load_hit_objects(osup_bm* map, const char* path) {
+  size_t i;
+  if (!osup_beatmap_load(map, path, OSUP_PARSE_HIT_OBJECTS)) return osup_false;
+  for (i = 0; i < map->hitObjects.count; i++) {
+    histogram[(map->hitObjects.elements[i].time / 4096) & 63]++;
+  }
+  return osup_true;
+}
+
+static osup_bool load_hit_object_columns(osup_bm* map, const char* path) {
+  return osup_beatmap_load(map, path,
+                           OSUP_PARSE_HIT_OBJECTS | OSUP_PARSE_HIT_OBJECT_COLUMNS);
+}
+
+/* a density pass over an already loaded map, only the times are read, so the
+ * columns touch a fraction of the cache lines */
+static void bench_time_scan(const char* path) {
+  osup_bm rows = {0};
+  osup_bm columns = {0};
+  double best[2] = {-1.0, -1.0};
+  int round, i, pass;
+  size_t j;
+  if (!osup_beatmap_load(&rows, path, OSUP_PARSE_HIT_OBJECTS) ||
+      !load_hit_object_columns(&columns, path)) {
+    osup_beatmap_free(&rows);
+    return;
+  }
+  for (round = 0; round < ROUNDS; round++) {
+    for (pass = 0; pass < 2; pass++) {
+      clock_t begin = clock();
+      for (i = 0; i < ITERATIONS * 10; i++) {
+        if (pass == 0) {
+          for (j = 0; j < rows.hitObjects.count; j++) {
+            histogram[(rows.hitObjects.elements[j].time / 4096) & 63]++;
+          }
+        } else {
+          for (j = 0; j < columns.hitObjectColumns.count; j++) {
+            histogram[(columns.hitObjectColumns.time[j] / 4096) & 63]++;
+          }
+        }
+      }
+      double us =
+          (double)(clock() - begin) / CLOCKS_PER_SEC * 1e6 / (ITERATIONS * 10);
+      if (best[pass] < 0.0 || us < best[pass]) best[pass] = us;
+    }
+  }
+  printf("%-8s %-24s %10.2f us/scan\n", "scan-aos", path, best[0]);
+  printf("%-8s %-24s %10.2f us/scan\n", "scan-soa", path, best[1]);
+  osup_beatmap_free(&rows);
+  osup_beatmap_free(&columns);
+}
+
+static osup_bool load_compact(osup_bm* map, const char* path) {
+  return osup_beatmap_load(map, path,
+                           OSUP_PARSE_HIT_OBJECTS | OSUP_PARSE_COMPACT_HIT_OBJECTS);
+}
+
+/* a map with only [HitObjects], mostly circles like a real one: one slider
+ * every 5 objects, one spinner every 50 and one custom hit sample every 10 */
+static char* make_synthetic_map(size_t objects) {
+  char* input = malloc(objects * 64 + 64);
+  char* it = input;
+  size_t i;
+  if (!input) return NULL;
+  it += sprintf(it, "osu file format v14\n\n[HitObjects]\n");
+  for (i = 0; i < objects; i++) {
+    int time = (int)(i * 100);
+    if (i % 50 == 49) {
+      it += sprintf(it, "256,192,%d,12,0,%d,0:0:0:0:\n", time, time + 50);
+    } else if (i % 5 == 4) {
+      it += sprintf(it, "100,100,%d,2,0,B|200:200|300:100,1,140\n", time);
+    } else if (i % 10 == 9) {
+      it += sprintf(it, "%d,%d,%d,1,2,1:2:0:70:\n", (int)(i % 512),
+                    (int)(i % 384), time);
+    } else {
+      it += sprintf(it, "%d,%d,%d,1,0,0:0:0:0:\n", (int)(i % 512),
+                    (int)(i % 384), time);
+    }
+  }
+  return input;
+}
+
+/* clock() adds up the time of every thread, the threaded loader needs the
+ * wall clock */
+static double wall_seconds() {
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void bench_threaded(const char* name, const char* input,
+                           size_t maxThreads) {
+  double single = -1.0;
+  size_t threads;
+  for (threads = 1; threads <= maxThreads; threads++) {
+    double best = -1.0;
+    int round, i;
+    for (round = 0; round < ROUNDS; round++) {
+      double begin = wall_seconds();
+      for (i = 0; i < 5; i++) {
+        osup_bm map = {0};
+        if (!osup_beatmap_load_string_threaded(&map, input, OSUP_PARSE_ALL,
+                                               threads)) {
+          fprintf(stderr, "threaded: failed to load %s\n", name);
+          return;
+        }
+        osup_beatmap_free(&map);
+      }
+      double us = (wall_seconds() - begin) * 1e6 / 5;
+      if (best < 0.0 || us < best) best = us;
+    }
+    if (single < 0.0) single = best;
+    printf("threads  %-24s %2zu %10.1f us/load %5.2fx\n", name, threads, best,
+           single / best);
+  }
+}
+
+/* bytes per object owned by the object array and by the compact list, the
+ * slider curve points and edge arrays are the same for both and left out */
+static void print_hit_object_memory(const char* name, const char* input) {
+  osup_bm rows = {0};
+  osup_bm compact = {0};
+  const osup_bm_compact_hitobjects* list = &compact.compactHitObjects;
+  if (!osup_beatmap_load_string(&rows, input, OSUP_PARSE_HIT_OBJECTS) ||
+      !osup_beatmap_load_string(&compact, input,
+                                OSUP_PARSE_HIT_OBJECTS |
+                                    OSUP_PARSE_COMPACT_HIT_OBJECTS) ||
+      !list->count) {
+    osup_beatmap_free(&rows);
+    osup_beatmap_free(&compact);
+    return;
+  }
+  size_t compactBytes = list->count * sizeof(osup_compact_hitobject) +
+                        list->sliders.count * sizeof(osup_slider_params) +
+                        list->endTimes.count * sizeof(osup_int) +
+                        list->hitSamples.count * sizeof(osup_hitsample_entry);
+  printf("%-8s %-24s %8zu objects %6.1f B/obj array %6.1f B/obj compact\n",
+         "memory", name, list->count, (double)sizeof(osup_hitobject),
+         (double)compactBytes / list->count);
+  osup_beatmap_free(&rows);
+  osup_beatmap_free(&compact);
+}
+
+/* a replay analyzer that only looks at the first 100 objects */
+static osup_bool iterate_first_objects(osup_bm* map, const char* path) {
+  osup_mapped_file f;
+  osup_hitobject_iter iter;
+  const osup_hitobject* obj;
+  int count = 0;
+  (void)map;
+  if (!osup_map_file(path, &f)) return osup_false;
+  osup_hitobject_iter_begin(&iter, f.data);
+  while (count < 100 && (obj = osup_hitobject_iter_next(&iter))) {
+    histogram[(obj->time / 4096) & 63]++;
+    count++;
+  }
+  osup_hitobject_iter_end(&iter);
+  osup_unmap_file(&f);
+  return !iter.failed;
+}
+
+static osup_bool load_stream(osup_bm* map, const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return osup_false;
+  osup_bool ret = osup_beatmap_load_stream(map, f, OSUP_PARSE_ALL);
+  fclose(f);
+  return ret;
+}
+
+/* binary snapshots, written once from the text file */
+static const char* snapshotPath = "bm_bench.osub";
+static char* snapshot = NULL;
+static size_t snapshotSize = 0;
+
+static osup_bool write_snapshot(const char* path) {
+  osup_bm map = {0};
+  osup_bool ok = osup_beatmap_load(&map, path, OSUP_PARSE_ALL) &&
+                 osup_beatmap_save_binary(&map, snapshotPath) &&
+                 osup_beatmap_save_binary_buffer(&map, &snapshot,
+                                                 &snapshotSize);
+  osup_beatmap_free(&map);
+  return ok;
+}
+
+static osup_bool load_binary(osup_bm* map, const char* path) {
+  (void)path;
+  return osup_beatmap_load_binary(map, snapshotPath);
+}
+
+static osup_bool load_binary_buffer(osup_bm* map, const char* path) {
+  (void)path;
+  return osup_beatmap_load_binary_buffer(map, snapshot, snapshotSize);
+}
+
+/* the machine may be busy, so report the best of a few rounds */
+static double bench(const char* name, load_fn fn, const char* path) {
+  double best = -1.0;
+  int round, i;
+  for (round = 0; round < ROUNDS; round++) {
+    clock_t begin = clock();
+    for (i = 0; i < ITERATIONS; i++) {
+      osup_bm map = {0};
+      if (!fn(&map, path)) {
+        fprintf(stderr, "%s: failed to load %s\n", name, path);
+        return -1.0;
+      }
+      osup_beatmap_free(&map);
+    }
+    double us = (double)(clock() - begin) / CLOCKS_PER_SEC * 1e6 / ITERATIONS;
+    if (best < 0.0 || us < best) best = us;
+  }
+  printf("%-8s %-24s %10.1f us/load\n", name, path, best);
+  return best;
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "res/unshakable.osu";
+  double stream = bench("stream", load_stream, path);
+  double mapped = bench("mmap", load_mapped, path);
+  if (stream < 0.0 || mapped < 0.0) return 1;
+  printf("speedup: %.2fx\n", stream / mapped);
+  bench("arena", load_arena, path);
+  bench("chunked", load_chunked, path);
+  bench("hist-map", load_hit_objects, path);
+  bench("hist-vis", visit_hit_objects, path);
+  bench("iter-100", iterate_first_objects, path);
+  bench("cols", load_hit_object_columns, path);
+  bench_time_scan(path);
+  bench("compact", load_compact, path);
+  if (write_snapshot(path)) {
+    double binary = bench("bin-file", load_binary, path);
+    bench("bin-buf", load_binary_buffer, path);
+    printf("binary speedup: %.2fx (%zu bytes)\n", mapped / binary,
+           snapshotSize);
+    remove(snapshotPath);
+    free(snapshot);
+  }
+  {
+    osup_mapped_file f;
+    static const size_t sizes[] = {10000, 100000, 1000000};
+    size_t i;
+    if (osup_map_file(path, &f)) {
+      print_hit_object_memory(path, f.data);
+      osup_unmap_file(&f);
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      char name[32];
+      char* input = make_synthetic_map(sizes[i]);
+      if (!input) continue;
+      sprintf(name, "synthetic-%zu", sizes[i]);
+      print_hit_object_memory(name, input);
+      free(input);
+    }
+  }
+  {
+    char* input = make_synthetic_map(200000);
+    if (input) {
+      bench_threaded("synthetic-200000", input, 8);
+      free(input);
+    }
+  }
+  bench("idx-copy", load_index_copies, path);
+  bench("idx-view", load_index_views, path);
+  bench("brw-load", load_browse, path);
+  bench("brw-open", open_browse, path);
+  bench("brw-strm", stream_browse, path);
+  kvInput = make_kv_input(path);
+  if (kvInput) {
+    bench("kv-only", load_kv, path);
+    free(kvInput);
+  }
+
+#ifdef OSUP_BENCH_COUNT_ALLOCS
+  {
+    static const char* maps[] = {"res/unshakable.osu", "res/magma.osu"};
+    size_t i;
+    for (i = 0; i < sizeof(maps) / sizeof(maps[0]); i++) {
+      osup_bm map = {0};
+      allocCount = freeCount = 0;
+      load_mapped(&map, maps[i]);
+      osup_beatmap_free(&map);
+      printf("%-24s malloc: %6zu malloc/realloc, %6zu free\n", maps[i], allocCount,
+             freeCount);
+      allocCount = freeCount = 0;
+      load_arena(&map, maps[i]);
+      osup_beatmap_free(&map);
+      printf("%-24s arena:  %6zu malloc/realloc, %6zu free\n", maps[i], allocCount,
+             freeCount);
+      allocCount = freeCount = 0;
+      visit_hit_objects(&map, maps[i]);
+      printf("%-24s visit:  %6zu malloc/realloc, %6zu free\n", maps[i], allocCount,
+             freeCount);
+    }
+  }
+#endif
+
+  /* the same mmap load with every scanner the CPU supports */
+  static const char* levelNames[] = {"scalar", "swar", "sse2", "avx2"};
+  int level;
+  for (level = OSUP_SIMD_NONE; level <= OSUP_SIMD_AVX2; level++) {
+    if (osup_set_simd_level((osup_simd_level)level)) {
+      bench(levelNames[level], load_mapped, path);
+    }
+  }
+  return 0;
+}
@@ -1,12 +1,1030 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "osup/osup_beatmap.h"
 
-int main() {
+/* the mmap loader and the stream loader must produce the same map */
+void testLoadersAgree(const char* path) {
+  osup_bm mapped = {0};
+  osup_bm streamed = {0};
+  FILE* f = fopen(path, "r");
+  assert(f);
+  assert(osup_beatmap_load(&mapped, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_load_stream(&streamed, f, OSUP_PARSE_ALL));
+  fclose(f);
+
+  assert(!strcmp(mapped.metadata.title, streamed.metadata.title));
+  assert(mapped.metadata.beatmapID == streamed.metadata.beatmapID);
+  assert(mapped.difficulty.approachRate == streamed.difficulty.approachRate);
+  assert(mapped.colors.maxCombo == streamed.colors.maxCombo);
+  assert(mapped.events.count == streamed.events.count);
+  assert(mapped.timingPoints.count == streamed.timingPoints.count);
+  assert(mapped.hitObjects.count == streamed.hitObjects.count);
+  assert(mapped.hitObjects.count > 0);
+  assert(!memcmp(&mapped.hitObjects.elements[mapped.hitObjects.count - 1].time,
+                 &streamed.hitObjects.elements[streamed.hitObjects.count - 1]
+                      .time,
+                 sizeof(osup_int)));
+
+  osup_beatmap_free(&mapped);
+  osup_beatmap_free(&streamed);
+}
+
+/* arena maps must look exactly like malloc maps */
+void testArena(const char* path) {
+  osup_bm heap = {0};
+  osup_bm arena = {0};
+  size_t i;
+  assert(osup_beatmap_load(&heap, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_load(&arena, path, OSUP_PARSE_ALL | OSUP_PARSE_ARENA));
+  assert(arena.arena.blocks && !heap.arena.blocks);
+  assert(!strcmp(heap.metadata.title, arena.metadata.title));
+  assert(heap.metadata.tags.count == arena.metadata.tags.count);
+  assert(!strcmp(heap.metadata.tags.elements[heap.metadata.tags.count - 1],
+                 arena.metadata.tags.elements[arena.metadata.tags.count - 1]));
+  assert(heap.hitObjects.count == arena.hitObjects.count);
+  for (i = 0; i < heap.hitObjects.count; i++) {
+    osup_hitobject* a = &heap.hitObjects.elements[i];
+    osup_hitobject* b = &arena.hitObjects.elements[i];
+    assert(a->time == b->time && a->type == b->type);
+    if (OSUP_IS_SLIDER(a->type)) {
+      assert(a->slider.curvePoints.count == b->slider.curvePoints.count);
+      assert(!memcmp(a->slider.curvePoints.elements,
+                     b->slider.curvePoints.elements,
+                     a->slider.curvePoints.count * sizeof(osup_vec2)));
+    }
+  }
+  osup_beatmap_free(&heap);
+  osup_beatmap_free(&arena);
+  assert(!arena.arena.blocks);
+}
+
+/* a capacity hint is only a hint, wrong ones must still give the same map */
+void testCapacityHint(const char* path) {
+  osup_bm mapped = {0};
+  osup_bm hinted = {0};
+  osup_bm_capacity capacity;
+  FILE* f;
+  assert(osup_beatmap_load(&mapped, path, OSUP_PARSE_ALL));
+
+  capacity.events = mapped.events.count;
+  capacity.timingPoints = mapped.timingPoints.count;
+  capacity.hitObjects = mapped.hitObjects.count;
+  f = fopen(path, "r");
+  assert(f);
+  assert(osup_beatmap_load_stream_with_capacity(&hinted, f, OSUP_PARSE_ALL,
+                                                &capacity));
+  fclose(f);
+  assert(hinted.events.count == mapped.events.count);
+  assert(hinted.timingPoints.count == mapped.timingPoints.count);
+  assert(hinted.hitObjects.count == mapped.hitObjects.count);
+  osup_beatmap_free(&hinted);
+
+  capacity.events = 1;
+  capacity.timingPoints = 1;
+  capacity.hitObjects = 1;
+  f = fopen(path, "r");
+  assert(f);
+  assert(osup_beatmap_load_stream_with_capacity(&hinted, f, OSUP_PARSE_ALL,
+                                                &capacity));
+  fclose(f);
+  assert(hinted.hitObjects.count == mapped.hitObjects.count);
+  assert(hinted.hitObjects.elements[hinted.hitObjects.count - 1].time ==
+         mapped.hitObjects.elements[mapped.hitObjects.count - 1].time);
+  osup_beatmap_free(&hinted);
+  osup_beatmap_free(&mapped);
+}
+
+static osup_bool sliceEquals(osup_slice slice, const char* string) {
+  return string && (size_t)(slice.end - slice.begin) == strlen(string) &&
+         !memcmp(slice.begin, string, strlen(string));
+}
+
+/* string views must match the copies, and point into the input */
+void testStringViews(const char* path) {
+  osup_bm copied = {0};
+  osup_bm viewed = {0};
+  osup_bm fromString = {0};
+  osup_mapped_file f;
+  size_t i;
+  assert(osup_beatmap_load(&copied, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_load(&viewed, path,
+                           OSUP_PARSE_ALL | OSUP_PARSE_STRING_VIEWS));
+  assert(viewed.source.data);
+  assert(!viewed.metadata.title && !viewed.metadata.tags.elements);
+  assert(sliceEquals(viewed.metadata.titleView, copied.metadata.title));
+  assert(sliceEquals(copied.metadata.titleView, copied.metadata.title));
+  assert(sliceEquals(viewed.metadata.creatorView, copied.metadata.creator));
+  assert(sliceEquals(viewed.general.audioFilenameView,
+                     copied.general.audioFilename));
+  assert(viewed.metadata.tagsView.end - viewed.metadata.tagsView.begin ==
+         copied.metadata.tagsView.end - copied.metadata.tagsView.begin);
+  assert(!memcmp(viewed.metadata.tagsView.begin, copied.metadata.tagsView.begin,
+                 (size_t)(copied.metadata.tagsView.end -
+                          copied.metadata.tagsView.begin)));
+  /* splitting the copy doesn't touch the list the view points at */
+  assert(copied.metadata.tags.count > 1);
+  assert(memchr(copied.metadata.tagsView.begin, ' ',
+                (size_t)(copied.metadata.tagsView.end -
+                         copied.metadata.tagsView.begin)));
+  assert(sliceEquals(copied.metadata.tagsView,
+                     copied.metadata.tagsView.begin));
+  assert(viewed.events.count == copied.events.count);
+  for (i = 0; i < copied.events.count; i++) {
+    if (copied.events.elements[i].eventType == OSUP_EVENT_TYPE_BACKGROUND) {
+      assert(sliceEquals(viewed.events.elements[i].bg.filenameView,
+                         copied.events.elements[i].bg.filename));
+    }
+  }
+  assert(viewed.hitObjects.count == copied.hitObjects.count);
+
+  assert(osup_map_file(path, &f));
+  assert(osup_beatmap_load_string(&fromString, f.data,
+                                  OSUP_PARSE_ALL | OSUP_PARSE_STRING_VIEWS));
+  assert(fromString.metadata.titleView.begin >= f.data &&
+         fromString.metadata.titleView.end <= f.data + f.size);
+  assert(sliceEquals(fromString.metadata.titleView, copied.metadata.title));
+  osup_beatmap_free(&fromString);
+  osup_unmap_file(&f);
+
+  osup_beatmap_free(&copied);
+  osup_beatmap_free(&viewed);
+  assert(!viewed.source.data);
+}
+
+/* sections parsed on demand must give the same map as an eager load */
+void testLazySections(const char* path) {
+  osup_bm eager = {0};
+  osup_bm lazy = {0};
+  assert(osup_beatmap_load(&eager, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_open(&lazy, path, OSUP_PARSE_METADATA));
+  assert(lazy.directory.found & OSUP_PARSE_HIT_OBJECTS);
+  assert(lazy.directory.parsed == OSUP_PARSE_METADATA);
+  assert(!strcmp(lazy.metadata.title, eager.metadata.title));
+  assert(lazy.hitObjects.count == 0 && lazy.difficulty.approachRate == 0.0);
+
+  assert(osup_bm_parse_section(&lazy, OSUP_PARSE_HIT_OBJECTS));
+  assert(lazy.hitObjects.count == eager.hitObjects.count);
+  assert(lazy.hitObjects.elements[lazy.hitObjects.count - 1].time ==
+         eager.hitObjects.elements[eager.hitObjects.count - 1].time);
+  /* already parsed sections are skipped */
+  assert(osup_bm_parse_section(&lazy, OSUP_PARSE_HIT_OBJECTS));
+  assert(lazy.hitObjects.count == eager.hitObjects.count);
+
+  assert(osup_bm_parse_section(&lazy, OSUP_PARSE_ALL));
+  assert(lazy.difficulty.approachRate == eager.difficulty.approachRate);
+  assert(lazy.colors.maxCombo == eager.colors.maxCombo);
+  assert(lazy.events.count == eager.events.count);
+  assert(lazy.timingPoints.count == eager.timingPoints.count);
+  assert(lazy.editor.bookmarks.count == eager.editor.bookmarks.count);
+  assert(lazy.general.mode == eager.general.mode);
+
+  osup_beatmap_free(&eager);
+  osup_beatmap_free(&lazy);
+}
+
+/* once the requested sections are over, the loaders must stop reading */
+void testEarlyTermination(const char* path) {
+  osup_bm full = {0};
+  osup_bm partial = {0};
+  osup_bm streamed = {0};
+  osup_bitfield32 flags = OSUP_PARSE_METADATA | OSUP_PARSE_DIFFICULTY;
+  FILE* f;
+  long size;
+  assert(osup_beatmap_load(&full, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_load(&partial, path, flags));
+  assert(!strcmp(partial.metadata.title, full.metadata.title));
+  assert(partial.difficulty.approachRate == full.difficulty.approachRate);
+  assert(partial.hitObjects.count == 0);
+
+  f = fopen(path, "r");
+  assert(f);
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  rewind(f);
+  assert(osup_beatmap_load_stream(&streamed, f, flags));
+  assert(!strcmp(streamed.metadata.title, full.metadata.title));
+  assert(streamed.difficulty.sliderMultiplier ==
+         full.difficulty.sliderMultiplier);
+  /* the stream is left right after the header that closed [Difficulty] */
+  assert(ftell(f) < size && !feof(f));
+  fclose(f);
+
+  osup_beatmap_free(&full);
+  osup_beatmap_free(&partial);
+  osup_beatmap_free(&streamed);
+}
+
+/* only a known header on a line of its own starts a section */
+void testSectionHeaderLines() {
+  static const char* input = "osu file format v14\n"
+                             "\n"
+                             "[General]\n"
+                             "AudioFilename: audio.mp3\n"
+                             "[HitObjects] and more\n"
+                             "[Metadata] \r\n"
+                             "Title:title\n";
+  osup_bm map = {0};
+  assert(osup_beatmap_open_string(&map, input, OSUP_PARSE_METADATA));
+  assert(map.directory.found == (OSUP_PARSE_GENERAL | OSUP_PARSE_METADATA));
+  assert(!strcmp(map.metadata.title, "title"));
+  /* the bracketed line stays in the [General] body, where it is an error */
+  assert(!osup_bm_parse_section(&map, OSUP_PARSE_GENERAL));
+  osup_beatmap_free(&map);
+}
+
+/* all the ways people write key-value lines */
+void testKeyVariants() {
+  static const char* input =
+      "osu file format v14\r\n"
+      "\r\n"
+      "[General]\r\n"
+      "AudioFilename: audio.mp3\r\n"
+      "AudioLeadIn:500\r\n"
+      "Mode : 3\r\n"
+      "SampleSet: Soft\r\n"
+      "\r\n"
+      "[Metadata]\r\n"
+      "Title:Some Title\r\n"
+      "TitleUnicode: Unicode Title  \r\n"
+      "Artist :Someone\r\n"
+      "BeatmapSetID:-1\r\n"
+      "Tags:a b c\r\n"
+      "\r\n"
+      "[Difficulty]\r\n"
+      "HPDrainRate:5\r\n"
+      "SliderMultiplier: 1.4\r\n"
+      "\r\n"
+      "[Colours]\r\n"
+      "Combo1 : 255,0,0\r\n"
+      "Combo2:0,255,0\r\n"
+      "SliderBorder : 1,2,3\r\n";
+  osup_bm map = {0};
+  assert(osup_beatmap_load_string(&map, input, OSUP_PARSE_ALL));
+  assert(!strcmp(map.general.audioFilename, "audio.mp3"));
+  assert(map.general.audioLeadIn == 500);
+  assert(map.general.mode == OSUP_MODE_MANIA);
+  assert(map.general.sampleSet == OSUP_SAMPLESET_SOFT);
+  assert(!strcmp(map.metadata.title, "Some Title"));
+  assert(!strcmp(map.metadata.titleUnicode, "Unicode Title"));
+  assert(!strcmp(map.metadata.artist, "Someone"));
+  assert(map.metadata.beatmapSetID == -1);
+  assert(map.metadata.tags.count == 3);
+  assert(map.difficulty.hpDrainRate == 5.0);
+  assert(map.difficulty.sliderMultiplier == 1.4);
+  assert(map.colors.maxCombo == 1);
+  assert(map.colors.combos[1].green == 255);
+  assert(map.colors.sliderBorder.blue == 3);
+  osup_beatmap_free(&map);
+
+  /* unknown keys are still errors */
+  assert(!osup_beatmap_load_string(
+      &map, "osu file format v14\n[Difficulty]\nHPDrainRat:5\n",
+      OSUP_PARSE_ALL));
+  osup_beatmap_free(&map);
+}
+
+typedef struct {
+  const char* data;
+  size_t size;
+  size_t chunkSize;
+  size_t offset;
+} chunk_reader;
+
+static const char* nextChunk(void* ptr, size_t* size) {
+  chunk_reader* reader = ptr;
+  const char* chunk = reader->data + reader->offset;
+  *size = reader->size - reader->offset;
+  if (*size > reader->chunkSize) *size = reader->chunkSize;
+  reader->offset += *size;
+  return chunk;
+}
+
+/* lines split across chunks must not change the result */
+void testChunkedReader(const char* path, size_t chunkSize) {
+  osup_bm mapped = {0};
+  osup_bm chunked = {0};
+  osup_mapped_file f;
+  chunk_reader reader;
+  size_t i;
+  assert(osup_beatmap_load(&mapped, path, OSUP_PARSE_ALL));
+  assert(osup_map_file(path, &f));
+  reader.data = f.data;
+  reader.size = f.size;
+  reader.chunkSize = chunkSize;
+  reader.offset = 0;
+  assert(osup_beatmap_load_callbacks(&chunked, nextChunk, &reader,
+                                     OSUP_PARSE_ALL));
+  osup_unmap_file(&f);
+
+  assert(!strcmp(mapped.metadata.title, chunked.metadata.title));
+  assert(mapped.metadata.tags.count == chunked.metadata.tags.count);
+  assert(mapped.colors.maxCombo == chunked.colors.maxCombo);
+  assert(mapped.events.count == chunked.events.count);
+  assert(mapped.timingPoints.count == chunked.timingPoints.count);
+  assert(mapped.hitObjects.count == chunked.hitObjects.count);
+  for (i = 0; i < mapped.hitObjects.count; i++) {
+    osup_hitobject* a = &mapped.hitObjects.elements[i];
+    osup_hitobject* b = &chunked.hitObjects.elements[i];
+    assert(a->time == b->time && a->type == b->type && a->x == b->x);
+  }
+  osup_beatmap_free(&mapped);
+  osup_beatmap_free(&chunked);
+}
+
+/* feeding the file in uneven pieces must give the same map */
+void testPushParser(const char* path) {
+  osup_bm mapped = {0};
+  osup_bm pushed = {0};
+  osup_bm partial = {0};
+  osup_mapped_file f;
+  osup_bm_parser* parser;
+  size_t offset = 0, piece = 1;
+  assert(osup_beatmap_load(&mapped, path, OSUP_PARSE_ALL));
+  assert(osup_map_file(path, &f));
+
+  parser = osup_bm_parser_init(&pushed, OSUP_PARSE_ALL);
+  assert(parser);
+  while (offset < f.size) {
+    size_t length = f.size - offset < piece ? f.size - offset : piece;
+    assert(osup_bm_parser_feed(parser, f.data + offset, length));
+    offset += length;
+    piece = piece * 3 % 5000 + 1;
+  }
+  assert(osup_bm_parser_finish(parser));
+  assert(!strcmp(mapped.metadata.title, pushed.metadata.title));
+  assert(mapped.events.count == pushed.events.count);
+  assert(mapped.timingPoints.count == pushed.timingPoints.count);
+  assert(mapped.hitObjects.count == pushed.hitObjects.count);
+  assert(mapped.hitObjects.elements[mapped.hitObjects.count - 1].time ==
+         pushed.hitObjects.elements[pushed.hitObjects.count - 1].time);
+
+  /* every chunk in a buffer of exactly its size, with no slack byte after it
+   * (run with -fsanitize=address to catch reads past the end) */
+  osup_beatmap_free(&pushed);
+  parser = osup_bm_parser_init(&pushed, OSUP_PARSE_ALL);
+  offset = 0;
+  while (offset < f.size) {
+    const char* newline = memchr(f.data + offset, '\n', f.size - offset);
+    size_t length = newline ? (size_t)(newline + 1 - (f.data + offset))
+                            : f.size - offset;
+    char* chunk = malloc(length);
+    assert(chunk);
+    memcpy(chunk, f.data + offset, length);
+    assert(osup_bm_parser_feed(parser, chunk, length));
+    free(chunk);
+    offset += length;
+  }
+  assert(osup_bm_parser_finish(parser));
+  assert(mapped.hitObjects.count == pushed.hitObjects.count);
+
+  /* the parser says when the rest of the input is not needed */
+  parser = osup_bm_parser_init(&partial, OSUP_PARSE_METADATA);
+  offset = 0;
+  while (offset < f.size && !osup_bm_parser_is_done(parser)) {
+    size_t length = f.size - offset < 100 ? f.size - offset : 100;
+    assert(osup_bm_parser_feed(parser, f.data + offset, length));
+    offset += length;
+  }
+  assert(osup_bm_parser_finish(parser));
+  assert(offset < f.size);
+  assert(!strcmp(mapped.metadata.title, partial.metadata.title));
+
+  /* garbage is rejected, and keeps being rejected */
+  parser = osup_bm_parser_init(&partial, OSUP_PARSE_ALL);
+  assert(!osup_bm_parser_feed(parser, "not a beatmap\n", 14));
+  assert(!osup_bm_parser_feed(parser, "osu file format v14\n", 20));
+  assert(!osup_bm_parser_finish(parser));
+
+  osup_unmap_file(&f);
+  osup_beatmap_free(&mapped);
+  osup_beatmap_free(&pushed);
+  osup_beatmap_free(&partial);
+}
+
+typedef struct {
+  size_t kvLines;
+  size_t events;
+  size_t timingPoints;
+  size_t hitObjects;
+  size_t curvePoints;
+  osup_int lastTime;
+  char title[64];
+  size_t stopAfter;
+} visit_stats;
+
+static osup_bool countKv(void* userData, osup_bitfield32 section,
+                         osup_slice key, osup_slice value) {
+  visit_stats* stats = userData;
+  stats->kvLines++;
+  if (section == OSUP_PARSE_METADATA && key.end - key.begin == 5 &&
+      !memcmp(key.begin, "Title", 5)) {
+    size_t length = (size_t)(value.end - value.begin);
+    if (length > sizeof(stats->title) - 1) length = sizeof(stats->title) - 1;
+    memcpy(stats->title, value.begin, length);
+    stats->title[length] = '\0';
+  }
+  return osup_true;
+}
+
+static osup_bool countEvent(void* userData, const osup_event* event) {
+  (void)event;
+  ((visit_stats*)userData)->events++;
+  return osup_true;
+}
+
+static osup_bool countTimingPoint(void* userData,
+                                  const osup_timingpoint* timingPoint) {
+  (void)timingPoint;
+  ((visit_stats*)userData)->timingPoints++;
+  return osup_true;
+}
+
+static osup_bool countHitObject(void* userData,
+                                const osup_hitobject* hitObject) {
+  visit_stats* stats = userData;
+  stats->hitObjects++;
+  stats->lastTime = hitObject->time;
+  if (OSUP_IS_SLIDER(hitObject->type)) {
+    stats->curvePoints += hitObject->slider.curvePoints.count;
+  }
+  return stats->hitObjects != stats->stopAfter;
+}
+
+/* the visitor must see exactly what ends up in the map */
+void testVisitor(const char* path) {
+  osup_bm map = {0};
+  osup_bm_visitor visitor;
+  visit_stats stats;
+  size_t i, curvePoints = 0;
+  assert(osup_beatmap_load(&map, path, OSUP_PARSE_ALL));
+  for (i = 0; i < map.hitObjects.count; i++) {
+    if (OSUP_IS_SLIDER(map.hitObjects.elements[i].type)) {
+      curvePoints += map.hitObjects.elements[i].slider.curvePoints.count;
+    }
+  }
+
+  memset(&stats, 0, sizeof(stats));
+  memset(&visitor, 0, sizeof(visitor));
+  visitor.userData = &stats;
+  visitor.on_kv = countKv;
+  visitor.on_event = countEvent;
+  visitor.on_timing_point = countTimingPoint;
+  visitor.on_hit_object = countHitObject;
+  assert(osup_beatmap_visit(path, &visitor, OSUP_PARSE_ALL));
+  assert(stats.kvLines > 0);
+  assert(!strcmp(stats.title, map.metadata.title));
+  assert(stats.events == map.events.count);
+  assert(stats.timingPoints == map.timingPoints.count);
+  assert(stats.hitObjects == map.hitObjects.count);
+  assert(stats.curvePoints == curvePoints);
+  assert(stats.lastTime ==
+         map.hitObjects.elements[map.hitObjects.count - 1].time);
+
+  /* returning osup_false stops the visit */
+  memset(&stats, 0, sizeof(stats));
+  stats.stopAfter = 10;
+  assert(osup_beatmap_visit(path, &visitor, OSUP_PARSE_HIT_OBJECTS));
+  assert(stats.hitObjects == 10 && stats.kvLines == 0);
+  osup_beatmap_free(&map);
+}
+
+/* the iterator must walk the same objects as a full load */
+void testHitObjectIter(const char* path) {
+  osup_bm map = {0};
+  osup_mapped_file f;
+  osup_hitobject_iter iter;
+  const osup_hitobject* obj;
+  size_t i = 0;
+  assert(osup_beatmap_load(&map, path, OSUP_PARSE_ALL));
+  assert(osup_map_file(path, &f));
+  assert(osup_hitobject_iter_begin(&iter, f.data));
+  while ((obj = osup_hitobject_iter_next(&iter))) {
+    osup_hitobject* expected = &map.hitObjects.elements[i++];
+    assert(obj->time == expected->time && obj->type == expected->type);
+    assert(obj->x == expected->x && obj->y == expected->y);
+    if (OSUP_IS_SLIDER(obj->type)) {
+      assert(obj->slider.curvePoints.count ==
+             expected->slider.curvePoints.count);
+      assert(!memcmp(obj->slider.curvePoints.elements,
+                     expected->slider.curvePoints.elements,
+                     obj->slider.curvePoints.count * sizeof(osup_vec2)));
+    }
+  }
+  assert(!iter.failed);
+  assert(i == map.hitObjects.count);
+  osup_hitobject_iter_end(&iter);
+
+  /* stopping early is fine */
+  assert(osup_hitobject_iter_begin(&iter, f.data));
+  assert(osup_hitobject_iter_next(&iter)->time ==
+         map.hitObjects.elements[0].time);
+  osup_hitobject_iter_end(&iter);
+
+  osup_unmap_file(&f);
+  osup_beatmap_free(&map);
+}
+
+/* a default hit sample in the side tables has the empty filename the object
+ * array gets from "0:0:0:0:" (or no filename if the hit sample is left out) */
+static void checkSameFilename(const osup_hitsample* h,
+                              const osup_hitsample* expected) {
+  const char* filename = expected->filename ? expected->filename : "";
+  assert(h->filename && !strcmp(h->filename, filename));
+  assert(sliceEquals(h->filenameView, filename));
+}
+
+static void checkColumns(const osup_bm* rows, const osup_bm* map) {
+  const osup_bm_hitobject_columns* columns = &map->hitObjectColumns;
+  size_t i, hitSample = 0;
+  assert(columns->count == rows->hitObjects.count);
+  for (i = 0; i < columns->count; i++) {
+    const osup_hitobject* expected = &rows->hitObjects.elements[i];
+    assert(columns->x[i] == expected->x && columns->y[i] == expected->y);
+    assert(columns->time[i] == expected->time);
+    assert(columns->type[i] == expected->type);
+    assert(columns->hitSound[i] == expected->hitSound);
+    if (OSUP_IS_SLIDER(expected->type)) {
+      const osup_slider_params* slider =
+          &columns->sliders.elements[columns->payload[i]];
+      assert(slider->slides == expected->slider.slides);
+      assert(slider->curvePoints.count == expected->slider.curvePoints.count);
+      assert(!memcmp(slider->curvePoints.elements,
+                     expected->slider.curvePoints.elements,
+                     slider->curvePoints.count * sizeof(osup_vec2)));
+    } else if (OSUP_IS_SPINNER(expected->type) ||
+               OSUP_IS_MANIA_HOLD(expected->type)) {
+      assert(columns->endTimes.elements[columns->payload[i]] ==
+             expected->spinner.endTime);
+    } else {
+      assert(columns->payload[i] == OSUP_NO_PAYLOAD);
+    }
+    assert(osup_hitobject_column_hitsample(columns, i)->volume ==
+           expected->hitSample.volume);
+    checkSameFilename(osup_hitobject_column_hitsample(columns, i),
+                      &expected->hitSample);
+    if (hitSample < columns->hitSamples.count &&
+        columns->hitSamples.elements[hitSample].object == i) {
+      assert(columns->hitSamples.elements[hitSample].hitSample.volume ==
+             expected->hitSample.volume);
+      hitSample++;
+    }
+  }
+  assert(hitSample == columns->hitSamples.count);
+}
+
+/* columns parsed directly or converted afterwards match the object array */
+void testHitObjectColumns(const char* path) {
+  osup_bm rows = {0};
+  osup_bm parsed = {0};
+  osup_bm converted = {0};
+  osup_bm arena = {0};
+  assert(osup_beatmap_load(&rows, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_load(&parsed, path,
+                           OSUP_PARSE_ALL | OSUP_PARSE_HIT_OBJECT_COLUMNS));
+  assert(!parsed.hitObjects.count && !parsed.hitObjects.elements);
+  checkColumns(&rows, &parsed);
+
+  assert(osup_beatmap_load(&converted, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_to_hitobject_columns(&converted));
+  assert(!converted.hitObjects.count && !converted.hitObjects.elements);
+  checkColumns(&rows, &converted);
+  /* only once */
+  assert(!osup_beatmap_to_hitobject_columns(&converted));
+
+  assert(osup_beatmap_load(&arena, path, OSUP_PARSE_ALL | OSUP_PARSE_ARENA));
+  assert(osup_beatmap_to_hitobject_columns(&arena));
+  checkColumns(&rows, &arena);
+
+  osup_beatmap_free(&rows);
+  osup_beatmap_free(&parsed);
+  osup_beatmap_free(&converted);
+  osup_beatmap_free(&arena);
+}
+
+static void checkCompact(const osup_bm* rows, const osup_bm* map) {
+  const osup_bm_compact_hitobjects* list = &map->compactHitObjects;
+  size_t i;
+  assert(list->count == rows->hitObjects.count);
+  for (i = 0; i < list->count; i++) {
+    const osup_hitobject* expected = &rows->hitObjects.elements[i];
+    const osup_slider_params* slider = osup_compact_hitobject_slider(list, i);
+    osup_hitobject obj;
+    osup_compact_hitobject_expand(list, i, &obj);
+    assert(obj.x == expected->x && obj.y == expected->y);
+    assert(obj.time == expected->time && obj.type == expected->type);
+    assert(obj.hitSound == expected->hitSound);
+    assert(obj.hitSample.volume == expected->hitSample.volume);
+    assert(osup_compact_hitobject_hitsample(list, i)->normalSet ==
+           expected->hitSample.normalSet);
+    checkSameFilename(osup_compact_hitobject_hitsample(list, i),
+                      &expected->hitSample);
+    if (OSUP_IS_SLIDER(expected->type)) {
+      assert(slider && slider->slides == expected->slider.slides);
+      assert(obj.slider.curvePoints.count ==
+             expected->slider.curvePoints.count);
+      assert(!memcmp(obj.slider.curvePoints.elements,
+                     expected->slider.curvePoints.elements,
+                     obj.slider.curvePoints.count * sizeof(osup_vec2)));
+      assert(osup_compact_hitobject_end_time(list, i) == expected->time);
+    } else if (OSUP_IS_SPINNER(expected->type) ||
+               OSUP_IS_MANIA_HOLD(expected->type)) {
+      assert(!slider);
+      assert(osup_compact_hitobject_end_time(list, i) ==
+             expected->spinner.endTime);
+    } else {
+      assert(!slider);
+      assert(osup_compact_hitobject_end_time(list, i) == expected->time);
+    }
+  }
+}
+
+/* compact objects parsed directly or converted afterwards match the object
+ * array */
+void testCompactHitObjects(const char* path) {
+  osup_bm rows = {0};
+  osup_bm parsed = {0};
+  osup_bm converted = {0};
+  assert(sizeof(osup_compact_hitobject) <= 24);
+  assert(osup_beatmap_load(&rows, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_load(&parsed, path,
+                           OSUP_PARSE_ALL | OSUP_PARSE_COMPACT_HIT_OBJECTS));
+  assert(!parsed.hitObjects.count && !parsed.hitObjects.elements);
+  checkCompact(&rows, &parsed);
+
+  assert(osup_beatmap_load(&converted, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_to_compact_hitobjects(&converted));
+  assert(!converted.hitObjects.count);
+  checkCompact(&rows, &converted);
+  assert(!osup_beatmap_to_compact_hitobjects(&converted));
+
+  osup_beatmap_free(&rows);
+  osup_beatmap_free(&parsed);
+  osup_beatmap_free(&converted);
+}
+
+/* big enough to be split into chunks */
+static char* makeLargeMap(size_t objects) {
+  char* input = malloc(objects * 96 + 128);
+  char* it = input;
+  size_t i;
+  it += sprintf(it, "osu file format v14\n\n[Metadata]\nTitle:large\n\n");
+  it += sprintf(it, "[TimingPoints]\n");
+  for (i = 0; i < objects / 4; i++) {
+    it += sprintf(it, "%d,%s,4,2,1,60,%d,0\n", (int)(i * 400),
+                  i % 2 ? "-100" : "333.5", (int)(i % 2 == 0));
+  }
+  it += sprintf(it, "\n[HitObjects]\n");
+  for (i = 0; i < objects; i++) {
+    if (i % 7 == 3) {
+      it += sprintf(it, "100,100,%d,2,0,B|200:200|300:100,2,140\n",
+                    (int)(i * 100));
+    } else if (i % 50 == 49) {
+      it += sprintf(it, "256,192,%d,12,0,%d,0:0:0:0:\n", (int)(i * 100),
+                    (int)(i * 100 + 50));
+    } else {
+      it += sprintf(it, "%d,%d,%d,1,0,1:2:0:70:\n", (int)(i % 512),
+                    (int)(i % 384), (int)(i * 100));
+    }
+  }
+  return input;
+}
+
+/* the threaded loader joins the chunks into the same map */
+void testThreadedLoad(const char* input, size_t threadCount) {
+  osup_bm serial = {0};
+  osup_bm threaded = {0};
+  osup_bm columns = {0};
+  size_t i;
+  assert(osup_beatmap_load_string(&serial, input, OSUP_PARSE_ALL));
+  assert(osup_beatmap_load_string_threaded(&threaded, input, OSUP_PARSE_ALL,
+                                           threadCount));
+  assert(!threaded.directory.input);
+  assert(!strcmp(serial.metadata.title, threaded.metadata.title));
+  assert(serial.timingPoints.count == threaded.timingPoints.count);
+  for (i = 0; i < serial.timingPoints.count; i++) {
+    osup_timingpoint* expected = &serial.timingPoints.elements[i];
+    osup_timingpoint* timingPoint = &threaded.timingPoints.elements[i];
+    assert(timingPoint->time == expected->time);
+    /* some maps have NaN beat lengths */
+    assert(!memcmp(&timingPoint->beatLength, &expected->beatLength,
+                   sizeof(osup_decimal)));
+    assert(timingPoint->uninherited == expected->uninherited);
+  }
+  assert(serial.hitObjects.count == threaded.hitObjects.count);
+  for (i = 0; i < serial.hitObjects.count; i++) {
+    osup_hitobject* expected = &serial.hitObjects.elements[i];
+    osup_hitobject* obj = &threaded.hitObjects.elements[i];
+    assert(obj->time == expected->time && obj->type == expected->type);
+    assert(obj->x == expected->x && obj->y == expected->y);
+    assert(obj->hitSample.volume == expected->hitSample.volume);
+    if (OSUP_IS_SLIDER(obj->type)) {
+      assert(obj->slider.curvePoints.count ==
+             expected->slider.curvePoints.count);
+      assert(obj->slider.slides == expected->slider.slides);
+    }
+  }
+
+  assert(osup_beatmap_load_string_threaded(
+      &columns, input, OSUP_PARSE_ALL | OSUP_PARSE_HIT_OBJECT_COLUMNS,
+      threadCount));
+  checkColumns(&serial, &columns);
+
+  osup_beatmap_free(&serial);
+  osup_beatmap_free(&threaded);
+  osup_beatmap_free(&columns);
+}
+
+/* big sections with comments only have no elements to join */
+void testThreadedEmptySections() {
+  const char* header = "osu file format v14\n\n[TimingPoints]\n";
+  const char* comment = "// a comment long enough to fill a few chunks\n";
+  size_t lines = 4 * 1024, i;
+  char* input = malloc(strlen(header) + 2 * lines * strlen(comment) + 32);
+  char* it = input;
+  osup_bm map = {0};
+  assert(input);
+  it += sprintf(it, "%s", header);
+  for (i = 0; i < lines; i++) it += sprintf(it, "%s", comment);
+  it += sprintf(it, "\n[HitObjects]\n");
+  for (i = 0; i < lines; i++) it += sprintf(it, "%s", comment);
+  assert(osup_beatmap_load_string_threaded(&map, input, OSUP_PARSE_ALL, 4));
+  assert(!map.timingPoints.count && !map.hitObjects.count);
+  osup_beatmap_free(&map);
+  free(input);
+}
+
+/* every file gets its own result, failures don't affect the others */
+#ifndef OSUP_NO_LOGGING
+static void countErrors(const char* err, void* ptr) {
+  (void)err;
+  (*(size_t*)ptr)++;
+}
+#endif
+
+void testBatchLoad(size_t threadCount) {
+  static const char* paths[] = {"res/unshakable.osu", "res/missing.osu",
+                                "res/magma.osu", "res/unshakable.osu",
+                                "res/magma.osu"};
+  const size_t count = sizeof(paths) / sizeof(paths[0]);
+  osup_bm_batch_result results[sizeof(paths) / sizeof(paths[0])];
+  osup_bm expected = {0};
+  size_t i, usedThreads;
+#ifndef OSUP_NO_LOGGING
+  size_t errors = 0;
+  void* ptr;
+  osup_set_thread_error_callback(countErrors, &errors);
+#endif
+  assert(osup_batch_load(paths, 0, OSUP_PARSE_ALL, NULL, threadCount, NULL) ==
+         0);
+  assert(osup_batch_load(paths, count, OSUP_PARSE_ALL, results, threadCount,
+                         &usedThreads) == count - 1);
+  assert(usedThreads >= 1 && usedThreads <= threadCount);
+  assert(!results[1].ok && results[1].size == 0);
+#ifndef OSUP_NO_LOGGING
+  assert(strstr(results[1].error, "res/missing.osu"));
+  /* the caller's own callback is still there, and got none of the errors */
+  assert(osup_get_thread_error_callback(&ptr) == countErrors &&
+         ptr == &errors && errors == 0);
+  osup_set_thread_error_callback(NULL, NULL);
+#endif
+  for (i = 0; i < count; i++) {
+    if (i == 1) continue;
+    assert(results[i].ok && results[i].size > 0);
+    assert(osup_beatmap_load(&expected, paths[i], OSUP_PARSE_ALL));
+    assert(!strcmp(results[i].map.metadata.title, expected.metadata.title));
+    assert(results[i].map.hitObjects.count == expected.hitObjects.count);
+    osup_beatmap_free(&expected);
+  }
+  for (i = 0; i < count; i++) {
+    osup_beatmap_free(&results[i].map);
+  }
+}
+
+static void checkSameString(const char* a, const char* b) {
+  assert((!a && !b) || (a && b && !strcmp(a, b)));
+}
+
+static void checkSameMap(const osup_bm* expected, const osup_bm* map) {
+  size_t i;
+  checkSameString(expected->general.audioFilename, map->general.audioFilename);
+  assert(sliceEquals(map->general.audioFilenameView,
+                     expected->general.audioFilename));
+  assert(expected->general.previewTime == map->general.previewTime);
+  assert(expected->editor.bookmarks.count == map->editor.bookmarks.count);
+  assert(!expected->editor.bookmarks.count ||
+         !memcmp(expected->editor.bookmarks.elements,
+                 map->editor.bookmarks.elements,
+                 map->editor.bookmarks.count * sizeof(osup_int)));
+  checkSameString(expected->metadata.title, map->metadata.title);
+  checkSameString(expected->metadata.artistUnicode,
+                  map->metadata.artistUnicode);
+  checkSameString(expected->metadata.version, map->metadata.version);
+  assert(sliceEquals(map->metadata.creatorView, expected->metadata.creator));
+  assert(map->metadata.tagsView.end - map->metadata.tagsView.begin ==
+         expected->metadata.tagsView.end - expected->metadata.tagsView.begin);
+  assert(!memcmp(map->metadata.tagsView.begin,
+                 expected->metadata.tagsView.begin,
+                 (size_t)(expected->metadata.tagsView.end -
+                          expected->metadata.tagsView.begin)));
+  assert(expected->metadata.tags.count == map->metadata.tags.count);
+  for (i = 0; i < map->metadata.tags.count; i++) {
+    checkSameString(expected->metadata.tags.elements[i],
+                    map->metadata.tags.elements[i]);
+  }
+  assert(!memcmp(&expected->difficulty, &map->difficulty,
+                 sizeof(osup_bm_difficulty)));
+  assert(!memcmp(&expected->colors, &map->colors, sizeof(osup_bm_colors)));
+  assert(expected->events.count == map->events.count);
+  for (i = 0; i < map->events.count; i++) {
+    const osup_event* event = &map->events.elements[i];
+    assert(event->eventType == expected->events.elements[i].eventType);
+    assert(event->startTime == expected->events.elements[i].startTime);
+    if (event->eventType != OSUP_EVENT_TYPE_BREAK) {
+      checkSameString(expected->events.elements[i].bg.filename,
+                      event->bg.filename);
+    }
+  }
+  /* the elements are copied as they are, padding and NaNs included */
+  assert(expected->timingPoints.count == map->timingPoints.count);
+  assert(!memcmp(expected->timingPoints.elements, map->timingPoints.elements,
+                 map->timingPoints.count * sizeof(osup_timingpoint)));
+  assert(expected->hitObjects.count == map->hitObjects.count);
+  for (i = 0; i < map->hitObjects.count; i++) {
+    const osup_hitobject* a = &expected->hitObjects.elements[i];
+    const osup_hitobject* b = &map->hitObjects.elements[i];
+    assert(a->x == b->x && a->y == b->y && a->time == b->time);
+    assert(a->type == b->type && a->hitSound == b->hitSound);
+    assert(a->hitSample.volume == b->hitSample.volume);
+    checkSameString(a->hitSample.filename, b->hitSample.filename);
+    if (OSUP_IS_SLIDER(a->type)) {
+      assert(a->slider.slides == b->slider.slides);
+      assert(a->slider.length == b->slider.length);
+      assert(a->slider.curvePoints.count == b->slider.curvePoints.count);
+      assert(!memcmp(a->slider.curvePoints.elements,
+                     b->slider.curvePoints.elements,
+                     a->slider.curvePoints.count * sizeof(osup_vec2)));
+      assert(a->slider.edgeSounds.count == b->slider.edgeSounds.count);
+      assert(!a->slider.edgeSounds.count ||
+             !memcmp(a->slider.edgeSounds.elements,
+                     b->slider.edgeSounds.elements,
+                     a->slider.edgeSounds.count * sizeof(osup_int)));
+      assert(a->slider.edgeSets.count == b->slider.edgeSets.count);
+      assert(!a->slider.edgeSets.count ||
+             !memcmp(a->slider.edgeSets.elements,
+                     b->slider.edgeSets.elements,
+                     a->slider.edgeSets.count *
+                         sizeof(*a->slider.edgeSets.elements)));
+    } else if (OSUP_IS_SPINNER(a->type) || OSUP_IS_MANIA_HOLD(a->type)) {
+      assert(a->spinner.endTime == b->spinner.endTime);
+    }
+  }
+}
+
+/* a snapshot loads back into the same map, and broken ones are rejected */
+void testBinarySnapshot(const char* path, const char* dir) {
+  osup_bm text = {0};
+  osup_bm viewed = {0};
+  osup_bm loaded = {0};
+  osup_bm columns = {0};
+  char* data;
+  char* copy;
+  size_t size;
+  char file[1024];
+  FILE* f;
+  assert(osup_beatmap_load(&text, path, OSUP_PARSE_ALL));
+  assert(osup_beatmap_save_binary_buffer(&text, &data, &size));
+  assert(osup_beatmap_load_binary_buffer(&loaded, data, size));
+  assert(loaded.arena.blocks && !loaded.source.data);
+  checkSameMap(&text, &loaded);
+  /* the map owns its copy */
+  copy = malloc(size);
+  memcpy(copy, data, size);
+  memset(data, 0, size);
+  checkSameMap(&text, &loaded);
+  osup_beatmap_free(&loaded);
+
+  /* truncated, another version, an offset out of the blob */
+  assert(!osup_beatmap_load_binary_buffer(&loaded, copy, size - 1));
+  assert(!osup_beatmap_load_binary_buffer(&loaded, copy, 16));
+  memcpy(data, copy, size);
+  ((osup_bm_binary_header*)data)->version++;
+  assert(!osup_beatmap_load_binary_buffer(&loaded, data, size));
+  /* a size past the end of the buffer */
+  memcpy(data, copy, size);
+  ((osup_bm_binary_header*)data)->size = (uint64_t)-1;
+  assert(!osup_beatmap_load_binary_buffer(&loaded, data, size));
+  memcpy(data, copy, size);
+  ((osup_bm*)(data + sizeof(osup_bm_binary_header)))->hitObjects.elements =
+      (osup_hitobject*)(uintptr_t)(size - 8);
+  assert(!osup_beatmap_load_binary_buffer(&loaded, data, size));
+  assert(!loaded.arena.blocks);
+  free(data);
+
+  /* through a file */
+  sprintf(file, "%s/bm_test.osub", dir);
+  assert(osup_beatmap_save_binary(&text, file));
+  assert(osup_beatmap_load_binary(&loaded, file));
+  checkSameMap(&text, &loaded);
+  /* snapshots can be converted like arena maps */
+  assert(osup_beatmap_to_hitobject_columns(&loaded));
+  checkColumns(&text, &loaded);
+  assert(!osup_beatmap_save_binary(&loaded, file));
+  osup_beatmap_free(&loaded);
+  f = fopen(file, "wb");
+  assert(f && fwrite(copy, 1, size / 2, f) == size / 2);
+  fclose(f);
+  assert(!osup_beatmap_load_binary(&loaded, file));
+  /* the header must not ask for more than the file has */
+  ((osup_bm_binary_header*)copy)->size = (uint64_t)-1 / 2;
+  f = fopen(file, "wb");
+  assert(f && fwrite(copy, 1, size, f) == size);
+  fclose(f);
+  assert(!osup_beatmap_load_binary(&loaded, file));
+  remove(file);
+  free(copy);
+
+  /* views are turned into strings */
+  assert(osup_beatmap_load(&viewed, path,
+                           OSUP_PARSE_ALL | OSUP_PARSE_STRING_VIEWS));
+  assert(osup_beatmap_save_binary_buffer(&viewed, &data, &size));
+  osup_beatmap_free(&viewed);
+  assert(osup_beatmap_load_binary_buffer(&loaded, data, size));
+  free(data);
+  assert(!strcmp(loaded.metadata.title, text.metadata.title));
+  assert(loaded.metadata.tagsView.end - loaded.metadata.tagsView.begin ==
+         text.metadata.tagsView.end - text.metadata.tagsView.begin);
+  assert(!memcmp(loaded.metadata.tagsView.begin, text.metadata.tagsView.begin,
+                 (size_t)(text.metadata.tagsView.end -
+                          text.metadata.tagsView.begin)));
+  assert(!loaded.metadata.tags.elements);
+  assert(loaded.hitObjects.count == text.hitObjects.count);
+  osup_beatmap_free(&loaded);
+
+  assert(osup_beatmap_load(&columns, path,
+                           OSUP_PARSE_ALL | OSUP_PARSE_HIT_OBJECT_COLUMNS));
+  assert(!osup_beatmap_save_binary_buffer(&columns, &data, &size));
+  osup_beatmap_free(&columns);
+  osup_beatmap_free(&text);
+}
+
+int main(int argc, char** argv) {
+  const char* dir = argc > 1 ? argv[1] : ".";
   osup_bm map = {0};
 #ifndef OSUP_NO_LOGGING
   osup_set_default_error_callback();
 #endif
   osup_bool ret = osup_beatmap_load(&map, "res/unshakable.osu", OSUP_PARSE_ALL);
   osup_beatmap_free(&map);
+
+#ifndef OSUP_NO_LOGGING
+  /* storyboard lines are reported as errors, don't spam them */
+  osup_set_error_callback(NULL, NULL);
+#endif
+  testLoadersAgree("res/unshakable.osu");
+  testLoadersAgree("res/magma.osu");
+  testArena("res/unshakable.osu");
+  testArena("res/magma.osu");
+  testCapacityHint("res/unshakable.osu");
+  testCapacityHint("res/magma.osu");
+  testStringViews("res/unshakable.osu");
+  testStringViews("res/magma.osu");
+  testLazySections("res/unshakable.osu");
+  testLazySections("res/magma.osu");
+  testEarlyTermination("res/unshakable.osu");
+  testSectionHeaderLines();
+  testKeyVariants();
+  testChunkedReader("res/magma.osu", 1);
+  testChunkedReader("res/magma.osu", 61);
+  testChunkedReader("res/unshakable.osu", 4093);
+  testChunkedReader("res/unshakable.osu", (size_t)-1);
+  testPushParser("res/unshakable.osu");
+  testPushParser("res/magma.osu");
+  testVisitor("res/unshakable.osu");
+  testVisitor("res/magma.osu");
+  testHitObjectIter("res/unshakable.osu");
+  testHitObjectIter("res/magma.osu");
+  testHitObjectColumns("res/unshakable.osu");
+  testHitObjectColumns("res/magma.osu");
+  testCompactHitObjects("res/unshakable.osu");
+  testCompactHitObjects("res/magma.osu");
+  {
+    osup_mapped_file f;
+    char* large = makeLargeMap(20000);
+    assert(osup_map_file("res/unshakable.osu", &f));
+    testThreadedLoad(f.data, 4);
+    osup_unmap_file(&f);
+    testThreadedLoad(large, 1);
+    testThreadedLoad(large, 2);
+    testThreadedLoad(large, 7);
+    free(large);
+  }
+  testThreadedEmptySections();
+  testBatchLoad(1);
+  testBatchLoad(3);
+  testBinarySnapshot("res/unshakable.osu", dir);
+  testBinarySnapshot("res/magma.osu", dir);
   return !ret;
 }
-
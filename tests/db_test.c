@@ -0,0 +1,305 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osup/osup_db.h"
+#include "osup/osup_replay.h"
+
+/* the databases are written here the way the client does, for the three
+ * record layouts */
+typedef struct {
+  unsigned char* data;
+  size_t size;
+  size_t capacity;
+} buffer;
+
+static void put(buffer* b, const void* bytes, size_t size) {
+  if (b->size + size > b->capacity) {
+    b->capacity = (b->size + size) * 2;
+    b->data = realloc(b->data, b->capacity);
+    assert(b->data);
+  }
+  memcpy(b->data + b->size, bytes, size);
+  b->size += size;
+}
+
+static void putUint(buffer* b, uint64_t value, size_t size) {
+  unsigned char bytes[8];
+  size_t i;
+  for (i = 0; i < size; i++) bytes[i] = (unsigned char)(value >> (8 * i));
+  put(b, bytes, size);
+}
+
+static void putSingle(buffer* b, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  putUint(b, bits, 4);
+}
+
+static void putDouble(buffer* b, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  putUint(b, bits, 8);
+}
+
+static void putString(buffer* b, const char* string) {
+  size_t length;
+  if (!string) {
+    putUint(b, 0x00, 1);
+    return;
+  }
+  putUint(b, 0x0b, 1);
+  length = strlen(string);
+  do {
+    putUint(b, (length & 0x7f) | (length > 0x7f ? 0x80 : 0), 1);
+    length >>= 7;
+  } while (length);
+  put(b, string, strlen(string));
+}
+
+static char* title(size_t i) {
+  static char string[256];
+  /* long enough for a two-byte length every few records */
+  sprintf(string, "song %zu%s", i, i % 5 ? "" :
+          " (extended mix, with a title long enough to need a second byte for "
+          "its ULEB128 length, which most real titles don't but some do)");
+  return string;
+}
+
+static void putRecord(buffer* b, osup_int version, size_t i) {
+  buffer record = {0};
+  size_t mode, j;
+  char hash[33];
+  putString(&record, "artist");
+  putString(&record, i % 2 ? "artist unicode" : NULL);
+  putString(&record, title(i));
+  putString(&record, "");
+  putString(&record, "creator");
+  putString(&record, "Insane");
+  putString(&record, "audio.mp3");
+  sprintf(hash, "%032zx", i);
+  putString(&record, hash);
+  putString(&record, "map.osu");
+  putUint(&record, OSUP_DB_RANKED_RANKED, 1);
+  putUint(&record, 100 + i, 2);
+  putUint(&record, 50, 2);
+  putUint(&record, 2, 2);
+  putUint(&record, 637000000000000000ull + i, 8);
+  if (version < OSUP_DB_VERSION_FLOAT_DIFFICULTY) {
+    putUint(&record, 9, 1);
+    putUint(&record, 4, 1);
+    putUint(&record, 6, 1);
+    putUint(&record, 8, 1);
+  } else {
+    putSingle(&record, 9.3f);
+    putSingle(&record, 4.0f);
+    putSingle(&record, 6.5f);
+    putSingle(&record, 8.5f);
+  }
+  putDouble(&record, 1.8);
+  if (version >= OSUP_DB_VERSION_FLOAT_DIFFICULTY) {
+    for (mode = 0; mode < 4; mode++) {
+      size_t count = mode == 0 ? 2 : 0;
+      putUint(&record, count, 4);
+      for (j = 0; j < count; j++) {
+        putUint(&record, 0x08, 1);
+        putUint(&record, j ? OSUP_MOD_DOUBLE_TIME : 0, 4);
+        if (version >= OSUP_DB_VERSION_FLOAT_STAR_RATINGS) {
+          putUint(&record, 0x0c, 1);
+          putSingle(&record, j ? 7.25f : 5.5f);
+        } else {
+          putUint(&record, 0x0d, 1);
+          putDouble(&record, j ? 7.25 : 5.5);
+        }
+      }
+    }
+  }
+  putUint(&record, 180, 4);
+  putUint(&record, 200000, 4);
+  putUint(&record, 60000, 4);
+  putUint(&record, 2, 4);
+  putDouble(&record, 300.0);
+  putDouble(&record, 1200.0);
+  putUint(&record, 1, 1);
+  putDouble(&record, -50.0);
+  putDouble(&record, 30000.0);
+  putUint(&record, 0, 1);
+  putUint(&record, 1000 + i, 4);
+  putUint(&record, 500 + i / 4, 4);
+  putUint(&record, 0, 4);
+  putUint(&record, 0x09090909, 4);
+  putUint(&record, (uint16_t)-15, 2);
+  putSingle(&record, 0.7f);
+  putUint(&record, i % 4, 1);
+  putString(&record, "source");
+  putString(&record, "tag1 tag2");
+  putUint(&record, 0, 2);
+  putString(&record, NULL);
+  putUint(&record, 1, 1);
+  putUint(&record, 0, 8);
+  putUint(&record, 0, 1);
+  putString(&record, "folder");
+  putUint(&record, 0, 8);
+  putUint(&record, 0, 5);
+  if (version < OSUP_DB_VERSION_FLOAT_DIFFICULTY) putUint(&record, 0, 2);
+  putUint(&record, 0, 4);
+  putUint(&record, 20, 1);
+
+  if (version < OSUP_DB_VERSION_NO_ENTRY_SIZE) putUint(b, record.size, 4);
+  put(b, record.data, record.size);
+  free(record.data);
+}
+
+static buffer makeDb(osup_int version, size_t count) {
+  buffer b = {0};
+  size_t i;
+  putUint(&b, version, 4);
+  putUint(&b, count / 4, 4);
+  putUint(&b, 1, 1);
+  putUint(&b, 0, 8);
+  putString(&b, "player");
+  putUint(&b, count, 4);
+  for (i = 0; i < count; i++) putRecord(&b, version, i);
+  putUint(&b, 5, 4);
+  return b;
+}
+
+static osup_bool sliceEquals(osup_slice slice, const char* string) {
+  return slice.begin && (size_t)(slice.end - slice.begin) == strlen(string) &&
+         !memcmp(slice.begin, string, strlen(string));
+}
+
+static void checkRecords(const osup_db* db, osup_int version, size_t count) {
+  osup_db_record record;
+  osup_timingpoint timingPoint;
+  osup_decimal stars;
+  char hash[33];
+  size_t i;
+  assert(db->version == version && db->folderCount == (osup_int)count / 4);
+  assert(db->accountUnlocked && sliceEquals(db->playerName, "player"));
+  assert(db->permissions == 5);
+  assert(osup_db_count(db) == count);
+  /* out of order, they don't depend on each other */
+  for (i = count; i-- > 0;) {
+    assert(osup_db_get(db, i, &record));
+    assert(sliceEquals(record.metadata.artistView, "artist"));
+    assert(!record.metadata.artist && !record.metadata.tags.elements);
+    assert(!record.metadata.artistUnicodeView.begin == !(i % 2));
+    assert(sliceEquals(record.metadata.titleView, title(i)));
+    assert(record.metadata.titleUnicodeView.begin &&
+           record.metadata.titleUnicodeView.begin ==
+               record.metadata.titleUnicodeView.end);
+    assert(sliceEquals(record.metadata.versionView, "Insane"));
+    assert(sliceEquals(record.metadata.sourceView, "source"));
+    assert(sliceEquals(record.metadata.tagsView, "tag1 tag2"));
+    assert(record.metadata.beatmapID == (osup_int)(1000 + i));
+    assert(record.metadata.beatmapSetID == (osup_int)(500 + i / 4));
+    sprintf(hash, "%032zx", i);
+    assert(sliceEquals(record.hash, hash));
+    assert(sliceEquals(record.folderName, "folder"));
+    assert(!record.titleFont.begin);
+    assert(record.rankedStatus == OSUP_DB_RANKED_RANKED);
+    assert(record.hitCircleCount == (osup_int)(100 + i));
+    assert(record.lastModified == (osup_long)(637000000000000000ll + i));
+    if (version < OSUP_DB_VERSION_FLOAT_DIFFICULTY) {
+      assert(record.difficulty.approachRate == 9);
+      assert(record.difficulty.overallDifficulty == 8);
+      assert(!osup_db_star_rating(&record, OSUP_MODE_OSU, 0, &stars));
+    } else {
+      assert(record.difficulty.approachRate == 9.3f);
+      assert(record.difficulty.overallDifficulty == 8.5);
+      assert(osup_db_star_rating(&record, OSUP_MODE_OSU, 0, &stars) &&
+             stars == 5.5);
+      assert(osup_db_star_rating(&record, OSUP_MODE_OSU,
+                                 OSUP_MOD_DOUBLE_TIME, &stars) &&
+             stars == 7.25);
+      assert(!osup_db_star_rating(&record, OSUP_MODE_OSU, OSUP_MOD_EASY,
+                                  &stars));
+      assert(!osup_db_star_rating(&record, OSUP_MODE_TAIKO, 0, &stars));
+    }
+    assert(record.difficulty.circleSize == 4);
+    assert(record.difficulty.sliderMultiplier == 1.8);
+    assert(record.drainTime == 180 && record.totalTime == 200000);
+    assert(record.previewTime == 60000);
+    assert(record.timingPoints.count == 2);
+    assert(osup_db_timing_point(&record, 1, &timingPoint));
+    assert(timingPoint.time == 30000 && timingPoint.beatLength == -50.0);
+    assert(!timingPoint.uninherited);
+    assert(osup_db_timing_point(&record, 0, &timingPoint));
+    assert(timingPoint.time == 1200 && timingPoint.uninherited);
+    assert(!osup_db_timing_point(&record, 2, &timingPoint));
+    assert(record.grades[3] == 9);
+    assert(record.localOffset == -15);
+    assert(record.stackLeniency == 0.7f);
+    assert(record.mode == (osup_gamemode)(i % 4));
+    assert(record.unplayed && !record.osz2);
+    assert(record.maniaScrollSpeed == 20);
+  }
+  assert(!osup_db_get(db, count, &record));
+}
+
+void testVersion(osup_int version, size_t count) {
+  osup_db db;
+  buffer b = makeDb(version, count);
+  size_t size;
+  assert(osup_db_open_buffer(&db, b.data, b.size));
+  checkRecords(&db, version, count);
+  osup_db_close(&db);
+  /* truncated anywhere */
+  for (size = 0; size < b.size; size += b.size / 13 + 1) {
+    assert(!osup_db_open_buffer(&db, b.data, size));
+    assert(!db.offsets && osup_db_count(&db) == 0);
+  }
+  assert(!osup_db_open_buffer(&db, b.data, b.size - 1));
+  free(b.data);
+}
+
+/* with the size prefix, a damaged record doesn't hide the others */
+void testDamagedRecord() {
+  osup_db db;
+  osup_db_record record;
+  buffer b = makeDb(20191105, 3);
+  assert(osup_db_open_buffer(&db, b.data, b.size));
+  /* the first string marker of the second record */
+  b.data[db.offsets[1] + 4] = 0x42;
+  assert(osup_db_get(&db, 0, &record) && osup_db_get(&db, 2, &record));
+  assert(!osup_db_get(&db, 1, &record));
+  osup_db_close(&db);
+  free(b.data);
+}
+
+void testFile(const char* dir) {
+  osup_db db;
+  char path[1024];
+  buffer b = makeDb(20250107, 1000);
+  FILE* f;
+  sprintf(path, "%s/db_test.db", dir);
+  f = fopen(path, "wb");
+  assert(f && fwrite(b.data, 1, b.size, f) == b.size);
+  fclose(f);
+  free(b.data);
+  assert(osup_db_open(&db, path));
+  assert(db.file.data && db.data == (const uint8_t*)db.file.data);
+  checkRecords(&db, 20250107, 1000);
+  osup_db_close(&db);
+  assert(!db.file.data);
+  remove(path);
+  assert(!osup_db_open(&db, path));
+}
+
+int main(int argc, char** argv) {
+  const char* dir = argc > 1 ? argv[1] : ".";
+#ifndef OSUP_NO_LOGGING
+  /* the broken databases below are reported as errors, don't spam them */
+  osup_set_error_callback(NULL, NULL);
+#endif
+  testVersion(20250107, 50);
+  testVersion(20191106, 50);
+  testVersion(20191105, 50);
+  testVersion(20140608, 50);
+  testVersion(20250107, 0);
+  testDamagedRecord();
+  testFile(dir);
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osup/osup_index.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/time.h>
+#define HAS_UTIMES
+#endif
+
+/* run from the repository root, with a scratch directory as argv[1] */
+static char indexPath[1024];
+static char newIndexPath[1024];
+static char copyPath[1024];
+
+static void copyFile(const char* from, const char* to, const char* extra) {
+  osup_mapped_file f;
+  FILE* out = fopen(to, "wb");
+  assert(out && osup_map_file(from, &f));
+  assert(fwrite(f.data, 1, f.size, out) == f.size);
+  if (extra) fputs(extra, out);
+  fclose(out);
+  osup_unmap_file(&f);
+}
+
+static void setMtime(const char* path, long seconds) {
+#ifdef HAS_UTIMES
+  struct timeval times[2];
+  times[0].tv_sec = times[1].tv_sec = seconds;
+  times[0].tv_usec = times[1].tv_usec = 0;
+  assert(!utimes(path, times));
+#else
+  (void)path;
+  (void)seconds;
+#endif
+}
+
+/* the records hold what a full load would give */
+void testRecords(const osup_index* index, const char* path) {
+  osup_bm map = {0};
+  const osup_index_record* record = osup_index_find(index, path);
+  assert(record);
+  assert(osup_beatmap_load(&map, path, OSUP_PARSE_ALL));
+  assert(!strcmp(osup_index_string(index, record->path), path));
+  assert(!strcmp(osup_index_string(index, record->title), map.metadata.title));
+  assert(!strcmp(osup_index_string(index, record->version),
+                 map.metadata.version));
+  assert(!strcmp(osup_index_string(index, record->audioFilename),
+                 map.general.audioFilename));
+  assert(record->beatmapID == map.metadata.beatmapID);
+  assert(record->difficulty.approachRate == map.difficulty.approachRate);
+  assert(record->mode == (osup_int)map.general.mode);
+  osup_beatmap_free(&map);
+}
+
+/* rescan with paths, then swap the new index in */
+void rescan(osup_index* index, const char* const* paths, size_t count,
+            osup_index_stats* stats) {
+  assert(osup_index_update(index, paths, count, newIndexPath, 2, stats));
+  osup_index_close(index);
+  remove(indexPath);
+  assert(!rename(newIndexPath, indexPath));
+  assert(osup_index_open(index, indexPath));
+}
+
+int main(int argc, char** argv) {
+  const char* dir = argc > 1 ? argv[1] : ".";
+  const char* paths[3];
+  osup_index index;
+  osup_index_stats stats;
+  sprintf(indexPath, "%s/index_test.idx", dir);
+  sprintf(newIndexPath, "%s/index_test.idx.new", dir);
+  sprintf(copyPath, "%s/index_test.osu", dir);
+  copyFile("res/magma.osu", copyPath, NULL);
+  setMtime(copyPath, 1000000);
+  paths[0] = "res/unshakable.osu";
+  paths[1] = copyPath;
+  paths[2] = "res/missing.osu";
+
+  /* no index yet, everything is parsed */
+  remove(indexPath);
+  assert(!osup_index_open(&index, indexPath));
+  assert(osup_index_count(&index) == 0);
+  rescan(&index, paths, 3, &stats);
+  assert(stats.parsed == 2 && stats.failed == 1 && stats.reused == 0);
+  assert(osup_index_count(&index) == 2);
+  testRecords(&index, "res/unshakable.osu");
+  testRecords(&index, copyPath);
+  assert(!osup_index_find(&index, "res/missing.osu"));
+
+  /* nothing changed */
+  rescan(&index, paths, 2, &stats);
+  assert(stats.reused == 2 && stats.parsed == 0 && stats.rehashed == 0);
+  testRecords(&index, copyPath);
+
+#ifdef HAS_UTIMES
+  /* touched only */
+  setMtime(copyPath, 2000000);
+  rescan(&index, paths, 2, &stats);
+  assert(stats.reused == 1 && stats.rehashed == 1 && stats.parsed == 0);
+  assert(osup_index_find(&index, copyPath)->mtime == 2000000);
+  testRecords(&index, copyPath);
+#endif
+
+  /* changed */
+  copyFile("res/magma.osu", copyPath, "\n// changed\n");
+  rescan(&index, paths, 2, &stats);
+  assert(stats.reused == 1 && stats.parsed == 1);
+  testRecords(&index, copyPath);
+
+  /* not an index */
+  osup_index_close(&index);
+  assert(!osup_index_open(&index, copyPath));
+  assert(osup_index_count(&index) == 0);
+
+  remove(indexPath);
+  remove(copyPath);
+  return 0;
+}
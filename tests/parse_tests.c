@@ -1,4 +1,7 @@
 #include <assert.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "osup/osup_common.h"
@@ -8,6 +11,39 @@ void testInt(const char* str, osup_int expected) {
   assert(osup_parse_int(str, str + strlen(str), &v) && v == expected);
 }
 
+void testInvalidInt(const char* str) {
+  osup_int v;
+  assert(!osup_parse_int(str, str + strlen(str), &v));
+}
+
+/* parse a list like osup_bm_parse_hit_objects_line does */
+void testIntUntilNondigit(const char* str, osup_int expected,
+                          size_t expectedLength) {
+  osup_int v;
+  const char* it = str;
+  assert(osup_parse_int_until_nondigit_char(&it, &v) && v == expected &&
+         (size_t)(it - str) == expectedLength);
+}
+
+void fuzzInt() {
+  char buffer[32];
+  int round;
+  srand(42);
+  for (round = 0; round < 100000; round++) {
+    long long expected = ((long long)rand() << 16 ^ rand()) %
+                         (rand() % 2 ? 1000 : 4294967296ll);
+    if (rand() % 2) expected = -expected;
+    sprintf(buffer, "%lld", expected);
+    if (expected >= INT32_MIN && expected <= INT32_MAX) {
+      testInt(buffer, (osup_int)expected);
+      strcat(buffer, "|");
+      testIntUntilNondigit(buffer, (osup_int)expected, strlen(buffer) - 1);
+    } else {
+      testInvalidInt(buffer);
+    }
+  }
+}
+
 void testDecimal(const char* str, osup_decimal expected) {
   static const osup_decimal epsilon = 0.001;
   osup_decimal v;
@@ -15,15 +51,186 @@ void testDecimal(const char* str, osup_decimal expected) {
          v - expected < epsilon && expected - v < epsilon);
 }
 
+/* the result must be the correctly rounded double, same as strtod */
+void testDecimalExact(const char* str) {
+  osup_decimal v;
+  assert(osup_parse_decimal(str, str + strlen(str), &v) &&
+         v == strtod(str, NULL));
+}
+
+/* the slow path must not use the decimal point of the current locale */
+void testDecimalLocale() {
+  static const char* locales[] = {"de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8",
+                                  "fr_FR.utf8", "de_DE", "fr_FR"};
+  static const char* strs[] = {"149.99999542236328125", "1.5e-400",
+                               "0.30000000000000000000001"};
+  osup_decimal expected[sizeof(strs) / sizeof(strs[0])];
+  size_t i;
+  for (i = 0; i < sizeof(strs) / sizeof(strs[0]); i++) {
+    expected[i] = strtod(strs[i], NULL);
+  }
+  for (i = 0; i < sizeof(locales) / sizeof(locales[0]); i++) {
+    if (setlocale(LC_NUMERIC, locales[i])) break;
+  }
+  /* no locale with a decimal comma is installed */
+  if (i == sizeof(locales) / sizeof(locales[0])) return;
+  for (i = 0; i < sizeof(strs) / sizeof(strs[0]); i++) {
+    osup_decimal v;
+    assert(osup_parse_decimal(strs[i], strs[i] + strlen(strs[i]), &v) &&
+           v == expected[i]);
+  }
+  setlocale(LC_NUMERIC, "C");
+}
+
+void testInvalidDecimal(const char* str) {
+  osup_decimal v;
+  assert(!osup_parse_decimal(str, str + strlen(str), &v));
+}
+
+void fuzzDecimal() {
+  char buffer[64];
+  int round;
+  srand(1234);
+  for (round = 0; round < 200000; round++) {
+    char* it = buffer;
+    int digits = 1 + rand() % 24;
+    int point = rand() % (digits + 1);
+    int i;
+    if (rand() % 2) *(it++) = '-';
+    for (i = 0; i < digits; i++) {
+      if (i == point) *(it++) = '.';
+      /* lots of zeros and nines make the rounding harder */
+      switch (rand() % 4) {
+        case 0:
+          *(it++) = '0';
+          break;
+        case 1:
+          *(it++) = '9';
+          break;
+        default:
+          *(it++) = '0' + rand() % 10;
+      }
+    }
+    if (rand() % 4 == 0) {
+      it += sprintf(it, "e%d", rand() % 80 - 40);
+    }
+    *it = '\0';
+    testDecimalExact(buffer);
+  }
+}
+
 void testRGB(const char* str, uint8_t r, uint8_t g, uint8_t b) {
   osup_rgb v;
   assert(osup_parse_rgb(str, str + strlen(str), &v) && v.red == r &&
          v.green == g && v.blue == b);
 }
 
+/* reference implementations, the dispatched scanners must match them byte for
+ * byte */
+const char* referenceSplit(char delimiter, const char* it) {
+  while (*it != delimiter && !osup_is_line_terminator(*it)) ++it;
+  return it;
+}
+
+const char* referenceLastNonBlank(const char* line, const char** end) {
+  const char* it = line;
+  while (!osup_is_line_terminator(*it)) {
+    if (*it == ' ' || *it == '\t') {
+      ++it;
+    } else {
+      line = ++it;
+    }
+  }
+  *end = it;
+  return line;
+}
+
+void testScanners(osup_simd_level level) {
+  static const char alphabet[] = "0123456789 \t,|:\"\r\nab-.";
+  /* leave some room so every alignment is covered */
+  char buffer[256 + 64];
+  int round;
+  if (!osup_set_simd_level(level)) return;
+  srand(level);
+  for (round = 0; round < 2000; round++) {
+    size_t offset = rand() % 64;
+    size_t len = rand() % 256;
+    size_t i;
+    char* str = buffer + offset;
+    memset(buffer, 'x', sizeof(buffer));
+    for (i = 0; i < len; i++) {
+      /* make the special characters rare, so long runs are tested too */
+      str[i] = rand() % 8 ? 'a' + rand() % 26
+                          : alphabet[rand() % (sizeof(alphabet) - 1)];
+    }
+    str[len] = '\0';
+
+    for (i = 0; i <= len; i++) {
+      const char* begin = NULL;
+      const char* end = str + i - 1;
+      const char* special = str + i;
+      while (!osup_is_special_char(*special)) ++special;
+      assert(osup_find_special_char(str + i) == special);
+      assert(osup_find_line_terminator(str + i) ==
+             referenceSplit('\0', str + i));
+
+      if (osup_split_string_line_terminated(',', &begin, &end)) {
+        assert(begin == str + i && end == referenceSplit(',', str + i));
+      }
+
+      const char* line = str + i;
+      const char* expectedEnd;
+      const char* expectedLine = referenceLastNonBlank(line, &expectedEnd);
+      assert(osup_advance_to_last_nonblank_char(&line) == expectedEnd &&
+             line == expectedLine);
+    }
+  }
+}
+
+static void countPart(void* part) { (*(int*)part)++; }
+
+/* every part runs exactly once, whatever the thread count */
+void testPool(size_t threadCount) {
+  int parts[1000] = {0};
+  int round;
+  size_t i;
+  osup_pool* pool = osup_pool_create(threadCount);
+  assert(pool && osup_pool_thread_count(pool) >= 1);
+  for (round = 1; round <= 3; round++) {
+    osup_pool_run(pool, countPart, parts, sizeof(int), 1000);
+    for (i = 0; i < 1000; i++) assert(parts[i] == round);
+  }
+  osup_pool_free(pool);
+}
+
 int main() {
+  testScanners(OSUP_SIMD_NONE);
+  testScanners(OSUP_SIMD_SWAR);
+  testScanners(OSUP_SIMD_SSE2);
+  testScanners(OSUP_SIMD_AVX2);
+
   testInt("123", 123);
   testInt("-782", -782);
+  testInt("0", 0);
+  testInt("12345678", 12345678);
+  testInt("123456789", 123456789);
+  testInt("2147483647", 2147483647);
+  testInt("-2147483648", INT32_MIN);
+  testInt("000000000000042", 42);
+  testInvalidInt("2147483648");
+  testInvalidInt("-2147483649");
+  testInvalidInt("99999999999");
+  testInvalidInt("12a4");
+  testInvalidInt("1234567:");
+  testIntUntilNondigit("320:240", 320, 3);
+  testIntUntilNondigit("-6|", -6, 2);
+  {
+    /* overflow must be detected even without an explicit end */
+    const char* overflow = "1234567890123,";
+    osup_int v;
+    assert(!osup_parse_int_until_nondigit_char(&overflow, &v));
+  }
+  fuzzInt();
 
   testDecimal("0.1", 0.1);
   testDecimal("-0.1", -0.1);
@@ -32,7 +239,31 @@ int main() {
   testDecimal("2.1e10", 2.1e10);
   testDecimal("-2.1E9", -2.1E9);
 
+  testDecimalExact("-166.666666666667");
+  testDecimalExact("149.999995422363");
+  testDecimalExact("0.1");
+  testDecimalExact("2.1e10");
+  testDecimalExact("1.5e-5");
+  testDecimalExact("123e25");
+  testDecimalExact("9007199254740993");
+  testDecimalExact("0.000000000000000000000000000001");
+  testDecimalExact("12345678901234567890123456789");
+  testDecimalExact("1e400");
+  testDecimalExact("1e-400");
+  testDecimalExact("5.");
+  testDecimalExact(".5");
+  testInvalidDecimal("");
+  testInvalidDecimal(".");
+  testInvalidDecimal("1e");
+  testInvalidDecimal("1.2.3");
+  testInvalidDecimal("0x10");
+  fuzzDecimal();
+  testDecimalLocale();
+
   testRGB("100,20,30", 100, 20, 30);
 
+  testPool(1);
+  testPool(4);
+
   return 0;
 }
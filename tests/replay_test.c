@@ -0,0 +1,162 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osup/osup_replay.h"
+
+/* res/replay.osr is synthetic: after the usual 0 and -1 delta frames at
+ * (256, -500), frame i follows the generator below, then comes the seed frame.
+ * the frames were compressed with a 64 KiB dictionary, smaller than the text,
+ * so the decoder's window wraps around */
+#define FRAME_COUNT 10000
+#define SEED 7364
+
+static uint32_t state;
+
+static void expectedFrame(size_t i, osup_replay_frame* frame) {
+  uint32_t r;
+  state = (state * 1103515245u + 12345u) & 0x7fffffff;
+  r = state >> 16;
+  frame->delta = 16 + (r & 1);
+  frame->x = (double)((i % 512) * 100 + r % 100) / 100.0;
+  frame->y = (double)(((i * 3) % 384) * 10 + (r >> 8) % 10) / 10.0;
+  frame->keys = (r >> 4) % 16;
+}
+
+static void checkFrames(const osup_replay* replay) {
+  osup_replay_frame_iter iter;
+  osup_replay_frame expected;
+  const osup_replay_frame* frame;
+  osup_long time = -1;
+  size_t i;
+  assert(osup_replay_frame_iter_begin(&iter, replay));
+  frame = osup_replay_frame_iter_next(&iter);
+  assert(frame && frame->delta == 0 && frame->x == 256 && frame->y == -500);
+  frame = osup_replay_frame_iter_next(&iter);
+  assert(frame && frame->delta == -1 && frame->time == -1);
+  state = 1;
+  for (i = 0; i < FRAME_COUNT; i++) {
+    frame = osup_replay_frame_iter_next(&iter);
+    assert(frame);
+    expectedFrame(i, &expected);
+    time += expected.delta;
+    assert(frame->delta == expected.delta && frame->time == time);
+    assert(fabs(frame->x - expected.x) < 1e-9);
+    assert(fabs(frame->y - expected.y) < 1e-9);
+    assert(frame->keys == expected.keys);
+  }
+  assert(!osup_replay_frame_iter_next(&iter));
+  assert(!osup_replay_frame_iter_next(&iter));
+  assert(!iter.failed && iter.hasSeed && iter.seed == SEED);
+  osup_replay_frame_iter_end(&iter);
+}
+
+void testHeader(const osup_replay* replay) {
+  assert(replay->mode == OSUP_MODE_OSU);
+  assert(replay->version == 20210520);
+  assert(!strcmp(replay->beatmapHash, "c6c1b7a4e5d0e3f3b0fd2d6a7e1c8b21"));
+  assert(!strcmp(replay->playerName, "osup"));
+  assert(!strcmp(replay->replayHash, "5d41402abc4b2a76b9719d911017c592"));
+  assert(replay->count300 == 1210 && replay->count100 == 42);
+  assert(replay->count50 == 3 && replay->countGeki == 201);
+  assert(replay->countKatu == 30 && replay->countMiss == 5);
+  assert(replay->score == 4521337 && replay->maxCombo == 812);
+  assert(!replay->perfect);
+  assert(replay->mods == (OSUP_MOD_HIDDEN | OSUP_MOD_DOUBLE_TIME));
+  /* the life bar string is longer than 127 bytes, so its length takes two
+   * ULEB128 bytes */
+  assert(replay->lifeBar.count == 40);
+  assert(replay->lifeBar.elements[0].time == 0);
+  assert(replay->lifeBar.elements[0].health == 1.0);
+  assert(replay->lifeBar.elements[39].time == 78000);
+  assert(fabs(replay->lifeBar.elements[39].health - 0.61) < 1e-9);
+  assert(replay->timestamp == 637500000000000000ll);
+  assert(replay->onlineScoreID == 3141592653ll);
+}
+
+/* a copy whose frames can be damaged */
+static char* copyReplay(const osup_replay* replay, osup_replay* copy) {
+  size_t size = (size_t)(replay->frameData.end - replay->frameData.begin);
+  char* frames = malloc(size);
+  assert(frames);
+  memcpy(frames, replay->frameData.begin, size);
+  memset(copy, 0, sizeof(*copy));
+  copy->frameData.begin = frames;
+  copy->frameData.end = frames + size;
+  return frames;
+}
+
+void testStreams(const osup_replay* replay) {
+  osup_replay copy;
+  osup_replay_frame_iter iter;
+  char* frames = copyReplay(replay, &copy);
+  size_t size = (size_t)(copy.frameData.end - copy.frameData.begin);
+  const osup_replay_frame* frame;
+  size_t count = 0;
+
+  /* without the size in the header, the end marker ends the stream */
+  memset(frames + 5, 0xff, 8);
+  checkFrames(&copy);
+
+  /* a 4 GiB dictionary, the window only grows as far as the output does */
+  memset(frames + 1, 0xff, 4);
+  checkFrames(&copy);
+  memcpy(frames + 1, replay->frameData.begin + 1, 4);
+
+  /* truncated */
+  copy.frameData.end = frames + size / 2;
+  assert(osup_replay_frame_iter_begin(&iter, &copy));
+  while ((frame = osup_replay_frame_iter_next(&iter))) count++;
+  assert(iter.failed && count > 0 && count < FRAME_COUNT);
+  osup_replay_frame_iter_end(&iter);
+
+  /* invalid properties */
+  copy.frameData.end = frames + size;
+  frames[0] = (char)225;
+  assert(!osup_replay_frame_iter_begin(&iter, &copy));
+  assert(iter.failed && !osup_replay_frame_iter_next(&iter));
+  osup_replay_frame_iter_end(&iter);
+  free(frames);
+
+  /* no frames at all */
+  memset(&copy, 0, sizeof(copy));
+  assert(osup_replay_frame_iter_begin(&iter, &copy));
+  assert(!osup_replay_frame_iter_next(&iter) && !iter.failed);
+  osup_replay_frame_iter_end(&iter);
+}
+
+void testTruncatedHeader() {
+  osup_mapped_file f;
+  osup_replay replay = {0};
+  size_t size;
+  assert(osup_map_file("res/replay.osr", &f));
+  assert(osup_replay_load_buffer(&replay, f.data, f.size));
+  osup_replay_free(&replay);
+  /* cut in a string, in the frames, in the score id */
+  for (size = 10; size < f.size; size += f.size / 7) {
+    assert(!osup_replay_load_buffer(&replay, f.data, size));
+    assert(!replay.playerName && !replay.lifeBar.elements);
+  }
+  assert(!osup_replay_load_buffer(&replay, f.data, f.size - 1));
+  osup_unmap_file(&f);
+}
+
+int main() {
+  osup_replay replay = {0};
+#ifndef OSUP_NO_LOGGING
+  /* the broken replays below are reported as errors, don't spam them */
+  osup_set_error_callback(NULL, NULL);
+#endif
+  assert(osup_replay_load(&replay, "res/replay.osr"));
+  assert(replay.source.data);
+  testHeader(&replay);
+  checkFrames(&replay);
+  testStreams(&replay);
+  osup_replay_free(&replay);
+  assert(!replay.source.data && !replay.playerName);
+  assert(!osup_replay_load(&replay, "res/missing.osr"));
+  testTruncatedHeader();
+  return 0;
+}
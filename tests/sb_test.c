@@ -0,0 +1,625 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osup/osup_beatmap.h"
+
+#define FLAGS (OSUP_PARSE_EVENTS | OSUP_PARSE_STORYBOARD)
+
+static osup_bool sliceEquals(osup_slice slice, const char* string) {
+  return slice.begin && (size_t)(slice.end - slice.begin) == strlen(string) &&
+         !memcmp(slice.begin, string, strlen(string));
+}
+
+static osup_bool sameSlice(osup_slice a, osup_slice b) {
+  return !a.begin == !b.begin && a.end - a.begin == b.end - b.begin &&
+         (!a.begin || !memcmp(a.begin, b.begin, (size_t)(a.end - a.begin)));
+}
+
+#define CHECK_SAME_TABLE(table)                                 \
+  assert(a->table.count == b->table.count);                    \
+  assert(!a->table.count ||                                    \
+         !memcmp(a->table.elements, b->table.elements,         \
+                 a->table.count * sizeof(*a->table.elements)))
+
+/* the strings may be copies or views, everything else must be the same */
+static void checkSameStoryboard(const osup_sb* a, const osup_sb* b) {
+  size_t i;
+  assert(a->objects.count == b->objects.count);
+  for (i = 0; i < a->objects.count; i++) {
+    osup_sb_object x = a->objects.elements[i];
+    osup_sb_object y = b->objects.elements[i];
+    assert(sameSlice(x.filenameView, y.filenameView));
+    x.filename = y.filename = NULL;
+    memset(&x.filenameView, 0, sizeof(x.filenameView));
+    memset(&y.filenameView, 0, sizeof(y.filenameView));
+    assert(!memcmp(&x, &y, sizeof(x)));
+  }
+  assert(a->samples.count == b->samples.count);
+  for (i = 0; i < a->samples.count; i++) {
+    assert(sameSlice(a->samples.elements[i].filenameView,
+                     b->samples.elements[i].filenameView));
+    assert(a->samples.elements[i].time == b->samples.elements[i].time);
+    assert(a->samples.elements[i].volume == b->samples.elements[i].volume);
+  }
+  assert(a->groups.count == b->groups.count);
+  for (i = 0; i < a->groups.count; i++) {
+    assert(sameSlice(a->groups.elements[i].triggerView,
+                     b->groups.elements[i].triggerView));
+    assert(a->groups.elements[i].startTime ==
+           b->groups.elements[i].startTime);
+    assert(a->groups.elements[i].object == b->groups.elements[i].object);
+  }
+  CHECK_SAME_TABLE(fade);
+  CHECK_SAME_TABLE(move);
+  CHECK_SAME_TABLE(moveX);
+  CHECK_SAME_TABLE(moveY);
+  CHECK_SAME_TABLE(scale);
+  CHECK_SAME_TABLE(vectorScale);
+  CHECK_SAME_TABLE(rotate);
+  CHECK_SAME_TABLE(colour);
+  CHECK_SAME_TABLE(parameter);
+}
+
+/* count the storyboard of the text the slow way: objects, groups and the
+ * commands of every type, with the shorthand chains expanded */
+static void countStoryboard(const char* text, size_t* objects,
+                            size_t* samples, size_t* groups,
+                            size_t* commands) {
+  static const char* names[] = {"F", "M", "MX", "MY", "S", "V", "R", "C", "P"};
+  static const size_t arity[] = {1, 2, 1, 1, 1, 2, 1, 3, 1};
+  char line[4096];
+  const char* it = strstr(text, "[Events]");
+  size_t i;
+  *objects = *samples = *groups = 0;
+  memset(commands, 0, OSUP_SB_COMMAND_TYPE_COUNT * sizeof(size_t));
+  while (it && (it = strchr(it, '\n')) && *++it && *it != '[') {
+    size_t length = strcspn(it, "\r\n"), values = 0, depth = 0;
+    char* token;
+    memcpy(line, it, length);
+    line[length] = '\0';
+    if (!strncmp(line, "Sprite,", 7) || !strncmp(line, "Animation,", 10)) {
+      (*objects)++;
+    } else if (!strncmp(line, "Sample,", 7)) {
+      (*samples)++;
+    }
+    while (line[depth] == ' ' || line[depth] == '_') depth++;
+    if (!depth) continue;
+    token = strchr(line, ',');
+    while (token) {
+      values++;
+      token = strchr(token + 1, ',');
+    }
+    *strchr(line, ',') = '\0';
+    if (!strcmp(line + depth, "L") || !strcmp(line + depth, "T")) {
+      (*groups)++;
+      continue;
+    }
+    for (i = 0; i < OSUP_SB_COMMAND_TYPE_COUNT; i++) {
+      if (!strcmp(line + depth, names[i])) {
+        /* the easing and the times */
+        values -= 3;
+        commands[i] += values > arity[i] ? values / arity[i] - 1 : 1;
+      }
+    }
+  }
+}
+
+void testMap(const char* path) {
+  osup_bm map = {0};
+  osup_bm events = {0};
+  osup_mapped_file f;
+  size_t objects, samples, groups, commands[OSUP_SB_COMMAND_TYPE_COUNT];
+  size_t i;
+  assert(osup_map_file(path, &f));
+  countStoryboard(f.data, &objects, &samples, &groups, commands);
+  osup_unmap_file(&f);
+  assert(osup_beatmap_load(&map, path, FLAGS));
+  const osup_sb* sb = &map.storyboard;
+  assert(sb->objects.count == objects && objects > 1000);
+  assert(sb->samples.count == samples && samples > 0);
+  assert(sb->groups.count == groups && groups > 0);
+  assert(sb->fade.count == commands[OSUP_SB_COMMAND_FADE]);
+  assert(sb->move.count == commands[OSUP_SB_COMMAND_MOVE]);
+  assert(sb->moveX.count == commands[OSUP_SB_COMMAND_MOVE_X]);
+  assert(sb->moveY.count == commands[OSUP_SB_COMMAND_MOVE_Y]);
+  assert(sb->scale.count == commands[OSUP_SB_COMMAND_SCALE]);
+  assert(sb->vectorScale.count == commands[OSUP_SB_COMMAND_VECTOR_SCALE]);
+  assert(sb->rotate.count == commands[OSUP_SB_COMMAND_ROTATE]);
+  assert(sb->colour.count == commands[OSUP_SB_COMMAND_COLOUR]);
+  assert(sb->parameter.count == commands[OSUP_SB_COMMAND_PARAMETER]);
+  assert(osup_storyboard_check(sb));
+
+  /* Sprite,Background,Centre,"sb\bg5.jpg",320,240
+   *  M,0,93552,99552,320.5818,214.9818,322.3273,238.8364 */
+  const osup_sb_object* object = &sb->objects.elements[1];
+  assert(object->type == OSUP_SB_OBJECT_SPRITE);
+  assert(object->layer == OSUP_SB_LAYER_BACKGROUND);
+  assert(object->origin == OSUP_SB_ORIGIN_CENTRE);
+  assert(!strcmp(object->filename, "sb\\bg5.jpg"));
+  assert(object->x == 320 && object->y == 240);
+  const osup_sb_vector_command* move =
+      &sb->move.elements[object->commands[OSUP_SB_COMMAND_MOVE]];
+  assert(move->command.object == 1 && move->command.group == OSUP_SB_NO_GROUP);
+  assert(move->command.startTime == 93552 && move->command.endTime == 99552);
+  assert(move->start[0] == 320.5818f && move->end[1] == 238.8364f);
+  /* the commands of an object are found from the object */
+  for (i = object->commands[OSUP_SB_COMMAND_ROTATE];
+       i < object[1].commands[OSUP_SB_COMMAND_ROTATE]; i++) {
+    assert(sb->rotate.elements[i].command.object == 1);
+  }
+  assert(object[1].commands[OSUP_SB_COMMAND_ROTATE] -
+             object->commands[OSUP_SB_COMMAND_ROTATE] ==
+         3);
+
+  /* the other events are the same as without the storyboard */
+  assert(osup_beatmap_load(&events, path, OSUP_PARSE_EVENTS));
+  assert(!events.storyboard.objects.count && !events.storyboard.fade.count);
+  assert(events.events.count == map.events.count);
+  assert(!memcmp(&events.events.elements[1], &map.events.elements[1],
+                 sizeof(osup_event)));
+  osup_beatmap_free(&events);
+  osup_beatmap_free(&map);
+  assert(!map.storyboard.objects.elements);
+}
+
+/* every way to load a map gives the same storyboard */
+void testLoaders(const char* path) {
+  osup_bm map = {0};
+  osup_bm other = {0};
+  FILE* f;
+  osup_mapped_file file;
+  assert(osup_beatmap_load(&map, path, FLAGS));
+
+  assert(osup_beatmap_load(&other, path, FLAGS | OSUP_PARSE_ARENA));
+  checkSameStoryboard(&map.storyboard, &other.storyboard);
+  osup_beatmap_free(&other);
+
+  assert(osup_beatmap_load(&other, path, FLAGS | OSUP_PARSE_STRING_VIEWS));
+  assert(!other.storyboard.objects.elements[0].filename);
+  checkSameStoryboard(&map.storyboard, &other.storyboard);
+  osup_beatmap_free(&other);
+
+  f = fopen(path, "r");
+  assert(f);
+  assert(osup_beatmap_load_stream(&other, f, FLAGS));
+  fclose(f);
+  checkSameStoryboard(&map.storyboard, &other.storyboard);
+  osup_beatmap_free(&other);
+
+  assert(osup_map_file(path, &file));
+  assert(osup_beatmap_load_string_threaded(&other, file.data,
+                                           OSUP_PARSE_ALL |
+                                               OSUP_PARSE_STORYBOARD,
+                                           4));
+  checkSameStoryboard(&map.storyboard, &other.storyboard);
+  osup_beatmap_free(&other);
+
+  assert(osup_beatmap_open_string(&other, file.data, OSUP_PARSE_STORYBOARD));
+  assert(!other.storyboard.objects.count);
+  assert(osup_bm_parse_section(&other, OSUP_PARSE_EVENTS));
+  checkSameStoryboard(&map.storyboard, &other.storyboard);
+  osup_beatmap_free(&other);
+  osup_unmap_file(&file);
+
+  osup_beatmap_free(&map);
+}
+
+void testBinarySnapshot(const char* path) {
+  osup_bm map = {0};
+  osup_bm loaded = {0};
+  char* data;
+  size_t size;
+  assert(osup_beatmap_load(&map, path, FLAGS | OSUP_PARSE_STRING_VIEWS));
+  assert(osup_beatmap_save_binary_buffer(&map, &data, &size));
+  assert(osup_beatmap_load_binary_buffer(&loaded, data, size));
+  checkSameStoryboard(&map.storyboard, &loaded.storyboard);
+  assert(!strcmp(loaded.storyboard.objects.elements[1].filename,
+                 "sb\\bg5.jpg"));
+  osup_beatmap_free(&loaded);
+  free(data);
+  osup_beatmap_free(&map);
+}
+
+static const char* storyboard =
+    "\xEF\xBB\xBF[Variables]\n"
+    "$bg=\"sb/bg.png\"\n"
+    "$bgLong=\"sb/bg long.png\"\n"
+    "$c=Centre \n"
+    "\n"
+    "[Events]\r\n"
+    "//Background and Video events\r\n"
+    "0,0,\"bg.jpg\",0,0\r\n"
+    "Sprite,Foreground,$c,$bg,320,240\r\n"
+    "_F,0,1000,2000,0,1,0.5,0\r\n"
+    "_M,1,1000,,10,20\r\n"
+    "_MX,2,0,100,1.5,2.5\r\n"
+    "_MY,3,0,100,7\r\n"
+    "_C,4,0,100,255,128,0,0,0,300\r\n"
+    "_P,5,0,100,A\r\n"
+    "_L,500,3\r\n"
+    "__S,6,0,50,1,2\r\n"
+    "__R,7,50,100,0,3.14\r\n"
+    "_V,8,0,0,1,2,3,4\r\n"
+    "_T,HitSoundClap,0,5000,1\r\n"
+    "__F,3,0,100,1,0\r\n"
+    "Animation,1,7,$bgLong,0.5,-1,12,16.5,LoopOnce\r\n"
+    " T,Passing\r\n"
+    "  F,0,0,0,1\r\n"
+    "Sample,4000,3,\"hit.wav\"\r\n"
+    "5,4500,0,\"hit2.wav\",40\r\n"
+    "6,Pass,BottomRight,\"anim.png\",1,2,3,4\r\n"
+    " S,34,0,,1.5,2\r\n"
+    "4,0,9,\"x.png\",1,2\r\n"
+    "Sprite,Foreground,Centre,\"$notavariable.png\",320,240\r\n"
+    "[Other]\r\n"
+    "Sprite,Foreground,Centre,\"ignored.png\",320,240\r\n";
+
+static void checkStoryboard(const osup_sb* sb) {
+  const osup_sb_object* object = sb->objects.elements;
+  assert(sb->objects.count == 5);
+  assert(sliceEquals(object[0].filenameView, "sb/bg.png"));
+  assert(object[0].layer == OSUP_SB_LAYER_FOREGROUND);
+  assert(object[0].origin == OSUP_SB_ORIGIN_CENTRE);
+  /* the longest variable name wins */
+  assert(sliceEquals(object[1].filenameView, "sb/bg long.png"));
+  assert(object[1].type == OSUP_SB_OBJECT_ANIMATION);
+  assert(object[1].layer == OSUP_SB_LAYER_FAIL);
+  assert(object[1].origin == OSUP_SB_ORIGIN_CENTRE_RIGHT);
+  assert(object[1].x == 0.5f && object[1].y == -1);
+  assert(object[1].frameCount == 12 && object[1].frameDelay == 16.5);
+  assert(object[1].loopType == OSUP_SB_LOOP_ONCE);
+  assert(object[2].type == OSUP_SB_OBJECT_ANIMATION);
+  assert(object[2].layer == OSUP_SB_LAYER_PASS);
+  assert(object[2].origin == OSUP_SB_ORIGIN_BOTTOM_RIGHT);
+  assert(object[2].loopType == OSUP_SB_LOOP_FOREVER);
+  assert(object[3].type == OSUP_SB_OBJECT_SPRITE);
+  assert(sliceEquals(object[4].filenameView, "$notavariable.png"));
+
+  /* F,0,1000,2000,0,1,0.5,0 is a chain of 3 */
+  assert(sb->fade.count == 5);
+  assert(sb->fade.elements[0].command.startTime == 1000);
+  assert(sb->fade.elements[0].start == 0 && sb->fade.elements[0].end == 1);
+  assert(sb->fade.elements[1].command.startTime == 2000);
+  assert(sb->fade.elements[1].command.endTime == 3000);
+  assert(sb->fade.elements[1].start == 1 && sb->fade.elements[1].end == 0.5f);
+  assert(sb->fade.elements[2].command.endTime == 4000);
+  assert(sb->fade.elements[2].end == 0);
+  assert(sb->fade.elements[3].command.group == 1);
+  assert(sb->fade.elements[3].command.easing == OSUP_SB_EASING_QUAD_IN);
+
+  /* an empty end time is the start time, a single value is both values */
+  assert(sb->move.count == 1);
+  assert(sb->move.elements[0].command.endTime == 1000);
+  assert(sb->move.elements[0].command.easing == OSUP_SB_EASING_OUT);
+  assert(sb->move.elements[0].start[0] == 10 &&
+         sb->move.elements[0].end[1] == 20);
+  assert(sb->moveX.count == 1 && sb->moveX.elements[0].end == 2.5f);
+  assert(sb->moveY.count == 1 && sb->moveY.elements[0].start == 7 &&
+         sb->moveY.elements[0].end == 7);
+  /* out of range colours are clamped */
+  assert(sb->colour.count == 1);
+  assert(sb->colour.elements[0].start.red == 255 &&
+         sb->colour.elements[0].start.green == 128);
+  assert(sb->colour.elements[0].end.blue == 255);
+  assert(sb->parameter.count == 1 &&
+         sb->parameter.elements[0].parameter == OSUP_SB_PARAMETER_ADDITIVE);
+
+  /* the loop, the commands under it, then back to the object */
+  assert(sb->groups.count == 3);
+  assert(sb->groups.elements[0].type == OSUP_SB_GROUP_LOOP);
+  assert(sb->groups.elements[0].startTime == 500);
+  assert(sb->groups.elements[0].loopCount == 3);
+  assert(sb->scale.count == 2 && sb->scale.elements[0].command.group == 0);
+  assert(sb->rotate.count == 1 && sb->rotate.elements[0].command.group == 0);
+  assert(sb->vectorScale.count == 1);
+  assert(sb->vectorScale.elements[0].command.group == OSUP_SB_NO_GROUP);
+  assert(sb->vectorScale.elements[0].end[1] == 4);
+  assert(sb->groups.elements[1].type == OSUP_SB_GROUP_TRIGGER);
+  assert(sliceEquals(sb->groups.elements[1].triggerView, "HitSoundClap"));
+  assert(sb->groups.elements[1].endTime == 5000);
+  assert(sb->groups.elements[1].groupNumber == 1);
+  /* a trigger without times lasts forever */
+  assert(sb->groups.elements[2].object == 1);
+  assert(sliceEquals(sb->groups.elements[2].triggerView, "Passing"));
+  assert(sb->groups.elements[2].startTime == INT32_MIN);
+  assert(sb->groups.elements[2].endTime == INT32_MAX);
+  assert(sb->scale.elements[1].command.object == 2);
+  assert(sb->scale.elements[1].command.easing == OSUP_SB_EASING_BOUNCE_IN_OUT);
+
+  assert(object[1].commands[OSUP_SB_COMMAND_FADE] == 4);
+  assert(sb->fade.elements[4].command.object == 1);
+  assert(sb->fade.elements[4].command.group == 2);
+  assert(object[1].groups == 2 && object[2].groups == 3);
+
+  assert(sb->samples.count == 2);
+  assert(sb->samples.elements[0].time == 4000);
+  assert(sb->samples.elements[0].layer == OSUP_SB_LAYER_FOREGROUND);
+  assert(sb->samples.elements[0].volume == 100);
+  assert(sliceEquals(sb->samples.elements[1].filenameView, "hit2.wav"));
+  assert(sb->samples.elements[1].volume == 40);
+  assert(osup_storyboard_check(sb));
+}
+
+void testOsb(const char* dir) {
+  osup_sb sb;
+  osup_sb copy;
+  char path[1024];
+  FILE* f;
+  assert(osup_storyboard_load_string(&sb, storyboard, 0));
+  checkStoryboard(&sb);
+  assert(sb.objects.elements[0].filename);
+
+  assert(osup_storyboard_load_string(&copy, storyboard, OSUP_PARSE_ARENA));
+  assert(copy.arena.blocks);
+  checkStoryboard(&copy);
+  checkSameStoryboard(&sb, &copy);
+  osup_storyboard_free(&copy);
+
+  sprintf(path, "%s/sb_test.osb", dir);
+  f = fopen(path, "wb");
+  assert(f && fputs(storyboard, f) >= 0);
+  fclose(f);
+  assert(osup_storyboard_load(&copy, path, OSUP_PARSE_STRING_VIEWS));
+  assert(copy.source.data);
+  /* the lines with variables are copied, the others are views */
+  assert(copy.objects.elements[0].filename);
+  assert(!copy.objects.elements[2].filename);
+  checkStoryboard(&copy);
+  checkSameStoryboard(&sb, &copy);
+  osup_storyboard_free(&copy);
+  assert(!copy.source.data);
+  remove(path);
+  assert(!osup_storyboard_load(&copy, path, 0));
+
+  osup_storyboard_free(&sb);
+  assert(!sb.objects.elements && !sb.fade.elements);
+}
+
+#ifndef OSUP_NO_LOGGING
+static void countErrors(const char* err, void* ptr) {
+  (void)err;
+  (*(size_t*)ptr)++;
+}
+#endif
+
+/* the storyboard of a map is checked just as strictly, but a broken one is
+ * only reported and dropped, the rest of the map still loads */
+static void testMapErrors(osup_bitfield32 flags) {
+  static const char* input =
+      "osu file format v14\n"
+      "[Events]\n"
+      "0,0,\"bg.jpg\",0,0\n"
+      "Sprite,Foreground,Centre,\"a.png\",320,240\n"
+      " F,0,0,1000,0,1\n"
+      " F,35,0,0,1\n"
+      "Sprite,Foreground,Centre,\"b.png\",320,240\n"
+      " F,0,0,1000,0,1\n"
+      "2,100,200\n"
+      "[HitObjects]\n"
+      "256,192,1000,1,0,0:0:0:0:\n";
+  osup_bm map = {0};
+#ifndef OSUP_NO_LOGGING
+  size_t errors = 0;
+  osup_set_error_callback(countErrors, &errors);
+#endif
+  assert(osup_beatmap_load_string(
+      &map, input, FLAGS | OSUP_PARSE_HIT_OBJECTS | flags));
+  assert(!map.storyboard.objects.count && !map.storyboard.objects.elements);
+  assert(!map.storyboard.fade.count);
+  assert(map.events.count == 2 && map.hitObjects.count == 1);
+#ifndef OSUP_NO_LOGGING
+  assert(errors > 0);
+  osup_set_error_callback(NULL, NULL);
+#endif
+  osup_beatmap_free(&map);
+  assert(osup_beatmap_load_string(
+      &map, "osu file format v14\n[Events]\n F,0,0,0,1\n", FLAGS | flags));
+  assert(!map.storyboard.fade.count);
+  osup_beatmap_free(&map);
+}
+
+void testErrors() {
+  static const char* const invalid[] = {
+      /* no object yet */
+      "[Events]\n F,0,0,0,1\n",
+      /* samples can't have commands */
+      "[Events]\nSample,0,0,\"a.wav\"\n F,0,0,0,1\n",
+      "[Events]\nSprite,Nowhere,Centre,\"a.png\",0,0\n",
+      "[Events]\nSprite,Background,Middle,\"a.png\",0,0\n",
+      "[Events]\nSprite,Background,Centre,\"a.png\",0\n",
+      "[Events]\nSprite,Background,Centre,\"a.png\",0,0,0\n",
+      "[Events]\nAnimation,Background,Centre,\"a.png\",0,0,2\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n Q,0,0,0,1\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n F,35,0,0,1\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n F,0,x,0,1\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n F,0,0,0\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n M,0,0,0,1\n",
+      /* half a chain */
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n M,0,0,0,1,2,3\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n P,0,0,0,X\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n L,0\n",
+      "[Events]\nSprite,0,0,\"a.png\",0,0\n T\n",
+      "[Variables]\nbg=1\n"};
+  osup_sb sb;
+  size_t i;
+  for (i = 0; i < sizeof(invalid) / sizeof(*invalid); i++) {
+    assert(!osup_storyboard_load_string(&sb, invalid[i], 0));
+    assert(!sb.objects.elements && !sb.samples.elements);
+  }
+  testMapErrors(0);
+  testMapErrors(OSUP_PARSE_ARENA);
+}
+
+void testEasing() {
+  size_t i;
+  for (i = 0; i < OSUP_SB_EASING_COUNT; i++) {
+    double start = osup_sb_ease((osup_sb_easing)i, 0);
+    double end = osup_sb_ease((osup_sb_easing)i, 1);
+    /* the exponential and elastic ones only get close */
+    assert(start > -0.002 && start < 0.002);
+    assert(end > 0.998 && end < 1.002);
+  }
+  assert(osup_sb_ease(OSUP_SB_EASING_LINEAR, 0.3) == 0.3);
+  assert(osup_sb_ease(OSUP_SB_EASING_IN, 0.5) == 0.25);
+  assert(osup_sb_ease(OSUP_SB_EASING_OUT, 0.5) == 0.75);
+  assert(osup_sb_ease(OSUP_SB_EASING_CUBIC_IN_OUT, 0.5) == 0.5);
+  assert(osup_sb_ease(OSUP_SB_EASING_BACK_IN, 0.2) < 0);
+  assert(osup_sb_ease(OSUP_SB_EASING_ELASTIC_OUT, 0.2) > 1);
+  assert(osup_sb_ease(OSUP_SB_EASING_BOUNCE_OUT, 1 / 2.75) > 0.999);
+}
+
+static osup_bool near(float a, float b) { return a - b < 1e-3 && b - a < 1e-3; }
+
+static const char* timeline =
+    "[Events]\n"
+    "Sprite,Foreground,Centre,\"a.png\",320,240\n"
+    " F,0,1000,2000,0,1\n"
+    " M,2,1000,2000,0,0,100,200\n"
+    " MX,0,1500,,50\n"
+    " S,0,0,1000,1,2\n"
+    " V,0,0,,1,3\n"
+    " R,0,0,1000,0,1\n"
+    " C,0,0,1000,0,0,0,255,255,255\n"
+    " P,0,500,600,H\n"
+    " P,0,0,,A\n"
+    " L,3000,4\n"
+    "  F,0,0,100,1,0\n"
+    "  F,0,100,500,0,1\n"
+    " T,HitSoundClap,0,10000\n"
+    "  S,0,0,100,5\n"
+    "Sprite,Background,TopLeft,\"b.png\",10,20\n"
+    " F,0,5000,6000,1\n"
+    "Animation,Pass,Centre,\"c.png\",0,0,4,100,LoopOnce\n"
+    " F,0,0,1000,1\n"
+    "Sprite,Background,TopLeft,\"nothing.png\",0,0\n";
+
+void testEvaluator() {
+  osup_sb sb;
+  osup_sb_evaluator evaluator;
+  osup_sb_state states[2];
+  osup_sb_state state;
+  int pass;
+  assert(osup_storyboard_load_string(&sb, timeline, 0));
+  assert(osup_sb_evaluator_init(&evaluator, &sb));
+  /* the loop runs 4 times from 3000, 500 ms each */
+  assert(evaluator.startTimes[0] == 0 && evaluator.endTimes[0] == 5000);
+  assert(evaluator.startTimes[1] == 5000 && evaluator.endTimes[1] == 6000);
+  assert(evaluator.orderCount == 3 && evaluator.maxActive == 2);
+
+  /* twice, the second time after jumping back */
+  for (pass = 0; pass < 2; pass++) {
+    assert(osup_sb_evaluate(&evaluator, 500, states) == 2);
+    assert(states[0].object == 0 && states[1].object == 2);
+    /* before its first fade, the object has the fade's first value */
+    assert(states[0].opacity == 0);
+    assert(states[0].x == 0 && states[0].y == 0);
+    assert(near(states[0].scale[0], 1.5f) && near(states[0].scale[1], 4.5f));
+    assert(near(states[0].rotation, 0.5f));
+    assert(near(states[0].colour[0], 127.5f));
+    assert(states[0].flipH && !states[0].flipV && states[0].additive);
+    /* frame 5 of an animation of 4 that doesn't loop */
+    assert(states[1].frame == 3);
+    assert(osup_sb_evaluate_object(&evaluator, 2, 250, &state));
+    assert(state.frame == 2);
+
+    /* the MX that started last wins over M on X */
+    assert(osup_sb_evaluate(&evaluator, 1500, states) == 1);
+    assert(states[0].x == 50 && near(states[0].y, 50));
+    assert(near(states[0].opacity, 0.5f) && !states[0].flipH);
+    assert(states[0].additive);
+
+    assert(osup_sb_evaluate(&evaluator, 3050, states) == 1);
+    assert(near(states[0].opacity, 0.5f));
+    /* the trigger is left out */
+    assert(states[0].scale[0] == 2);
+    assert(osup_sb_evaluate(&evaluator, 3650, states) == 1);
+    assert(near(states[0].opacity, 0.125f));
+    assert(osup_sb_evaluate(&evaluator, 4550, states) == 1);
+    assert(near(states[0].opacity, 0.5f));
+
+    assert(osup_sb_evaluate(&evaluator, 5000, states) == 2);
+    assert(states[0].object == 0 && states[0].opacity == 1);
+    assert(states[1].object == 1 && states[1].x == 10 && states[1].y == 20);
+    assert(states[1].opacity == 1 && states[1].colour[2] == 255);
+    assert(osup_sb_evaluate(&evaluator, 7000, states) == 0);
+  }
+
+  assert(osup_sb_evaluate_object(&evaluator, 1, 5500, &state));
+  assert(state.object == 1 && state.opacity == 1);
+  assert(!osup_sb_evaluate_object(&evaluator, 1, 4999, &state));
+  assert(!osup_sb_evaluate_object(&evaluator, 3, 0, &state));
+  assert(!osup_sb_evaluate_object(&evaluator, 4, 0, &state));
+  osup_sb_evaluator_free(&evaluator);
+  osup_storyboard_free(&sb);
+
+  /* nothing to show */
+  assert(osup_storyboard_load_string(&sb, "[Events]\n", 0));
+  assert(osup_sb_evaluator_init(&evaluator, &sb));
+  assert(evaluator.maxActive == 0);
+  assert(osup_sb_evaluate(&evaluator, 0, states) == 0);
+  osup_sb_evaluator_free(&evaluator);
+  osup_storyboard_free(&sb);
+}
+
+/* playing through a map gives the objects alive at each time and nothing
+ * else, the same as asking for each object on its own */
+void testEvaluatorMap(const char* path) {
+  osup_bm map = {0};
+  osup_sb_evaluator evaluator;
+  osup_sb_state* states;
+  osup_sb_state state;
+  osup_int time, step;
+  size_t count, i, j, alive, maxAlive = 0;
+  assert(osup_beatmap_load(&map, path, FLAGS));
+  assert(osup_sb_evaluator_init(&evaluator, &map.storyboard));
+  states = malloc(evaluator.maxActive * sizeof(osup_sb_state));
+  assert(states);
+  for (step = 0; step < 3; step++) {
+    /* forward in small steps, then in big ones, then backwards */
+    for (i = 0; i < 400; i++) {
+      time = step == 2 ? (osup_int)(160000 - i * 401)
+                       : (osup_int)(i * (step ? 997 : 401) - 1000);
+      count = osup_sb_evaluate(&evaluator, time, states);
+      assert(count <= evaluator.maxActive);
+      for (j = 1; j < count; j++) {
+        assert(states[j - 1].object < states[j].object);
+      }
+      for (j = 0, alive = 0; j < map.storyboard.objects.count; j++) {
+        if (!osup_sb_evaluate_object(&evaluator, (uint32_t)j, time, &state)) {
+          continue;
+        }
+        assert(alive < count && states[alive].object == j);
+        assert(!memcmp(&state, &states[alive], sizeof(state)));
+        alive++;
+      }
+      assert(alive == count);
+      if (alive > maxAlive) maxAlive = alive;
+    }
+  }
+  assert(maxAlive > 10 && maxAlive <= evaluator.maxActive);
+  /* the first sprite is the background, shown at the start */
+  assert(osup_sb_evaluate_object(&evaluator, 0, 0, &state));
+  assert(state.x == 320 && state.y == 240 && state.opacity == 0);
+  free(states);
+  osup_sb_evaluator_free(&evaluator);
+  osup_beatmap_free(&map);
+}
+
+int main(int argc, char** argv) {
+  const char* dir = argc > 1 ? argv[1] : ".";
+#ifndef OSUP_NO_LOGGING
+  /* the broken storyboards below are reported as errors, don't spam them */
+  osup_set_error_callback(NULL, NULL);
+#endif
+  testMap("res/unshakable.osu");
+  testLoaders("res/unshakable.osu");
+  testBinarySnapshot("res/unshakable.osu");
+  testOsb(dir);
+  testErrors();
+  testEasing();
+  testEvaluator();
+  testEvaluatorMap("res/unshakable.osu");
+  return 0;
+}
@@ -0,0 +1,250 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osup/osup_slider.h"
+
+static osup_bool near(osup_decimal a, osup_decimal b, osup_decimal epsilon) {
+  return fabs(a - b) <= epsilon;
+}
+
+static osup_bool nearPoint(osup_vec2f point, osup_decimal x, osup_decimal y,
+                           osup_decimal epsilon) {
+  return near(point.x, x, epsilon) && near(point.y, y, epsilon);
+}
+
+/* head is (0, 0), the points are pairs of coordinates */
+static void compute(osup_slider_path* path, osup_slider_curve type,
+                    const osup_int* points, size_t count,
+                    osup_decimal length) {
+  osup_vec2 head = {0, 0};
+  osup_vec2 curve[8];
+  osup_slider_params slider;
+  size_t i;
+  memset(&slider, 0, sizeof(slider));
+  for (i = 0; i < count; i++) {
+    curve[i].x = points[2 * i];
+    curve[i].y = points[2 * i + 1];
+  }
+  slider.curveType = type;
+  slider.curvePoints.elements = curve;
+  slider.curvePoints.count = count;
+  slider.length = length;
+  assert(osup_slider_path_compute(head, &slider, path));
+}
+
+/* what every path must look like */
+static void checkPath(const osup_slider_path* path) {
+  size_t i;
+  assert(path->count > 0 && path->lengths[0] == 0);
+  for (i = 1; i < path->count; i++) {
+    assert(path->lengths[i] >= path->lengths[i - 1]);
+    assert(path->points[i].x == path->points[i].x);
+    assert(path->points[i].y == path->points[i].y);
+  }
+}
+
+void testLinear() {
+  osup_slider_path path = {0};
+  const osup_int corner[] = {100, 0, 100, 100};
+  const osup_int repeated[] = {100, 0, 100, 0};
+  compute(&path, OSUP_CURVE_LINEAR, corner, 2, 200);
+  checkPath(&path);
+  assert(path.count == 3);
+  assert(path.lengths[1] == 100 && path.lengths[2] == 200);
+  assert(osup_slider_path_length(&path) == 200);
+  assert(nearPoint(osup_slider_position_at(&path, 0), 0, 0, 0));
+  assert(nearPoint(osup_slider_position_at(&path, 0.25), 50, 0, 1e-4));
+  assert(nearPoint(osup_slider_position_at(&path, 0.75), 100, 50, 1e-4));
+  assert(nearPoint(osup_slider_position_at(&path, 1), 100, 100, 0));
+  /* out of range progress is clamped */
+  assert(nearPoint(osup_slider_position_at(&path, -1), 0, 0, 0));
+  assert(nearPoint(osup_slider_position_at(&path, 2), 100, 100, 0));
+
+  /* shorter than the points, the path is cut */
+  compute(&path, OSUP_CURVE_LINEAR, corner, 2, 150);
+  checkPath(&path);
+  assert(path.count == 3 && path.lengths[2] == 150);
+  assert(nearPoint(path.points[2], 100, 50, 1e-4));
+  compute(&path, OSUP_CURVE_LINEAR, corner, 2, 50);
+  checkPath(&path);
+  assert(path.count == 2 && path.lengths[1] == 50);
+  assert(nearPoint(path.points[1], 50, 0, 1e-4));
+  /* longer, the last segment is stretched */
+  compute(&path, OSUP_CURVE_LINEAR, corner, 2, 300);
+  checkPath(&path);
+  assert(path.count == 3 && path.lengths[2] == 300);
+  assert(nearPoint(path.points[2], 100, 200, 1e-4));
+  /* unless the last two points are the same */
+  compute(&path, OSUP_CURVE_LINEAR, repeated, 2, 300);
+  checkPath(&path);
+  assert(path.count == 3 && osup_slider_path_length(&path) == 100);
+  /* no length, the path is left alone */
+  compute(&path, OSUP_CURVE_LINEAR, corner, 2, 0);
+  assert(osup_slider_path_length(&path) == 200);
+  /* no curve points, only the head */
+  compute(&path, OSUP_CURVE_LINEAR, corner, 0, 100);
+  assert(path.count == 1 && osup_slider_path_length(&path) == 0);
+  assert(nearPoint(osup_slider_position_at(&path, 0.5), 0, 0, 0));
+  osup_slider_path_free(&path);
+}
+
+void testCircle() {
+  osup_slider_path path = {0};
+  const osup_int arc[] = {50, 50, 100, 0};
+  const osup_int otherWay[] = {50, -50, 100, 0};
+  const osup_int line[] = {50, 0, 100, 0};
+  const osup_int four[] = {50, 50, 100, 0, 150, 50};
+  size_t i;
+  compute(&path, OSUP_CURVE_PERFECT_CIRCLE, arc, 2, 0);
+  checkPath(&path);
+  assert(path.count > 10);
+  for (i = 0; i < path.count; i++) {
+    osup_decimal x = path.points[i].x - 50, y = path.points[i].y;
+    assert(near(sqrt(x * x + y * y), 50, 1e-3));
+    assert(y >= -1e-3);
+  }
+  assert(nearPoint(path.points[0], 0, 0, 1e-3));
+  assert(nearPoint(path.points[path.count - 1], 100, 0, 1e-3));
+  assert(near(osup_slider_path_length(&path), 50 * 3.14159265, 0.5));
+  assert(nearPoint(osup_slider_position_at(&path, 0.5), 50, 50, 0.1));
+  compute(&path, OSUP_CURVE_PERFECT_CIRCLE, otherWay, 2, 0);
+  checkPath(&path);
+  assert(nearPoint(osup_slider_position_at(&path, 0.5), 50, -50, 0.1));
+  /* the length cuts the arc */
+  compute(&path, OSUP_CURVE_PERFECT_CIRCLE, arc, 2, 50 * 3.14159265 / 2);
+  checkPath(&path);
+  assert(nearPoint(path.points[path.count - 1], 50, 50, 0.1));
+  /* points on a line are a line */
+  compute(&path, OSUP_CURVE_PERFECT_CIRCLE, line, 2, 0);
+  assert(path.count == 3 && osup_slider_path_length(&path) == 100);
+  /* more than 3 points is a bezier curve */
+  compute(&path, OSUP_CURVE_PERFECT_CIRCLE, four, 3, 0);
+  checkPath(&path);
+  assert(nearPoint(path.points[0], 0, 0, 0));
+  assert(nearPoint(path.points[path.count - 1], 150, 50, 0));
+  assert(nearPoint(osup_slider_position_at(&path, 0.5), 75, 25, 0.5));
+  osup_slider_path_free(&path);
+}
+
+void testBezier() {
+  osup_slider_path path = {0};
+  const osup_int curve[] = {100, 100, 200, 0};
+  const osup_int segments[] = {100, 0, 100, 0, 100, 100};
+  size_t i;
+  compute(&path, OSUP_CURVE_BEZIER, curve, 2, 0);
+  checkPath(&path);
+  assert(path.count > 10);
+  assert(nearPoint(path.points[0], 0, 0, 0));
+  assert(nearPoint(path.points[path.count - 1], 200, 0, 0));
+  /* the curve is symmetric, its middle is at t = 0.5 */
+  assert(nearPoint(osup_slider_position_at(&path, 0.5), 100, 50, 0.25));
+  for (i = 0; i < path.count; i++) {
+    osup_decimal t = path.points[i].x / 200;
+    assert(near(path.points[i].y, 200 * t * (1 - t), 0.25));
+  }
+  /* a repeated point makes two straight segments */
+  compute(&path, OSUP_CURVE_BEZIER, segments, 3, 0);
+  checkPath(&path);
+  assert(path.count == 3);
+  assert(nearPoint(path.points[1], 100, 0, 0));
+  assert(osup_slider_path_length(&path) == 200);
+  osup_slider_path_free(&path);
+}
+
+void testCatmull() {
+  osup_slider_path path = {0};
+  const osup_int line[] = {100, 0, 200, 0};
+  const osup_int curve[] = {100, 100, 200, 0};
+  compute(&path, OSUP_CURVE_CENTRIPETAL_CATMULL_ROM, line, 2, 0);
+  checkPath(&path);
+  assert(path.count == 101);
+  assert(near(osup_slider_path_length(&path), 200, 1e-3));
+  assert(nearPoint(osup_slider_position_at(&path, 0.5), 100, 0, 1e-3));
+  compute(&path, OSUP_CURVE_CENTRIPETAL_CATMULL_ROM, curve, 2, 0);
+  checkPath(&path);
+  /* catmull-rom curves go through their control points */
+  assert(nearPoint(path.points[50], 100, 100, 1e-3));
+  assert(nearPoint(path.points[100], 200, 0, 1e-3));
+  osup_slider_path_free(&path);
+}
+
+static void checkSamePaths(const osup_slider_paths* a,
+                           const osup_slider_paths* b) {
+  assert(a->count == b->count);
+  assert(a->all.count == b->all.count);
+  assert(!memcmp(a->offsets, b->offsets, (a->count + 1) * sizeof(size_t)));
+  assert(!memcmp(a->all.points, b->all.points,
+                 a->all.count * sizeof(osup_vec2f)));
+  assert(!memcmp(a->all.lengths, b->all.lengths,
+                 a->all.count * sizeof(osup_decimal)));
+}
+
+/* the batched pass gives the paths of the single one, in every layout */
+void testMap(const char* file) {
+  osup_bm map = {0};
+  osup_slider_paths paths = {0};
+  osup_slider_paths other = {0};
+  osup_slider_path path = {0};
+  size_t i, slider = 0;
+  assert(osup_beatmap_load(&map, file, OSUP_PARSE_HIT_OBJECTS));
+  assert(osup_beatmap_slider_paths(&map, &paths));
+  assert(paths.count > 0);
+  for (i = 0; i < map.hitObjects.count; i++) {
+    const osup_hitobject* obj = &map.hitObjects.elements[i];
+    osup_vec2 head;
+    osup_slider_path view;
+    if (!OSUP_IS_SLIDER(obj->type)) continue;
+    head.x = obj->x;
+    head.y = obj->y;
+    assert(osup_slider_path_compute(head, &obj->slider, &path));
+    checkPath(&path);
+    view = osup_slider_paths_get(&paths, slider++);
+    assert(view.count == path.count);
+    assert(!memcmp(view.points, path.points, path.count * sizeof(osup_vec2f)));
+    assert(!memcmp(view.lengths, path.lengths,
+                   path.count * sizeof(osup_decimal)));
+    /* up to the rounding of the arcs */
+    assert(nearPoint(osup_slider_position_at(&view, 0), obj->x, obj->y,
+                     1e-3));
+    /* paths whose last two points are the same are not stretched */
+    if (obj->slider.length > 0 && path.count > 1 &&
+        (path.points[path.count - 1].x != path.points[path.count - 2].x ||
+         path.points[path.count - 1].y != path.points[path.count - 2].y)) {
+      assert(osup_slider_path_length(&path) == obj->slider.length);
+    }
+  }
+  assert(slider == paths.count);
+  /* the buffers are reused */
+  assert(osup_beatmap_slider_paths(&map, &other));
+  assert(osup_beatmap_slider_paths(&map, &other));
+  checkSamePaths(&paths, &other);
+
+  assert(osup_beatmap_to_hitobject_columns(&map));
+  assert(osup_beatmap_slider_paths(&map, &other));
+  checkSamePaths(&paths, &other);
+  osup_beatmap_free(&map);
+
+  memset(&map, 0, sizeof(map));
+  assert(osup_beatmap_load(&map, file, OSUP_PARSE_HIT_OBJECTS));
+  assert(osup_beatmap_to_compact_hitobjects(&map));
+  assert(osup_beatmap_slider_paths(&map, &other));
+  checkSamePaths(&paths, &other);
+  osup_beatmap_free(&map);
+
+  osup_slider_path_free(&path);
+  osup_slider_paths_free(&paths);
+  osup_slider_paths_free(&other);
+}
+
+int main() {
+  testLinear();
+  testCircle();
+  testBezier();
+  testCatmull();
+  testMap("res/unshakable.osu");
+  testMap("res/magma.osu");
+  return 0;
+}
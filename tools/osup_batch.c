@@ -0,0 +1,218 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "osup/osup_beatmap.h"
+#include "osup/osup_index.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define OSUP_HAS_DIRENT
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/* load every .osu file under the given files and directories (e.g. a Songs
+ * folder) with osup_batch_load, and report the failures and the throughput,
+ * or with -i, bring a metadata index of them up to date */
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-a] [-v] [-i index] path...\n"
+          "  -j  number of threads (1 to 1024), 1 by default\n"
+          "  -i  update the metadata index instead of loading the maps\n"
+          "  -a  load the maps with OSUP_PARSE_ARENA\n"
+          "  -v  load the maps with OSUP_PARSE_STRING_VIEWS\n",
+          program);
+}
+
+typedef struct {
+  char** elements;
+  size_t count;
+  size_t capacity;
+} path_list;
+
+static int add_path(path_list* list, const char* path) {
+  if (list->count >= list->capacity) {
+    size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+    char** elements = realloc(list->elements, capacity * sizeof(char*));
+    if (!elements) return 0;
+    list->elements = elements;
+    list->capacity = capacity;
+  }
+  list->elements[list->count] = malloc(strlen(path) + 1);
+  if (!list->elements[list->count]) return 0;
+  strcpy(list->elements[list->count++], path);
+  return 1;
+}
+
+/* a positive thread count, anything else (junk, a sign, 0) is rejected */
+static int parse_thread_count(const char* str, size_t* threadCount) {
+  char* end;
+  unsigned long value;
+  if (*str < '0' || *str > '9') return 0;
+  errno = 0;
+  value = strtoul(str, &end, 10);
+  if (errno || *end || value < 1 || value > 1024) return 0;
+  *threadCount = (size_t)value;
+  return 1;
+}
+
+static int is_osu_file(const char* path) {
+  size_t len = strlen(path);
+  return len >= 4 && !strcmp(path + len - 4, ".osu");
+}
+
+/* directories are walked recursively, only the .osu files are kept */
+static int collect(path_list* list, const char* path) {
+#ifdef OSUP_HAS_DIRENT
+  struct stat st;
+  if (!stat(path, &st) && S_ISDIR(st.st_mode)) {
+    DIR* dir = opendir(path);
+    struct dirent* entry;
+    int ok = 1;
+    if (!dir) {
+      fprintf(stderr, "unable to open directory %s\n", path);
+      return 1;
+    }
+    while (ok && (entry = readdir(dir))) {
+      char* child;
+      if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+        continue;
+      }
+      child = malloc(strlen(path) + strlen(entry->d_name) + 2);
+      if (!child) {
+        ok = 0;
+        break;
+      }
+      sprintf(child, "%s/%s", path, entry->d_name);
+      /* lstat, so symlinked directories are not followed, a link back to a
+       * parent would recurse forever */
+      if (!lstat(child, &st) && S_ISDIR(st.st_mode)) {
+        ok = collect(list, child);
+      } else if (is_osu_file(child)) {
+        ok = add_path(list, child);
+      }
+      free(child);
+    }
+    closedir(dir);
+    return ok;
+  }
+#endif
+  return add_path(list, path);
+}
+
+static double wall_seconds() {
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* only the changed files are parsed, the rest comes from the old index */
+static int update_index(const char* indexPath, const path_list* paths,
+                        size_t threadCount) {
+  osup_index old;
+  osup_index_stats stats;
+  char* newPath = malloc(strlen(indexPath) + sizeof(".new"));
+  if (!newPath) return 1;
+  sprintf(newPath, "%s.new", indexPath);
+  double begin = wall_seconds();
+  osup_index_open(&old, indexPath);
+  osup_bool ok =
+      osup_index_update(&old, (const char* const*)paths->elements,
+                        paths->count, newPath, threadCount, &stats);
+  osup_index_close(&old);
+  ok = ok && !rename(newPath, indexPath);
+  double seconds = wall_seconds() - begin;
+  free(newPath);
+  if (!ok) {
+    fprintf(stderr, "unable to write %s\n", indexPath);
+    return 1;
+  }
+  printf("%zu files, %zu reused, %zu rehashed, %zu parsed, %zu failed\n",
+         paths->count, stats.reused, stats.rehashed, stats.parsed,
+         stats.failed);
+  printf("%.3f s, %.0f files/s\n", seconds,
+         seconds > 0.0 ? paths->count / seconds : 0.0);
+  return stats.failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  path_list paths = {0};
+  const char* indexPath = NULL;
+  size_t threadCount = 1;
+  osup_bitfield32 flags = OSUP_PARSE_ALL;
+  int i;
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+      if (!parse_thread_count(argv[++i], &threadCount)) {
+        fprintf(stderr, "invalid thread count %s\n", argv[i]);
+        usage(argv[0]);
+        return 2;
+      }
+    } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+      indexPath = argv[++i];
+    } else if (!strcmp(argv[i], "-a")) {
+      flags |= OSUP_PARSE_ARENA;
+    } else if (!strcmp(argv[i], "-v")) {
+      flags |= OSUP_PARSE_STRING_VIEWS;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else if (!collect(&paths, argv[i])) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+  }
+  if (!paths.count) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (indexPath) {
+    int ret = update_index(indexPath, &paths, threadCount);
+    size_t j;
+    for (j = 0; j < paths.count; j++) free(paths.elements[j]);
+    free(paths.elements);
+    return ret;
+  }
+
+  osup_bm_batch_result* results =
+      malloc(paths.count * sizeof(osup_bm_batch_result));
+  size_t j;
+  if (!results) {
+    fprintf(stderr, "out of memory\n");
+    for (j = 0; j < paths.count; j++) free(paths.elements[j]);
+    free(paths.elements);
+    return 1;
+  }
+  size_t usedThreads;
+  double begin = wall_seconds();
+  size_t loaded =
+      osup_batch_load((const char* const*)paths.elements, paths.count, flags,
+                      results, threadCount, &usedThreads);
+  double seconds = wall_seconds() - begin;
+
+  size_t bytes = 0;
+  for (j = 0; j < paths.count; j++) {
+    bytes += results[j].size;
+    if (!results[j].ok) {
+      fprintf(stderr, "%s: %s\n", paths.elements[j],
+              results[j].error[0] ? results[j].error : "failed");
+    }
+    osup_beatmap_free(&results[j].map);
+    free(paths.elements[j]);
+  }
+  printf("%zu files, %zu loaded, %zu failed, %zu threads\n", paths.count,
+         loaded, paths.count - loaded, usedThreads);
+  printf("%.3f s, %.0f files/s, %.1f MB/s\n", seconds,
+         seconds > 0.0 ? paths.count / seconds : 0.0,
+         seconds > 0.0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0);
+  free(results);
+  free(paths.elements);
+  return loaded == paths.count ? 0 : 1;
+}